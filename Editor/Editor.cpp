@@ -36,12 +36,15 @@ void Editor::Initialize()
 	// otherwise, shaders will be loaded from the working directory
 	wiRenderer::GetShaderPath() = wiHelper::GetOriginalWorkingDirectory() + "../WickedEngine/shaders/";
 	wiFont::GetFontPath() = wiHelper::GetOriginalWorkingDirectory() + "../WickedEngine/fonts/"; // search for fonts elsewhere
+	// Edited files on disk take precedence over the mounted packages:
+	wiVirtualFileSystem::SetLooseFileOverride(true);
 	MainComponent::Initialize();
 
 	infoDisplay.active = true;
 	infoDisplay.watermark = true;
 	infoDisplay.fpsinfo = true;
 	infoDisplay.resolution = true;
+	infoDisplay.resourcememory = true;
 
 	wiRenderer::GetDevice()->SetVSyncEnabled(true);
 	wiRenderer::SetOcclusionCullingEnabled(true);
@@ -410,18 +413,43 @@ void EditorComponent::Load()
 			{
 				fileName += ".wiscene";
 			}
-			wiArchive archive(fileName, false);
-			if (archive.IsOpen())
-			{
-				Scene& scene = wiSceneSystem::GetScene();
+			Scene& scene = wiSceneSystem::GetScene();
+			const std::string patchFileName = wiSceneSystem::GetScenePatchFileName(fileName);
 
-				scene.Serialize(archive);
+			if (deltaSavesCheckBox->GetCheck() && fileName == savedFileName)
+			{
+				// Only the changes since the last full save are written:
+				wiArchive archive(patchFileName, false, compressSavesCheckBox->GetCheck());
+				if (archive.IsOpen())
+				{
+					scene.WritePatch(archive, savedSnapshot);
 
-				ResetHistory();
+					ResetHistory();
+				}
+				else
+				{
+					wiHelper::messageBox("Could not create " + patchFileName + "!");
+				}
 			}
 			else
 			{
-				wiHelper::messageBox("Could not create " + fileName + "!");
+				wiArchive archive(fileName, false, compressSavesCheckBox->GetCheck());
+				if (archive.IsOpen())
+				{
+					scene.Serialize(archive);
+
+					// The full save contains everything, so the old patch is not needed any more:
+					std::remove(patchFileName.c_str());
+					scene.CreateSnapshot(savedSnapshot, archive);
+					savedFileName = fileName;
+					sceneDirectory = wiHelper::GetDirectoryFromPath(fileName);
+
+					ResetHistory();
+				}
+				else
+				{
+					wiHelper::messageBox("Could not create " + fileName + "!");
+				}
 			}
 		}
 	});
@@ -478,6 +506,7 @@ void EditorComponent::Load()
 					}
 				});
 				loader->onFinished([=] {
+					sceneDirectory = wiHelper::GetDirectoryFromPath(fileName);
 					main->ActivatePath(this, 0.2f, wiColor::Black());
 					weatherWnd->UpdateFromRenderer();
 				});
@@ -645,6 +674,89 @@ void EditorComponent::Load()
 	});
 	GetGUI().AddWidget(cinemaModeCheckBox);
 
+	compressSavesCheckBox = new wiCheckBox("Compress Saves: ");
+	compressSavesCheckBox->SetSize(XMFLOAT2(18, 18));
+	compressSavesCheckBox->SetPos(XMFLOAT2(screenW - 25, 116));
+	compressSavesCheckBox->SetTooltip("Save scenes as compressed archives. They will be smaller and they are decompressed in parallel while loading.");
+	compressSavesCheckBox->SetCheck(false);
+	GetGUI().AddWidget(compressSavesCheckBox);
+
+	deltaSavesCheckBox = new wiCheckBox("Delta Saves: ");
+	deltaSavesCheckBox->SetSize(XMFLOAT2(18, 18));
+	deltaSavesCheckBox->SetPos(XMFLOAT2(screenW - 25, 138));
+	deltaSavesCheckBox->SetTooltip("Saving to the same file again writes only the changes since the last full save into a patch file next to the scene. The patch is applied when the scene is loaded. Save with this disabled to fold the patch into the scene file.");
+	deltaSavesCheckBox->SetCheck(false);
+	GetGUI().AddWidget(deltaSavesCheckBox);
+
+	wiButton* cookTexturesButton = new wiButton("Cook Textures");
+	cookTexturesButton->SetTooltip("Convert the textures of the scene materials into block compressed DDS files with mip chains in the background. The cooked textures are used when they are loaded the next time. Textures that didn't change are not cooked again.");
+	cookTexturesButton->SetPos(XMFLOAT2(screenW - 128, 160));
+	cookTexturesButton->SetSize(XMFLOAT2(121, 18));
+	cookTexturesButton->OnClick([&](wiEventArgs args) {
+		static wiJobSystem::context cookingContext;
+		if (wiJobSystem::IsBusy(cookingContext))
+		{
+			return;
+		}
+
+		// The texture names are relative to the scene directory like when the scene is loaded, unless they were set as absolute paths:
+		auto addTexture = [&](std::vector<std::pair<std::string, bool>>& textures, const std::string& name, bool srgb) {
+			if (name.empty())
+			{
+				return;
+			}
+			const bool absolute = name.find(':') != std::string::npos || name[0] == '/' || name[0] == '\\';
+			textures.push_back(std::make_pair(absolute ? name : sceneDirectory + name, srgb));
+		};
+
+		// The color textures are sRGB, their mips are filtered in linear space:
+		std::vector<std::pair<std::string, bool>> textures;
+		const Scene& scene = wiSceneSystem::GetScene();
+		for (size_t i = 0; i < scene.materials.GetCount(); ++i)
+		{
+			const MaterialComponent& material = scene.materials[i];
+			addTexture(textures, material.baseColorMapName, true);
+			addTexture(textures, material.emissiveMapName, true);
+			addTexture(textures, material.surfaceMapName, false);
+			addTexture(textures, material.normalMapName, false);
+			addTexture(textures, material.displacementMapName, false);
+			addTexture(textures, material.occlusionMapName, false);
+		}
+
+		wiJobSystem::Execute(cookingContext, [textures] {
+			int cooked = 0;
+			int upToDate = 0;
+			int failed = 0;
+			for (auto& x : textures)
+			{
+				const std::string extension = wiHelper::toUpper(wiHelper::GetExtensionFromFileName(x.first));
+				if (x.first.empty() || extension == "DDS")
+				{
+					continue;
+				}
+				wiTextureCooker::CookParams params;
+				params.srgb = x.second;
+				switch (wiTextureCooker::Cook(x.first, params))
+				{
+				case wiTextureCooker::RESULT_COOKED:
+					cooked++;
+					break;
+				case wiTextureCooker::RESULT_UP_TO_DATE:
+					upToDate++;
+					break;
+				default:
+					failed++;
+					wiBackLog::post(("Texture cooking failed: " + x.first).c_str());
+					break;
+				}
+			}
+			std::stringstream ss("");
+			ss << "Texture cooking finished: " << cooked << " cooked, " << upToDate << " up to date, " << failed << " failed";
+			wiBackLog::post(ss.str().c_str());
+		});
+	});
+	GetGUI().AddWidget(cookTexturesButton);
+
 
 	wiComboBox* renderPathComboBox = new wiComboBox("Render Path: ");
 	renderPathComboBox->SetSize(XMFLOAT2(100, 20));
@@ -686,17 +798,17 @@ void EditorComponent::Load()
 
 	
 
-	pointLightTex = *(Texture2D*)Content.add("images/pointlight.dds");
-	spotLightTex = *(Texture2D*)Content.add("images/spotlight.dds");
-	dirLightTex = *(Texture2D*)Content.add("images/directional_light.dds");
-	areaLightTex = *(Texture2D*)Content.add("images/arealight.dds");
-	decalTex = *(Texture2D*)Content.add("images/decal.dds");
-	forceFieldTex = *(Texture2D*)Content.add("images/forcefield.dds");
-	emitterTex = *(Texture2D*)Content.add("images/emitter.dds");
-	hairTex = *(Texture2D*)Content.add("images/hair.dds");
-	cameraTex = *(Texture2D*)Content.add("images/camera.dds");
-	armatureTex = *(Texture2D*)Content.add("images/armature.dds");
-	soundTex = *(Texture2D*)Content.add("images/sound.dds");
+	pointLightTex = *(Texture2D*)Content.add(WI_HASHSTRING("images/pointlight.dds"));
+	spotLightTex = *(Texture2D*)Content.add(WI_HASHSTRING("images/spotlight.dds"));
+	dirLightTex = *(Texture2D*)Content.add(WI_HASHSTRING("images/directional_light.dds"));
+	areaLightTex = *(Texture2D*)Content.add(WI_HASHSTRING("images/arealight.dds"));
+	decalTex = *(Texture2D*)Content.add(WI_HASHSTRING("images/decal.dds"));
+	forceFieldTex = *(Texture2D*)Content.add(WI_HASHSTRING("images/forcefield.dds"));
+	emitterTex = *(Texture2D*)Content.add(WI_HASHSTRING("images/emitter.dds"));
+	hairTex = *(Texture2D*)Content.add(WI_HASHSTRING("images/hair.dds"));
+	cameraTex = *(Texture2D*)Content.add(WI_HASHSTRING("images/camera.dds"));
+	armatureTex = *(Texture2D*)Content.add(WI_HASHSTRING("images/armature.dds"));
+	soundTex = *(Texture2D*)Content.add(WI_HASHSTRING("images/sound.dds"));
 }
 void EditorComponent::Start()
 {
@@ -56,6 +56,14 @@ public:
 	Editor*					main = nullptr;
 
 	wiCheckBox*				cinemaModeCheckBox = nullptr;
+	wiCheckBox*				compressSavesCheckBox = nullptr;
+	wiCheckBox*				deltaSavesCheckBox = nullptr;
+
+	// The scene was saved as a base to this file, delta saves write the changes since then into its patch file:
+	std::string						savedFileName;
+	wiSceneSystem::SceneSnapshot	savedSnapshot;
+	// The material texture names are relative to the directory of the last loaded or saved scene file:
+	std::string						sceneDirectory;
 
 	EditorLoadingScreen*	loader = nullptr;
 	RenderPath3D*	renderPath = nullptr;
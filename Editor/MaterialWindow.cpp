@@ -401,7 +401,7 @@ MaterialWindow::MaterialWindow(wiGUI* gui) : GUI(gui)
 
 		if (material->baseColorMap != nullptr)
 		{
-			material->baseColorMap = nullptr;
+			MaterialComponent::ReleaseTexture(material->baseColorMap, material->baseColorMapResource);
 			material->baseColorMapName = "";
 			material->SetDirty();
 			texture_baseColor_Button->SetText("");
@@ -420,7 +420,8 @@ MaterialWindow::MaterialWindow(wiGUI* gui) : GUI(gui)
 
 			if (result.ok) {
 				string fileName = result.filenames.front();
-				material->baseColorMap = (Texture2D*)wiResourceManager::GetGlobal().add(fileName);
+				material->baseColorMapResource = fileName;
+				material->baseColorMap = (Texture2D*)wiResourceManager::GetGlobal().add(material->baseColorMapResource);
 				material->baseColorMapName = fileName;
 				material->SetDirty();
 				fileName = wiHelper::GetFileNameFromPath(fileName);
@@ -463,7 +464,7 @@ MaterialWindow::MaterialWindow(wiGUI* gui) : GUI(gui)
 
 		if (material->normalMap != nullptr)
 		{
-			material->normalMap = nullptr;
+			MaterialComponent::ReleaseTexture(material->normalMap, material->normalMapResource);
 			material->normalMapName = "";
 			material->SetDirty();
 			texture_normal_Button->SetText("");
@@ -482,7 +483,8 @@ MaterialWindow::MaterialWindow(wiGUI* gui) : GUI(gui)
 
 			if (result.ok) {
 				string fileName = result.filenames.front();
-				material->normalMap = (Texture2D*)wiResourceManager::GetGlobal().add(fileName);
+				material->normalMapResource = fileName;
+				material->normalMap = (Texture2D*)wiResourceManager::GetGlobal().add(material->normalMapResource);
 				material->normalMapName = fileName;
 				material->SetDirty();
 				fileName = wiHelper::GetFileNameFromPath(fileName);
@@ -525,7 +527,7 @@ MaterialWindow::MaterialWindow(wiGUI* gui) : GUI(gui)
 
 		if (material->surfaceMap != nullptr)
 		{
-			material->surfaceMap = nullptr;
+			MaterialComponent::ReleaseTexture(material->surfaceMap, material->surfaceMapResource);
 			material->surfaceMapName = "";
 			material->SetDirty();
 			texture_surface_Button->SetText("");
@@ -544,7 +546,8 @@ MaterialWindow::MaterialWindow(wiGUI* gui) : GUI(gui)
 
 			if (result.ok) {
 				string fileName = result.filenames.front();
-				material->surfaceMap = (Texture2D*)wiResourceManager::GetGlobal().add(fileName);
+				material->surfaceMapResource = fileName;
+				material->surfaceMap = (Texture2D*)wiResourceManager::GetGlobal().add(material->surfaceMapResource);
 				material->surfaceMapName = fileName;
 				material->SetDirty();
 				fileName = wiHelper::GetFileNameFromPath(fileName);
@@ -587,7 +590,7 @@ MaterialWindow::MaterialWindow(wiGUI* gui) : GUI(gui)
 
 		if (material->displacementMap != nullptr)
 		{
-			material->displacementMap = nullptr;
+			MaterialComponent::ReleaseTexture(material->displacementMap, material->displacementMapResource);
 			material->displacementMapName = "";
 			material->SetDirty();
 			texture_displacement_Button->SetText("");
@@ -606,7 +609,8 @@ MaterialWindow::MaterialWindow(wiGUI* gui) : GUI(gui)
 
 			if (result.ok) {
 				string fileName = result.filenames.front();
-				material->displacementMap = (Texture2D*)wiResourceManager::GetGlobal().add(fileName);
+				material->displacementMapResource = fileName;
+				material->displacementMap = (Texture2D*)wiResourceManager::GetGlobal().add(material->displacementMapResource);
 				material->displacementMapName = fileName;
 				material->SetDirty();
 				fileName = wiHelper::GetFileNameFromPath(fileName);
@@ -649,7 +653,7 @@ MaterialWindow::MaterialWindow(wiGUI* gui) : GUI(gui)
 
 		if (material->emissiveMap != nullptr)
 		{
-			material->emissiveMap = nullptr;
+			MaterialComponent::ReleaseTexture(material->emissiveMap, material->emissiveMapResource);
 			material->emissiveMapName = "";
 			material->SetDirty();
 			texture_emissive_Button->SetText("");
@@ -668,7 +672,8 @@ MaterialWindow::MaterialWindow(wiGUI* gui) : GUI(gui)
 
 			if (result.ok) {
 				string fileName = result.filenames.front();
-				material->emissiveMap = (Texture2D*)wiResourceManager::GetGlobal().add(fileName);
+				material->emissiveMapResource = fileName;
+				material->emissiveMap = (Texture2D*)wiResourceManager::GetGlobal().add(material->emissiveMapResource);
 				material->emissiveMapName = fileName;
 				material->SetDirty();
 				fileName = wiHelper::GetFileNameFromPath(fileName);
@@ -712,7 +717,7 @@ MaterialWindow::MaterialWindow(wiGUI* gui) : GUI(gui)
 
 		if (material->occlusionMap != nullptr)
 		{
-			material->occlusionMap = nullptr;
+			MaterialComponent::ReleaseTexture(material->occlusionMap, material->occlusionMapResource);
 			material->occlusionMapName = "";
 			material->SetDirty();
 			texture_occlusion_Button->SetText("");
@@ -731,7 +736,8 @@ MaterialWindow::MaterialWindow(wiGUI* gui) : GUI(gui)
 
 			if (result.ok) {
 				string fileName = result.filenames.front();
-				material->occlusionMap = (Texture2D*)wiResourceManager::GetGlobal().add(fileName);
+				material->occlusionMapResource = fileName;
+				material->occlusionMap = (Texture2D*)wiResourceManager::GetGlobal().add(material->occlusionMapResource);
 				material->occlusionMapName = fileName;
 				material->SetDirty();
 				fileName = wiHelper::GetFileNameFromPath(fileName);
@@ -16,7 +16,7 @@ MeshWindow::MeshWindow(wiGUI* gui) : GUI(gui)
 
 
 	meshWindow = new wiWindow(GUI, "Mesh Window");
-	meshWindow->SetSize(XMFLOAT2(800, 700));
+	meshWindow->SetSize(XMFLOAT2(800, 900));
 	meshWindow->SetEnabled(false);
 	GUI->AddWidget(meshWindow);
 
@@ -165,15 +165,21 @@ MeshWindow::MeshWindow(wiGUI* gui) : GUI(gui)
 	});
 	meshWindow->AddWidget(flipNormalsButton);
 
+	smoothingAngleSlider = new wiSlider(0, 180, 180, 180, "Smoothing Angle: ");
+	smoothingAngleSlider->SetTooltip("Faces meeting at a larger angle (in degrees) than this will have a hard edge between them when computing smooth normals.");
+	smoothingAngleSlider->SetSize(XMFLOAT2(100, 30));
+	smoothingAngleSlider->SetPos(XMFLOAT2(x, y += step));
+	meshWindow->AddWidget(smoothingAngleSlider);
+
 	computeNormalsSmoothButton = new wiButton("Compute Normals [SMOOTH]");
-	computeNormalsSmoothButton->SetTooltip("Compute surface normals of the mesh. Resulting normals will be unique per vertex.");
+	computeNormalsSmoothButton->SetTooltip("Compute surface normals of the mesh. Resulting normals will be unique per vertex, except along hard edges.");
 	computeNormalsSmoothButton->SetSize(XMFLOAT2(240, 30));
 	computeNormalsSmoothButton->SetPos(XMFLOAT2(x - 50, y += step));
 	computeNormalsSmoothButton->OnClick([&](wiEventArgs args) {
 		MeshComponent* mesh = wiSceneSystem::GetScene().meshes.GetComponent(entity);
 		if (mesh != nullptr)
 		{
-			mesh->ComputeNormals(true);
+			mesh->ComputeNormals(true, XMConvertToRadians(smoothingAngleSlider->GetValue()));
 			SetEntity(entity);
 		}
 	});
@@ -221,6 +227,55 @@ MeshWindow::MeshWindow(wiGUI* gui) : GUI(gui)
 	});
 	meshWindow->AddWidget(recenterToBottomButton);
 
+	lodCountSlider = new wiSlider(1, 8, 4, 7, "LOD Count: ");
+	lodCountSlider->SetTooltip("Set the number of LOD levels (including the original mesh) that will be generated.");
+	lodCountSlider->SetSize(XMFLOAT2(100, 30));
+	lodCountSlider->SetPos(XMFLOAT2(x, y += step));
+	meshWindow->AddWidget(lodCountSlider);
+
+	lodGenerateButton = new wiButton("Generate LODs");
+	lodGenerateButton->SetTooltip("Generate simplified LOD levels of the mesh. Every LOD level will have half the triangles of the previous one, and they will be selected by the projected screen size of the object.");
+	lodGenerateButton->SetSize(XMFLOAT2(240, 30));
+	lodGenerateButton->SetPos(XMFLOAT2(x - 50, y += step));
+	lodGenerateButton->OnClick([&](wiEventArgs args) {
+		MeshComponent* mesh = wiSceneSystem::GetScene().meshes.GetComponent(entity);
+		if (mesh != nullptr)
+		{
+			mesh->CreateLODs((uint32_t)lodCountSlider->GetValue());
+			SetEntity(entity);
+		}
+	});
+	meshWindow->AddWidget(lodGenerateButton);
+
+	optimizeButton = new wiButton("Optimize");
+	optimizeButton->SetTooltip("Reorder triangles for better vertex cache efficiency and less overdraw, then reorder vertices for better vertex fetch locality. Unused vertices will be removed.");
+	optimizeButton->SetSize(XMFLOAT2(240, 30));
+	optimizeButton->SetPos(XMFLOAT2(x - 50, y += step));
+	optimizeButton->OnClick([&](wiEventArgs args) {
+		Scene& scene = wiSceneSystem::GetScene();
+		MeshComponent* mesh = scene.meshes.GetComponent(entity);
+		if (mesh != nullptr)
+		{
+			mesh->Optimize(scene.softbodies.GetComponent(entity));
+			SetEntity(entity);
+		}
+	});
+	meshWindow->AddWidget(optimizeButton);
+
+	meshletButton = new wiButton("Create Meshlets");
+	meshletButton->SetTooltip("Split the mesh into meshlets (small clusters of triangles) that can be culled individually when meshlet culling is enabled. This reorders triangles inside subsets.");
+	meshletButton->SetSize(XMFLOAT2(240, 30));
+	meshletButton->SetPos(XMFLOAT2(x - 50, y += step));
+	meshletButton->OnClick([&](wiEventArgs args) {
+		MeshComponent* mesh = wiSceneSystem::GetScene().meshes.GetComponent(entity);
+		if (mesh != nullptr)
+		{
+			mesh->CreateMeshlets();
+			SetEntity(entity);
+		}
+	});
+	meshWindow->AddWidget(meshletButton);
+
 
 
 
@@ -255,6 +310,23 @@ void MeshWindow::SetEntity(Entity entity)
 		ss << "Vertex count: " << mesh->vertex_positions.size() << endl;
 		ss << "Index count: " << mesh->indices.size() << endl;
 		ss << "Subset count: " << mesh->subsets.size() << endl;
+		ss << "LOD count: " << mesh->GetLODCount();
+		for (uint32_t lod = 0; lod < mesh->GetLODCount(); ++lod)
+		{
+			uint32_t first_subset = 0;
+			uint32_t last_subset = 0;
+			mesh->GetLODSubsetRange(lod, first_subset, last_subset);
+			uint32_t indexCount = 0;
+			for (uint32_t subsetIndex = first_subset; subsetIndex < last_subset; ++subsetIndex)
+			{
+				indexCount += mesh->subsets[subsetIndex].indexCount;
+			}
+			ss << (lod == 0 ? " (triangles: " : ", ") << indexCount / 3;
+		}
+		ss << ")" << endl;
+		const wiMeshOptimizer::VertexCacheStatistics statistics = wiMeshOptimizer::AnalyzeVertexCache(mesh->indices.data(), mesh->indices.size(), mesh->vertex_positions.size());
+		ss << "Vertex cache: ACMR = " << statistics.ACMR << ", ATVR = " << statistics.ATVR << endl;
+		ss << "Meshlet count: " << mesh->meshlets.size() << endl;
 		ss << endl << "Vertex buffers: ";
 		if (mesh->vertexBuffer_POS != nullptr) ss << "position; ";
 		if (mesh->vertexBuffer_UV0 != nullptr) ss << "uvset_0; ";
@@ -274,6 +346,7 @@ void MeshWindow::SetEntity(Entity entity)
 			impostorDistanceSlider->SetValue(impostor->swapInDistance);
 		}
 		tessellationFactorSlider->SetValue(mesh->GetTessellationFactor());
+		lodCountSlider->SetValue((float)mesh->GetLODCount());
 
 		softbodyCheckBox->SetCheck(false);
 
@@ -29,9 +29,14 @@ public:
 	wiSlider*	tessellationFactorSlider;
 	wiButton*	flipCullingButton;
 	wiButton*	flipNormalsButton;
+	wiSlider*	smoothingAngleSlider;
 	wiButton*	computeNormalsSmoothButton;
 	wiButton*	computeNormalsHardButton;
 	wiButton*	recenterButton;
 	wiButton*	recenterToBottomButton;
+	wiSlider*	lodCountSlider;
+	wiButton*	lodGenerateButton;
+	wiButton*	optimizeButton;
+	wiButton*	meshletButton;
 };
 
@@ -473,15 +473,30 @@ void ImportModel_GLTF(const std::string& fileName, Scene& scene)
 
 		// Retrieve textures by name:
 		if (!material.baseColorMapName.empty())
-			material.baseColorMap = (Texture2D*)wiResourceManager::GetGlobal().add(material.baseColorMapName);
+		{
+			material.baseColorMapResource = material.baseColorMapName;
+			material.baseColorMap = (Texture2D*)wiResourceManager::GetGlobal().add(material.baseColorMapResource);
+		}
 		if (!material.normalMapName.empty())
-			material.normalMap = (Texture2D*)wiResourceManager::GetGlobal().add(material.normalMapName);
+		{
+			material.normalMapResource = material.normalMapName;
+			material.normalMap = (Texture2D*)wiResourceManager::GetGlobal().add(material.normalMapResource);
+		}
 		if (!material.surfaceMapName.empty())
-			material.surfaceMap = (Texture2D*)wiResourceManager::GetGlobal().add(material.surfaceMapName);
+		{
+			material.surfaceMapResource = material.surfaceMapName;
+			material.surfaceMap = (Texture2D*)wiResourceManager::GetGlobal().add(material.surfaceMapResource);
+		}
 		if (!material.emissiveMapName.empty())
-			material.emissiveMap = (Texture2D*)wiResourceManager::GetGlobal().add(material.emissiveMapName);
+		{
+			material.emissiveMapResource = material.emissiveMapName;
+			material.emissiveMap = (Texture2D*)wiResourceManager::GetGlobal().add(material.emissiveMapResource);
+		}
 		if (!material.occlusionMapName.empty())
-			material.occlusionMap = (Texture2D*)wiResourceManager::GetGlobal().add(material.occlusionMapName);
+		{
+			material.occlusionMapResource = material.occlusionMapName;
+			material.occlusionMap = (Texture2D*)wiResourceManager::GetGlobal().add(material.occlusionMapResource);
+		}
 
 	}
 
@@ -690,6 +705,13 @@ void ImportModel_GLTF(const std::string& fileName, Scene& scene)
 
 		}
 
+		// The GPU buffers are only created once, after the processing:
+		mesh.Optimize(nullptr, false);
+		if (mesh.vertex_boneindices.empty())
+		{
+			// The armature is not yet assigned here, but skinned meshes are deformed on the GPU, so the meshlet bounds wouldn't be usable
+			mesh.CreateMeshlets(false);
+		}
 		mesh.CreateRenderData();
 	}
 
@@ -66,19 +66,23 @@ void ImportModel_OBJ(const std::string& fileName, Scene& scene)
 
 			if (!material.surfaceMapName.empty())
 			{
-				material.surfaceMap = (Texture2D*)wiResourceManager::GetGlobal().add(directory + material.surfaceMapName);
+				material.surfaceMapResource = directory + material.surfaceMapName;
+				material.surfaceMap = (Texture2D*)wiResourceManager::GetGlobal().add(material.surfaceMapResource);
 			}
 			if (!material.baseColorMapName.empty())
 			{
-				material.baseColorMap = (Texture2D*)wiResourceManager::GetGlobal().add(directory + material.baseColorMapName);
+				material.baseColorMapResource = directory + material.baseColorMapName;
+				material.baseColorMap = (Texture2D*)wiResourceManager::GetGlobal().add(material.baseColorMapResource);
 			}
 			if (!material.normalMapName.empty())
 			{
-				material.normalMap = (Texture2D*)wiResourceManager::GetGlobal().add(directory + material.normalMapName);
+				material.normalMapResource = directory + material.normalMapName;
+				material.normalMap = (Texture2D*)wiResourceManager::GetGlobal().add(material.normalMapResource);
 			}
 			if (!material.displacementMapName.empty())
 			{
-				material.displacementMap = (Texture2D*)wiResourceManager::GetGlobal().add(directory + material.displacementMapName);
+				material.displacementMapResource = directory + material.displacementMapName;
+				material.displacementMap = (Texture2D*)wiResourceManager::GetGlobal().add(material.displacementMapResource);
 			}
 
 			materialLibrary.push_back(materialEntity); // for subset-indexing...
@@ -181,6 +185,9 @@ void ImportModel_OBJ(const std::string& fileName, Scene& scene)
 					mesh.subsets.back().indexCount++;
 				}
 			}
+			// The GPU buffers are only created once, after the processing:
+			mesh.Optimize(nullptr, false);
+			mesh.CreateMeshlets(false);
 			mesh.CreateRenderData();
 		}
 
@@ -279,6 +279,19 @@ ObjectWindow::ObjectWindow(EditorComponent* editor) : editor(editor)
 	});
 	objectWindow->AddWidget(renderableCheckBox);
 
+	occluderCheckBox = new wiCheckBox("Occluder: ");
+	occluderCheckBox->SetTooltip("The object's mesh will be used to hide other objects with CPU occlusion culling. It should be simple and opaque.");
+	occluderCheckBox->SetPos(XMFLOAT2(x + 130, y));
+	occluderCheckBox->SetCheck(false);
+	occluderCheckBox->OnClick([&](wiEventArgs args) {
+		ObjectComponent* object = wiSceneSystem::GetScene().objects.GetComponent(entity);
+		if (object != nullptr)
+		{
+			object->SetOccluder(args.bValue);
+		}
+	});
+	objectWindow->AddWidget(occluderCheckBox);
+
 	ditherSlider = new wiSlider(0, 1, 0, 1000, "Dither: ");
 	ditherSlider->SetTooltip("Adjust dithered transparency of the object. This disables some optimizations so performance can be affected.");
 	ditherSlider->SetSize(XMFLOAT2(100, 30));
@@ -619,6 +632,7 @@ void ObjectWindow::SetEntity(Entity entity)
 		}
 
 		renderableCheckBox->SetCheck(object->IsRenderable());
+		occluderCheckBox->SetCheck(object->IsOccluder());
 		cascadeMaskSlider->SetValue((float)object->cascadeMask);
 		ditherSlider->SetValue(object->GetTransparency());
 
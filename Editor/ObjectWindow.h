@@ -25,6 +25,7 @@ public:
 
 	wiLabel*	nameLabel;
 	wiCheckBox* renderableCheckBox;
+	wiCheckBox* occluderCheckBox;
 	wiSlider*	ditherSlider;
 	wiSlider*	cascadeMaskSlider;
 	wiColorPicker* colorPicker;
@@ -15,7 +15,7 @@ RendererWindow::RendererWindow(wiGUI* gui, RenderPath3D* path) : GUI(gui)
 	wiRenderer::SetToDrawDebugCameras(true);
 
 	rendererWindow = new wiWindow(GUI, "Renderer Window");
-	rendererWindow->SetSize(XMFLOAT2(640, 790));
+	rendererWindow->SetSize(XMFLOAT2(640, 820));
 	rendererWindow->SetEnabled(true);
 	GUI->AddWidget(rendererWindow);
 
@@ -41,6 +41,37 @@ RendererWindow::RendererWindow(wiGUI* gui, RenderPath3D* path) : GUI(gui)
 	occlusionCullingCheckBox->SetCheck(wiRenderer::GetOcclusionCullingEnabled());
 	rendererWindow->AddWidget(occlusionCullingCheckBox);
 
+	cpuOcclusionCullingCheckBox = new wiCheckBox("CPU: ");
+	cpuOcclusionCullingCheckBox->SetTooltip("Toggle CPU occlusion culling. Objects marked as occluders will be rasterized on the CPU to hide objects behind them, without latency.");
+	cpuOcclusionCullingCheckBox->SetScriptTip("SetCPUOcclusionCullingEnabled(bool enabled)");
+	cpuOcclusionCullingCheckBox->SetPos(XMFLOAT2(x + 130, y));
+	cpuOcclusionCullingCheckBox->OnClick([](wiEventArgs args) {
+		wiRenderer::SetCPUOcclusionCullingEnabled(args.bValue);
+	});
+	cpuOcclusionCullingCheckBox->SetCheck(wiRenderer::GetCPUOcclusionCullingEnabled());
+	rendererWindow->AddWidget(cpuOcclusionCullingCheckBox);
+
+	meshletCullingCheckBox = new wiCheckBox("Meshlets: ");
+	meshletCullingCheckBox->SetTooltip("Toggle meshlet culling. Meshlets of meshes will be frustum and backface culled on the CPU, if the mesh has meshlets.");
+	meshletCullingCheckBox->SetScriptTip("SetMeshletCullingEnabled(bool enabled)");
+	meshletCullingCheckBox->SetPos(XMFLOAT2(x + 230, y));
+	meshletCullingCheckBox->OnClick([](wiEventArgs args) {
+		wiRenderer::SetMeshletCullingEnabled(args.bValue);
+	});
+	meshletCullingCheckBox->SetCheck(wiRenderer::GetMeshletCullingEnabled());
+	rendererWindow->AddWidget(meshletCullingCheckBox);
+
+	lodBiasSlider = new wiSlider(-4, 4, 0, 80, "LOD Bias: ");
+	lodBiasSlider->SetTooltip("Bias the selected LOD level of objects. Positive values switch to lower detail LODs closer to the camera.");
+	lodBiasSlider->SetScriptTip("SetLODBias(float value)");
+	lodBiasSlider->SetSize(XMFLOAT2(100, 30));
+	lodBiasSlider->SetPos(XMFLOAT2(x, y += 30));
+	lodBiasSlider->SetValue(wiRenderer::GetLODBias());
+	lodBiasSlider->OnSlide([&](wiEventArgs args) {
+		wiRenderer::SetLODBias(args.fValue);
+	});
+	rendererWindow->AddWidget(lodBiasSlider);
+
 	resolutionScaleSlider = new wiSlider(0.25f, 2.0f, 1.0f, 7.0f, "Resolution Scale: ");
 	resolutionScaleSlider->SetTooltip("Adjust the internal rendering resolution.");
 	resolutionScaleSlider->SetSize(XMFLOAT2(100, 30));
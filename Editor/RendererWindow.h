@@ -33,6 +33,9 @@ public:
 	wiWindow*	rendererWindow;
 	wiCheckBox* vsyncCheckBox;
 	wiCheckBox* occlusionCullingCheckBox;
+	wiCheckBox* cpuOcclusionCullingCheckBox;
+	wiCheckBox* meshletCullingCheckBox;
+	wiSlider*	lodBiasSlider;
 	wiSlider*	resolutionScaleSlider;
 	wiSlider*	gammaSlider;
 	wiCheckBox* voxelRadianceCheckBox;
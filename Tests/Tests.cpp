@@ -4,6 +4,9 @@
 #include <string>
 #include <sstream>
 #include <fstream>
+#include <thread>
+#include <functional>
+#include <algorithm>
 
 using namespace wiSceneSystem;
 
@@ -110,6 +113,17 @@ TestsRenderer::TestsRenderer()
 	testSelector->AddItem("Sprite Test");
 	testSelector->AddItem("Lightmap Bake Test");
 	testSelector->AddItem("Network Test");
+	testSelector->AddItem("Meshlet Test");
+	testSelector->AddItem("Compression Test");
+	testSelector->AddItem("Scene Loading Test");
+	testSelector->AddItem("Async Loading Test");
+	testSelector->AddItem("Duplication Test");
+	testSelector->AddItem("Texture Loading Test");
+	testSelector->AddItem("Resource Contention Test");
+	testSelector->AddItem("Package Test");
+	testSelector->AddItem("Benchmark");
+	testSelector->AddItem("Occlusion Test");
+	testSelector->AddItem("Resource Budget Test");
 	testSelector->SetMaxVisibleItemCount(100);
 	testSelector->OnSelect([=](wiEventArgs args) {
 
@@ -117,11 +131,13 @@ TestsRenderer::TestsRenderer()
 		wiRenderer::GetDevice()->SetVSyncEnabled(true);
 		wiRenderer::SetToDrawGridHelper(false);
 		wiRenderer::SetTemporalAAEnabled(false);
+		wiRenderer::SetMeshletCullingEnabled(false);
 		wiRenderer::ClearWorld();
 		wiSceneSystem::GetScene().weather = WeatherComponent();
 		this->clearSprites();
 		this->clearFonts();
 		wiLua::GetGlobal()->KillProcesses();
+		benchmarkFrames = 0;
 
 		// Reset camera position:
 		TransformComponent transform;
@@ -203,13 +219,47 @@ TestsRenderer::TestsRenderer()
 		case 15:
 			RunNetworkTest();
 			break;
+		case 16:
+			RunMeshletTest();
+			break;
+		case 17:
+			RunCompressionTest();
+			break;
+		case 18:
+			RunSceneLoadingTest();
+			break;
+		case 19:
+			RunAsyncLoadingTest();
+			break;
+		case 20:
+			RunDuplicationTest();
+			break;
+		case 21:
+			RunTextureLoadingTest();
+			break;
+		case 22:
+			RunResourceContentionTest();
+			break;
+		case 23:
+			RunPackageTest();
+			break;
+		case 24:
+			RunBenchmark();
+			break;
+		case 25:
+			RunOcclusionTest();
+			break;
+		case 26:
+			RunResourceBudgetTest();
+			break;
 		default:
 			assert(0);
 			break;
 		}
 
 	});
-	testSelector->SetSelected(0);
+	// The benchmark can be started from the command line: Tests.exe benchmark
+	testSelector->SetSelected(wiStartupArguments::HasArgument("benchmark") ? 24 : 0);
 	GetGUI().AddWidget(testSelector);
 
 }
@@ -289,6 +339,1202 @@ void TestsRenderer::RunJobSystemTest()
 	font.params.size = 24;
 	this->addFont(&font);
 }
+void TestsRenderer::RunMeshletTest()
+{
+	wiRenderer::SetTemporalAAEnabled(true);
+	wiRenderer::SetMeshletCullingEnabled(true);
+	wiSceneSystem::LoadModel("../models/teapot.wiscene");
+
+	// This will split every mesh of the models into meshlets, then check that the meshlets are valid and that the result is deterministic
+	//	The teapot is loaded into the global scene so that the meshlet culling can be seen, the other models are loaded into temporary scenes
+	std::stringstream ss("");
+	ss << "Meshlet test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunMeshletTest() function." << std::endl << std::endl;
+
+	auto equalMeshlets = [](const MeshComponent::Meshlet& a, const MeshComponent::Meshlet& b) {
+		return
+			a.subsetIndex == b.subsetIndex &&
+			a.indexOffset == b.indexOffset &&
+			a.triangleCount == b.triangleCount &&
+			a.vertexCount == b.vertexCount &&
+			a.center.x == b.center.x && a.center.y == b.center.y && a.center.z == b.center.z &&
+			a.radius == b.radius &&
+			a.coneAxis.x == b.coneAxis.x && a.coneAxis.y == b.coneAxis.y && a.coneAxis.z == b.coneAxis.z &&
+			a.coneCutoff == b.coneCutoff;
+	};
+
+	wiTimer timer;
+	size_t meshletCount = 0;
+	size_t triangleCount = 0;
+	size_t vertexCount = 0;
+	bool valid = true;
+	bool deterministic = true;
+	auto testScene = [&](Scene& scene, const std::string& fileName) {
+		size_t sceneMeshletCount = 0;
+		double time = 0;
+		for (size_t i = 0; i < scene.meshes.GetCount(); ++i)
+		{
+			MeshComponent& mesh = scene.meshes[i];
+			const std::vector<uint32_t> originalIndices = mesh.indices;
+
+			timer.record();
+			mesh.CreateMeshlets();
+			time += timer.elapsed();
+
+			size_t meshTriangleCount = 0;
+			for (auto& meshlet : mesh.meshlets)
+			{
+				valid &= meshlet.triangleCount > 0 && meshlet.triangleCount <= 124 && meshlet.vertexCount <= 64;
+				meshTriangleCount += meshlet.triangleCount;
+				vertexCount += meshlet.vertexCount;
+			}
+			valid &= meshTriangleCount * 3 == mesh.indices.size();
+			sceneMeshletCount += mesh.meshlets.size();
+			triangleCount += meshTriangleCount;
+
+			// Building meshlets again from the same input must give exactly the same meshlets and index order:
+			const std::vector<uint32_t> indices = mesh.indices;
+			const std::vector<MeshComponent::Meshlet> meshlets = mesh.meshlets;
+			mesh.indices = originalIndices;
+			mesh.CreateMeshlets();
+			deterministic &= indices == mesh.indices && std::equal(meshlets.begin(), meshlets.end(), mesh.meshlets.begin(), mesh.meshlets.end(), equalMeshlets);
+		}
+		meshletCount += sceneMeshletCount;
+		ss << wiHelper::GetFileNameFromPath(fileName) << ": " << scene.meshes.GetCount() << " meshes, " << sceneMeshletCount << " meshlets created in " << time << " milliseconds" << std::endl;
+	};
+
+	testScene(wiSceneSystem::GetScene(), "../models/teapot.wiscene");
+
+	std::vector<std::string> directoryFiles;
+	wiHelper::GetFilesInDirectory(directoryFiles, "../models");
+	for (auto& x : directoryFiles)
+	{
+		if (wiHelper::toUpper(wiHelper::GetExtensionFromFileName(x)) != "WISCENE" || wiHelper::GetFileNameFromPath(x) == "teapot.wiscene")
+		{
+			continue;
+		}
+		Scene scene;
+		wiSceneSystem::LoadModel(scene, x);
+		testScene(scene, x);
+	}
+
+	ss << std::endl;
+	if (meshletCount > 0)
+	{
+		ss << "Average triangles per meshlet: " << (float)triangleCount / meshletCount << std::endl;
+		ss << "Average vertices per meshlet: " << (float)vertexCount / meshletCount << std::endl;
+	}
+	ss << "Meshlet limits and triangle coverage: " << (valid ? "OK" : "FAILED") << std::endl;
+	ss << "Deterministic: " << (deterministic ? "OK" : "FAILED") << std::endl;
+	ss << "Meshlet culling is enabled, you can toggle it with wiRenderer::SetMeshletCullingEnabled()" << std::endl;
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = 10;
+	font.params.posY = 10;
+	font.params.size = 20;
+	this->addFont(&font);
+}
+void TestsRenderer::RunOcclusionTest()
+{
+	std::stringstream ss("");
+	ss << "Occlusion test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunOcclusionTest() function." << std::endl << std::endl;
+
+	// The camera is looking at a 4x4 quad occluder at the origin from 5 units away:
+	CameraComponent camera;
+	camera.CreatePerspective((float)wiRenderer::GetDevice()->GetScreenWidth(), (float)wiRenderer::GetDevice()->GetScreenHeight(), 0.1f, 800);
+	TransformComponent transform;
+	transform.Translate(XMFLOAT3(0, 0, -5));
+	transform.UpdateTransform();
+	camera.TransformCamera(transform);
+	camera.UpdateCamera();
+
+	const XMFLOAT3 positions[] = {
+		XMFLOAT3(-2, -2, 0),
+		XMFLOAT3(2, -2, 0),
+		XMFLOAT3(2, 2, 0),
+		XMFLOAT3(-2, 2, 0),
+	};
+	const uint32_t indices[] = { 0, 1, 2, 0, 2, 3 };
+
+	static wiOcclusionCuller culler; // it holds the depth buffer, so it's not put on the stack
+	wiTimer timer;
+	culler.Clear(camera.VP);
+	culler.AddOccluder(positions, 4, indices, 6, IDENTITYMATRIX);
+	wiJobSystem::context ctx;
+	culler.Rasterize(ctx);
+	wiJobSystem::Wait(ctx);
+	ss << "Rasterized " << culler.GetTriangleCount() << " occluder triangles in " << timer.elapsed() << " milliseconds" << std::endl << std::endl;
+
+	struct OcclusionTestCase
+	{
+		const char* name;
+		AABB aabb;
+		bool visible;
+	};
+	const OcclusionTestCase testCases[] = {
+		{ "Box behind the occluder", AABB(XMFLOAT3(-0.5f, -0.5f, 2), XMFLOAT3(0.5f, 0.5f, 3)), false },
+		{ "Box behind the occluder near its edge", AABB(XMFLOAT3(1, 1, 1), XMFLOAT3(2, 2, 2)), false },
+		{ "Box beside the occluder", AABB(XMFLOAT3(4, -0.5f, 2), XMFLOAT3(5, 0.5f, 3)), true },
+		{ "Box partially behind the occluder", AABB(XMFLOAT3(1.5f, -0.5f, 2), XMFLOAT3(3.5f, 0.5f, 3)), true },
+		{ "Box in front of the occluder", AABB(XMFLOAT3(-0.5f, -0.5f, -2), XMFLOAT3(0.5f, 0.5f, -1)), true },
+		{ "Box intersecting the occluder", AABB(XMFLOAT3(-0.5f, -0.5f, -0.5f), XMFLOAT3(0.5f, 0.5f, 0.5f)), true },
+	};
+	bool passed = true;
+	for (auto& x : testCases)
+	{
+		const bool visible = culler.IsVisible(x.aabb);
+		const bool ok = visible == x.visible;
+		ss << x.name << ": " << (visible ? "visible" : "hidden") << (ok ? " OK" : " FAILED") << std::endl;
+		passed &= ok;
+	}
+	ss << std::endl << "Occlusion culling: " << (passed ? "OK" : "FAILED") << std::endl;
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->addFont(&font);
+}
+void TestsRenderer::RunCompressionTest()
+{
+	wiTimer timer;
+
+	std::stringstream ss("");
+	ss << "Compression test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunCompressionTest() function." << std::endl << std::endl;
+
+	// 1) Compress the model files in chunks with wiCompression, then decompress and compare them with the original:
+	ss << "1) Codec round trip test:" << std::endl;
+	const char* fileNames[] = {
+		"../models/teapot.wiscene",
+		"../models/emitter_skinned.wiscene",
+		"../models/cloth_test.wiscene",
+		"../models/lightmap_bake_test.wiscene",
+	};
+	const size_t chunkSize = 1024 * 1024;
+	for (auto& fileName : fileNames)
+	{
+		std::vector<uint8_t> data;
+		if (!wiHelper::readByteData(fileName, data))
+		{
+			continue;
+		}
+
+		std::vector<uint8_t> compressed(wiCompression::CompressBound(chunkSize));
+		std::vector<uint8_t> decompressed(chunkSize);
+		size_t compressedSize = 0;
+		double compressTime = 0;
+		double decompressTime = 0;
+		bool valid = true;
+		for (size_t offset = 0; offset < data.size(); offset += chunkSize)
+		{
+			const size_t size = std::min(chunkSize, data.size() - offset);
+
+			timer.record();
+			const size_t chunkCompressedSize = wiCompression::Compress(data.data() + offset, size, compressed.data(), compressed.size());
+			compressTime += timer.elapsed();
+
+			timer.record();
+			valid &= wiCompression::Decompress(compressed.data(), chunkCompressedSize, decompressed.data(), size);
+			decompressTime += timer.elapsed();
+
+			valid &= memcmp(decompressed.data(), data.data() + offset, size) == 0;
+			compressedSize += chunkCompressedSize;
+		}
+
+		const double megabytes = (double)data.size() / (1024.0 * 1024.0);
+		ss << wiHelper::GetFileNameFromPath(fileName) << ": " << data.size() << " -> " << compressedSize << " bytes";
+		ss << ", compress: " << megabytes / (compressTime / 1000.0) << " MB/s";
+		ss << ", decompress: " << megabytes / (decompressTime / 1000.0) << " MB/s";
+		ss << ", round trip: " << (valid ? "OK" : "FAILED") << std::endl;
+	}
+
+	// 2) Save a scene as raw and compressed archive, then compare their loading times:
+	ss << std::endl << "2) Archive test:" << std::endl;
+	{
+		Scene scene;
+		LoadModel(scene, "../models/lightmap_bake_test.wiscene");
+
+		const std::string rawFileName = "compression_test_raw.wiscene";
+		const std::string compressedFileName = "compression_test_compressed.wiscene";
+		{
+			wiArchive archive(rawFileName, false);
+			scene.Serialize(archive);
+		}
+		{
+			wiArchive archive(compressedFileName, false, true);
+			scene.Serialize(archive);
+		}
+
+		std::vector<uint8_t> rawData, compressedData;
+		wiHelper::readByteData(rawFileName, rawData);
+		wiHelper::readByteData(compressedFileName, compressedData);
+		ss << "File size: raw = " << rawData.size() << " bytes, compressed = " << compressedData.size() << " bytes" << std::endl;
+
+		Scene rawScene;
+		timer.record();
+		LoadModel(rawScene, rawFileName);
+		ss << "LoadModel() raw took " << timer.elapsed() << " milliseconds" << std::endl;
+
+		Scene compressedScene;
+		timer.record();
+		LoadModel(compressedScene, compressedFileName);
+		ss << "LoadModel() compressed took " << timer.elapsed() << " milliseconds" << std::endl;
+
+		ss << "Loaded meshes match: " << (rawScene.meshes.GetCount() == compressedScene.meshes.GetCount() ? "OK" : "FAILED") << std::endl;
+	}
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 20;
+	this->addFont(&font);
+}
+void TestsRenderer::RunSceneLoadingTest()
+{
+	wiTimer timer;
+
+	std::stringstream ss("");
+	ss << "Scene loading test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunSceneLoadingTest() function." << std::endl << std::endl;
+
+	// The test models are merged into one scene, and saved in the current archive version, so it will be loaded in parallel by sections:
+	const std::string fileName = "scene_loading_test.wiscene";
+	{
+		Scene scene;
+		LoadModel(scene, "../models/teapot.wiscene");
+		LoadModel(scene, "../models/emitter_skinned.wiscene", XMMatrixTranslation(10, 0, 0));
+		LoadModel(scene, "../models/cloth_test.wiscene", XMMatrixTranslation(20, 0, 0));
+		LoadModel(scene, "../models/shadows_test.wiscene", XMMatrixTranslation(30, 0, 0));
+		LoadModel(scene, "../models/volumetric_test.wiscene", XMMatrixTranslation(40, 0, 0));
+		LoadModel(scene, "../models/lightmap_bake_test.wiscene", XMMatrixTranslation(50, 0, 0));
+
+		wiArchive archive(fileName, false);
+		scene.Serialize(archive);
+	}
+
+	// Deserialization is measured with every possible number of worker threads (the loading thread also works):
+	const uint32_t threadCount = wiJobSystem::GetThreadCount();
+	for (uint32_t activeThreadCount = 0; activeThreadCount <= threadCount; ++activeThreadCount)
+	{
+		wiJobSystem::SetActiveThreadCount(activeThreadCount);
+
+		const int repeatCount = 4;
+		double time = 0;
+		for (int i = 0; i < repeatCount; ++i)
+		{
+			Scene scene;
+			timer.record();
+			wiArchive archive(fileName);
+			scene.Serialize(archive);
+			time += timer.elapsed();
+		}
+		ss << activeThreadCount + 1 << " threads: " << time / repeatCount << " milliseconds" << std::endl;
+	}
+	wiJobSystem::SetActiveThreadCount(threadCount);
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->addFont(&font);
+}
+void TestsRenderer::RunAsyncLoadingTest()
+{
+	wiTimer timer;
+
+	std::stringstream ss("");
+	ss << "Async loading test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunAsyncLoadingTest() function." << std::endl << std::endl;
+
+	// This test doesn't depend on rendering frames, the loading is waited for here and the models are merged manually
+	const std::string fileName = "../models/emitter_skinned.wiscene";
+	Scene& scene = wiSceneSystem::GetScene();
+
+	// 1) Reference: blocking load
+	size_t referenceObjectCount = 0;
+	{
+		Scene referenceScene;
+		timer.record();
+		LoadModel(referenceScene, fileName);
+		ss << "1) LoadModel() blocked for " << timer.elapsed() << " milliseconds" << std::endl;
+		referenceObjectCount = referenceScene.objects.GetCount();
+	}
+
+	// 2) Asynchronous load, the main thread is only blocked by starting the task and the merge
+	{
+		const size_t objectCountBefore = scene.objects.GetCount();
+
+		timer.record();
+		auto task = LoadModelAsync(fileName);
+		double blockedTime = timer.elapsed();
+
+		int progressSteps = 0;
+		float progress = 0;
+		while (!task->IsFinished())
+		{
+			if (task->GetProgress() != progress)
+			{
+				progress = task->GetProgress();
+				progressSteps++;
+			}
+			std::this_thread::yield(); // a game would render frames here
+		}
+
+		const bool mergedEarly = task->IsMerged();
+		timer.record();
+		MergeLoadedModels();
+		blockedTime += timer.elapsed();
+
+		const bool valid = !mergedEarly && task->IsMerged() && task->GetProgress() == 1 && scene.objects.GetCount() - objectCountBefore == referenceObjectCount;
+		ss << "2) LoadModelAsync() blocked for " << blockedTime << " milliseconds, progress changes observed: " << progressSteps << ", result: " << (valid ? "OK" : "FAILED") << std::endl;
+	}
+
+	// 3) Cancelled load must not modify the global scene
+	{
+		const size_t objectCountBefore = scene.objects.GetCount();
+
+		auto task = LoadModelAsync(fileName);
+		task->Cancel();
+		wiJobSystem::Wait(task->ctx);
+		MergeLoadedModels();
+
+		const bool valid = task->IsFinished() && task->IsCancelled() && !task->IsMerged() && scene.objects.GetCount() == objectCountBefore;
+		ss << "3) Cancelled LoadModelAsync() result: " << (valid ? "OK" : "FAILED") << std::endl;
+	}
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->addFont(&font);
+}
+void TestsRenderer::RunDuplicationTest()
+{
+	wiTimer timer;
+
+	std::stringstream ss("");
+	ss << "Entity duplication test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunDuplicationTest() function." << std::endl << std::endl;
+
+	// The duplicates are created in a separate scene, so they won't be rendered
+	Scene scene;
+	LoadModel(scene, "../models/emitter_skinned.wiscene");
+	if (scene.objects.GetCount() == 0)
+	{
+		ss << "The test model could not be loaded!" << std::endl;
+	}
+	else
+	{
+		const wiECS::Entity entity = scene.objects.GetEntity(0);
+		const size_t count = 10000;
+
+		// 1) Reference: write the entity to an archive and read it back for every copy
+		{
+			const size_t objectCountBefore = scene.objects.GetCount();
+			timer.record();
+			for (size_t i = 0; i < count; ++i)
+			{
+				wiArchive archive;
+				archive.SetReadModeAndResetPos(false);
+				scene.Entity_Serialize(archive, entity, 0);
+				archive.SetReadModeAndResetPos(true);
+				scene.Entity_Serialize(archive, entity, wiRandom::getRandom(1, INT_MAX), false);
+			}
+			const bool valid = scene.objects.GetCount() - objectCountBefore == count;
+			ss << "1) Archive round-trip: " << count << " copies in " << timer.elapsed() << " milliseconds, result: " << (valid ? "OK" : "FAILED") << std::endl;
+		}
+
+		// 2) Direct component copies, one entity at a time
+		{
+			const size_t objectCountBefore = scene.objects.GetCount();
+			timer.record();
+			for (size_t i = 0; i < count; ++i)
+			{
+				scene.Entity_Duplicate(entity);
+			}
+			const bool valid = scene.objects.GetCount() - objectCountBefore == count;
+			ss << "2) Entity_Duplicate(): " << count << " copies in " << timer.elapsed() << " milliseconds, result: " << (valid ? "OK" : "FAILED") << std::endl;
+		}
+
+		// 3) Direct component copies in a batch, memory is reserved once per component manager
+		{
+			const size_t objectCountBefore = scene.objects.GetCount();
+			std::vector<wiECS::Entity> clones;
+			timer.record();
+			scene.Entity_Duplicate(entity, count, clones);
+			const double elapsed = timer.elapsed();
+
+			bool valid = clones.size() == count && scene.objects.GetCount() - objectCountBefore == count;
+			const ObjectComponent& source = *scene.objects.GetComponent(entity);
+			for (auto& clone : clones)
+			{
+				const ObjectComponent* object = scene.objects.GetComponent(clone);
+				valid = valid && object != nullptr && object->meshID == source.meshID && scene.transforms.Contains(clone);
+			}
+			ss << "3) Batched Entity_Duplicate(): " << count << " copies in " << elapsed << " milliseconds, result: " << (valid ? "OK" : "FAILED") << std::endl;
+		}
+	}
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->addFont(&font);
+}
+void TestsRenderer::RunTextureLoadingTest()
+{
+	wiTimer timer;
+
+	std::stringstream ss("");
+	ss << "Texture loading test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunTextureLoadingTest() function." << std::endl << std::endl;
+
+	// Create the test images first, they are all different so that none of them are shared:
+	const int textureCount = 256;
+	const uint32_t resolution = 256;
+	std::vector<std::string> fileNames(textureCount);
+	{
+		wiGraphics::TextureDesc desc;
+		desc.Width = resolution;
+		desc.Height = resolution;
+		desc.Format = wiGraphics::FORMAT_R8G8B8A8_UNORM;
+		std::vector<uint8_t> data(resolution * resolution * 4);
+		for (int i = 0; i < textureCount; ++i)
+		{
+			for (size_t j = 0; j < data.size(); ++j)
+			{
+				data[j] = (uint8_t)(j * 7 + i * 13);
+			}
+			fileNames[i] = "texture_loading_test_" + std::to_string(i) + ".png";
+			wiHelper::saveTextureToFile(data, desc, fileNames[i]);
+		}
+	}
+
+	wiResourceManager& resourceManager = wiResourceManager::GetGlobal();
+	const int half = textureCount / 2;
+
+	// 1) Reference: the first half is loaded on this thread
+	{
+		timer.record();
+		for (int i = 0; i < half; ++i)
+		{
+			resourceManager.add(fileNames[i]);
+		}
+		ss << "1) add(): " << half << " textures blocked for " << timer.elapsed() << " milliseconds" << std::endl;
+	}
+
+	// 2) The second half is loaded in the background, only the placeholder creation blocks
+	{
+		int successCount = 0;
+		timer.record();
+		for (int i = half; i < textureCount; ++i)
+		{
+			resourceManager.addAsync(fileNames[i], [&](bool success) {
+				if (success)
+				{
+					successCount++;
+				}
+			});
+		}
+		const double blockedTime = timer.elapsed();
+
+		bool readyEarly = true;
+		for (int i = half; i < textureCount; ++i)
+		{
+			readyEarly = readyEarly && resourceManager.IsReady(fileNames[i]);
+		}
+
+		// A game would render frames here, the textures are swapped in at the frame boundaries:
+		while (resourceManager.IsLoading())
+		{
+			resourceManager.FinishLoading();
+			std::this_thread::yield();
+		}
+		const double totalTime = timer.elapsed();
+
+		bool ready = true;
+		for (int i = half; i < textureCount; ++i)
+		{
+			ready = ready && resourceManager.IsReady(fileNames[i]);
+		}
+
+		const bool valid = !readyEarly && ready && successCount == textureCount - half;
+		ss << "2) addAsync(): " << textureCount - half << " textures blocked for " << blockedTime << " milliseconds, finished loading in " << totalTime << " milliseconds, result: " << (valid ? "OK" : "FAILED") << std::endl;
+	}
+
+	wiRenderer::GetDevice()->WaitForGPU();
+	for (auto& x : fileNames)
+	{
+		resourceManager.del(x);
+		std::remove(x.c_str());
+	}
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->addFont(&font);
+}
+void TestsRenderer::RunResourceContentionTest()
+{
+	wiTimer timer;
+
+	std::stringstream ss("");
+	ss << "Resource manager contention test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunResourceContentionTest() function." << std::endl << std::endl;
+
+	// A few textures that are shared by many materials:
+	const int textureCount = 16;
+	const uint32_t resolution = 512;
+	std::vector<std::string> fileNames(textureCount);
+	{
+		wiGraphics::TextureDesc desc;
+		desc.Width = resolution;
+		desc.Height = resolution;
+		desc.Format = wiGraphics::FORMAT_R8G8B8A8_UNORM;
+		std::vector<uint8_t> data(resolution * resolution * 4);
+		for (int i = 0; i < textureCount; ++i)
+		{
+			for (size_t j = 0; j < data.size(); ++j)
+			{
+				data[j] = (uint8_t)(j * 5 + i * 11);
+			}
+			fileNames[i] = "resource_contention_test_" + std::to_string(i) + ".png";
+			wiHelper::saveTextureToFile(data, desc, fileNames[i]);
+		}
+	}
+
+	wiResourceManager& resourceManager = wiResourceManager::GetGlobal();
+	wiJobSystem::context ctx;
+
+	// 1) Parallel material loading: every material requests 4 textures at the same time, every texture must be loaded only once
+	{
+		const uint32_t materialCount = 256;
+		const uint32_t mapCount = 4;
+		std::vector<const void*> results(materialCount * mapCount);
+		timer.record();
+		wiJobSystem::Dispatch(ctx, materialCount, 1, [&](wiJobDispatchArgs args) {
+			for (uint32_t map = 0; map < mapCount; ++map)
+			{
+				const uint32_t index = args.jobIndex * mapCount + map;
+				results[index] = resourceManager.add(fileNames[index % textureCount]);
+			}
+		});
+		wiJobSystem::Wait(ctx);
+		const double elapsed = timer.elapsed();
+
+		bool valid = true;
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			valid = valid && results[i] != nullptr && results[i] == results[i % textureCount];
+		}
+		for (int i = 0; i < textureCount; ++i)
+		{
+			valid = valid && resourceManager.get(fileNames[i]).refCount == long(results.size() / textureCount);
+		}
+		ss << "1) " << materialCount << " materials loaded " << results.size() << " textures on " << wiJobSystem::GetThreadCount() << " threads in " << elapsed << " milliseconds, result: " << (valid ? "OK" : "FAILED") << std::endl;
+	}
+
+	// 2) Lookups of loaded resources from all threads, compared with the same lookups serialized by a single lock
+	{
+		const uint32_t lookupCount = 1000000;
+		std::vector<wiHashString> names(fileNames.begin(), fileNames.end());
+
+		std::mutex singleLock;
+		timer.record();
+		wiJobSystem::Dispatch(ctx, lookupCount, 1000, [&](wiJobDispatchArgs args) {
+			std::lock_guard<std::mutex> lck(singleLock);
+			resourceManager.get(names[args.jobIndex % textureCount]);
+		});
+		wiJobSystem::Wait(ctx);
+		ss << "2) " << lookupCount << " lookups with a single lock: " << timer.elapsed() << " milliseconds" << std::endl;
+
+		timer.record();
+		wiJobSystem::Dispatch(ctx, lookupCount, 1000, [&](wiJobDispatchArgs args) {
+			resourceManager.get(names[args.jobIndex % textureCount]);
+		});
+		wiJobSystem::Wait(ctx);
+		ss << "   " << lookupCount << " lookups with sharded reader locks: " << timer.elapsed() << " milliseconds" << std::endl;
+	}
+
+	wiRenderer::GetDevice()->WaitForGPU();
+	for (auto& x : fileNames)
+	{
+		resourceManager.del(x, true);
+		std::remove(x.c_str());
+	}
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->addFont(&font);
+}
+void TestsRenderer::RunResourceBudgetTest()
+{
+	std::stringstream ss("");
+	ss << "Resource budget test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunResourceBudgetTest() function." << std::endl << std::endl;
+
+	// Textures that are only referenced by the materials of the test level:
+	const int textureCount = 8;
+	const uint32_t resolution = 512;
+	std::vector<std::string> fileNames(textureCount);
+	{
+		wiGraphics::TextureDesc desc;
+		desc.Width = resolution;
+		desc.Height = resolution;
+		desc.Format = wiGraphics::FORMAT_R8G8B8A8_UNORM;
+		std::vector<uint8_t> data(resolution * resolution * 4);
+		for (int i = 0; i < textureCount; ++i)
+		{
+			for (size_t j = 0; j < data.size(); ++j)
+			{
+				data[j] = (uint8_t)(j * 3 + i * 17);
+			}
+			fileNames[i] = "resource_budget_test_" + std::to_string(i) + ".png";
+			wiHelper::saveTextureToFile(data, desc, fileNames[i]);
+		}
+	}
+
+	// The level has a material for every texture, and it is saved, so it is loaded like a scene file:
+	const std::string fileName = "resource_budget_test.wiscene";
+	{
+		Scene scene;
+		for (int i = 0; i < textureCount; ++i)
+		{
+			wiECS::Entity entity = scene.Entity_CreateMaterial("resource_budget_test_" + std::to_string(i));
+			scene.materials.GetComponent(entity)->baseColorMapName = fileNames[i];
+		}
+		wiArchive archive(fileName, false);
+		scene.Serialize(archive);
+	}
+
+	wiResourceManager& resourceManager = wiResourceManager::GetGlobal();
+	const size_t previousBudget = resourceManager.GetMemoryBudget();
+
+	// Every unreferenced texture is over this budget, so the textures of a level must be evicted when the level is cleared:
+	resourceManager.SetMemoryBudget(1);
+	const size_t usageBefore = resourceManager.GetMemoryUsage(wiResourceManager::IMAGE_2D);
+
+	// The level is loaded and cleared repeatedly, like a game that streams through many levels, the memory usage must not grow:
+	const int levelCount = 4;
+	for (int i = 0; i < levelCount; ++i)
+	{
+		Scene scene;
+		LoadModel(scene, fileName);
+		while (resourceManager.IsLoading())
+		{
+			resourceManager.FinishLoading();
+			std::this_thread::yield();
+		}
+		const size_t usageLoaded = resourceManager.GetMemoryUsage(wiResourceManager::IMAGE_2D);
+
+		wiRenderer::GetDevice()->WaitForGPU();
+		scene.Clear();
+		const size_t usageCleared = resourceManager.GetMemoryUsage(wiResourceManager::IMAGE_2D);
+
+		const bool valid = scene.materials.GetCount() == 0 && usageLoaded >= usageBefore + textureCount * resolution * resolution * 4 && usageCleared <= usageBefore;
+		ss << "Level " << i << ": texture memory loaded: " << usageLoaded / 1024 << " KB, cleared: " << usageCleared / 1024 << " KB, result: " << (valid ? "OK" : "FAILED") << std::endl;
+	}
+
+	resourceManager.SetMemoryBudget(previousBudget);
+	std::remove(fileName.c_str());
+	for (auto& x : fileNames)
+	{
+		std::remove(x.c_str());
+	}
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->addFont(&font);
+}
+void TestsRenderer::RunPackageTest()
+{
+	wiTimer timer;
+
+	std::stringstream ss("");
+	ss << "Package test:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunPackageTest() function." << std::endl << std::endl;
+
+	// Many small textures, like the textures of a level:
+	const int textureCount = 64;
+	const uint32_t resolution = 128;
+	const std::string packageFileName = "package_test.wipak";
+	std::vector<std::string> fileNames(textureCount);
+	{
+		wiGraphics::TextureDesc desc;
+		desc.Width = resolution;
+		desc.Height = resolution;
+		desc.Format = wiGraphics::FORMAT_R8G8B8A8_UNORM;
+		std::vector<uint8_t> data(resolution * resolution * 4);
+		for (int i = 0; i < textureCount; ++i)
+		{
+			for (size_t j = 0; j < data.size(); ++j)
+			{
+				data[j] = (uint8_t)((j / 4) % resolution * 2 + i);
+			}
+			fileNames[i] = "package_test_" + std::to_string(i) + ".png";
+			wiHelper::saveTextureToFile(data, desc, fileNames[i]);
+		}
+	}
+
+	timer.record();
+	const bool created = wiVirtualFileSystem::CreatePackage(packageFileName, fileNames);
+	ss << "Package created from " << textureCount << " files in " << timer.elapsed() << " milliseconds" << std::endl << std::endl;
+
+	wiResourceManager& resourceManager = wiResourceManager::GetGlobal();
+	auto LoadTextures = [&](const char* description) {
+		const wiVirtualFileSystem::IOStatistics before = wiVirtualFileSystem::GetIOStatistics();
+		timer.record();
+		bool valid = true;
+		for (auto& x : fileNames)
+		{
+			valid = resourceManager.add(x) != nullptr && valid;
+		}
+		const double elapsed = timer.elapsed();
+		const wiVirtualFileSystem::IOStatistics after = wiVirtualFileSystem::GetIOStatistics();
+		ss << description << ": " << after.fileOpens - before.fileOpens << " file opens, " << after.packageReads - before.packageReads << " package reads, ";
+		ss << elapsed << " milliseconds, result: " << (valid ? "OK" : "FAILED") << std::endl;
+
+		wiRenderer::GetDevice()->WaitForGPU();
+		for (auto& x : fileNames)
+		{
+			resourceManager.del(x, true);
+		}
+	};
+
+	// 1) Loose files
+	LoadTextures("1) Loose files");
+
+	// 2) The same files from the mounted package, the package is opened only once when it is mounted
+	if (created && wiVirtualFileSystem::Mount(packageFileName))
+	{
+		LoadTextures("2) Mounted package");
+		wiVirtualFileSystem::Unmount(packageFileName);
+	}
+	else
+	{
+		ss << "2) Mounted package: FAILED" << std::endl;
+	}
+
+	for (auto& x : fileNames)
+	{
+		std::remove(x.c_str());
+	}
+	std::remove(packageFileName.c_str());
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->addFont(&font);
+}
+// Procedural scene for the benchmark:
+//	the objects share a cube mesh and they are placed on a grid, every hierarchyDepth objects form a parent-child chain,
+//	every armature is a chain of bones that is animated by a looping rotation animation
+static void GenerateBenchmarkScene(Scene& scene, uint32_t objectCount, uint32_t hierarchyDepth, uint32_t lightCount, uint32_t armatureCount, uint32_t boneCount)
+{
+	// The hierarchy components are created directly instead of Component_Attach(), because the parents are always created
+	//	before the children here, so there is no need to check the order of the whole hierarchy for every attachment
+	auto Attach = [&](wiECS::Entity entity, wiECS::Entity parent) {
+		HierarchyComponent& hierarchy = scene.hierarchy.Create(entity);
+		hierarchy.parentID = parent;
+		hierarchy.layerMask_bind = ~0u;
+		hierarchy.world_parent_inverse_bind = IDENTITYMATRIX;
+	};
+
+	const wiECS::Entity materialEntity = scene.Entity_CreateMaterial("benchmark_material");
+	const wiECS::Entity meshEntity = scene.Entity_CreateMesh("benchmark_mesh");
+	{
+		MeshComponent& mesh = *scene.meshes.GetComponent(meshEntity);
+		for (int i = 0; i < 8; ++i)
+		{
+			const XMFLOAT3 position = XMFLOAT3((i & 1) ? 0.5f : -0.5f, (i & 2) ? 0.5f : -0.5f, (i & 4) ? 0.5f : -0.5f);
+			XMFLOAT3 normal;
+			XMStoreFloat3(&normal, XMVector3Normalize(XMLoadFloat3(&position)));
+			mesh.vertex_positions.push_back(position);
+			mesh.vertex_normals.push_back(normal);
+		}
+		mesh.indices = {
+			0,1,2, 2,1,3,
+			4,6,5, 5,6,7,
+			0,4,1, 1,4,5,
+			2,3,6, 6,3,7,
+			0,2,4, 4,2,6,
+			1,5,3, 3,5,7,
+		};
+		mesh.subsets.emplace_back();
+		mesh.subsets.back().materialID = materialEntity;
+		mesh.subsets.back().indexCount = (uint32_t)mesh.indices.size();
+		mesh.CreateRenderData();
+	}
+
+	const uint32_t gridSize = std::max(1u, (uint32_t)ceil(sqrt((double)objectCount)));
+	const float spacing = 3;
+	const float extent = gridSize * spacing;
+	wiECS::Entity parent = wiECS::INVALID_ENTITY;
+	for (uint32_t i = 0; i < objectCount; ++i)
+	{
+		const wiECS::Entity entity = scene.Entity_CreateObject("benchmark_object_" + std::to_string(i));
+		scene.objects.GetComponent(entity)->meshID = meshEntity;
+
+		TransformComponent& transform = *scene.transforms.GetComponent(entity);
+		if (i % hierarchyDepth == 0)
+		{
+			transform.Translate(XMFLOAT3((i % gridSize) * spacing - extent * 0.5f, 0, (i / gridSize) * spacing - extent * 0.5f));
+			parent = entity;
+		}
+		else
+		{
+			// The children are relative to their parent:
+			transform.Translate(XMFLOAT3(spacing, 0, 0));
+			transform.RotateRollPitchYaw(XMFLOAT3(0, 0.1f, 0));
+			Attach(entity, parent);
+			parent = entity;
+		}
+		transform.UpdateTransform();
+	}
+
+	for (uint32_t i = 0; i < lightCount; ++i)
+	{
+		const XMFLOAT3 position = XMFLOAT3(wiRandom::getRandom(0, 1000) / 1000.0f * extent - extent * 0.5f, 2, wiRandom::getRandom(0, 1000) / 1000.0f * extent - extent * 0.5f);
+		scene.Entity_CreateLight("benchmark_light_" + std::to_string(i), position, XMFLOAT3(1, 1, 1), 2, 8);
+	}
+
+	for (uint32_t i = 0; i < armatureCount; ++i)
+	{
+		const wiECS::Entity armatureEntity = wiECS::CreateEntity();
+		scene.names.Create(armatureEntity) = "benchmark_armature_" + std::to_string(i);
+		scene.layers.Create(armatureEntity);
+		scene.transforms.Create(armatureEntity).Translate(XMFLOAT3(i * spacing - armatureCount * spacing * 0.5f, 0, -extent * 0.5f - spacing));
+
+		std::vector<wiECS::Entity> bones(boneCount);
+		wiECS::Entity boneParent = armatureEntity;
+		for (uint32_t j = 0; j < boneCount; ++j)
+		{
+			bones[j] = wiECS::CreateEntity();
+			scene.names.Create(bones[j]) = "benchmark_bone_" + std::to_string(j);
+			scene.layers.Create(bones[j]);
+			scene.transforms.Create(bones[j]).Translate(XMFLOAT3(0, 0.5f, 0));
+			Attach(bones[j], boneParent);
+			boneParent = bones[j];
+		}
+		ArmatureComponent& armature = scene.armatures.Create(armatureEntity);
+		armature.boneCollection = bones;
+		armature.inverseBindMatrices.resize(boneCount, IDENTITYMATRIX);
+
+		const wiECS::Entity animationEntity = wiECS::CreateEntity();
+		scene.names.Create(animationEntity) = "benchmark_animation_" + std::to_string(i);
+		AnimationComponent& animation = scene.animations.Create(animationEntity);
+		animation.start = 0;
+		animation.end = 2;
+		animation.Play();
+		animation.samplers.emplace_back();
+		AnimationComponent::AnimationSampler& sampler = animation.samplers.back();
+		sampler.keyframe_times = { 0, 1, 2 };
+		for (float angle : { -0.2f, 0.2f, -0.2f })
+		{
+			XMFLOAT4 rotation;
+			XMStoreFloat4(&rotation, XMQuaternionRotationRollPitchYaw(0, 0, angle));
+			sampler.keyframe_data.insert(sampler.keyframe_data.end(), { rotation.x, rotation.y, rotation.z, rotation.w });
+		}
+		for (auto& bone : bones)
+		{
+			animation.channels.emplace_back();
+			animation.channels.back().path = AnimationComponent::AnimationChannel::ROTATION;
+			animation.channels.back().target = bone;
+			animation.channels.back().samplerIndex = 0;
+		}
+	}
+
+	// Initialize the world matrices and bounds:
+	scene.Update(0);
+}
+
+// Benchmark of the CPU paths of the scene update and the renderer on a procedural scene
+//	The scene is configurable with startup arguments, for example: Tests.exe benchmark benchmark_objects=50000 benchmark_depth=8
+//	The results are written as JSON to benchmark_output (default: benchmark_results.json) when the benchmark frames are finished,
+//	and the application exits if it was started with the benchmark argument, so it can be used for automated trend tracking
+void TestsRenderer::RunBenchmark()
+{
+	auto GetArgument = [](const char* name, uint32_t defaultValue) {
+		return (uint32_t)std::max(0, atoi(wiStartupArguments::GetArgument(name, std::to_string(defaultValue)).c_str()));
+	};
+	const uint32_t objectCount = GetArgument("benchmark_objects", 10000);
+	const uint32_t hierarchyDepth = std::max(1u, GetArgument("benchmark_depth", 4));
+	const uint32_t lightCount = GetArgument("benchmark_lights", 256);
+	const uint32_t armatureCount = GetArgument("benchmark_armatures", 64);
+	const uint32_t boneCount = GetArgument("benchmark_bones", 32);
+	const uint32_t iterations = std::max(1u, GetArgument("benchmark_iterations", 100));
+
+	std::stringstream info("");
+	info << "\"objects\": " << objectCount << ", \"hierarchyDepth\": " << hierarchyDepth << ", \"lights\": " << lightCount;
+	info << ", \"armatures\": " << armatureCount << ", \"bones\": " << boneCount << ", \"threads\": " << wiJobSystem::GetThreadCount();
+	benchmarkInfo = info.str();
+	benchmarkResults.clear();
+
+	// The scene is generated separately, so the direct measurements are not affected by the global scene:
+	Scene scene;
+	GenerateBenchmarkScene(scene, objectCount, hierarchyDepth, lightCount, armatureCount, boneCount);
+
+	wiTimer timer;
+	std::vector<double> samples;
+	auto Measure = [&](const char* name, uint32_t count, const std::function<void()>& prepare, const std::function<void()>& task) {
+		samples.clear();
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			if (prepare != nullptr)
+			{
+				prepare();
+			}
+			timer.record();
+			task();
+			samples.push_back(timer.elapsed());
+		}
+		std::sort(samples.begin(), samples.end());
+		BenchmarkResult result;
+		result.name = name;
+		result.iterations = count;
+		result.min = samples.front();
+		result.median = samples[samples.size() / 2];
+		result.p95 = samples[std::min(samples.size() - 1, samples.size() * 95 / 100)];
+		result.max = samples.back();
+		benchmarkResults.push_back(result);
+	};
+	// The transform system only updates dirty transforms, so everything is made dirty before it is measured:
+	auto SetDirty = [&]() {
+		for (size_t i = 0; i < scene.transforms.GetCount(); ++i)
+		{
+			scene.transforms[i].SetDirty();
+		}
+	};
+	const float dt = 1.0f / 60.0f;
+
+	// 1) Scene systems, one at a time:
+	wiJobSystem::context ctx;
+	Measure("RunPreviousFrameTransformUpdateSystem", iterations, nullptr, [&]() {
+		RunPreviousFrameTransformUpdateSystem(ctx, scene.transforms, scene.prev_transforms);
+		wiJobSystem::Wait(ctx);
+	});
+	Measure("RunAnimationUpdateSystem", iterations, nullptr, [&]() {
+		RunAnimationUpdateSystem(ctx, scene.animations, scene.transforms, dt);
+		wiJobSystem::Wait(ctx);
+	});
+	Measure("RunTransformUpdateSystem", iterations, SetDirty, [&]() {
+		RunTransformUpdateSystem(ctx, scene.transforms);
+		wiJobSystem::Wait(ctx);
+	});
+	Measure("RunHierarchyUpdateSystem", iterations, nullptr, [&]() {
+		RunHierarchyUpdateSystem(ctx, scene.hierarchy, scene.transforms, scene.layers);
+		wiJobSystem::Wait(ctx);
+	});
+	Measure("RunArmatureUpdateSystem", iterations, nullptr, [&]() {
+		RunArmatureUpdateSystem(ctx, scene.transforms, scene.armatures);
+		wiJobSystem::Wait(ctx);
+	});
+	Measure("RunMaterialUpdateSystem", iterations, nullptr, [&]() {
+		RunMaterialUpdateSystem(ctx, scene.materials, dt);
+		wiJobSystem::Wait(ctx);
+	});
+	Measure("RunObjectUpdateSystem", iterations, nullptr, [&]() {
+		RunObjectUpdateSystem(ctx, scene.prev_transforms, scene.transforms, scene.meshes, scene.materials, scene.objects, scene.aabb_objects, scene.impostors, scene.softbodies, scene.bounds, scene.waterPlane);
+		wiJobSystem::Wait(ctx);
+	});
+	Measure("RunLightUpdateSystem", iterations, nullptr, [&]() {
+		RunLightUpdateSystem(ctx, scene.transforms, scene.aabb_lights, scene.lights);
+		wiJobSystem::Wait(ctx);
+	});
+	Measure("Scene::Update", iterations, SetDirty, [&]() {
+		scene.Update(dt);
+	});
+
+	// 2) Frustum culling of the objects and lights for a camera that sees a part of the scene, like the renderer does it:
+	CameraComponent camera;
+	camera.CreatePerspective((float)wiRenderer::GetInternalResolution().x, (float)wiRenderer::GetInternalResolution().y, 0.1f, 800);
+	{
+		TransformComponent transform;
+		transform.Translate(XMFLOAT3(0, 20, -scene.bounds.getHalfWidth().z));
+		transform.RotateRollPitchYaw(XMFLOAT3(0.4f, 0, 0));
+		transform.UpdateTransform();
+		camera.TransformCamera(transform);
+		camera.UpdateCamera();
+	}
+	std::vector<uint32_t> culledObjects;
+	std::vector<uint32_t> culledLights;
+	Measure("Frustum Culling", iterations, nullptr, [&]() {
+		culledObjects.clear();
+		culledLights.clear();
+		for (size_t i = 0; i < scene.aabb_objects.GetCount(); ++i)
+		{
+			if (camera.frustum.CheckBox(scene.aabb_objects[i]))
+			{
+				culledObjects.push_back((uint32_t)i);
+			}
+		}
+		for (size_t i = 0; i < scene.aabb_lights.GetCount(); ++i)
+		{
+			if (camera.frustum.CheckBox(scene.aabb_lights[i]))
+			{
+				culledLights.push_back((uint32_t)i);
+			}
+		}
+	});
+
+	// 3) Picking with rays from the camera towards random points of the scene:
+	const uint32_t pickCount = 100;
+	std::vector<RAY> rays(pickCount);
+	for (auto& ray : rays)
+	{
+		const XMFLOAT3 target = XMFLOAT3(wiRandom::getRandom(-1000, 1000) / 1000.0f * scene.bounds.getHalfWidth().x, 0, wiRandom::getRandom(-1000, 1000) / 1000.0f * scene.bounds.getHalfWidth().z);
+		XMFLOAT3 direction;
+		XMStoreFloat3(&direction, XMVector3Normalize(XMLoadFloat3(&target) - XMLoadFloat3(&camera.Eye)));
+		ray = RAY(XMLoadFloat3(&camera.Eye), XMLoadFloat3(&direction));
+	}
+	Measure("Pick (100 rays)", std::max(1u, iterations / 10), nullptr, [&]() {
+		for (auto& ray : rays)
+		{
+			Pick(ray, RENDERTYPE_ALL, ~0u, scene);
+		}
+	});
+
+	// 4) Archive save and load:
+	const std::string archiveFileName = "benchmark.wiscene";
+	Measure("Archive Save", std::max(1u, iterations / 10), nullptr, [&]() {
+		wiArchive archive;
+		archive.SetReadModeAndResetPos(false);
+		scene.Serialize(archive);
+		archive.SaveFile(archiveFileName);
+	});
+	Measure("Archive Load", std::max(1u, iterations / 10), nullptr, [&]() {
+		wiArchive archive(archiveFileName);
+		Scene loaded;
+		loaded.Serialize(archive);
+	});
+	std::remove(archiveFileName.c_str());
+
+	// 5) The renderer (frustum culling and render queues) is measured by the profiler while the scene is rendered:
+	wiRenderer::GetCamera() = camera;
+	wiSceneSystem::GetScene().Merge(scene);
+	wiRenderer::GetDevice()->SetVSyncEnabled(false);
+	wiProfiler::SetEnabled(true);
+	benchmarkFrames = std::max(1u, GetArgument("benchmark_frames", 300));
+	wiProfiler::SetStatisticsWindow(benchmarkFrames);
+
+	std::stringstream ss("");
+	ss << "Benchmark:" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunBenchmark() function." << std::endl << std::endl;
+	ss << "Measuring the renderer for " << benchmarkFrames << " frames..." << std::endl;
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->addFont(&font);
+}
+void TestsRenderer::Update(float dt)
+{
+	RenderPath3D_Deferred::Update(dt);
+
+	if (benchmarkFrames > 0)
+	{
+		benchmarkFrames--;
+		if (benchmarkFrames == 0)
+		{
+			FinishBenchmark();
+		}
+	}
+}
+void TestsRenderer::FinishBenchmark()
+{
+	// The renderer ranges of every thread are reported with their profiler path:
+	for (auto& x : wiProfiler::GetAllRangeStatistics())
+	{
+		const std::string name = x.path.substr(x.path.find_last_of('/') + 1);
+		if (name == "Frustum Culling" || name == "RenderQueue" || x.path == "Main Thread/CPU Frame")
+		{
+			BenchmarkResult result;
+			result.name = x.path;
+			result.iterations = x.samples;
+			result.min = x.min;
+			result.median = x.p50;
+			result.p95 = x.p95;
+			result.max = x.max;
+			benchmarkResults.push_back(result);
+		}
+	}
+	wiProfiler::SetEnabled(false);
+
+	const std::string outputFileName = wiStartupArguments::GetArgument("benchmark_output", "benchmark_results.json");
+	std::ofstream file(outputFileName, std::ios::trunc);
+	std::stringstream ss("");
+	ss << "Benchmark results (milliseconds, min / median / p95 / max):" << std::endl;
+	ss << "You can find out more in Tests.cpp, RunBenchmark() function." << std::endl << std::endl;
+	file << "{" << std::endl;
+	file << "\t\"version\": \"" << wiVersion::GetVersionString() << "\", " << benchmarkInfo << "," << std::endl;
+	file << "\t\"results\": [" << std::endl;
+	for (size_t i = 0; i < benchmarkResults.size(); ++i)
+	{
+		const BenchmarkResult& x = benchmarkResults[i];
+		file << "\t\t{ \"name\": \"" << x.name << "\", \"iterations\": " << x.iterations;
+		file << ", \"min\": " << x.min << ", \"median\": " << x.median << ", \"p95\": " << x.p95 << ", \"max\": " << x.max << " }";
+		file << (i + 1 < benchmarkResults.size() ? "," : "") << std::endl;
+		ss << x.name << ": " << x.min << " / " << x.median << " / " << x.p95 << " / " << x.max << std::endl;
+	}
+	file << "\t]" << std::endl;
+	file << "}" << std::endl;
+	file.close();
+	ss << std::endl << (file.fail() ? "Failed to save: " : "Saved: ") << outputFileName << std::endl;
+
+	if (wiStartupArguments::HasArgument("benchmark"))
+	{
+		exit(file.fail() ? 1 : 0);
+	}
+
+	static wiFont font;
+	font = wiFont(ss.str());
+	font.params.posX = wiRenderer::GetDevice()->GetScreenWidth() / 2;
+	font.params.posY = wiRenderer::GetDevice()->GetScreenHeight() / 2;
+	font.params.h_align = WIFALIGN_CENTER;
+	font.params.v_align = WIFALIGN_CENTER;
+	font.params.size = 20;
+	this->clearFonts();
+	this->addFont(&font);
+}
 void TestsRenderer::RunFontTest()
 {
 	static wiFont font;
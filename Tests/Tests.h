@@ -10,12 +10,39 @@ public:
 
 class TestsRenderer : public RenderPath3D_Deferred
 {
+	// The benchmark measures the renderer over multiple frames, the results are written when the frames are finished:
+	struct BenchmarkResult
+	{
+		std::string name;
+		uint32_t iterations = 0;
+		double min = 0;		// milliseconds
+		double median = 0;	// milliseconds
+		double p95 = 0;		// milliseconds
+		double max = 0;		// milliseconds
+	};
+	std::vector<BenchmarkResult> benchmarkResults;
+	std::string benchmarkInfo;
+	uint32_t benchmarkFrames = 0;
+	void FinishBenchmark();
 public: 
 	TestsRenderer();
 
+	void Update(float dt) override;
+
 	void RunJobSystemTest();
 	void RunFontTest();
 	void RunSpriteTest();
 	void RunNetworkTest();
+	void RunMeshletTest();
+	void RunCompressionTest();
+	void RunSceneLoadingTest();
+	void RunAsyncLoadingTest();
+	void RunDuplicationTest();
+	void RunTextureLoadingTest();
+	void RunResourceContentionTest();
+	void RunPackageTest();
+	void RunBenchmark();
+	void RunOcclusionTest();
+	void RunResourceBudgetTest();
 };
 
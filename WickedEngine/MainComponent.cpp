@@ -14,6 +14,8 @@
 #include "wiStartupArguments.h"
 #include "wiFont.h"
 #include "wiImage.h"
+#include "wiResourceManager.h"
+#include "wiVirtualFileSystem.h"
 
 #include "wiGraphicsDevice_DX11.h"
 #include "wiGraphicsDevice_DX12.h"
@@ -74,6 +76,12 @@ void MainComponent::Initialize()
 
 	}
 
+	// The shaders are loaded from the shader package if it exists, so they don't have to be opened one by one:
+	const std::string shaderPackage = wiRenderer::GetShaderPath() + "shaders.wipak";
+	if (wiHelper::FileExists(shaderPackage))
+	{
+		wiVirtualFileSystem::Mount(shaderPackage, wiRenderer::GetShaderPath());
+	}
 
 	wiInitializer::InitializeComponentsAsync();
 
@@ -121,6 +129,22 @@ void MainComponent::Run()
 		wiRenderer::GetDevice()->PresentEnd(cmd);
 		return;
 	}
+	if (!startupStatisticsReported)
+	{
+		startupStatisticsReported = true;
+		const wiVirtualFileSystem::IOStatistics statistics = wiVirtualFileSystem::GetIOStatistics();
+		std::stringstream ss;
+		ss << "Startup I/O: " << statistics.fileOpens << " file opens, " << statistics.packageReads << " package reads, " << statistics.bytesRead / 1024 << " KB read";
+		wiBackLog::post(ss.str().c_str());
+
+		// Profiler capture from startup arguments, for example: profile_capture=300 profile_trace=trace.json profile_csv=frames.csv profile_exit
+		const int captureFrames = atoi(wiStartupArguments::GetArgument("profile_capture", "0").c_str());
+		if (captureFrames > 0)
+		{
+			wiProfiler::BeginCapture((uint32_t)captureFrames, wiStartupArguments::GetArgument("profile_trace", "profile_trace.json"), wiStartupArguments::GetArgument("profile_csv", "profile_frames.csv"));
+			exitAfterProfilerCapture = wiStartupArguments::HasArgument("profile_exit");
+		}
+	}
 
 	wiProfiler::BeginFrame();
 
@@ -136,7 +160,7 @@ void MainComponent::Run()
 		fadeManager.Update(dt);
 
 		// Fixed time update:
-		auto range = wiProfiler::BeginRangeCPU("Fixed Update");
+		auto range = wiProfiler::BeginRangeCPU(WI_HASHSTRING("Fixed Update"));
 		{
 			if (frameskip)
 			{
@@ -183,11 +207,16 @@ void MainComponent::Run()
 	wiRenderer::GetDevice()->PresentEnd(cmd);
 
 	wiRenderer::EndFrame();
+
+	if (exitAfterProfilerCapture && !wiProfiler::IsCapturing())
+	{
+		exit(0);
+	}
 }
 
 void MainComponent::Update(float dt)
 {
-	auto range = wiProfiler::BeginRangeCPU("Update");
+	auto range = wiProfiler::BeginRangeCPU(WI_HASHSTRING("Update"));
 
 	wiLua::GetGlobal()->SetDeltaTime(double(dt));
 	wiLua::GetGlobal()->Update();
@@ -213,7 +242,7 @@ void MainComponent::FixedUpdate()
 
 void MainComponent::Render()
 {
-	auto range = wiProfiler::BeginRangeCPU("Render");
+	auto range = wiProfiler::BeginRangeCPU(WI_HASHSTRING("Render"));
 
 	wiLua::GetGlobal()->Render();
 
@@ -227,7 +256,7 @@ void MainComponent::Render()
 
 void MainComponent::Compose(CommandList cmd)
 {
-	auto range = wiProfiler::BeginRangeCPU("Compose");
+	auto range = wiProfiler::BeginRangeCPU(WI_HASHSTRING("Compose"));
 
 	if (GetActivePath() != nullptr)
 	{
@@ -288,6 +317,17 @@ void MainComponent::Compose(CommandList cmd)
 		{
 			ss << "Resolution: " << wiRenderer::GetDevice()->GetScreenWidth() << " x " << wiRenderer::GetDevice()->GetScreenHeight() << endl;
 		}
+		if (infoDisplay.resourcememory)
+		{
+			const wiResourceManager& resources = wiResourceManager::GetGlobal();
+			const size_t budget = resources.GetMemoryBudget();
+			ss << "Resource memory: " << resources.GetMemoryUsage() / (1024 * 1024) << " MB";
+			if (budget > 0)
+			{
+				ss << " / " << budget / (1024 * 1024) << " MB";
+			}
+			ss << endl;
+		}
 		if (infoDisplay.fpsinfo)
 		{
 			ss.precision(2);
@@ -15,6 +15,8 @@ protected:
 	bool frameskip = true;
 	bool framerate_lock = false;
 	bool initialized = false;
+	bool startupStatisticsReported = false;
+	bool exitAfterProfilerCapture = false;
 
 	wiFadeManager fadeManager;
 
@@ -80,6 +82,8 @@ public:
 		bool fpsinfo = false;
 		// display resolution info
 		bool resolution = false;
+		// display the memory usage of the global resources
+		bool resourcememory = false;
 		// text size
 		int size = 16;
 	};
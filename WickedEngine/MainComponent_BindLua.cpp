@@ -349,6 +349,68 @@ int SetProfilerEnabled(lua_State* L)
 
 	return 0;
 }
+int ProfilerCapture(lua_State* L)
+{
+	int argc = wiLua::SGetArgCount(L);
+	if (argc > 1)
+	{
+		uint32_t frameCount = (uint32_t)wiLua::SGetInt(L, 1);
+		std::string traceFileName = wiLua::SGetString(L, 2);
+		std::string csvFileName;
+		if (argc > 2)
+		{
+			csvFileName = wiLua::SGetString(L, 3);
+		}
+		wiProfiler::BeginCapture(frameCount, traceFileName, csvFileName);
+	}
+	else
+		wiLua::SError(L, "ProfilerCapture(int frameCount, string traceFileName, opt string csvFileName) not enough arguments!");
+
+	return 0;
+}
+int GetProfilerStatistics(lua_State* L)
+{
+	int argc = wiLua::SGetArgCount(L);
+	if (argc > 0)
+	{
+		wiProfiler::RangeStatistics statistics;
+		if (wiProfiler::GetRangeStatistics(wiLua::SGetString(L, 1), statistics))
+		{
+			wiLua::SSetDouble(L, statistics.p50);
+			wiLua::SSetDouble(L, statistics.p95);
+			wiLua::SSetDouble(L, statistics.p99);
+			wiLua::SSetDouble(L, statistics.max);
+			wiLua::SSetInt(L, (int)statistics.samples);
+			return 5;
+		}
+	}
+	else
+		wiLua::SError(L, "GetProfilerStatistics(string range) not enough arguments!");
+
+	return 0;
+}
+int SetProfilerHitchThreshold(lua_State* L)
+{
+	int argc = wiLua::SGetArgCount(L);
+	if (argc > 1)
+	{
+		double medianFactor = 0;
+		if (argc > 2)
+		{
+			medianFactor = wiLua::SGetDouble(L, 3);
+		}
+		wiProfiler::SetHitchThreshold(wiLua::SGetString(L, 1), wiLua::SGetDouble(L, 2), medianFactor);
+	}
+	else
+		wiLua::SError(L, "SetProfilerHitchThreshold(string range, float milliseconds, opt float medianFactor) not enough arguments!");
+
+	return 0;
+}
+int GetProfilerHitchCount(lua_State* L)
+{
+	wiLua::SSetLongLong(L, (long long)wiProfiler::GetHitchCount());
+	return 1;
+}
 
 void MainComponent_BindLua::Bind()
 {
@@ -359,5 +421,9 @@ void MainComponent_BindLua::Bind()
 		Luna<MainComponent_BindLua>::Register(wiLua::GetGlobal()->GetLuaState()); 
 		
 		wiLua::GetGlobal()->RegisterFunc("SetProfilerEnabled", SetProfilerEnabled);
+		wiLua::GetGlobal()->RegisterFunc("ProfilerCapture", ProfilerCapture);
+		wiLua::GetGlobal()->RegisterFunc("GetProfilerStatistics", GetProfilerStatistics);
+		wiLua::GetGlobal()->RegisterFunc("SetProfilerHitchThreshold", SetProfilerHitchThreshold);
+		wiLua::GetGlobal()->RegisterFunc("GetProfilerHitchCount", GetProfilerHitchCount);
 	}
 }
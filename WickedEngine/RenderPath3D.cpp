@@ -294,7 +294,7 @@ void RenderPath3D::RenderFrameSetUp(CommandList cmd) const
 }
 void RenderPath3D::RenderReflections(CommandList cmd) const
 {
-	auto range = wiProfiler::BeginRangeGPU("Reflection rendering", cmd);
+	auto range = wiProfiler::BeginRangeGPU(WI_HASHSTRING("Reflection rendering"), cmd);
 
 	if (wiRenderer::IsRequestedReflectionRendering())
 	{
@@ -526,7 +526,7 @@ void RenderPath3D::RenderTransparents(const Texture2D& dstSceneRT, RENDERPASS re
 
 	// Transparent scene
 	{
-		auto range = wiProfiler::BeginRangeGPU("Transparent Scene", cmd);
+		auto range = wiProfiler::BeginRangeGPU(WI_HASHSTRING("Transparent Scene"), cmd);
 
 		device->BindResource(PS, getReflectionsEnabled() ? &rtReflection : wiTextureHelper::getTransparent(), TEXSLOT_RENDERPATH_REFLECTION, cmd);
 		device->BindResource(PS, &rtSceneCopy, TEXSLOT_RENDERPATH_REFRACTION, cmd);
@@ -599,7 +599,7 @@ void RenderPath3D::RenderBloom(const Texture2D& srcdstSceneRT, CommandList cmd)
 		GraphicsDevice* device = wiRenderer::GetDevice();
 
 		device->EventBegin("Bloom", cmd);
-		auto range = wiProfiler::BeginRangeGPU("Bloom", cmd);
+		auto range = wiProfiler::BeginRangeGPU(WI_HASHSTRING("Bloom"), cmd);
 
 		wiRenderer::Postprocess_BloomSeparate(srcdstSceneRT, rtBloom, cmd, getBloomThreshold());
 
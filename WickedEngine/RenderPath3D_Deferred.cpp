@@ -92,7 +92,7 @@ void RenderPath3D_Deferred::Render() const
 		device->TransitionBarrier(dsv, ARRAYSIZE(dsv), RESOURCE_STATE_DEPTH_READ, RESOURCE_STATE_DEPTH_WRITE, cmd);
 
 		{
-			auto range = wiProfiler::BeginRangeGPU("Opaque Scene", cmd);
+			auto range = wiProfiler::BeginRangeGPU(WI_HASHSTRING("Opaque Scene"), cmd);
 
 			const Texture2D* rts[] = {
 				&rtGBuffer[0],
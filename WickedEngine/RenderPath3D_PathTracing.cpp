@@ -124,7 +124,7 @@ void RenderPath3D_PathTracing::Render() const
 		}
 		else
 		{
-			auto range = wiProfiler::BeginRangeGPU("Traced Scene", cmd);
+			auto range = wiProfiler::BeginRangeGPU(WI_HASHSTRING("Traced Scene"), cmd);
 
 			wiRenderer::UpdateCameraCB(wiRenderer::GetCamera(), cmd);
 
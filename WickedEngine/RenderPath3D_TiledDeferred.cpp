@@ -32,7 +32,7 @@ void RenderPath3D_TiledDeferred::Render() const
 		device->TransitionBarrier(dsv, ARRAYSIZE(dsv), RESOURCE_STATE_DEPTH_READ, RESOURCE_STATE_DEPTH_WRITE, cmd);
 
 		{
-			auto range = wiProfiler::BeginRangeGPU("Opaque Scene", cmd);
+			auto range = wiProfiler::BeginRangeGPU(WI_HASHSTRING("Opaque Scene"), cmd);
 
 			const Texture2D* rts[] = {
 				&rtGBuffer[0],
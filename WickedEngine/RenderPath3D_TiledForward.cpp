@@ -38,7 +38,7 @@ void RenderPath3D_TiledForward::Render() const
 
 		// depth prepass
 		{
-			auto range = wiProfiler::BeginRangeGPU("Z-Prepass", cmd);
+			auto range = wiProfiler::BeginRangeGPU(WI_HASHSTRING("Z-Prepass"), cmd);
 
 			device->BindRenderTargets(0, nullptr, &depthBuffer, cmd);
 			device->ClearDepthStencil(&depthBuffer, CLEAR_DEPTH | CLEAR_STENCIL, 0, 0, cmd);
@@ -85,7 +85,7 @@ void RenderPath3D_TiledForward::Render() const
 
 		// Opaque scene:
 		{
-			auto range = wiProfiler::BeginRangeGPU("Opaque Scene", cmd);
+			auto range = wiProfiler::BeginRangeGPU(WI_HASHSTRING("Opaque Scene"), cmd);
 
 			const Texture2D* rts[] = {
 				&rtMain[0],
@@ -41,6 +41,7 @@
 #include "wiHelper.h"
 #include "wiInputManager.h"
 #include "wiTextureHelper.h"
+#include "wiTextureCooker.h"
 #include "wiRandom.h"
 #include "wiColor.h"
 #include "wiPhysicsEngine.h"
@@ -54,12 +55,16 @@
 #include "wiHashString.h"
 #include "wiWindowRegistration.h"
 #include "wiArchive.h"
+#include "wiCompression.h"
+#include "wiVirtualFileSystem.h"
 #include "wiSpinLock.h"
 #include "wiRectPacker.h"
 #include "wiProfiler.h"
 #include "wiOcean.h"
 #include "wiStartupArguments.h"
 #include "wiGPUBVH.h"
+#include "wiOcclusionCuller.h"
+#include "wiMeshOptimizer.h"
 #include "wiGPUSortLib.h"
 #include "wiJobSystem.h"
 #include "wiNetwork.h"
@@ -1,36 +1,284 @@
 #include "wiArchive.h"
 #include "wiHelper.h"
+#include "wiCompression.h"
+#include "wiJobSystem.h"
+#include "wiVirtualFileSystem.h"
 
 #include <fstream>
 #include <sstream>
+#include <memory>
+#include <algorithm>
+#include <cassert>
+#include <atomic>
+#include <thread>
 
 using namespace std;
 
 // this should always be only INCREMENTED and only if a new serialization is implemeted somewhere!
-uint64_t __archiveVersion = 31;
+uint64_t __archiveVersion = 37;
 // this is the version number of which below the archive is not compatible with the current version
 uint64_t __archiveVersionBarrier = 22;
 
 // version history is logged in ArchiveVersionHistory.txt file!
 
+// Compressed archive file layout:
+//	[uint64 magic][compressed chunks...][chunk table: CompressedChunk * chunkCount][patches...][uint64 patchesSize][uint64 chunkCount][uint64 patched magic]
+//	The chunks contain the uncompressed archive (starting with the version number) split into fixed size parts
+//	The patches are the placeholder values that were written after their chunk was already compressed, every patch is
+//	a CompressedPatch followed by its data, and they are applied on the chunks after decompression in the order they were written
+//	Files that end with the first magic have no patches: [chunk table][uint64 chunkCount][uint64 magic]
+static const uint64_t __compressedArchiveMagic = 0x5A4C484352414957ull; // "WIARCHLZ"
+static const uint64_t __compressedArchivePatchedMagic = 0x504C484352414957ull; // "WIARCHLP"
+static const size_t __compressedArchiveChunkSize = 1024 * 1024;
+struct CompressedChunk
+{
+	uint64_t offset; // location in the file
+	uint32_t compressedSize; // if equal to uncompressedSize, the chunk is stored without compression
+	uint32_t uncompressedSize;
+};
+struct CompressedPatch
+{
+	uint64_t offset; // location in the uncompressed archive
+	uint64_t size;
+};
+struct wiArchive::CompressedData
+{
+	const uint8_t* fileData = nullptr; // the whole compressed file (mapped or in memory)
+	size_t chunkDataEnd = 0; // the chunk table starts here in the file
+	bool ownsFileData = false;
+	std::vector<CompressedChunk> chunks;
+	std::vector<size_t> chunkOffsets; // location of the chunks in the uncompressed archive
+	struct Patch
+	{
+		CompressedPatch info;
+		const uint8_t* data; // points into the file data
+	};
+	std::vector<Patch> patches;
+	std::unique_ptr<std::atomic<uint32_t>[]> chunkStates; // 0: not started, 1: decompressing, 2: done, 3: failed
+	size_t nextChunk = 0; // the first chunk that was not yet checked by the reader
+	wiJobSystem::context ctx;
+
+	// Decompress the chunk unless an other thread already started it
+	void DecompressChunk(size_t chunk, uint8_t* DATA)
+	{
+		uint32_t expected = 0;
+		if (!chunkStates[chunk].compare_exchange_strong(expected, 1))
+		{
+			return;
+		}
+		const CompressedChunk& info = chunks[chunk];
+		bool success = true;
+		if (info.offset + info.compressedSize > chunkDataEnd)
+		{
+			success = false;
+		}
+		else if (info.compressedSize == info.uncompressedSize)
+		{
+			memcpy(DATA + chunkOffsets[chunk], fileData + info.offset, info.uncompressedSize);
+		}
+		else
+		{
+			success = wiCompression::Decompress(fileData + info.offset, info.compressedSize, DATA + chunkOffsets[chunk], info.uncompressedSize);
+		}
+		if (success)
+		{
+			// The parts of the patches that are inside this chunk:
+			const size_t chunkBegin = chunkOffsets[chunk];
+			const size_t chunkEnd = chunkBegin + info.uncompressedSize;
+			for (auto& patch : patches)
+			{
+				const size_t patchBegin = std::max(chunkBegin, (size_t)patch.info.offset);
+				const size_t patchEnd = std::min(chunkEnd, size_t(patch.info.offset + patch.info.size));
+				if (patchBegin < patchEnd)
+				{
+					memcpy(DATA + patchBegin, patch.data + (patchBegin - patch.info.offset), patchEnd - patchBegin);
+				}
+			}
+		}
+		chunkStates[chunk].store(success ? 2 : 3);
+	}
+};
+
+// Writes the stream of an archive into a file as compressed chunks
+struct CompressedFileWriter
+{
+	ofstream file;
+	std::vector<uint8_t> chunk;
+	std::vector<uint8_t> compressedChunk;
+	std::vector<CompressedChunk> chunks;
+	std::vector<uint8_t> patches;
+	uint64_t offset = 0;
+	uint64_t compressedEnd = 0; // the uncompressed archive is compressed until this position, the rest is in the chunk buffer
+
+	void WriteChunk()
+	{
+		if (chunk.empty())
+		{
+			return;
+		}
+		compressedChunk.resize(wiCompression::CompressBound(chunk.size()));
+		size_t compressedSize = wiCompression::Compress(chunk.data(), chunk.size(), compressedChunk.data(), chunk.size() - 1);
+
+		CompressedChunk info;
+		info.offset = offset;
+		info.uncompressedSize = (uint32_t)chunk.size();
+		if (compressedSize == 0)
+		{
+			// Store without compression if it doesn't get smaller:
+			info.compressedSize = info.uncompressedSize;
+			file.write((const char*)chunk.data(), (streamsize)chunk.size());
+		}
+		else
+		{
+			info.compressedSize = (uint32_t)compressedSize;
+			file.write((const char*)compressedChunk.data(), (streamsize)compressedSize);
+		}
+		offset += info.compressedSize;
+		compressedEnd += info.uncompressedSize;
+		chunks.push_back(info);
+		chunk.clear();
+	}
+	void Write(const uint8_t* data, size_t size)
+	{
+		while (size > 0)
+		{
+			const size_t count = std::min(size, __compressedArchiveChunkSize - chunk.size());
+			chunk.insert(chunk.end(), data, data + count);
+			data += count;
+			size -= count;
+			if (chunk.size() == __compressedArchiveChunkSize)
+			{
+				WriteChunk();
+			}
+		}
+	}
+	// Data that is still in the chunk buffer is overwritten, the rest is saved as a patch, so the chunks don't need to be held back
+	void Overwrite(size_t position, const uint8_t* data, size_t size)
+	{
+		if (position >= compressedEnd)
+		{
+			memcpy(chunk.data() + (position - compressedEnd), data, size);
+			return;
+		}
+		CompressedPatch patch;
+		patch.offset = (uint64_t)position;
+		patch.size = (uint64_t)size;
+		patches.insert(patches.end(), (const uint8_t*)&patch, (const uint8_t*)&patch + sizeof(patch));
+		patches.insert(patches.end(), data, data + size);
+	}
+	void Close()
+	{
+		WriteChunk();
+		if (!chunks.empty())
+		{
+			file.write((const char*)chunks.data(), (streamsize)(sizeof(CompressedChunk) * chunks.size()));
+		}
+		if (!patches.empty())
+		{
+			file.write((const char*)patches.data(), (streamsize)patches.size());
+		}
+		const uint64_t patchesSize = (uint64_t)patches.size();
+		file.write((const char*)&patchesSize, sizeof(patchesSize));
+		const uint64_t chunkCount = (uint64_t)chunks.size();
+		file.write((const char*)&chunkCount, sizeof(chunkCount));
+		file.write((const char*)&__compressedArchivePatchedMagic, sizeof(__compressedArchivePatchedMagic));
+		file.close();
+	}
+};
+
 wiArchive::wiArchive()
 {
 	CreateEmpty();
 }
-wiArchive::wiArchive(const std::string& fileName, bool readMode) : fileName(fileName), readMode(readMode)
+wiArchive::wiArchive(const std::string& fileName, bool readMode, bool compress) : fileName(fileName), readMode(readMode)
 {
 	if (!fileName.empty())
 	{
 		if (readMode)
 		{
-			ifstream file(fileName, ios::binary | ios::ate);
-			if (file.is_open())
+			// The file is read through the virtual file system, so it can come from a mounted package
+			//	Loose files are memory mapped, so the OS pages in the file on demand, without an intermediate copy of the whole file:
+			wiVirtualFileSystem::FileView view;
+			if (wiVirtualFileSystem::OpenFile(fileName, view) && view.data != nullptr)
+			{
+				DATA = const_cast<uint8_t*>(view.data); // only read operations are allowed on the file data
+				dataSize = view.size;
+				fileData = view.owner;
+			}
+
+			if (DATA != nullptr && dataSize >= sizeof(uint64_t) * 3 && *(const uint64_t*)DATA == __compressedArchiveMagic)
+			{
+				const uint64_t endMagic = *(const uint64_t*)(DATA + dataSize - sizeof(uint64_t));
+				const uint64_t chunkCount = *(const uint64_t*)(DATA + dataSize - sizeof(uint64_t) * 2);
+				const size_t footerSize = sizeof(uint64_t) * (endMagic == __compressedArchivePatchedMagic ? 3 : 2);
+				const uint64_t patchesSize = endMagic == __compressedArchivePatchedMagic && dataSize >= sizeof(uint64_t) * 4 ? *(const uint64_t*)(DATA + dataSize - sizeof(uint64_t) * 3) : 0;
+				if ((endMagic != __compressedArchiveMagic && endMagic != __compressedArchivePatchedMagic) ||
+					dataSize < sizeof(uint64_t) + footerSize ||
+					patchesSize > dataSize - sizeof(uint64_t) - footerSize ||
+					chunkCount > (dataSize - sizeof(uint64_t) - footerSize - patchesSize) / sizeof(CompressedChunk))
+				{
+					wiHelper::messageBox("The compressed archive is corrupted: " + fileName, "Error!");
+					Close();
+					return;
+				}
+
+				// The file is a compressed archive, the file data will be the source of the decompression:
+				compressed = new CompressedData;
+				CompressedData& data = *compressed;
+				data.fileData = DATA;
+				data.ownsFileData = fileData == nullptr;
+
+				const size_t patchesOffset = dataSize - footerSize - (size_t)patchesSize;
+				const size_t tableOffset = patchesOffset - sizeof(CompressedChunk) * (size_t)chunkCount;
+				data.chunkDataEnd = tableOffset;
+				data.chunks.resize((size_t)chunkCount);
+				memcpy(data.chunks.data(), DATA + tableOffset, sizeof(CompressedChunk) * data.chunks.size());
+
+				size_t uncompressedSize = 0;
+				for (auto& chunk : data.chunks)
+				{
+					data.chunkOffsets.push_back(uncompressedSize);
+					uncompressedSize += chunk.uncompressedSize;
+				}
+
+				for (size_t patchOffset = patchesOffset; patchOffset < patchesOffset + patchesSize;)
+				{
+					CompressedData::Patch patch;
+					const size_t remaining = patchesOffset + (size_t)patchesSize - patchOffset;
+					if (remaining >= sizeof(CompressedPatch))
+					{
+						memcpy(&patch.info, DATA + patchOffset, sizeof(CompressedPatch));
+						patch.data = DATA + patchOffset + sizeof(CompressedPatch);
+					}
+					if (remaining < sizeof(CompressedPatch) || patch.info.size > remaining - sizeof(CompressedPatch) ||
+						patch.info.offset > uncompressedSize || patch.info.size > uncompressedSize - patch.info.offset)
+					{
+						wiHelper::messageBox("The compressed archive is corrupted: " + fileName, "Error!");
+						SAFE_DELETE(compressed); // DATA is still the file data
+						Close();
+						return;
+					}
+					data.patches.push_back(patch);
+					patchOffset += sizeof(CompressedPatch) + (size_t)patch.info.size;
+				}
+				data.chunkStates.reset(new std::atomic<uint32_t>[data.chunks.size()]);
+				for (size_t i = 0; i < data.chunks.size(); ++i)
+				{
+					data.chunkStates[i].store(0);
+				}
+
+				// The reading can start while the chunks are decompressed in the background:
+				DATA = new uint8_t[uncompressedSize];
+				dataSize = uncompressedSize;
+				readLimit = 0;
+				uint8_t* dst = DATA;
+				wiJobSystem::Dispatch(data.ctx, (uint32_t)data.chunks.size(), 1, [&data, dst](wiJobDispatchArgs args) {
+					data.DecompressChunk(args.jobIndex, dst);
+				});
+			}
+
+			if (DATA != nullptr)
 			{
-				dataSize = (size_t)file.tellg();
-				file.seekg(0, file.beg);
-				DATA = new uint8_t[(size_t)dataSize];
-				file.read((char*)DATA, dataSize);
-				file.close();
 				(*this) >> version;
 				if (version < __archiveVersionBarrier)
 				{
@@ -51,10 +299,67 @@ wiArchive::wiArchive(const std::string& fileName, bool readMode) : fileName(file
 		}
 		else
 		{
-			CreateEmpty();
+			if (compress)
+			{
+				shared_ptr<CompressedFileWriter> writer = make_shared<CompressedFileWriter>();
+				writer->file.open(fileName, ios::binary | ios::trunc);
+				if (writer->file.is_open())
+				{
+					writer->file.write((const char*)&__compressedArchiveMagic, sizeof(__compressedArchiveMagic));
+					writer->offset = sizeof(__compressedArchiveMagic);
+					stream = new Stream;
+					stream->write = [writer](const uint8_t* data, size_t size) {
+						writer->Write(data, size);
+					};
+					stream->overwrite = [writer](size_t offset, const uint8_t* data, size_t size) {
+						writer->Overwrite(offset, data, size);
+					};
+					stream->close = [writer]() {
+						writer->Close();
+					};
+					CreateEmpty(__compressedArchiveChunkSize);
+				}
+				return;
+			}
+
+			shared_ptr<ofstream> file = make_shared<ofstream>(fileName, ios::binary | ios::trunc);
+			if (file->is_open())
+			{
+				stream = new Stream;
+				stream->write = [file](const uint8_t* data, size_t size) {
+					file->write((const char*)data, (streamsize)size);
+				};
+				stream->overwrite = [file](size_t offset, const uint8_t* data, size_t size) {
+					const streampos end = file->tellp();
+					file->seekp((streamoff)offset);
+					file->write((const char*)data, (streamsize)size);
+					file->seekp(end);
+				};
+				CreateEmpty(4 * 1024 * 1024);
+			}
 		}
 	}
 }
+wiArchive::wiArchive(const Stream& stream, size_t chunkSize)
+{
+	this->stream = new Stream(stream);
+	CreateEmpty(chunkSize);
+}
+wiArchive::wiArchive(wiArchive& source, size_t position) : fileName(source.fileName)
+{
+	assert(source.readMode);
+
+	// The whole data must be available, because the source can't be waited for from multiple threads:
+	source._decompress(source.dataSize);
+
+	version = source.version;
+	readMode = true;
+	DATA = source.DATA;
+	dataSize = source.dataSize;
+	sharedData = true;
+	stringTable = source.stringTable;
+	Jump(position);
+}
 
 
 wiArchive::~wiArchive()
@@ -62,19 +367,42 @@ wiArchive::~wiArchive()
 	Close();
 }
 
-void wiArchive::CreateEmpty()
+void wiArchive::CreateEmpty(size_t initialSize)
 {
 	readMode = false;
 	pos = 0;
 
 	version = __archiveVersion;
-	dataSize = 128; // this will grow if necessary anyway...
+	dataSize = initialSize; // this will grow if necessary anyway (unless streaming)...
 	DATA = new uint8_t[dataSize];
 	(*this) << version;
 }
 
 void wiArchive::SetReadModeAndResetPos(bool isReadMode)
 {
+	assert(stream == nullptr); // streamed data can't be read back
+	assert(!sharedData || isReadMode); // shared data can't be modified
+	if (!isReadMode && compressed != nullptr)
+	{
+		// The data will be modified, so wait for the decompression and release the compressed data:
+		wiJobSystem::Wait(compressed->ctx);
+		if (compressed->ownsFileData)
+		{
+			delete[] compressed->fileData;
+		}
+		SAFE_DELETE(compressed);
+		readLimit = ~0ull;
+		fileData.reset();
+	}
+	if (!isReadMode && fileData != nullptr)
+	{
+		// The file data is read-only, so it is copied before writing:
+		uint8_t* NEWDATA = new uint8_t[dataSize];
+		memcpy(NEWDATA, DATA, dataSize);
+		fileData.reset();
+		DATA = NEWDATA;
+	}
+
 	readMode = isReadMode; 
 	pos = 0;
 
@@ -96,16 +424,47 @@ bool wiArchive::IsOpen()
 
 void wiArchive::Close()
 {
-	if (!readMode && !fileName.empty())
+	if (stream != nullptr)
+	{
+		assert(placeholders.empty()); // every placeholder should be patched before closing!
+		placeholders.clear();
+		_flush();
+		if (stream->close)
+		{
+			stream->close();
+		}
+		SAFE_DELETE(stream); // the file is closed when the stream is destroyed
+	}
+	else if (!readMode && !fileName.empty() && DATA != nullptr)
 	{
 		SaveFile(fileName);
 	}
+	if (sharedData)
+	{
+		DATA = nullptr; // it is owned by the source archive
+		sharedData = false;
+	}
+	if (compressed != nullptr)
+	{
+		wiJobSystem::Wait(compressed->ctx); // decompression jobs are referencing the data
+		if (compressed->ownsFileData)
+		{
+			delete[] compressed->fileData;
+		}
+		SAFE_DELETE(compressed);
+		readLimit = ~0ull;
+	}
+	else if (fileData != nullptr)
+	{
+		DATA = nullptr; // it was pointing into the file data
+	}
+	fileData.reset();
 	SAFE_DELETE_ARRAY(DATA);
 }
 
 bool wiArchive::SaveFile(const std::string& fileName)
 {
-	if (pos <= 0)
+	if (pos <= 0 || stream != nullptr)
 	{
 		return false;
 	}
@@ -121,6 +480,88 @@ bool wiArchive::SaveFile(const std::string& fileName)
 	return false;
 }
 
+size_t wiArchive::WritePlaceholder()
+{
+	const size_t placeholder = GetSize();
+	_write((uint64_t)0);
+	if (stream != nullptr && !stream->overwrite)
+	{
+		placeholders.push_back(placeholder);
+	}
+	return placeholder;
+}
+
+void wiArchive::Patch(size_t placeholder, uint64_t value)
+{
+	assert(!readMode);
+	if (placeholder >= streamPos)
+	{
+		memcpy(DATA + (placeholder - streamPos), &value, sizeof(value));
+	}
+	else
+	{
+		stream->overwrite(placeholder, (const uint8_t*)&value, sizeof(value));
+	}
+
+	auto it = std::find(placeholders.begin(), placeholders.end(), placeholder);
+	if (it != placeholders.end())
+	{
+		placeholders.erase(it);
+	}
+}
+
+void wiArchive::Jump(size_t position)
+{
+	assert(readMode);
+	assert(position <= dataSize);
+	pos = position; // compressed data will be waited for by the next read
+}
+
+void wiArchive::_decompress(size_t end)
+{
+	if (compressed == nullptr)
+	{
+		return;
+	}
+	CompressedData& data = *compressed;
+	while (data.nextChunk < data.chunks.size() && data.chunkOffsets[data.nextChunk] < end)
+	{
+		const size_t chunk = data.nextChunk;
+
+		// If the chunk was not started by a worker yet, the reader decompresses it instead of waiting:
+		data.DecompressChunk(chunk, DATA);
+		while (data.chunkStates[chunk].load() == 1)
+		{
+			std::this_thread::yield();
+		}
+		if (data.chunkStates[chunk].load() == 3)
+		{
+			memset(DATA + data.chunkOffsets[chunk], 0, data.chunks[chunk].uncompressedSize);
+			wiHelper::messageBox("The compressed archive is corrupted: " + fileName, "Error!");
+		}
+
+		data.nextChunk++;
+		readLimit = data.chunkOffsets[chunk] + data.chunks[chunk].uncompressedSize;
+	}
+	if (data.nextChunk == data.chunks.size())
+	{
+		readLimit = ~0ull;
+	}
+}
+
+void wiArchive::_flush()
+{
+	// Placeholders are created in increasing order, so the first one is the earliest:
+	const size_t flushSize = placeholders.empty() ? pos : placeholders.front() - streamPos;
+	if (flushSize > 0)
+	{
+		stream->write(DATA, flushSize);
+		memmove(DATA, DATA + flushSize, pos - flushSize);
+		pos -= flushSize;
+		streamPos += flushSize;
+	}
+}
+
 string wiArchive::GetSourceDirectory() const
 {
 	return wiHelper::GetDirectoryFromPath(fileName);
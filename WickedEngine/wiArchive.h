@@ -4,37 +4,100 @@
 
 #include <string>
 #include <vector>
+#include <functional>
+#include <memory>
+#include <unordered_map>
 
 class wiArchive
 {
+public:
+	// Destination of a streaming write archive
+	struct Stream
+	{
+		// Receives the next part of the archive data
+		std::function<void(const uint8_t* data, size_t size)> write;
+		// Optional, overwrites data that was already written at an absolute position in the archive (used by Patch())
+		//	If not provided, data after unpatched placeholders is held back in memory until they are patched
+		std::function<void(size_t offset, const uint8_t* data, size_t size)> overwrite;
+		// Optional, called when the archive is closed, after all data was written
+		std::function<void()> close;
+	};
+
+	// Interned strings, so that repeated strings (for example texture paths) are stored only once
+	struct StringTable
+	{
+		std::vector<std::string> strings;
+		std::unordered_map<std::string, uint64_t> lookup; // only used when writing
+	};
+
 private:
 	uint64_t version = 0;
 	bool readMode = false;
 	size_t pos = 0;
 	uint8_t* DATA = nullptr;
 	size_t dataSize = 0;
+	std::shared_ptr<void> fileData; // if not null, DATA is pointing into read-only file data (file mapping or mounted package)
+
+	Stream* stream = nullptr; // if not null, DATA is a fixed size buffer that is passed to the stream when it is full
+	size_t streamPos = 0; // position of DATA[0] in the whole archive
+	std::vector<size_t> placeholders; // placeholders that are not patched yet and hold back streaming
+
+	struct CompressedData;
+	CompressedData* compressed = nullptr; // if not null, DATA is being decompressed in parallel, in chunks
+	size_t readLimit = ~0ull; // DATA is available for reading until this position
+	bool sharedData = false; // if true, DATA belongs to an other archive
 
 	std::string fileName; // save to this file on closing if not empty
 
-	void CreateEmpty();
+	std::shared_ptr<StringTable> stringTable; // if not null, strings are serialized as indices into this table
+
+	void CreateEmpty(size_t initialSize = 128);
 
 public:
 	// Create empty arhive for writing
 	wiArchive();
 	// Create archive and link to file
-	wiArchive(const std::string& fileName, bool readMode = true);
+	//	In read mode, the file is opened with wiVirtualFileSystem, it will be memory mapped (or read from a mounted package) if possible, so it is not copied into memory as a whole
+	//	In write mode, the data will be streamed to the file in chunks while writing
+	//	compress	: in write mode, the file will be written as independently compressed chunks. Compressed files are detected automatically
+	//				  in read mode, and they are decompressed in parallel while the archive is being read
+	wiArchive(const std::string& fileName, bool readMode = true, bool compress = false);
+	// Create archive for writing that passes the data to the stream in chunks, so the memory usage doesn't grow with the archive size
+	wiArchive(const Stream& stream, size_t chunkSize = 4 * 1024 * 1024);
+	// Create archive for reading the data of an other read mode archive, starting from the specified position
+	//	This can be used to read independent parts of an archive on multiple threads
+	//	The source archive must stay open while this archive is used
+	wiArchive(wiArchive& source, size_t position);
 	~wiArchive();
 
 	const uint8_t* GetData() const { return DATA; }
-	size_t GetSize() const { return pos; }
+	size_t GetSize() const { return streamPos + pos; }
+	// The current read or write position in the archive
+	size_t GetPos() const { return streamPos + pos; }
 	uint64_t GetVersion() const { return version; }
 	bool IsReadMode() const { return readMode; }
+	bool IsMapped() const { return fileData != nullptr; }
+	bool IsStreaming() const { return stream != nullptr; }
+	bool IsCompressed() const { return compressed != nullptr; }
 	void SetReadModeAndResetPos(bool isReadMode);
 	bool IsOpen();
+	// Close the archive. In write mode the file will be saved, in read mode the file data will be released
 	void Close();
+	// Save the archive data that is in memory to a file (streaming archives are already written while writing)
 	bool SaveFile(const std::string& fileName);
+	// Write a placeholder uint64 value, its position is returned. The value can be written later with Patch(), for example to write size prefixes
+	size_t WritePlaceholder();
+	// Write the value of a placeholder
+	void Patch(size_t placeholder, uint64_t value);
+	// Set the read position (only in read mode), this can be used to skip over data or to read it again
+	void Jump(size_t position);
 	std::string GetSourceDirectory() const;
 	std::string GetSourceFileName() const;
+	// While a string table is set, strings are written as indices into the table (new strings are added to it), and read from it
+	//	The table must be serialized separately (for example after the data when writing, and before it when reading),
+	//	without the table being set. Archives that read parts of this archive (see the constructor) share its table.
+	void SetStringTable(const std::shared_ptr<StringTable>& table) { stringTable = table; }
+	const std::shared_ptr<StringTable>& GetStringTable() const { return stringTable; }
 
 	// It could be templated but we have to be extremely careful of different datasizes on different platforms
 	// because serialized data should be interchangeable!
@@ -143,6 +206,17 @@ public:
 	}
 	inline wiArchive& operator<<(const std::string& data)
 	{
+		if (stringTable != nullptr)
+		{
+			auto it = stringTable->lookup.find(data);
+			if (it == stringTable->lookup.end())
+			{
+				it = stringTable->lookup.insert(std::make_pair(data, (uint64_t)stringTable->strings.size())).first;
+				stringTable->strings.push_back(data);
+			}
+			_write(it->second);
+			return *this;
+		}
 		uint64_t len = (uint64_t)(data.length() + 1); // +1 for the null-terminator
 		_write(len);
 		_write(*data.c_str(), len);
@@ -151,6 +225,34 @@ public:
 	template<typename T>
 	inline wiArchive& operator<<(const std::vector<T>& data)
 	{
+		if (IsWideSerializable((const T*)nullptr))
+		{
+			// Integers are written as 64-bit values like the single values, because size_t is not the same size on every platform
+			//	They are converted in blocks, so the array is still written with a few memory operations:
+			_write((uint64_t)data.size());
+			uint64_t block[256];
+			for (size_t i = 0; i < data.size(); i += 256)
+			{
+				const size_t count = data.size() - i < 256 ? data.size() - i : 256;
+				for (size_t j = 0; j < count; ++j)
+				{
+					block[j] = (uint64_t)data[i + j];
+				}
+				_write(block[0], (uint64_t)count);
+			}
+			return *this;
+		}
+		if (version >= 34 && IsBulkSerializable((const T*)nullptr))
+		{
+			// The whole array is written as one block with native element sizes:
+			_write((uint64_t)data.size());
+			if (!data.empty())
+			{
+				_write(data[0], (uint64_t)data.size());
+			}
+			return *this;
+		}
+
 		// Here we will use the << operator so that non-specified types will have compile error!
 		(*this) << data.size();
 		for (const T& x : data)
@@ -281,18 +383,57 @@ public:
 	}
 	inline wiArchive& operator >> (std::string& data)
 	{
+		if (stringTable != nullptr)
+		{
+			uint64_t index;
+			_read(index);
+			if (index < stringTable->strings.size())
+			{
+				data = stringTable->strings[(size_t)index];
+			}
+			else
+			{
+				data.clear();
+			}
+			return *this;
+		}
 		uint64_t len;
 		_read(len);
-		char* str = new char[(size_t)len];
-		memset(str, '\0', (size_t)(sizeof(char)*len));
-		_read(*str, len);
-		data = std::string(str);
-		delete[] str;
+		// The string is assigned directly from the archive data, until the null-terminator:
+		const char* str = (const char*)_skip((size_t)len);
+		data.assign(str, strnlen(str, (size_t)len));
 		return *this;
 	}
 	template<typename T>
 	inline wiArchive& operator >> (std::vector<T>& data)
 	{
+		if (IsWideSerializable((const T*)nullptr) && (version < 34 || version >= 37))
+		{
+			uint64_t count;
+			_read(count);
+			data.resize((size_t)count);
+			const uint8_t* src = _skip((size_t)count * sizeof(uint64_t));
+			for (size_t i = 0; i < data.size(); ++i)
+			{
+				uint64_t value;
+				memcpy(&value, src + i * sizeof(uint64_t), sizeof(uint64_t));
+				data[i] = (T)value;
+			}
+			return *this;
+		}
+		if (version >= 34 && (IsBulkSerializable((const T*)nullptr) || IsWideSerializable((const T*)nullptr)))
+		{
+			// Archive versions 34-36 contain integer arrays with native element sizes too
+			uint64_t count;
+			_read(count);
+			data.resize((size_t)count);
+			if (!data.empty())
+			{
+				_read(data[0], count);
+			}
+			return *this;
+		}
+
 		// Here we will use the >> operator so that non-specified types will have compile error!
 		size_t count;
 		(*this) >> count;
@@ -308,16 +449,61 @@ public:
 
 private:
 
+	// Vectors of these types are serialized as one memory block since archive version 34, because their memory layout is the same on every platform
+	//	Other types (for example long or std::string) are still serialized element by element
+	template<typename T>
+	static constexpr bool IsBulkSerializable(const T*) { return false; }
+	static constexpr bool IsBulkSerializable(const char*) { return true; }
+	static constexpr bool IsBulkSerializable(const unsigned char*) { return true; }
+	static constexpr bool IsBulkSerializable(const float*) { return true; }
+	static constexpr bool IsBulkSerializable(const double*) { return true; }
+	static constexpr bool IsBulkSerializable(const XMFLOAT2*) { return true; }
+	static constexpr bool IsBulkSerializable(const XMFLOAT3*) { return true; }
+	static constexpr bool IsBulkSerializable(const XMFLOAT4*) { return true; }
+	static constexpr bool IsBulkSerializable(const XMFLOAT3X3*) { return true; }
+	static constexpr bool IsBulkSerializable(const XMFLOAT4X3*) { return true; }
+	static constexpr bool IsBulkSerializable(const XMFLOAT4X4*) { return true; }
+	static constexpr bool IsBulkSerializable(const XMUINT2*) { return true; }
+	static constexpr bool IsBulkSerializable(const XMUINT3*) { return true; }
+	static constexpr bool IsBulkSerializable(const XMUINT4*) { return true; }
+
+	// Vectors of these types are serialized with a fixed 64-bit element size, because size_t is one of them on every platform (unsigned int on x86, unsigned long long on x64)
+	//	Archive versions 34-36 wrote them as one memory block with native element sizes
+	template<typename T>
+	static constexpr bool IsWideSerializable(const T*) { return false; }
+	static constexpr bool IsWideSerializable(const int*) { return true; }
+	static constexpr bool IsWideSerializable(const unsigned int*) { return true; }
+	static constexpr bool IsWideSerializable(const long long*) { return true; }
+	static constexpr bool IsWideSerializable(const unsigned long long*) { return true; }
+
 	// This should not be exposed to avoid misaligning data by mistake
 	// Any specific type serialization should be implemented by hand
 	// But these can be used as helper functions inside this class
 
+	// Pass the data to the stream (until the first unpatched placeholder)
+	void _flush();
+
+	// Wait until the data is decompressed until the end position
+	void _decompress(size_t end);
+
 	// Write data using memory operations
 	template<typename T>
 	inline void _write(const T& data, uint64_t count = 1)
 	{
 		size_t _size = (size_t)(sizeof(data)*count);
 		size_t _right = pos + _size;
+		if (_right > dataSize && stream != nullptr)
+		{
+			_flush();
+			if (pos == 0 && _size >= dataSize)
+			{
+				// Data that doesn't fit into the chunk is passed directly:
+				stream->write((const uint8_t*)&data, _size);
+				streamPos += _size;
+				return;
+			}
+			_right = pos + _size;
+		}
 		if (_right > dataSize)
 		{
 			uint8_t* NEWDATA = new uint8_t[_right * 2];
@@ -330,10 +516,26 @@ private:
 		pos = _right;
 	}
 
+	// Retrieve the data at the current read position and move past it
+	inline const uint8_t* _skip(size_t size)
+	{
+		if (pos + size > readLimit)
+		{
+			_decompress(pos + size);
+		}
+		const uint8_t* data = DATA + pos;
+		pos += size;
+		return data;
+	}
+
 	// Read data using memory operations
 	template<typename T>
 	inline void _read(T& data, uint64_t count = 1)
 	{
+		if (pos + (size_t)(sizeof(data)*count) > readLimit)
+		{
+			_decompress(pos + (size_t)(sizeof(data)*count));
+		}
 		memcpy(&data, reinterpret_cast<void*>((uint64_t)DATA + (uint64_t)pos), (size_t)(sizeof(data)*count));
 		pos += (size_t)(sizeof(data)*count);
 	}
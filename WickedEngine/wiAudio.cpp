@@ -334,6 +334,15 @@ namespace wiAudio
 			instance->handle = WI_NULL_HANDLE;
 		}
 	}
+	size_t GetSoundSize(const Sound* sound)
+	{
+		if (sound != nullptr && sound->handle != WI_NULL_HANDLE)
+		{
+			const SoundInternal* soundinternal = (const SoundInternal*)sound->handle;
+			return soundinternal->audioData.size();
+		}
+		return 0;
+	}
 	void Play(SoundInstance* instance)
 	{
 		if (instance != nullptr && instance->handle != WI_NULL_HANDLE)
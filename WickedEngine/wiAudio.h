@@ -65,6 +65,8 @@ namespace wiAudio
 	HRESULT CreateSoundInstance(const Sound* sound, SoundInstance* instance);
 	void Destroy(Sound* sound);
 	void Destroy(SoundInstance* instance);
+	// Returns the size of the audio data in bytes
+	size_t GetSoundSize(const Sound* sound);
 
 	void Play(SoundInstance* instance);
 	void Pause(SoundInstance* instance);
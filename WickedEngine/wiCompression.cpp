@@ -0,0 +1,236 @@
+#include "wiCompression.h"
+
+#include <vector>
+
+using namespace std;
+
+namespace wiCompression
+{
+	static const size_t MINMATCH = 4;
+	static const size_t LASTLITERALS = 5; // the last bytes are always literals
+	static const size_t MFLIMIT = 12; // the last match must start before this many bytes from the end
+	static const size_t MAXOFFSET = 65535;
+	static const uint32_t HASHLOG = 16;
+
+	static inline uint32_t Read32(const uint8_t* p)
+	{
+		uint32_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+	static inline uint32_t Hash(uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - HASHLOG);
+	}
+	static inline uint8_t* WriteLength(uint8_t* op, size_t length)
+	{
+		while (length >= 255)
+		{
+			*op++ = 255;
+			length -= 255;
+		}
+		*op++ = (uint8_t)length;
+		return op;
+	}
+
+	size_t Compress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity)
+	{
+		const uint8_t* ip = src;
+		const uint8_t* anchor = src;
+		const uint8_t* const iend = src + srcSize;
+		uint8_t* op = dst;
+		uint8_t* const oend = dst + dstCapacity;
+
+		if (srcSize > MFLIMIT)
+		{
+			const uint8_t* const mflimit = iend - MFLIMIT;
+			const uint8_t* const matchlimit = iend - LASTLITERALS;
+
+			// Positions of the last occurence of hashed 4 byte sequences:
+			vector<uint32_t> table(size_t(1) << HASHLOG, 0);
+
+			ip++;
+			while (ip < mflimit)
+			{
+				const uint32_t sequence = Read32(ip);
+				const uint32_t hash = Hash(sequence);
+				const uint8_t* ref = src + table[hash];
+				table[hash] = (uint32_t)(ip - src);
+
+				if (size_t(ip - ref) > MAXOFFSET || Read32(ref) != sequence)
+				{
+					// Skip faster over data that doesn't compress:
+					ip += 1 + ((ip - anchor) >> 6);
+					continue;
+				}
+
+				// Extend the match backwards and forwards:
+				while (ip > anchor && ref > src && ip[-1] == ref[-1])
+				{
+					ip--;
+					ref--;
+				}
+				const uint8_t* matchEnd = ip + MINMATCH;
+				const uint8_t* refEnd = ref + MINMATCH;
+				while (matchEnd < matchlimit && *matchEnd == *refEnd)
+				{
+					matchEnd++;
+					refEnd++;
+				}
+
+				const size_t literalLength = size_t(ip - anchor);
+				const size_t matchLength = size_t(matchEnd - ip) - MINMATCH;
+				if (size_t(oend - op) < 1 + literalLength / 255 + 1 + literalLength + 2 + matchLength / 255 + 1)
+				{
+					return 0;
+				}
+
+				// Sequence: token, literal length, literals, offset, match length
+				uint8_t* token = op++;
+				if (literalLength >= 15)
+				{
+					*token = 15 << 4;
+					op = WriteLength(op, literalLength - 15);
+				}
+				else
+				{
+					*token = (uint8_t)(literalLength << 4);
+				}
+				memcpy(op, anchor, literalLength);
+				op += literalLength;
+
+				const uint16_t offset = (uint16_t)(ip - ref);
+				*op++ = (uint8_t)(offset & 0xFF);
+				*op++ = (uint8_t)(offset >> 8);
+
+				if (matchLength >= 15)
+				{
+					*token |= 15;
+					op = WriteLength(op, matchLength - 15);
+				}
+				else
+				{
+					*token |= (uint8_t)matchLength;
+				}
+
+				ip = matchEnd;
+				anchor = ip;
+
+				// Register a position inside the match to find repetitions better:
+				if (ip < mflimit)
+				{
+					table[Hash(Read32(ip - 2))] = (uint32_t)(ip - 2 - src);
+				}
+			}
+		}
+
+		// The last sequence contains only literals:
+		const size_t literalLength = size_t(iend - anchor);
+		if (size_t(oend - op) < 1 + literalLength / 255 + 1 + literalLength)
+		{
+			return 0;
+		}
+		uint8_t* token = op++;
+		if (literalLength >= 15)
+		{
+			*token = 15 << 4;
+			op = WriteLength(op, literalLength - 15);
+		}
+		else
+		{
+			*token = (uint8_t)(literalLength << 4);
+		}
+		memcpy(op, anchor, literalLength);
+		op += literalLength;
+
+		return size_t(op - dst);
+	}
+
+	bool Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize)
+	{
+		const uint8_t* ip = src;
+		const uint8_t* const iend = src + srcSize;
+		uint8_t* op = dst;
+		uint8_t* const oend = dst + dstSize;
+
+		while (ip < iend)
+		{
+			const uint8_t token = *ip++;
+
+			size_t literalLength = token >> 4;
+			if (literalLength == 15)
+			{
+				uint8_t value;
+				do
+				{
+					if (ip >= iend)
+					{
+						return false;
+					}
+					value = *ip++;
+					literalLength += value;
+				} while (value == 255);
+			}
+			if (literalLength > size_t(iend - ip) || literalLength > size_t(oend - op))
+			{
+				return false;
+			}
+			memcpy(op, ip, literalLength);
+			ip += literalLength;
+			op += literalLength;
+
+			if (ip >= iend)
+			{
+				break; // the last sequence has no match
+			}
+
+			if (iend - ip < 2)
+			{
+				return false;
+			}
+			const size_t offset = size_t(ip[0]) | (size_t(ip[1]) << 8);
+			ip += 2;
+			if (offset == 0 || offset > size_t(op - dst))
+			{
+				return false;
+			}
+
+			size_t matchLength = token & 15;
+			if (matchLength == 15)
+			{
+				uint8_t value;
+				do
+				{
+					if (ip >= iend)
+					{
+						return false;
+					}
+					value = *ip++;
+					matchLength += value;
+				} while (value == 255);
+			}
+			matchLength += MINMATCH;
+			if (matchLength > size_t(oend - op))
+			{
+				return false;
+			}
+
+			const uint8_t* match = op - offset;
+			if (offset >= matchLength)
+			{
+				memcpy(op, match, matchLength);
+			}
+			else
+			{
+				// Overlapping match repeats the previous bytes:
+				for (size_t i = 0; i < matchLength; ++i)
+				{
+					op[i] = match[i];
+				}
+			}
+			op += matchLength;
+		}
+
+		return op == oend;
+	}
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include "CommonInclude.h"
+
+// Fast LZ compression (LZ4 block format compatible)
+namespace wiCompression
+{
+	// The worst case size of the compressed data
+	inline size_t CompressBound(size_t size) { return size + size / 255 + 16; }
+
+	// Compress a block of data
+	//	returns the compressed size, or 0 if the result would not fit into dstCapacity
+	size_t Compress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity);
+
+	// Decompress a block that was compressed with Compress()
+	//	dstSize	: the exact uncompressed size
+	//	returns false if the compressed data is invalid
+	bool Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize);
+}
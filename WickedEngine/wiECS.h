@@ -36,8 +36,22 @@ namespace wiECS
 		}
 	}
 
+	// Type independent interface of component managers, so that different kinds of component managers can be handled together
+	class ComponentManager_Interface
+	{
+	public:
+		virtual ~ComponentManager_Interface() = default;
+		virtual void Clear() = 0;
+		virtual void Serialize(wiArchive& archive, uint32_t seed, bool propagateSeedDeep) = 0;
+		virtual void SerializeComponent(wiArchive& archive, Entity entity, uint32_t seed) = 0;
+		virtual void Remove(Entity entity) = 0;
+		virtual bool Contains(Entity entity) const = 0;
+		virtual size_t GetCount() const = 0;
+		virtual Entity GetEntity(size_t index) const = 0;
+	};
+
 	template<typename Component>
-	class ComponentManager
+	class ComponentManager final : public ComponentManager_Interface
 	{
 	public:
 
@@ -50,13 +64,21 @@ namespace wiECS
 		}
 
 		// Clear the whole container
-		inline void Clear()
+		inline void Clear() override
 		{
 			components.clear();
 			entities.clear();
 			lookup.clear();
 		}
 
+		// Reserve memory for the specified number of components, so that creating components until then won't reallocate the containers
+		inline void Reserve(size_t count)
+		{
+			components.reserve(count);
+			entities.reserve(count);
+			lookup.reserve(count);
+		}
+
 		// Perform deep copy of all the contents of "other" into this
 		inline void Copy(const ComponentManager<Component>& other)
 		{
@@ -90,7 +112,7 @@ namespace wiECS
 		// Read/Write everything to an archive depending on the archive state
 		//	seed: needed when serializing from disk which might cause discrepancy in entity uniqueness
 		//	propagateSeedDeep: Components can have Entity references inside them, should the seed be propageted to those too?
-		inline void Serialize(wiArchive& archive, uint32_t seed = 0, bool propagateSeedDeep = true)
+		inline void Serialize(wiArchive& archive, uint32_t seed = 0, bool propagateSeedDeep = true) override
 		{
 			if (archive.IsReadMode())
 			{
@@ -128,6 +150,31 @@ namespace wiECS
 			}
 		}
 
+		// Read/Write the component of a single entity depending on the archive state (the entity itself is not serialized)
+		//	In write mode, the component must exist
+		//	In read mode, the component is created if it doesn't exist yet, otherwise it is replaced
+		inline void SerializeComponent(wiArchive& archive, Entity entity, uint32_t seed = 0) override
+		{
+			if (archive.IsReadMode())
+			{
+				auto it = lookup.find(entity);
+				if (it == lookup.end())
+				{
+					Create(entity).Serialize(archive, seed);
+				}
+				else
+				{
+					components[it->second] = Component();
+					components[it->second].Serialize(archive, seed);
+				}
+			}
+			else
+			{
+				assert(Contains(entity));
+				components[lookup[entity]].Serialize(archive);
+			}
+		}
+
 		// Create a new component and retrieve a reference to it
 		inline Component& Create(Entity entity)
 		{
@@ -154,7 +201,7 @@ namespace wiECS
 		}
 
 		// Remove a component of a certain entity if it exists
-		inline void Remove(Entity entity)
+		inline void Remove(Entity entity) override
 		{
 			auto it = lookup.find(entity);
 			if (it != lookup.end())
@@ -243,7 +290,7 @@ namespace wiECS
 		}
 
 		// Check if a component exists for a given entity or not
-		inline bool Contains(Entity entity) const
+		inline bool Contains(Entity entity) const override
 		{
 			return lookup.find(entity) != lookup.end();
 		}
@@ -282,11 +329,11 @@ namespace wiECS
 		}
 
 		// Retrieve the number of existing entries
-		inline size_t GetCount() const { return components.size(); }
+		inline size_t GetCount() const override { return components.size(); }
 
 		// Directly index a specific component without indirection
 		//	0 <= index < GetCount()
-		inline Entity GetEntity(size_t index) const { return entities[index]; }
+		inline Entity GetEntity(size_t index) const override { return entities[index]; }
 
 		// Directly index a specific [read/write] component without indirection
 		//	0 <= index < GetCount()
@@ -269,7 +269,7 @@ void wiEmittedParticle::UpdateGPU(const TransformComponent& transform, const Mat
 		EmittedParticleCB cb;
 		cb.xEmitterWorld = transform.world;
 		cb.xEmitCount = (UINT)emit;
-		cb.xEmitterMeshIndexCount = mesh == nullptr ? 0 : (UINT)mesh->indices.size();
+		cb.xEmitterMeshIndexCount = mesh == nullptr ? 0 : (UINT)mesh->GetLOD0IndexCount();
 		cb.xEmitterMeshVertexPositionStride = sizeof(MeshComponent::Vertex_POS);
 		cb.xEmitterRandomness = wiRandom::getRandom(0, 1000) * 0.001f;
 		cb.xParticleLifeSpan = life;
@@ -344,7 +344,7 @@ void wiEmittedParticle::UpdateGPU(const TransformComponent& transform, const Mat
 
 		if (IsSPHEnabled())
 		{
-			auto range = wiProfiler::BeginRangeGPU("SPH - Simulation", cmd);
+			auto range = wiProfiler::BeginRangeGPU(WI_HASHSTRING("SPH - Simulation"), cmd);
 
 			// Smooth Particle Hydrodynamics:
 			device->EventBegin("SPH - Simulation", cmd);
@@ -65,6 +65,17 @@ void wiGPUBVH::UpdateGlobalMaterialResources(const Scene& scene, CommandList cmd
 
 	bool repackAtlas = false;
 	const int atlasWrapBorder = 1;
+
+	// Textures that were loaded in the background are swapped into the placeholder texture objects,
+	//	so the pointers stay the same, but the sizes and contents are different:
+	const uint64_t currentTextureSwapCount = wiResourceManager::GetTextureSwapCount();
+	if (textureSwapCount != currentTextureSwapCount)
+	{
+		textureSwapCount = currentTextureSwapCount;
+		storedTextures.clear();
+		repackAtlas = true;
+	}
+
 	for (const Texture2D* tex : sceneTextures)
 	{
 		if (tex == nullptr)
@@ -136,8 +147,13 @@ void wiGPUBVH::UpdateGlobalMaterialResources(const Scene& scene, CommandList cmd
 		{
 			const MeshComponent& mesh = *scene.meshes.GetComponent(object.meshID);
 
-			for (auto& subset : mesh.subsets)
+			// Only LOD0 is traced, the LOD levels use the same materials:
+			uint32_t first_subset = 0;
+			uint32_t last_subset = 0;
+			mesh.GetLODSubsetRange(0, first_subset, last_subset);
+			for (uint32_t subsetIndex = first_subset; subsetIndex < last_subset; ++subsetIndex)
 			{
+				const MeshComponent::MeshSubset& subset = mesh.subsets[subsetIndex];
 				const MaterialComponent& material = *scene.materials.GetComponent(subset.materialID);
 				ShaderMaterial global_material = material.CreateShaderMaterial();
 
@@ -286,7 +302,7 @@ void wiGPUBVH::Build(const Scene& scene, CommandList cmd)
 		{
 			const MeshComponent& mesh = *scene.meshes.GetComponent(object.meshID);
 
-			totalTriangles += (uint)mesh.indices.size() / 3;
+			totalTriangles += (uint)mesh.GetLOD0IndexCount() / 3;
 		}
 	}
 
@@ -376,7 +392,7 @@ void wiGPUBVH::Build(const Scene& scene, CommandList cmd)
 	}
 
 
-	auto range = wiProfiler::BeginRangeGPU("BVH Rebuild", cmd);
+	auto range = wiProfiler::BeginRangeGPU(WI_HASHSTRING("BVH Rebuild"), cmd);
 
 	UpdateGlobalMaterialResources(scene, cmd);
 
@@ -407,7 +423,8 @@ void wiGPUBVH::Build(const Scene& scene, CommandList cmd)
 				cb.xBVHInstanceColor = object.color;
 				cb.xBVHMaterialOffset = materialCount;
 				cb.xBVHMeshTriangleOffset = primitiveCount;
-				cb.xBVHMeshTriangleCount = (uint)mesh.indices.size() / 3;
+				// LOD0 indices are placed before the other LOD levels in the index buffer:
+				cb.xBVHMeshTriangleCount = (uint)mesh.GetLOD0IndexCount() / 3;
 				cb.xBVHMeshVertexPOSStride = sizeof(MeshComponent::Vertex_POS);
 
 				device->UpdateBuffer(&constantBuffer, &cb, cmd);
@@ -428,10 +445,10 @@ void wiGPUBVH::Build(const Scene& scene, CommandList cmd)
 
 				device->Dispatch((cb.xBVHMeshTriangleCount + BVH_BUILDER_GROUPSIZE - 1) / BVH_BUILDER_GROUPSIZE, 1, 1, cmd);
 
-				for (auto& subset : mesh.subsets)
-				{
-					materialCount++;
-				}
+				uint32_t first_subset = 0;
+				uint32_t last_subset = 0;
+				mesh.GetLODSubsetRange(0, first_subset, last_subset);
+				materialCount += last_subset - first_subset;
 			}
 		}
 
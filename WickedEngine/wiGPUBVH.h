@@ -30,6 +30,7 @@ private:
 	std::vector<ShaderMaterial> materialArray;
 	std::unordered_map<const wiGraphics::Texture2D*, wiRectPacker::rect_xywh> storedTextures;
 	std::unordered_set<const wiGraphics::Texture2D*> sceneTextures;
+	uint64_t textureSwapCount = 0; // the atlas is repacked when textures were swapped by background loading
 	void UpdateGlobalMaterialResources(const wiSceneSystem::Scene& scene, wiGraphics::CommandList cmd);
 
 public:
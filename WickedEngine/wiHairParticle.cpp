@@ -108,7 +108,7 @@ void wiHairParticle::UpdateGPU(const MeshComponent& mesh, const MaterialComponen
 	hcb.xHairParticleCount = hcb.xHairStrandCount * hcb.xHairSegmentCount;
 	hcb.xHairRandomSeed = randomSeed;
 	hcb.xHairViewDistance = viewDistance;
-	hcb.xHairBaseMeshIndexCount = (uint)mesh.indices.size();
+	hcb.xHairBaseMeshIndexCount = (uint)mesh.GetLOD0IndexCount();
 	hcb.xHairBaseMeshVertexPositionStride = sizeof(MeshComponent::Vertex_POS);
 	// segmentCount will be loop in the shader, not a threadgroup so we don't need it here:
 	hcb.xHairNumDispatchGroups = (uint)ceilf((float)strandCount / (float)THREADCOUNT_SIMULATEHAIR);
@@ -0,0 +1,132 @@
+#include "wiHashString.h"
+
+#include <unordered_map>
+#include <shared_mutex>
+#include <mutex>
+#include <atomic>
+#include <cassert>
+
+struct InternedString
+{
+	uint64_t hash;
+	std::string value;
+};
+
+// All interned strings, the entries are never removed, so they can be referenced without locking
+struct InternTable
+{
+	std::shared_timed_mutex locker;
+	std::unordered_map<uint64_t, InternedString> entries;
+};
+static InternTable& GetInternTable()
+{
+	static InternTable table; // constructed on first use, wiHashString can be used by static initializers
+	return table;
+}
+
+// Lock-free cache of the interned string literals, indexed by hash with linear probing
+//	Once a slot is filled it never changes, so a literal that was already interned is only an atomic load
+static const size_t LITERAL_CACHE_SIZE = 4096;
+static const size_t LITERAL_CACHE_PROBES = 16;
+static std::atomic<const InternedString*> literalCache[LITERAL_CACHE_SIZE] = {};
+
+static void CheckCollision(const InternedString& entry, const char* value, size_t length)
+{
+#ifdef _DEBUG
+	// Different strings with the same hash would be the same wiHashString:
+	assert(entry.value.length() == length && entry.value.compare(0, length, value, length) == 0);
+#endif // _DEBUG
+}
+
+static const InternedString& InternString(uint64_t hash, const char* value, size_t length)
+{
+	InternTable& table = GetInternTable();
+	{
+		std::shared_lock<std::shared_timed_mutex> lock(table.locker);
+		auto it = table.entries.find(hash);
+		if (it != table.entries.end())
+		{
+			CheckCollision(it->second, value, length);
+			return it->second;
+		}
+	}
+
+	std::unique_lock<std::shared_timed_mutex> lock(table.locker);
+	auto it = table.entries.find(hash);
+	if (it == table.entries.end())
+	{
+		InternedString entry;
+		entry.hash = hash;
+		entry.value.assign(value, length);
+		it = table.entries.insert(std::make_pair(hash, std::move(entry))).first;
+	}
+	CheckCollision(it->second, value, length);
+	return it->second;
+}
+
+static const InternedString* FindLiteral(uint64_t hash)
+{
+	for (size_t i = 0; i < LITERAL_CACHE_PROBES; ++i)
+	{
+		const InternedString* entry = literalCache[(hash + i) % LITERAL_CACHE_SIZE].load(std::memory_order_acquire);
+		if (entry == nullptr || entry->hash == hash)
+		{
+			return entry;
+		}
+	}
+	return nullptr;
+}
+
+void wiHashString::Intern(uint64_t hash, const char* value, size_t length)
+{
+	InternString(hash, value, length);
+}
+
+void wiHashString::InternLiteral(uint64_t hash, const char* value)
+{
+	for (size_t i = 0; i < LITERAL_CACHE_PROBES; ++i)
+	{
+		std::atomic<const InternedString*>& slot = literalCache[(hash + i) % LITERAL_CACHE_SIZE];
+		const InternedString* entry = slot.load(std::memory_order_acquire);
+		if (entry == nullptr)
+		{
+			// First use of the literal, it is interned and cached:
+			const InternedString* interned = &InternString(hash, value, strlen(value));
+			if (slot.compare_exchange_strong(entry, interned, std::memory_order_acq_rel))
+			{
+				return;
+			}
+			// An other thread filled the slot in the meantime, entry is the new value now
+		}
+		if (entry->hash == hash)
+		{
+#ifdef _DEBUG
+			CheckCollision(*entry, value, strlen(value));
+#endif // _DEBUG
+			return;
+		}
+	}
+
+	// The cache is full around this slot, the literal is interned without caching:
+	InternString(hash, value, strlen(value));
+}
+
+const std::string& wiHashString::GetString() const
+{
+	const InternedString* entry = FindLiteral(hash);
+	if (entry != nullptr)
+	{
+		return entry->value;
+	}
+
+	InternTable& table = GetInternTable();
+	std::shared_lock<std::shared_timed_mutex> lock(table.locker);
+	auto it = table.entries.find(hash);
+	if (it != table.entries.end())
+	{
+		return it->second.value;
+	}
+
+	static const std::string empty;
+	return empty; // every constructor interns its string, except the default constructor (empty string)
+}
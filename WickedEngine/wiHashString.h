@@ -2,24 +2,85 @@
 #include "CommonInclude.h"
 
 #include <string>
+#include <cstring>
+#include <type_traits>
 
+// 8 byte string identifier: the string is hashed once and interned into a global table, so it can be recovered with GetString()
+//	String literals are interned through a lock-free cache, WI_HASHSTRING() also guarantees that their hash is computed at compile time
+//	and only interns the literal the first time it's executed
+//	Hash collisions of different strings are detected in debug builds
 class wiHashString
 {
 private:
-	std::string str;
-	size_t hash;
+	uint64_t hash = 14695981039346656037ull; // empty string
+
+	// Intern a string, the hash must be computed from it
+	static void Intern(uint64_t hash, const char* value, size_t length);
+	static void InternLiteral(uint64_t hash, const char* value);
 public:
-	wiHashString(const std::string& value = "") : str(value), hash(std::hash<std::string>{}(value)) {}
-	wiHashString(const char* value) : wiHashString(std::string(value)) {}
+	// FNV-1a, it can also be used for arbitrary data
+	//	seed	: the hash of the previous data to continue hashing after it
+	static constexpr uint64_t Hash(const char* value, size_t length, uint64_t seed = 14695981039346656037ull)
+	{
+		uint64_t result = seed;
+		for (size_t i = 0; i < length; ++i)
+		{
+			result ^= (uint8_t)value[i];
+			result *= 1099511628211ull;
+		}
+		return result;
+	}
+	static constexpr uint64_t Hash(const char* value)
+	{
+		uint64_t result = 14695981039346656037ull;
+		for (size_t i = 0; value[i] != 0; ++i)
+		{
+			result ^= (uint8_t)value[i];
+			result *= 1099511628211ull;
+		}
+		return result;
+	}
 
-	constexpr const std::string& GetString() const { return str; }
-	constexpr size_t GetHash() const { return hash; }
+	constexpr wiHashString() = default;
+	wiHashString(const std::string& value) : hash(Hash(value.c_str(), value.length())) { Intern(hash, value.c_str(), value.length()); }
+	// C string (it is a template, so that string literals choose the literal constructor instead)
+	template<typename T, typename std::enable_if<std::is_same<T, const char*>::value || std::is_same<T, char*>::value, int>::type = 0>
+	wiHashString(T value) : hash(Hash(value)) { Intern(hash, value, strlen(value)); }
+	// String literal, it is interned the first time, after that it's only a lookup in the lock-free literal cache
+	template<size_t N>
+	wiHashString(const char(&value)[N]) : hash(Hash(value)) { InternLiteral(hash, value); }
+	// Modifiable character arrays are not literals, they are copied when interned
+	template<size_t N>
+	wiHashString(char(&value)[N]) : wiHashString(std::string(value)) {}
+
+	// String literal with the hash as a template argument, so it is always computed at compile time, use it by WI_HASHSTRING()
+	//	The literal is interned once for every literal hash, after that only the hash is returned
+	template<uint64_t literalHash, size_t N>
+	static wiHashString Literal(const char(&value)[N])
+	{
+		static const bool interned = (InternLiteral(literalHash, value), true);
+		(void)interned;
+		wiHashString result;
+		result.hash = literalHash;
+		return result;
+	}
+
+	// Returns the interned string
+	const std::string& GetString() const;
+	constexpr size_t GetHash() const { return (size_t)hash; }
 };
 
+// Interned string literal with compile time hash
+#define WI_HASHSTRING(literal) wiHashString::Literal<wiHashString::Hash(literal)>(literal)
+
 constexpr bool operator==(const wiHashString& a, const wiHashString& b)
 {
 	return a.GetHash() == b.GetHash();
 }
+constexpr bool operator!=(const wiHashString& a, const wiHashString& b)
+{
+	return a.GetHash() != b.GetHash();
+}
 
 namespace std
 {
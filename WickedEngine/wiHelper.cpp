@@ -49,6 +49,71 @@ namespace wiHelper
 		return false;
 	}
 
+	bool MapFile(const std::string& fileName, MappedFile& file)
+	{
+		UnmapFile(file);
+
+#ifndef WINSTORE_SUPPORT
+		wstring wfileName;
+		StringConvert(fileName, wfileName);
+
+		HANDLE fileHandle = CreateFileW(wfileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (fileHandle == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+		{
+			CloseHandle(fileHandle);
+			return false;
+		}
+
+		HANDLE mappingHandle = CreateFileMappingW(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mappingHandle == nullptr)
+		{
+			CloseHandle(fileHandle);
+			return false;
+		}
+
+		const void* data = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+		if (data == nullptr)
+		{
+			CloseHandle(mappingHandle);
+			CloseHandle(fileHandle);
+			return false;
+		}
+
+		file.data = (const uint8_t*)data;
+		file.size = (size_t)fileSize.QuadPart;
+		file.fileHandle = fileHandle;
+		file.mappingHandle = mappingHandle;
+		return true;
+#else
+		return false;
+#endif // WINSTORE_SUPPORT
+	}
+
+	void UnmapFile(MappedFile& file)
+	{
+#ifndef WINSTORE_SUPPORT
+		if (file.data != nullptr)
+		{
+			UnmapViewOfFile(file.data);
+		}
+		if (file.mappingHandle != nullptr)
+		{
+			CloseHandle(file.mappingHandle);
+		}
+		if (file.fileHandle != nullptr)
+		{
+			CloseHandle(file.fileHandle);
+		}
+#endif // WINSTORE_SUPPORT
+		file = MappedFile();
+	}
+
 	void messageBox(const std::string& msg, const std::string& caption){
 #ifndef WINSTORE_SUPPORT
 		MessageBoxA(wiWindowRegistration::GetRegisteredWindow(), msg.c_str(), caption.c_str(), 0);
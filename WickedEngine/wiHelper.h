@@ -18,6 +18,19 @@ namespace wiHelper
 
 	bool readByteData(const std::string& fileName, std::vector<uint8_t>& data);
 
+	// Read-only memory mapped view of a whole file
+	struct MappedFile
+	{
+		const uint8_t* data = nullptr;
+		size_t size = 0;
+		void* fileHandle = nullptr;
+		void* mappingHandle = nullptr;
+	};
+	// Map a file into memory for reading. Returns false if the file can't be mapped, then it can still be read with readByteData()
+	bool MapFile(const std::string& fileName, MappedFile& file);
+	// Unmap the file, the mapped data will be no longer valid
+	void UnmapFile(MappedFile& file);
+
 	void messageBox(const std::string& msg, const std::string& caption = "Warning!");
 
 	void screenshot(const std::string& name = "");
@@ -2,6 +2,7 @@
 #include "wiSpinLock.h"
 #include "wiBackLog.h"
 #include "wiContainers.h"
+#include "wiProfiler.h"
 
 #include <thread>
 #include <condition_variable>
@@ -14,26 +15,62 @@ namespace wiJobSystem
 	{
 		std::function<void()> task;
 		context* ctx;
+		bool background;
 	};
 
 	uint32_t numThreads = 0;
+	std::atomic<uint32_t> activeThreadCount{ 0 };
 	wiContainers::ThreadSafeRingBuffer<Job, 256> jobQueue;
+	wiContainers::ThreadSafeRingBuffer<Job, 256> backgroundQueue;
 	std::condition_variable wakeCondition;
 	std::mutex wakeMutex;
+	thread_local bool backgroundJob = false; // the thread is executing a background job
 
-	// This function executes the next item from the job queue. Returns true if successful, false if there was no job available
-	inline bool work()
+	// This function executes the next item from the job queue (or the background queue). Returns true if successful, false if there was no job available
+	inline bool work(bool background = false)
 	{
 		Job job;
-		if (jobQueue.pop_front(job))
+		if ((background ? backgroundQueue : jobQueue).pop_front(job))
 		{
+			const bool wasBackgroundJob = backgroundJob;
+			backgroundJob = job.background;
+			auto range = wiProfiler::BeginRangeCPU(job.background ? WI_HASHSTRING("Background Job") : WI_HASHSTRING("Job"));
 			job.task(); // execute job
+			wiProfiler::EndRange(range);
+			backgroundJob = wasBackgroundJob;
+			if (job.background)
+			{
+				job.ctx->backgroundCounter.fetch_sub(1);
+			}
 			job.ctx->counter.fetch_sub(1);
 			return true;
 		}
 		return false;
 	}
 
+	// Try to push a new job until it is pushed successfully, a full queue is helped by this thread too (it could be a job that is pushing new jobs)
+	//	A full background queue is only helped by background jobs, other threads wait for the worker threads instead
+	inline void push(const Job& job)
+	{
+		if (job.background)
+		{
+			job.ctx->backgroundCounter.fetch_add(1);
+		}
+		auto& queue = job.background ? backgroundQueue : jobQueue;
+		while (!queue.push_back(job))
+		{
+			wakeCondition.notify_all();
+			if (!job.background || backgroundJob)
+			{
+				work(job.background);
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
 	void Initialize()
 	{
 		// Retrieve the number of hardware threads in this system:
@@ -41,16 +78,19 @@ namespace wiJobSystem
 
 		// Calculate the actual number of worker threads we want (-1 main thread):
 		numThreads = std::max(1u, numCores - 1);
+		activeThreadCount.store(numThreads);
 
 		for (uint32_t threadID = 0; threadID < numThreads; ++threadID)
 		{
-			std::thread worker([] {
+			std::thread worker([threadID] {
+
+				wiProfiler::SetThreadName("wiJobSystem_" + std::to_string(threadID));
 
 				std::function<void()> job;
 
 				while (true)
 				{
-					if (!work())
+					if (threadID >= activeThreadCount.load() || (!work() && !work(true)))
 					{
 						// no job, put thread to sleep
 						std::unique_lock<std::mutex> lock(wakeMutex);
@@ -93,13 +133,34 @@ namespace wiJobSystem
 		return numThreads;
 	}
 
+	void SetActiveThreadCount(uint32_t count)
+	{
+		activeThreadCount.store(std::min(count, numThreads));
+		wakeCondition.notify_all();
+	}
+
+	uint32_t GetActiveThreadCount()
+	{
+		return activeThreadCount.load();
+	}
+
 	void Execute(context& ctx, const std::function<void()>& job)
 	{
 		// Context state is updated:
 		ctx.counter.fetch_add(1);
 
-		// Try to push a new job until it is pushed successfully:
-		while (!jobQueue.push_back({ job, &ctx })) { wakeCondition.notify_all(); }
+		push({ job, &ctx, backgroundJob });
+
+		// Wake any one thread that might be sleeping:
+		wakeCondition.notify_one();
+	}
+
+	void ExecuteBackground(context& ctx, const std::function<void()>& job)
+	{
+		// Context state is updated:
+		ctx.counter.fetch_add(1);
+
+		push({ job, &ctx, true });
 
 		// Wake any one thread that might be sleeping:
 		wakeCondition.notify_one();
@@ -138,8 +199,7 @@ namespace wiJobSystem
 				}
 			};
 
-			// Try to push a new job until it is pushed successfully:
-			while (!jobQueue.push_back({ jobGroup, &ctx })) { wakeCondition.notify_all(); }
+			push({ jobGroup, &ctx, backgroundJob });
 		}
 
 		// Wake any threads that might be sleeping:
@@ -157,7 +217,14 @@ namespace wiJobSystem
 		// Wake any threads that might be sleeping:
 		wakeCondition.notify_all();
 
-		// Waiting will also put the current thread to good use by working on an other job if it can:
-		while (IsBusy(ctx)) { work(); }
+		// Waiting will also put the current thread to good use by working on an other job if it can
+		//	Background jobs can take long, so they are only executed here if this thread is in the background, or it is waiting for the background:
+		while (IsBusy(ctx))
+		{
+			if (!work() && (backgroundJob || ctx.backgroundCounter.load() > 0))
+			{
+				work(true);
+			}
+		}
 	}
 }
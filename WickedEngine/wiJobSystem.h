@@ -15,15 +15,26 @@ namespace wiJobSystem
 
 	uint32_t GetThreadCount();
 
+	// Limit the number of worker threads that can execute jobs, for example to measure how a task scales with thread count
+	//	The threads that are waiting for jobs will still execute jobs too, so with a limit of 0, only Wait() executes jobs. The limit is GetThreadCount() by default
+	void SetActiveThreadCount(uint32_t count);
+	uint32_t GetActiveThreadCount();
+
 	// Defines a state of execution, can be waited on
 	struct context
 	{
 		std::atomic<uint32_t> counter{ 0 };
+		std::atomic<uint32_t> backgroundCounter{ 0 }; // background jobs of the context that are not finished yet
 	};
 
 	// Add a job to execute asynchronously. Any idle thread will execute this job.
 	void Execute(context& ctx, const std::function<void()>& job);
 
+	// Add a long running job (like loading) that is executed only by the worker threads, so it will never be executed
+	//	by a thread that is waiting for other work with Wait() (like the main thread every frame)
+	//	The jobs that a background job adds with Execute() or Dispatch() are background jobs too
+	void ExecuteBackground(context& ctx, const std::function<void()>& job);
+
 	// Divide a job onto multiple jobs and execute in parallel.
 	//	jobCount	: how many jobs to generate for this task.
 	//	groupSize	: how many jobs to execute per thread. Jobs inside a group execute serially. It might be worth to increase for small jobs
@@ -34,5 +45,6 @@ namespace wiJobSystem
 	bool IsBusy(const context& ctx);
 
 	// Wait until all threads become idle
+	//	The waiting thread executes jobs too, but background jobs only if it is waiting for a background job or it is executing one
 	void Wait(const context& ctx);
 }
@@ -0,0 +1,999 @@
+#include "wiMeshOptimizer.h"
+
+#include <unordered_map>
+#include <algorithm>
+#include <cassert>
+
+using namespace std;
+
+namespace wiMeshOptimizer
+{
+	size_t WeldPositions(const XMFLOAT3* positions, size_t vertexCount, vector<uint32_t>& weld, float tolerance)
+	{
+		weld.resize(vertexCount);
+		size_t uniqueCount = 0;
+
+		if (tolerance <= 0)
+		{
+			struct PositionHasher
+			{
+				inline size_t operator()(const XMFLOAT3& p) const
+				{
+					const uint32_t* bits = (const uint32_t*)&p;
+					return ((size_t)bits[0] * 73856093) ^ ((size_t)bits[1] * 19349663) ^ ((size_t)bits[2] * 83492791);
+				}
+			};
+			struct PositionEqual
+			{
+				inline bool operator()(const XMFLOAT3& a, const XMFLOAT3& b) const
+				{
+					return memcmp(&a, &b, sizeof(XMFLOAT3)) == 0;
+				}
+			};
+			unordered_map<XMFLOAT3, uint32_t, PositionHasher, PositionEqual> lookup;
+			lookup.reserve(vertexCount);
+
+			for (size_t i = 0; i < vertexCount; ++i)
+			{
+				// +0 and -0 are the same position, but they are different bitwise:
+				const XMFLOAT3 p = XMFLOAT3(positions[i].x + 0.0f, positions[i].y + 0.0f, positions[i].z + 0.0f);
+				auto it = lookup.insert(make_pair(p, (uint32_t)i));
+				weld[i] = it.first->second;
+				uniqueCount += it.second ? 1 : 0;
+			}
+			return uniqueCount;
+		}
+
+		// Spatial hash with cells of tolerance size, a welded position can be found in the 3x3x3 neighbouring cells:
+		struct Cell
+		{
+			int64_t x, y, z;
+			inline bool operator==(const Cell& other) const { return x == other.x && y == other.y && z == other.z; }
+		};
+		struct CellHasher
+		{
+			inline size_t operator()(const Cell& c) const
+			{
+				return ((size_t)c.x * 73856093) ^ ((size_t)c.y * 19349663) ^ ((size_t)c.z * 83492791);
+			}
+		};
+		unordered_map<Cell, uint32_t, CellHasher> cells; // first unique vertex in the cell
+		cells.reserve(vertexCount);
+		vector<uint32_t> next(vertexCount, ~0u); // next unique vertex in the same cell
+
+		const double scale = 1.0 / (double)tolerance;
+		for (size_t i = 0; i < vertexCount; ++i)
+		{
+			const XMFLOAT3& p = positions[i];
+			const Cell cell = { (int64_t)floor(p.x * scale), (int64_t)floor(p.y * scale), (int64_t)floor(p.z * scale) };
+
+			uint32_t found = ~0u;
+			for (int64_t x = -1; x <= 1 && found == ~0u; ++x)
+			{
+				for (int64_t y = -1; y <= 1 && found == ~0u; ++y)
+				{
+					for (int64_t z = -1; z <= 1 && found == ~0u; ++z)
+					{
+						auto it = cells.find({ cell.x + x, cell.y + y, cell.z + z });
+						if (it == cells.end())
+						{
+							continue;
+						}
+						for (uint32_t candidate = it->second; candidate != ~0u; candidate = next[candidate])
+						{
+							const XMFLOAT3& q = positions[candidate];
+							if (fabs(p.x - q.x) < tolerance && fabs(p.y - q.y) < tolerance && fabs(p.z - q.z) < tolerance)
+							{
+								found = candidate;
+								break;
+							}
+						}
+					}
+				}
+			}
+
+			if (found != ~0u)
+			{
+				weld[i] = found;
+			}
+			else
+			{
+				weld[i] = (uint32_t)i;
+				uniqueCount++;
+				auto it = cells.insert(make_pair(cell, (uint32_t)i));
+				if (!it.second)
+				{
+					next[i] = it.first->second;
+					it.first->second = (uint32_t)i;
+				}
+			}
+		}
+		return uniqueCount;
+	}
+
+	// Symmetric 4x4 matrix of the plane equations, its error is the sum of squared distances to the planes
+	struct Quadric
+	{
+		float a2 = 0, b2 = 0, c2 = 0, d2 = 0;
+		float ab = 0, ac = 0, ad = 0;
+		float bc = 0, bd = 0, cd = 0;
+
+		void AddPlane(const XMFLOAT3& normal, float d, float weight)
+		{
+			a2 += normal.x * normal.x * weight;
+			b2 += normal.y * normal.y * weight;
+			c2 += normal.z * normal.z * weight;
+			d2 += d * d * weight;
+			ab += normal.x * normal.y * weight;
+			ac += normal.x * normal.z * weight;
+			ad += normal.x * d * weight;
+			bc += normal.y * normal.z * weight;
+			bd += normal.y * d * weight;
+			cd += normal.z * d * weight;
+		}
+		void Add(const Quadric& other)
+		{
+			a2 += other.a2; b2 += other.b2; c2 += other.c2; d2 += other.d2;
+			ab += other.ab; ac += other.ac; ad += other.ad;
+			bc += other.bc; bd += other.bd; cd += other.cd;
+		}
+		float Error(const XMFLOAT3& p) const
+		{
+			const float rx = a2 * p.x + ab * p.y + ac * p.z + ad;
+			const float ry = ab * p.x + b2 * p.y + bc * p.z + bd;
+			const float rz = ac * p.x + bc * p.y + c2 * p.z + cd;
+			const float rw = ad * p.x + bd * p.y + cd * p.z + d2;
+			return fabsf(rx * p.x + ry * p.y + rz * p.z + rw);
+		}
+	};
+
+	float Simplify(vector<uint32_t>& indices, const XMFLOAT3* positions, size_t vertexCount, size_t targetIndexCount, float targetError)
+	{
+		const uint32_t triangleCount = (uint32_t)indices.size() / 3;
+		if (triangleCount == 0 || indices.size() <= targetIndexCount)
+		{
+			return 0;
+		}
+
+		vector<uint32_t> weld;
+		WeldPositions(positions, vertexCount, weld);
+
+		// Work in a normalized space, so errors are relative to the mesh extents:
+		XMFLOAT3 _min = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+		XMFLOAT3 _max = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		for (uint32_t index : indices)
+		{
+			const XMFLOAT3& p = positions[index];
+			_min = XMFLOAT3(min(_min.x, p.x), min(_min.y, p.y), min(_min.z, p.z));
+			_max = XMFLOAT3(max(_max.x, p.x), max(_max.y, p.y), max(_max.z, p.z));
+		}
+		const float extent = max(_max.x - _min.x, max(_max.y - _min.y, _max.z - _min.z));
+		const float scale = extent > 0 ? 1.0f / extent : 1.0f;
+		vector<XMFLOAT3> pos(vertexCount);
+		for (size_t i = 0; i < vertexCount; ++i)
+		{
+			pos[i] = XMFLOAT3((positions[i].x - _min.x) * scale, (positions[i].y - _min.y) * scale, (positions[i].z - _min.z) * scale);
+		}
+
+		// Triangle plane quadrics, weighted by area:
+		vector<Quadric> quadrics(vertexCount);
+		for (uint32_t i = 0; i < triangleCount; ++i)
+		{
+			const uint32_t w0 = weld[indices[i * 3 + 0]];
+			const uint32_t w1 = weld[indices[i * 3 + 1]];
+			const uint32_t w2 = weld[indices[i * 3 + 2]];
+			XMVECTOR P0 = XMLoadFloat3(&pos[w0]);
+			XMVECTOR N = XMVector3Cross(XMLoadFloat3(&pos[w1]) - P0, XMLoadFloat3(&pos[w2]) - P0);
+			const float area = XMVectorGetX(XMVector3Length(N)) * 0.5f;
+			if (area > 0)
+			{
+				XMFLOAT3 normal;
+				XMStoreFloat3(&normal, XMVector3Normalize(N));
+				const float d = -XMVectorGetX(XMVector3Dot(XMLoadFloat3(&normal), P0));
+				quadrics[w0].AddPlane(normal, d, area);
+				quadrics[w1].AddPlane(normal, d, area);
+				quadrics[w2].AddPlane(normal, d, area);
+			}
+		}
+
+		// Open borders get heavily weighted perpendicular planes, so they keep their shape:
+		{
+			struct DirectedEdge
+			{
+				uint64_t key;
+				uint32_t triangle;
+				bool operator<(const DirectedEdge& other) const { return key < other.key || (key == other.key && triangle < other.triangle); }
+			};
+			vector<DirectedEdge> edges;
+			edges.reserve(triangleCount * 3);
+			for (uint32_t i = 0; i < triangleCount; ++i)
+			{
+				for (int j = 0; j < 3; ++j)
+				{
+					const uint32_t a = weld[indices[i * 3 + j]];
+					const uint32_t b = weld[indices[i * 3 + (j + 1) % 3]];
+					edges.push_back({ ((uint64_t)min(a, b) << 32) | max(a, b), i });
+				}
+			}
+			sort(edges.begin(), edges.end());
+			for (size_t i = 0; i < edges.size(); ++i)
+			{
+				const bool single = (i == 0 || edges[i - 1].key != edges[i].key) && (i + 1 == edges.size() || edges[i + 1].key != edges[i].key);
+				if (!single)
+				{
+					continue;
+				}
+				const uint32_t a = (uint32_t)(edges[i].key >> 32);
+				const uint32_t b = (uint32_t)(edges[i].key & 0xFFFFFFFF);
+				const uint32_t t = edges[i].triangle;
+				XMVECTOR P0 = XMLoadFloat3(&pos[weld[indices[t * 3 + 0]]]);
+				XMVECTOR P1 = XMLoadFloat3(&pos[weld[indices[t * 3 + 1]]]);
+				XMVECTOR P2 = XMLoadFloat3(&pos[weld[indices[t * 3 + 2]]]);
+				XMVECTOR E = XMLoadFloat3(&pos[b]) - XMLoadFloat3(&pos[a]);
+				XMVECTOR N = XMVector3Cross(E, XMVector3Cross(P1 - P0, P2 - P0));
+				const float length = XMVectorGetX(XMVector3Length(E));
+				if (length > 0 && XMVectorGetX(XMVector3LengthSq(N)) > 0)
+				{
+					XMFLOAT3 normal;
+					XMStoreFloat3(&normal, XMVector3Normalize(N));
+					const float d = -XMVectorGetX(XMVector3Dot(XMLoadFloat3(&normal), XMLoadFloat3(&pos[a])));
+					quadrics[a].AddPlane(normal, d, length * 10);
+					quadrics[b].AddPlane(normal, d, length * 10);
+				}
+			}
+		}
+
+		const float targetErrorSquared = targetError < sqrtf(FLT_MAX) ? targetError * targetError : FLT_MAX;
+		float resultError = 0;
+
+		vector<uint32_t> result = indices;
+		vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+		vector<uint32_t> adjacency;
+		vector<uint64_t> edgeKeys;
+		vector<uint8_t> borderVertex(vertexCount);
+		vector<uint8_t> lockedVertex(vertexCount);
+		vector<uint8_t> touched(vertexCount);
+		vector<uint32_t> vertexRemap(vertexCount);
+		vector<pair<uint32_t, uint32_t>> wedges;
+
+		struct Collapse
+		{
+			uint32_t from;
+			uint32_t to;
+			float error;
+			bool operator<(const Collapse& other) const
+			{
+				if (error != other.error)
+					return error < other.error;
+				if (from != other.from)
+					return from < other.from;
+				return to < other.to;
+			}
+		};
+		vector<Collapse> collapses;
+
+		// Every pass collapses a set of independent edges in order of increasing error:
+		while (result.size() > targetIndexCount)
+		{
+			const uint32_t currentTriangleCount = (uint32_t)result.size() / 3;
+
+			// Triangle adjacency of welded vertices:
+			std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+			for (uint32_t index : result)
+			{
+				adjacencyOffsets[weld[index] + 1]++;
+			}
+			for (size_t i = 1; i < adjacencyOffsets.size(); ++i)
+			{
+				adjacencyOffsets[i] += adjacencyOffsets[i - 1];
+			}
+			adjacency.resize(result.size());
+			for (uint32_t i = 0; i < currentTriangleCount; ++i)
+			{
+				for (int j = 0; j < 3; ++j)
+				{
+					adjacency[adjacencyOffsets[weld[result[i * 3 + j]]]++] = i;
+				}
+			}
+			for (size_t i = adjacencyOffsets.size() - 1; i > 0; --i)
+			{
+				adjacencyOffsets[i] = adjacencyOffsets[i - 1];
+			}
+			adjacencyOffsets[0] = 0;
+
+			// Unique edges, border vertices can only move along borders, non-manifold vertices are locked:
+			edgeKeys.clear();
+			for (uint32_t i = 0; i < currentTriangleCount; ++i)
+			{
+				for (int j = 0; j < 3; ++j)
+				{
+					const uint32_t a = weld[result[i * 3 + j]];
+					const uint32_t b = weld[result[i * 3 + (j + 1) % 3]];
+					edgeKeys.push_back(((uint64_t)min(a, b) << 32) | max(a, b));
+				}
+			}
+			sort(edgeKeys.begin(), edgeKeys.end());
+			std::fill(borderVertex.begin(), borderVertex.end(), 0);
+			std::fill(lockedVertex.begin(), lockedVertex.end(), 0);
+			for (size_t i = 0; i < edgeKeys.size();)
+			{
+				size_t count = 1;
+				while (i + count < edgeKeys.size() && edgeKeys[i + count] == edgeKeys[i])
+				{
+					count++;
+				}
+				const uint32_t a = (uint32_t)(edgeKeys[i] >> 32);
+				const uint32_t b = (uint32_t)(edgeKeys[i] & 0xFFFFFFFF);
+				if (count == 1)
+				{
+					borderVertex[a] = 1;
+					borderVertex[b] = 1;
+				}
+				else if (count > 2)
+				{
+					lockedVertex[a] = 1;
+					lockedVertex[b] = 1;
+				}
+				i += count;
+			}
+
+			collapses.clear();
+			for (size_t i = 0; i < edgeKeys.size();)
+			{
+				size_t count = 1;
+				while (i + count < edgeKeys.size() && edgeKeys[i + count] == edgeKeys[i])
+				{
+					count++;
+				}
+				const bool borderEdge = count == 1;
+				const uint32_t a = (uint32_t)(edgeKeys[i] >> 32);
+				const uint32_t b = (uint32_t)(edgeKeys[i] & 0xFFFFFFFF);
+				i += count;
+
+				Quadric q = quadrics[a];
+				q.Add(quadrics[b]);
+				const bool a_movable = !lockedVertex[a] && (!borderVertex[a] || borderEdge);
+				const bool b_movable = !lockedVertex[b] && (!borderVertex[b] || borderEdge);
+				const float error_ab = a_movable ? q.Error(pos[b]) : FLT_MAX;
+				const float error_ba = b_movable ? q.Error(pos[a]) : FLT_MAX;
+				if (error_ab == FLT_MAX && error_ba == FLT_MAX)
+				{
+					continue;
+				}
+				if (error_ab <= error_ba)
+				{
+					collapses.push_back({ a, b, error_ab });
+				}
+				else
+				{
+					collapses.push_back({ b, a, error_ba });
+				}
+			}
+			sort(collapses.begin(), collapses.end());
+
+			std::fill(touched.begin(), touched.end(), 0);
+			for (size_t i = 0; i < vertexCount; ++i)
+			{
+				vertexRemap[i] = (uint32_t)i;
+			}
+
+			const uint32_t trianglesToRemove = currentTriangleCount - (uint32_t)(targetIndexCount / 3);
+			uint32_t removed = 0;
+			uint32_t collapseCount = 0;
+			for (const Collapse& collapse : collapses)
+			{
+				if (removed >= trianglesToRemove || collapse.error > targetErrorSquared)
+				{
+					break;
+				}
+				const uint32_t u = collapse.from;
+				const uint32_t v = collapse.to;
+				if (touched[u] || touched[v])
+				{
+					continue;
+				}
+
+				// Check that no triangle flips, and that every attribute variant (wedge) of u has a matching wedge of v:
+				bool valid = true;
+				uint32_t degenerate = 0;
+				wedges.clear();
+				for (uint32_t k = adjacencyOffsets[u]; k < adjacencyOffsets[u + 1] && valid; ++k)
+				{
+					const uint32_t t = adjacency[k];
+					const uint32_t* tri = &result[t * 3];
+					int corner = 0;
+					int other = -1;
+					for (int j = 0; j < 3; ++j)
+					{
+						const uint32_t w = weld[tri[j]];
+						if (w == u)
+						{
+							corner = j;
+						}
+						else if (w == v)
+						{
+							other = j;
+						}
+					}
+
+					auto it = std::find_if(wedges.begin(), wedges.end(), [&](const pair<uint32_t, uint32_t>& x) { return x.first == tri[corner]; });
+					if (it == wedges.end())
+					{
+						wedges.push_back(make_pair(tri[corner], ~0u));
+						it = wedges.end() - 1;
+					}
+
+					if (other >= 0)
+					{
+						degenerate++;
+						it->second = tri[other];
+						continue;
+					}
+
+					XMVECTOR P0 = XMLoadFloat3(&pos[weld[tri[0]]]);
+					XMVECTOR P1 = XMLoadFloat3(&pos[weld[tri[1]]]);
+					XMVECTOR P2 = XMLoadFloat3(&pos[weld[tri[2]]]);
+					XMVECTOR N_old = XMVector3Cross(P1 - P0, P2 - P0);
+					XMVECTOR P = XMLoadFloat3(&pos[v]);
+					P0 = corner == 0 ? P : P0;
+					P1 = corner == 1 ? P : P1;
+					P2 = corner == 2 ? P : P2;
+					XMVECTOR N_new = XMVector3Cross(P1 - P0, P2 - P0);
+					if (XMVectorGetX(XMVector3Dot(N_old, N_new)) <= 0)
+					{
+						valid = false;
+					}
+				}
+				for (auto& x : wedges)
+				{
+					valid = valid && x.second != ~0u;
+				}
+				if (!valid || degenerate == 0)
+				{
+					continue;
+				}
+
+				for (auto& x : wedges)
+				{
+					vertexRemap[x.first] = x.second;
+				}
+				quadrics[v].Add(quadrics[u]);
+				resultError = max(resultError, collapse.error);
+
+				// Lock the one-ring of u for the rest of this pass, because those triangles change:
+				for (uint32_t k = adjacencyOffsets[u]; k < adjacencyOffsets[u + 1]; ++k)
+				{
+					const uint32_t* tri = &result[adjacency[k] * 3];
+					touched[weld[tri[0]]] = 1;
+					touched[weld[tri[1]]] = 1;
+					touched[weld[tri[2]]] = 1;
+				}
+
+				removed += degenerate;
+				collapseCount++;
+			}
+
+			if (collapseCount == 0)
+			{
+				break;
+			}
+
+			size_t write = 0;
+			for (size_t i = 0; i < result.size(); i += 3)
+			{
+				const uint32_t i0 = vertexRemap[result[i + 0]];
+				const uint32_t i1 = vertexRemap[result[i + 1]];
+				const uint32_t i2 = vertexRemap[result[i + 2]];
+				if (weld[i0] != weld[i1] && weld[i1] != weld[i2] && weld[i2] != weld[i0])
+				{
+					result[write++] = i0;
+					result[write++] = i1;
+					result[write++] = i2;
+				}
+			}
+			result.resize(write);
+		}
+
+		indices.swap(result);
+		return sqrtf(resultError);
+	}
+
+	void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+	{
+		const size_t triangleCount = indexCount / 3;
+		if (triangleCount == 0)
+		{
+			return;
+		}
+
+		// Vertex -> triangle adjacency, and the number of not yet emitted triangles per vertex:
+		vector<uint32_t> liveTriangles(vertexCount);
+		for (size_t i = 0; i < triangleCount * 3; ++i)
+		{
+			liveTriangles[indices[i]]++;
+		}
+		vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+		for (size_t i = 0; i < vertexCount; ++i)
+		{
+			adjacencyOffsets[i + 1] = adjacencyOffsets[i] + liveTriangles[i];
+		}
+		vector<uint32_t> adjacency(triangleCount * 3);
+		{
+			vector<uint32_t> cursors(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t i = 0; i < triangleCount * 3; ++i)
+			{
+				adjacency[cursors[indices[i]]++] = (uint32_t)(i / 3);
+			}
+		}
+
+		vector<uint32_t> cacheTime(vertexCount);
+		uint32_t time = cacheSize + 1;
+		vector<uint8_t> emitted(triangleCount);
+		vector<uint32_t> deadEnd;
+		deadEnd.reserve(triangleCount * 3);
+		vector<uint32_t> candidates;
+		vector<uint32_t> result;
+		result.reserve(triangleCount * 3);
+		size_t scanCursor = 0;
+
+		uint32_t fanning = indices[0];
+		while (fanning != ~0u)
+		{
+			// Emit every remaining triangle around the fanning vertex:
+			candidates.clear();
+			for (uint32_t k = adjacencyOffsets[fanning]; k < adjacencyOffsets[fanning + 1]; ++k)
+			{
+				const uint32_t triangle = adjacency[k];
+				if (emitted[triangle])
+				{
+					continue;
+				}
+				emitted[triangle] = 1;
+				for (int j = 0; j < 3; ++j)
+				{
+					const uint32_t v = indices[triangle * 3 + j];
+					result.push_back(v);
+					deadEnd.push_back(v);
+					candidates.push_back(v);
+					liveTriangles[v]--;
+					if (time - cacheTime[v] > cacheSize)
+					{
+						cacheTime[v] = time++;
+					}
+				}
+			}
+
+			// The next fanning vertex is the oldest candidate that will still be in the cache after its triangles are emitted:
+			uint32_t next = ~0u;
+			int bestPriority = -1;
+			for (uint32_t v : candidates)
+			{
+				if (liveTriangles[v] > 0)
+				{
+					int priority = 0;
+					if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize)
+					{
+						priority = (int)(time - cacheTime[v]);
+					}
+					if (priority > bestPriority)
+					{
+						bestPriority = priority;
+						next = v;
+					}
+				}
+			}
+
+			// Dead end, continue with a recently used vertex, or the next vertex in input order:
+			while (next == ~0u && !deadEnd.empty())
+			{
+				const uint32_t v = deadEnd.back();
+				deadEnd.pop_back();
+				if (liveTriangles[v] > 0)
+				{
+					next = v;
+				}
+			}
+			while (next == ~0u && scanCursor < vertexCount)
+			{
+				if (liveTriangles[scanCursor] > 0)
+				{
+					next = (uint32_t)scanCursor;
+				}
+				scanCursor++;
+			}
+
+			fanning = next;
+		}
+
+		assert(result.size() == triangleCount * 3);
+		std::copy(result.begin(), result.end(), indices);
+	}
+
+	// Simulates the FIFO cache for one triangle, returns the number of cache misses
+	static inline uint32_t UpdateCache(const uint32_t* triangle, vector<uint32_t>& cacheTime, uint32_t& time, uint32_t cacheSize)
+	{
+		uint32_t misses = 0;
+		for (int j = 0; j < 3; ++j)
+		{
+			const uint32_t v = triangle[j];
+			if (time - cacheTime[v] > cacheSize)
+			{
+				cacheTime[v] = time++;
+				misses++;
+			}
+		}
+		return misses;
+	}
+
+	void OptimizeOverdraw(uint32_t* indices, size_t indexCount, const XMFLOAT3* positions, size_t vertexCount, float threshold, uint32_t cacheSize)
+	{
+		const size_t triangleCount = indexCount / 3;
+		if (triangleCount < 2)
+		{
+			return;
+		}
+
+		vector<uint32_t> cacheTime(vertexCount);
+		uint32_t time = cacheSize + 1;
+
+		// Hard boundaries are where the vertex cache was flushed, because there every triangle misses the cache:
+		vector<uint32_t> hardBoundaries;
+		for (size_t i = 0; i < triangleCount; ++i)
+		{
+			if (UpdateCache(&indices[i * 3], cacheTime, time, cacheSize) == 3 || i == 0)
+			{
+				hardBoundaries.push_back((uint32_t)i);
+			}
+		}
+		hardBoundaries.push_back((uint32_t)triangleCount);
+
+		// Soft boundaries split hard clusters further where the local ACMR is already close to the cluster's ACMR:
+		vector<uint32_t> clusters;
+		for (size_t c = 0; c + 1 < hardBoundaries.size(); ++c)
+		{
+			const uint32_t start = hardBoundaries[c];
+			const uint32_t end = hardBoundaries[c + 1];
+
+			time += cacheSize + 1;
+			uint32_t clusterMisses = 0;
+			for (uint32_t i = start; i < end; ++i)
+			{
+				clusterMisses += UpdateCache(&indices[i * 3], cacheTime, time, cacheSize);
+			}
+			const float clusterThreshold = threshold * (float)clusterMisses / (float)(end - start);
+
+			time += cacheSize + 1;
+			clusters.push_back(start);
+			uint32_t clusterStart = start;
+			uint32_t misses = 0;
+			for (uint32_t i = start; i < end; ++i)
+			{
+				misses += UpdateCache(&indices[i * 3], cacheTime, time, cacheSize);
+				if (i + 1 < end && (float)misses <= clusterThreshold * (float)(i + 1 - clusterStart))
+				{
+					clusters.push_back(i + 1);
+					clusterStart = i + 1;
+					misses = 0;
+					time += cacheSize + 1;
+				}
+			}
+		}
+		const size_t clusterCount = clusters.size();
+		clusters.push_back((uint32_t)triangleCount);
+
+		// Clusters facing outwards from the mesh center are drawn first, because they are likely to occlude the others:
+		XMVECTOR meshCenter = XMVectorZero();
+		for (size_t i = 0; i < triangleCount * 3; ++i)
+		{
+			meshCenter += XMLoadFloat3(&positions[indices[i]]);
+		}
+		meshCenter /= (float)(triangleCount * 3);
+
+		vector<float> sortKeys(clusterCount);
+		for (size_t c = 0; c < clusterCount; ++c)
+		{
+			XMVECTOR center = XMVectorZero();
+			XMVECTOR normal = XMVectorZero();
+			float area = 0;
+			for (uint32_t i = clusters[c]; i < clusters[c + 1]; ++i)
+			{
+				XMVECTOR P0 = XMLoadFloat3(&positions[indices[i * 3 + 0]]);
+				XMVECTOR P1 = XMLoadFloat3(&positions[indices[i * 3 + 1]]);
+				XMVECTOR P2 = XMLoadFloat3(&positions[indices[i * 3 + 2]]);
+				XMVECTOR N = XMVector3Cross(P1 - P0, P2 - P0);
+				const float triangleArea = XMVectorGetX(XMVector3Length(N));
+				center += (P0 + P1 + P2) * (triangleArea / 3.0f);
+				normal += N;
+				area += triangleArea;
+			}
+			center = area > 0 ? center / area : XMLoadFloat3(&positions[indices[clusters[c] * 3]]);
+			sortKeys[c] = XMVectorGetX(XMVector3Dot(center - meshCenter, XMVector3Normalize(normal)));
+		}
+
+		vector<uint32_t> order(clusterCount);
+		for (size_t c = 0; c < clusterCount; ++c)
+		{
+			order[c] = (uint32_t)c;
+		}
+		std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+			return sortKeys[a] > sortKeys[b];
+		});
+
+		vector<uint32_t> result;
+		result.reserve(triangleCount * 3);
+		for (uint32_t c : order)
+		{
+			result.insert(result.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+		}
+		std::copy(result.begin(), result.end(), indices);
+	}
+
+	size_t OptimizeVertexFetch(uint32_t* indices, size_t indexCount, size_t vertexCount, vector<uint32_t>& remap)
+	{
+		remap.resize(vertexCount);
+		std::fill(remap.begin(), remap.end(), ~0u);
+
+		uint32_t next = 0;
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			uint32_t& index = indices[i];
+			if (remap[index] == ~0u)
+			{
+				remap[index] = next++;
+			}
+			index = remap[index];
+		}
+		return next;
+	}
+
+	VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+	{
+		VertexCacheStatistics statistics;
+		const size_t triangleCount = indexCount / 3;
+		if (triangleCount == 0)
+		{
+			return statistics;
+		}
+
+		vector<uint32_t> cacheTime(vertexCount);
+		vector<uint8_t> referenced(vertexCount);
+		uint32_t time = cacheSize + 1;
+		uint32_t uniqueVertices = 0;
+		for (size_t i = 0; i < triangleCount; ++i)
+		{
+			statistics.verticesTransformed += UpdateCache(&indices[i * 3], cacheTime, time, cacheSize);
+			for (int j = 0; j < 3; ++j)
+			{
+				const uint32_t v = indices[i * 3 + j];
+				uniqueVertices += referenced[v] == 0 ? 1 : 0;
+				referenced[v] = 1;
+			}
+		}
+
+		statistics.ACMR = (float)statistics.verticesTransformed / (float)triangleCount;
+		statistics.ATVR = (float)statistics.verticesTransformed / (float)uniqueVertices;
+		return statistics;
+	}
+
+	// Bounding sphere and normal cone of the meshlet that starts at indices:
+	static void ComputeMeshletBounds(Meshlet& meshlet, const uint32_t* indices, const XMFLOAT3* positions, const vector<uint32_t>& vertices)
+	{
+		// Ritter's bounding sphere:
+		XMVECTOR P0 = XMLoadFloat3(&positions[vertices[0]]);
+		XMVECTOR P1 = P0;
+		float farthest = 0;
+		for (uint32_t v : vertices)
+		{
+			XMVECTOR P = XMLoadFloat3(&positions[v]);
+			const float distance = XMVectorGetX(XMVector3LengthSq(P - P0));
+			if (distance > farthest)
+			{
+				farthest = distance;
+				P1 = P;
+			}
+		}
+		XMVECTOR P2 = P1;
+		farthest = 0;
+		for (uint32_t v : vertices)
+		{
+			XMVECTOR P = XMLoadFloat3(&positions[v]);
+			const float distance = XMVectorGetX(XMVector3LengthSq(P - P1));
+			if (distance > farthest)
+			{
+				farthest = distance;
+				P2 = P;
+			}
+		}
+		XMVECTOR center = (P1 + P2) * 0.5f;
+		float radius = sqrtf(farthest) * 0.5f;
+		for (uint32_t v : vertices)
+		{
+			XMVECTOR P = XMLoadFloat3(&positions[v]);
+			const float distance = XMVectorGetX(XMVector3Length(P - center));
+			if (distance > radius)
+			{
+				const float newRadius = (radius + distance) * 0.5f;
+				center += (P - center) * ((newRadius - radius) / distance);
+				radius = newRadius;
+			}
+		}
+		XMStoreFloat3(&meshlet.center, center);
+		meshlet.radius = radius;
+
+		// Normal cone, face normals are computed with the same winding order as MeshComponent::ComputeNormals():
+		vector<XMFLOAT3> normals;
+		normals.reserve(meshlet.triangleCount);
+		XMVECTOR axis = XMVectorZero();
+		for (uint32_t i = 0; i < meshlet.triangleCount; ++i)
+		{
+			XMVECTOR A = XMLoadFloat3(&positions[indices[i * 3 + 0]]);
+			XMVECTOR B = XMLoadFloat3(&positions[indices[i * 3 + 1]]);
+			XMVECTOR C = XMLoadFloat3(&positions[indices[i * 3 + 2]]);
+			XMVECTOR N = XMVector3Cross(C - A, B - A);
+			if (XMVectorGetX(XMVector3LengthSq(N)) > 0)
+			{
+				N = XMVector3Normalize(N);
+				axis += N;
+				normals.emplace_back();
+				XMStoreFloat3(&normals.back(), N);
+			}
+		}
+		meshlet.coneAxis = XMFLOAT3(0, 0, 1);
+		meshlet.coneCutoff = 1;
+		if (normals.empty() || XMVectorGetX(XMVector3LengthSq(axis)) < 1e-12f)
+		{
+			return;
+		}
+		axis = XMVector3Normalize(axis);
+		float minDot = 1;
+		for (auto& normal : normals)
+		{
+			minDot = min(minDot, XMVectorGetX(XMVector3Dot(axis, XMLoadFloat3(&normal))));
+		}
+		XMStoreFloat3(&meshlet.coneAxis, axis);
+		if (minDot > 0)
+		{
+			// The cone opens to 90 degrees + the normal spread angle, so the cutoff is cos(90 - spread) = sin(spread):
+			meshlet.coneCutoff = sqrtf(1 - minDot * minDot);
+		}
+	}
+
+	void BuildMeshlets(uint32_t* indices, size_t indexCount, const XMFLOAT3* positions, size_t vertexCount, vector<Meshlet>& meshlets, uint32_t maxVertices, uint32_t maxTriangles)
+	{
+		meshlets.clear();
+		const uint32_t triangleCount = (uint32_t)(indexCount / 3);
+		if (triangleCount == 0)
+		{
+			return;
+		}
+		maxVertices = max(maxVertices, 3u);
+		maxTriangles = max(maxTriangles, 1u);
+
+		// Triangles are connected through welded positions, so that meshlets can grow over UV seams and hard edges:
+		vector<uint32_t> weld;
+		WeldPositions(positions, vertexCount, weld);
+		vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+		for (uint32_t i = 0; i < triangleCount * 3; ++i)
+		{
+			adjacencyOffsets[weld[indices[i]] + 1]++;
+		}
+		for (size_t i = 1; i < adjacencyOffsets.size(); ++i)
+		{
+			adjacencyOffsets[i] += adjacencyOffsets[i - 1];
+		}
+		vector<uint32_t> adjacency(triangleCount * 3);
+		{
+			vector<uint32_t> cursors(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (uint32_t i = 0; i < triangleCount * 3; ++i)
+			{
+				adjacency[cursors[weld[indices[i]]]++] = i / 3;
+			}
+		}
+
+		vector<uint8_t> emitted(triangleCount);
+		vector<uint32_t> vertexMeshlet(vertexCount, ~0u); // which meshlet was the vertex last added to
+		vector<uint32_t> weldMeshlet(vertexCount, ~0u);
+		vector<uint32_t> meshletVertices;
+		vector<uint32_t> meshletWelds;
+		vector<uint32_t> result;
+		result.reserve(triangleCount * 3);
+		uint32_t seedCursor = 0;
+
+		auto countNewVertices = [&](uint32_t triangle, uint32_t meshletID) {
+			const uint32_t* tri = &indices[triangle * 3];
+			uint32_t count = 0;
+			for (int j = 0; j < 3; ++j)
+			{
+				if (vertexMeshlet[tri[j]] != meshletID && (j == 0 || tri[j] != tri[0]) && (j < 2 || tri[j] != tri[1]))
+				{
+					count++;
+				}
+			}
+			return count;
+		};
+
+		while (result.size() < triangleCount * 3)
+		{
+			const uint32_t meshletID = (uint32_t)meshlets.size();
+			Meshlet meshlet;
+			meshlet.indexOffset = (uint32_t)result.size();
+			meshletVertices.clear();
+			meshletWelds.clear();
+
+			while (emitted[seedCursor])
+			{
+				seedCursor++;
+			}
+			uint32_t triangle = seedCursor;
+
+			while (triangle != ~0u)
+			{
+				emitted[triangle] = 1;
+				for (int j = 0; j < 3; ++j)
+				{
+					const uint32_t v = indices[triangle * 3 + j];
+					result.push_back(v);
+					if (vertexMeshlet[v] != meshletID)
+					{
+						vertexMeshlet[v] = meshletID;
+						meshletVertices.push_back(v);
+					}
+					if (weldMeshlet[weld[v]] != meshletID)
+					{
+						weldMeshlet[weld[v]] = meshletID;
+						meshletWelds.push_back(weld[v]);
+					}
+				}
+				meshlet.triangleCount++;
+				if (meshlet.triangleCount >= maxTriangles)
+				{
+					break;
+				}
+
+				// The next triangle is a neighbour that adds the fewest new vertices (the lowest triangle index wins ties):
+				triangle = ~0u;
+				uint32_t bestCount = ~0u;
+				for (uint32_t w : meshletWelds)
+				{
+					for (uint32_t k = adjacencyOffsets[w]; k < adjacencyOffsets[w + 1]; ++k)
+					{
+						const uint32_t candidate = adjacency[k];
+						if (emitted[candidate])
+						{
+							continue;
+						}
+						const uint32_t count = countNewVertices(candidate, meshletID);
+						if (meshletVertices.size() + count > maxVertices)
+						{
+							continue;
+						}
+						if (count < bestCount || (count == bestCount && candidate < triangle))
+						{
+							bestCount = count;
+							triangle = candidate;
+						}
+					}
+				}
+
+				// If there are no neighbours left, continue with the next triangle in input order if it still fits:
+				if (triangle == ~0u)
+				{
+					while (seedCursor < triangleCount && emitted[seedCursor])
+					{
+						seedCursor++;
+					}
+					if (seedCursor < triangleCount && meshletVertices.size() + countNewVertices(seedCursor, meshletID) <= maxVertices)
+					{
+						triangle = seedCursor;
+					}
+				}
+			}
+
+			meshlet.vertexCount = (uint32_t)meshletVertices.size();
+			ComputeMeshletBounds(meshlet, &result[meshlet.indexOffset], positions, meshletVertices);
+			meshlets.push_back(meshlet);
+		}
+
+		std::copy(result.begin(), result.end(), indices);
+	}
+}
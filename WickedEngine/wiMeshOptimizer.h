@@ -0,0 +1,78 @@
+#pragma once
+#include "CommonInclude.h"
+
+#include <vector>
+
+// Mesh processing algorithms that work on plain index and vertex arrays
+namespace wiMeshOptimizer
+{
+	// Find vertices that share the same position. Every vertex will be mapped to the first vertex index at its position
+	//	weld		: output table, weld[i] is the vertex index that the vertex i is welded to
+	//	tolerance	: positions closer than this on every axis are considered the same, 0 means exact match
+	//	returns the number of unique positions
+	size_t WeldPositions(const XMFLOAT3* positions, size_t vertexCount, std::vector<uint32_t>& weld, float tolerance = 0);
+
+	// Simplify a triangle list with quadric error metric edge collapses. Vertices are never moved or created,
+	//	so the simplified index list can be used with the same vertex buffers as the original.
+	//	Vertices that share the same position are treated as one, UV seams and open borders are preserved.
+	//	indices				: triangle list to simplify, it will be replaced by the simplified triangle list
+	//	positions			: vertex positions
+	//	vertexCount			: number of vertex positions
+	//	targetIndexCount	: simplification stops when the index count drops to this
+	//	targetError			: simplification stops when a collapse would introduce larger error than this (relative to the mesh extents)
+	//	returns the error of the simplified mesh relative to the mesh extents
+	float Simplify(std::vector<uint32_t>& indices, const XMFLOAT3* positions, size_t vertexCount, size_t targetIndexCount, float targetError = FLT_MAX);
+
+	// Reorder triangles to improve post-transform vertex cache hit rate (Tipsify)
+	//	indices		: triangle list that will be reordered in place
+	//	cacheSize	: the size of the simulated FIFO cache
+	void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = 16);
+
+	// Reorder clusters of triangles to reduce overdraw, while keeping the vertex cache efficiency close to the input
+	//	This should be called after OptimizeVertexCache()
+	//	threshold	: the allowed vertex cache efficiency loss, 1.05 means that ACMR can get 5% worse
+	void OptimizeOverdraw(uint32_t* indices, size_t indexCount, const XMFLOAT3* positions, size_t vertexCount, float threshold = 1.05f, uint32_t cacheSize = 16);
+
+	// Compute a vertex remap table that orders vertices by their first use in the index buffer, to improve vertex fetch locality
+	//	Vertices that are not referenced by the index buffer will be remapped to ~0, indices will be rewritten to the new order
+	//	remap		: output remap table, the new location of the old vertex i is remap[i]
+	//	returns the number of referenced vertices
+	size_t OptimizeVertexFetch(uint32_t* indices, size_t indexCount, size_t vertexCount, std::vector<uint32_t>& remap);
+
+	struct VertexCacheStatistics
+	{
+		uint32_t verticesTransformed = 0;
+		float ACMR = 0; // average cache miss ratio: transformed vertices per triangle (lower is better, 0.5 is optimal for regular grids)
+		float ATVR = 0; // average transformed vertex ratio: transformed vertices per referenced vertex (lower is better, 1 is optimal)
+	};
+	// Simulate a FIFO post-transform vertex cache to measure vertex cache efficiency
+	VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = 16);
+
+	struct Meshlet
+	{
+		uint32_t indexOffset = 0;	// the meshlet's triangles are a contiguous range in the index buffer
+		uint32_t triangleCount = 0;
+		uint32_t vertexCount = 0;	// number of unique vertices referenced by the meshlet
+
+		// Bounding sphere:
+		XMFLOAT3 center = XMFLOAT3(0, 0, 0);
+		float radius = 0;
+
+		// Normal cone, the meshlet is backfacing if dot(center - eye, coneAxis) >= coneCutoff * length(center - eye) + radius
+		//	coneCutoff is 1 if the normals are spread too wide, which means that the meshlet can't be backface culled
+		XMFLOAT3 coneAxis = XMFLOAT3(0, 0, 1);
+		float coneCutoff = 1;
+	};
+	// Split a triangle list into meshlets (clusters) that can be culled individually. Triangles are reordered in place,
+	//	so that every meshlet will be a contiguous range in the index buffer. Meshlets grow over neighbouring triangles
+	//	(vertices with the same position are considered connected). The result is deterministic.
+	//	meshlets	: output meshlets, indexOffset is relative to the start of indices
+	void BuildMeshlets(uint32_t* indices, size_t indexCount, const XMFLOAT3* positions, size_t vertexCount, std::vector<Meshlet>& meshlets, uint32_t maxVertices = 64, uint32_t maxTriangles = 124);
+
+	// Returns true if every triangle of the meshlet is facing away from the eye position (in the same space as the meshlet)
+	inline bool IsMeshletBackfacing(const Meshlet& meshlet, const XMFLOAT3& eye)
+	{
+		const XMVECTOR V = XMLoadFloat3(&meshlet.center) - XMLoadFloat3(&eye);
+		return XMVectorGetX(XMVector3Dot(V, XMLoadFloat3(&meshlet.coneAxis))) >= meshlet.coneCutoff * XMVectorGetX(XMVector3Length(V)) + meshlet.radius;
+	}
+}
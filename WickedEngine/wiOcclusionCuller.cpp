@@ -0,0 +1,260 @@
+#include "wiOcclusionCuller.h"
+#include "wiIntersect.h"
+
+#include <algorithm>
+
+using namespace std;
+
+// Geometry closer than this (in clip space w) is clipped away from occluders, and boxes reaching it are always visible:
+static const float NEAR_CLIP_W = 0.01f;
+
+wiOcclusionCuller::wiOcclusionCuller()
+{
+	Clear(IDENTITYMATRIX);
+}
+
+void wiOcclusionCuller::Clear(const XMFLOAT4X4& viewProjection)
+{
+	this->viewProjection = viewProjection;
+	triangles.clear();
+	for (auto& bin : tileTriangles)
+	{
+		bin.clear();
+	}
+	std::fill(std::begin(depthBuffer), std::end(depthBuffer), FLT_MAX);
+	std::fill(std::begin(tileDepth), std::end(tileDepth), FLT_MAX);
+}
+
+void wiOcclusionCuller::AddOccluder(const XMFLOAT3* positions, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, const XMFLOAT4X4& world)
+{
+	const XMMATRIX M = XMLoadFloat4x4(&world) * XMLoadFloat4x4(&viewProjection);
+
+	clipPositions.resize(vertexCount);
+	for (uint32_t i = 0; i < vertexCount; ++i)
+	{
+		XMStoreFloat4(&clipPositions[i], XMVector3Transform(XMLoadFloat3(&positions[i]), M));
+	}
+
+	for (uint32_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		const XMFLOAT4* in[] = {
+			&clipPositions[indices[i + 0]],
+			&clipPositions[indices[i + 1]],
+			&clipPositions[indices[i + 2]],
+		};
+
+		if (in[0]->w >= NEAR_CLIP_W && in[1]->w >= NEAR_CLIP_W && in[2]->w >= NEAR_CLIP_W)
+		{
+			AddTriangle(*in[0], *in[1], *in[2]);
+			continue;
+		}
+
+		// Clip against the near plane, this produces a polygon with at most 4 vertices:
+		XMFLOAT4 polygon[4];
+		int count = 0;
+		for (int j = 0; j < 3; ++j)
+		{
+			const XMFLOAT4& a = *in[j];
+			const XMFLOAT4& b = *in[(j + 1) % 3];
+			const bool a_inside = a.w >= NEAR_CLIP_W;
+			const bool b_inside = b.w >= NEAR_CLIP_W;
+			if (a_inside)
+			{
+				polygon[count++] = a;
+			}
+			if (a_inside != b_inside)
+			{
+				const float t = (NEAR_CLIP_W - a.w) / (b.w - a.w);
+				XMStoreFloat4(&polygon[count++], XMVectorLerp(XMLoadFloat4(&a), XMLoadFloat4(&b), t));
+			}
+		}
+		for (int j = 2; j < count; ++j)
+		{
+			AddTriangle(polygon[0], polygon[j - 1], polygon[j]);
+		}
+	}
+}
+
+void wiOcclusionCuller::AddTriangle(const XMFLOAT4& c0, const XMFLOAT4& c1, const XMFLOAT4& c2)
+{
+	Triangle tri;
+	tri.v0 = XMFLOAT2((c0.x / c0.w * 0.5f + 0.5f) * RESOLUTION_X, (0.5f - c0.y / c0.w * 0.5f) * RESOLUTION_Y);
+	tri.v1 = XMFLOAT2((c1.x / c1.w * 0.5f + 0.5f) * RESOLUTION_X, (0.5f - c1.y / c1.w * 0.5f) * RESOLUTION_Y);
+	tri.v2 = XMFLOAT2((c2.x / c2.w * 0.5f + 0.5f) * RESOLUTION_X, (0.5f - c2.y / c2.w * 0.5f) * RESOLUTION_Y);
+
+	// Make every triangle counter clockwise in screen space, both faces of occluders are rasterized:
+	const float area = (tri.v1.x - tri.v0.x) * (tri.v2.y - tri.v0.y) - (tri.v1.y - tri.v0.y) * (tri.v2.x - tri.v0.x);
+	if (area == 0)
+	{
+		return;
+	}
+	if (area < 0)
+	{
+		std::swap(tri.v1, tri.v2);
+	}
+
+	// Pixel centers that can be inside the triangle:
+	tri.minX = max(0, (int)ceilf(min(tri.v0.x, min(tri.v1.x, tri.v2.x)) - 0.5f));
+	tri.minY = max(0, (int)ceilf(min(tri.v0.y, min(tri.v1.y, tri.v2.y)) - 0.5f));
+	tri.maxX = min(RESOLUTION_X - 1, (int)floorf(max(tri.v0.x, max(tri.v1.x, tri.v2.x)) - 0.5f));
+	tri.maxY = min(RESOLUTION_Y - 1, (int)floorf(max(tri.v0.y, max(tri.v1.y, tri.v2.y)) - 0.5f));
+	if (tri.minX > tri.maxX || tri.minY > tri.maxY)
+	{
+		return;
+	}
+
+	// The whole triangle is written with its farthest depth, so it can never occlude more than itself:
+	tri.depth = max(c0.w, max(c1.w, c2.w));
+
+	// Bin the triangle into the tiles that its pixel rectangle overlaps, so a tile only rasterizes the triangles that can touch it:
+	const uint32_t triangleIndex = (uint32_t)triangles.size();
+	for (int tileY = tri.minY / TILE_SIZE_Y; tileY <= tri.maxY / TILE_SIZE_Y; ++tileY)
+	{
+		for (int tileX = tri.minX / TILE_SIZE_X; tileX <= tri.maxX / TILE_SIZE_X; ++tileX)
+		{
+			tileTriangles[tileY * TILE_COUNT_X + tileX].push_back(triangleIndex);
+		}
+	}
+
+	triangles.push_back(tri);
+}
+
+void wiOcclusionCuller::Rasterize(wiJobSystem::context& ctx)
+{
+	wiJobSystem::Dispatch(ctx, TILE_COUNT_X * TILE_COUNT_Y, 1, [&](wiJobDispatchArgs args) {
+		RasterizeTile(args.jobIndex % TILE_COUNT_X, args.jobIndex / TILE_COUNT_X);
+	});
+}
+
+void wiOcclusionCuller::RasterizeTile(int tileX, int tileY)
+{
+	const int tileMinX = tileX * TILE_SIZE_X;
+	const int tileMinY = tileY * TILE_SIZE_Y;
+	const int tileMaxX = tileMinX + TILE_SIZE_X - 1;
+	const int tileMaxY = tileMinY + TILE_SIZE_Y - 1;
+
+	const XMVECTOR zero = XMVectorZero();
+	const XMVECTOR pixelOffsets = XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f);
+
+	for (uint32_t triangleIndex : tileTriangles[tileY * TILE_COUNT_X + tileX])
+	{
+		const Triangle& tri = triangles[triangleIndex];
+
+		// Only 4-pixel aligned groups are processed, this never crosses the tile border because tile width is a multiple of 4:
+		const int minX = max(tri.minX, tileMinX) & ~3;
+		const int minY = max(tri.minY, tileMinY);
+		const int maxX = min(tri.maxX, tileMaxX);
+		const int maxY = min(tri.maxY, tileMaxY);
+		if (minX > maxX || minY > maxY)
+		{
+			continue;
+		}
+
+		// Edge functions: E(x,y) = A * x + B * y + C, inside when all three are >= 0
+		const float A0 = tri.v0.y - tri.v1.y, B0 = tri.v1.x - tri.v0.x, C0 = tri.v0.x * tri.v1.y - tri.v0.y * tri.v1.x;
+		const float A1 = tri.v1.y - tri.v2.y, B1 = tri.v2.x - tri.v1.x, C1 = tri.v1.x * tri.v2.y - tri.v1.y * tri.v2.x;
+		const float A2 = tri.v2.y - tri.v0.y, B2 = tri.v0.x - tri.v2.x, C2 = tri.v2.x * tri.v0.y - tri.v2.y * tri.v0.x;
+		const XMVECTOR a0 = XMVectorReplicate(A0);
+		const XMVECTOR a1 = XMVectorReplicate(A1);
+		const XMVECTOR a2 = XMVectorReplicate(A2);
+		const XMVECTOR depth = XMVectorReplicate(tri.depth);
+
+		for (int y = minY; y <= maxY; ++y)
+		{
+			const float py = (float)y + 0.5f;
+			const XMVECTOR row0 = XMVectorReplicate(B0 * py + C0);
+			const XMVECTOR row1 = XMVectorReplicate(B1 * py + C1);
+			const XMVECTOR row2 = XMVectorReplicate(B2 * py + C2);
+			float* dst = &depthBuffer[y * RESOLUTION_X];
+
+			for (int x = minX; x <= maxX; x += 4)
+			{
+				const XMVECTOR px = XMVectorAdd(XMVectorReplicate((float)x), pixelOffsets);
+				XMVECTOR inside = XMVectorGreaterOrEqual(XMVectorMultiplyAdd(a0, px, row0), zero);
+				inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(XMVectorMultiplyAdd(a1, px, row1), zero));
+				inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(XMVectorMultiplyAdd(a2, px, row2), zero));
+
+				XMFLOAT4* pixels = (XMFLOAT4*)&dst[x];
+				const XMVECTOR current = XMLoadFloat4(pixels);
+				XMStoreFloat4(pixels, XMVectorSelect(current, XMVectorMin(current, depth), inside));
+			}
+		}
+	}
+
+	// Update the hierarchical depth of the tile:
+	float farthest = 0;
+	for (int y = tileMinY; y <= tileMaxY; ++y)
+	{
+		for (int x = tileMinX; x <= tileMaxX; ++x)
+		{
+			farthest = max(farthest, depthBuffer[y * RESOLUTION_X + x]);
+		}
+	}
+	tileDepth[tileY * TILE_COUNT_X + tileX] = farthest;
+}
+
+bool wiOcclusionCuller::IsVisible(const AABB& aabb) const
+{
+	const XMMATRIX VP = XMLoadFloat4x4(&viewProjection);
+
+	float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+	float closest = FLT_MAX;
+	for (int i = 0; i < 8; ++i)
+	{
+		const XMFLOAT3 corner = aabb.corner(i);
+		XMFLOAT4 p;
+		XMStoreFloat4(&p, XMVector3Transform(XMLoadFloat3(&corner), VP));
+		if (p.w < NEAR_CLIP_W)
+		{
+			// The box reaches the near plane, it can't be tested conservatively:
+			return true;
+		}
+		const float x = (p.x / p.w * 0.5f + 0.5f) * RESOLUTION_X;
+		const float y = (0.5f - p.y / p.w * 0.5f) * RESOLUTION_Y;
+		minX = min(minX, x);
+		minY = min(minY, y);
+		maxX = max(maxX, x);
+		maxY = max(maxY, y);
+		closest = min(closest, p.w);
+	}
+
+	// Every pixel that the projected box touches:
+	const int x0 = max(0, (int)floorf(minX));
+	const int y0 = max(0, (int)floorf(minY));
+	const int x1 = min(RESOLUTION_X - 1, (int)floorf(maxX));
+	const int y1 = min(RESOLUTION_Y - 1, (int)floorf(maxY));
+	if (x0 > x1 || y0 > y1)
+	{
+		// Off screen, leave this decision to frustum culling
+		return true;
+	}
+
+	for (int tileY = y0 / TILE_SIZE_Y; tileY <= y1 / TILE_SIZE_Y; ++tileY)
+	{
+		for (int tileX = x0 / TILE_SIZE_X; tileX <= x1 / TILE_SIZE_X; ++tileX)
+		{
+			if (closest > tileDepth[tileY * TILE_COUNT_X + tileX])
+			{
+				// Every occluder in the tile is in front of the box:
+				continue;
+			}
+
+			const int tx0 = max(x0, tileX * TILE_SIZE_X);
+			const int ty0 = max(y0, tileY * TILE_SIZE_Y);
+			const int tx1 = min(x1, tileX * TILE_SIZE_X + TILE_SIZE_X - 1);
+			const int ty1 = min(y1, tileY * TILE_SIZE_Y + TILE_SIZE_Y - 1);
+			for (int y = ty0; y <= ty1; ++y)
+			{
+				for (int x = tx0; x <= tx1; ++x)
+				{
+					if (closest <= depthBuffer[y * RESOLUTION_X + x])
+					{
+						return true;
+					}
+				}
+			}
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "CommonInclude.h"
+#include "wiJobSystem.h"
+
+#include <vector>
+
+struct AABB;
+
+// CPU occlusion culler: designated occluder meshes are rasterized into a low resolution hierarchical depth buffer,
+//	then bounding boxes can be tested against it before the render queues are built.
+//	It doesn't use the graphics device, so the results are available in the same frame and it also works headless.
+class wiOcclusionCuller
+{
+public:
+	static const int RESOLUTION_X = 256;
+	static const int RESOLUTION_Y = 128;
+	static const int TILE_SIZE_X = 32;
+	static const int TILE_SIZE_Y = 16;
+	static const int TILE_COUNT_X = RESOLUTION_X / TILE_SIZE_X;
+	static const int TILE_COUNT_Y = RESOLUTION_Y / TILE_SIZE_Y;
+
+private:
+	struct Triangle
+	{
+		XMFLOAT2 v0, v1, v2;	// screen space positions in pixels
+		int minX, minY, maxX, maxY;	// covered pixel rectangle (inclusive)
+		float depth;			// farthest linear depth of the triangle (conservative)
+	};
+	std::vector<Triangle> triangles;
+	std::vector<uint32_t> tileTriangles[TILE_COUNT_X * TILE_COUNT_Y]; // the triangles that overlap each tile (binned when they are added)
+	std::vector<XMFLOAT4> clipPositions;
+	XMFLOAT4X4 viewProjection;
+
+	// Depth buffers store linear depth of the closest occluder, FLT_MAX means there is no occluder:
+	float depthBuffer[RESOLUTION_X * RESOLUTION_Y];
+	float tileDepth[TILE_COUNT_X * TILE_COUNT_Y]; // farthest occluder depth inside each tile
+
+	void AddTriangle(const XMFLOAT4& c0, const XMFLOAT4& c1, const XMFLOAT4& c2);
+	void RasterizeTile(int tileX, int tileY);
+
+public:
+	wiOcclusionCuller();
+
+	// Start a new occlusion pass with the camera's view projection matrix, removes all occluders
+	void Clear(const XMFLOAT4X4& viewProjection);
+	// Add an occluder triangle list with its world matrix. Triangles crossing the near plane are clipped.
+	void AddOccluder(const XMFLOAT3* positions, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, const XMFLOAT4X4& world);
+	// Rasterize the occluders into the depth buffer. The work is split up into screen tiles that only process their binned triangles, ctx must be waited before testing
+	void Rasterize(wiJobSystem::context& ctx);
+	// Test a world space bounding box, returns false only if it is completely hidden behind occluders
+	//	This is thread safe after the rasterization is complete
+	bool IsVisible(const AABB& aabb) const;
+
+	inline uint32_t GetTriangleCount() const { return (uint32_t)triangles.size(); }
+	inline const float* GetDepthBuffer() const { return depthBuffer; }
+};
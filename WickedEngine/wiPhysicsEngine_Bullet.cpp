@@ -112,7 +112,8 @@ namespace wiPhysicsEngine
 		case RigidBodyPhysicsComponent::CollisionShape::TRIANGLE_MESH:
 			{
 				int totalVerts = (int)mesh.vertex_positions.size();
-				int totalTriangles = (int)mesh.indices.size() / 3;
+				const int indexCount = (int)mesh.GetLOD0IndexCount();
+				int totalTriangles = indexCount / 3;
 
 				btVector3* btVerts = new btVector3[totalVerts];
 				size_t i = 0;
@@ -121,11 +122,10 @@ namespace wiPhysicsEngine
 					btVerts[i++] = btVector3(pos.x, pos.y, pos.z);
 				}
 
-				int* btInd = new int[mesh.indices.size()];
-				i = 0;
-				for (auto& ind : mesh.indices)
+				int* btInd = new int[indexCount];
+				for (int j = 0; j < indexCount; ++j)
 				{
-					btInd[i++] = ind;
+					btInd[j] = mesh.indices[j];
 				}
 
 				int vertStride = sizeof(btVector3);
@@ -217,7 +217,7 @@ namespace wiPhysicsEngine
 			btVerts[i * 3 + 2] = btScalar(position.z);
 		}
 
-		const int iCount = (int)mesh.indices.size();
+		const int iCount = (int)mesh.GetLOD0IndexCount();
 		const int tCount = iCount / 3;
 		int* btInd = new int[iCount];
 		for (int i = 0; i < iCount; ++i) 
@@ -311,7 +311,7 @@ namespace wiPhysicsEngine
 
 		wiJobSystem::Wait(ctx);
 
-		auto range = wiProfiler::BeginRangeCPU("Physics");
+		auto range = wiProfiler::BeginRangeCPU(WI_HASHSTRING("Physics"));
 
 		btVector3 wind = btVector3(weather.windDirection.x, weather.windDirection.y, weather.windDirection.z);
 
@@ -456,8 +456,9 @@ namespace wiPhysicsEngine
 				if (softbody != nullptr)
 				{
 					SoftBodyPhysicsComponent* physicscomponent = softbodies.GetComponent(entity);
-					if (physicscomponent == nullptr)
+					if (physicscomponent == nullptr || physicscomponent->physicsobject != softbody)
 					{
+						// The component was removed, or its physics object was recreated (for example after MeshComponent::Optimize()):
 						((btSoftRigidDynamicsWorld*)dynamicsWorld)->removeSoftBody(softbody);
 						i--;
 						continue;
@@ -2,41 +2,697 @@
 #include "wiGraphicsDevice.h"
 #include "wiRenderer.h"
 #include "wiFont.h"
-#include "wiTimer.h"
 #include "wiGraphicsResource.h"
+#include "wiBackLog.h"
 
 #include <sstream>
 #include <unordered_map>
 #include <stack>
 #include <mutex>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <algorithm>
+#include <cmath>
 
 using namespace std;
 using namespace wiGraphics;
 
 namespace wiProfiler
 {
-	bool ENABLED = false;
+	std::atomic<bool> ENABLED{ false };
 	bool initialized = false;
 	std::mutex lock;
 	range_id cpu_frame;
 	range_id gpu_frame;
 
+	// The lowest bit of a range_id tells if it is a CPU range, 0 is an invalid range
+	static const range_id CPU_RANGE_BIT = 1;
+
 	struct Range
 	{
-		std::string name;
+		wiHashString name;
 		float time = 0;
 		CommandList cmd = COMMANDLIST_COUNT;
 
-		wiTimer cpuBegin, cpuEnd;
-
 		wiRenderer::GPUQueryRing<4> gpuBegin;
 		wiRenderer::GPUQueryRing<4> gpuEnd;
-
-		bool IsCPURange() const { return cmd == COMMANDLIST_COUNT; }
 	};
-	std::unordered_map<size_t, Range*> ranges;
+	std::unordered_map<size_t, Range*> ranges; // GPU ranges
 	wiRenderer::GPUQueryRing<4> disjoint;
 
+	// CPU ranges are recorded as begin and end events into a ring buffer per thread
+	//	The buffer has a single writer (the thread) and a single reader (EndFrame), so no locking is needed
+	struct Event
+	{
+		wiHashString name;
+		int64_t time;
+		bool begin;
+	};
+	static const uint64_t EVENT_CAPACITY = 1 << 15;
+	static const uint32_t MAX_DEPTH = 64;
+	struct ThreadData
+	{
+		std::string name;
+		std::unique_ptr<Event[]> events; // allocated when the first event is recorded
+		std::atomic<uint64_t> writeCount{ 0 };
+		std::atomic<uint64_t> readCount{ 0 };
+		std::atomic<uint64_t> droppedEvents{ 0 };
+
+		// Used only by the thread:
+		uint32_t depth = 0;
+		bool recorded[MAX_DEPTH] = {}; // if the begin event of a depth was recorded, the end event must be recorded too
+
+		// Used only by EndFrame, the ranges that were begun but not ended yet (they can span over multiple frames):
+		struct OpenRange
+		{
+			wiHashString name;
+			uint32_t node;
+			int64_t begin;
+			double childTime;
+		};
+		std::vector<OpenRange> stack;
+		ThreadResult result;
+	};
+	std::vector<std::unique_ptr<ThreadData>> threads; // the data is kept after a thread exits
+	thread_local ThreadData* threadData = nullptr;
+	std::vector<ThreadResult> results;
+	int64_t frameBeginTime = 0;
+	bool frameStarted = false; // the profiler can be enabled between BeginFrame() and EndFrame()
+
+	// Capture of multiple frames for exporting
+	struct CapturedFrame
+	{
+		double beginTime; // milliseconds, relative to the beginning of the capture
+		std::vector<ThreadResult> threads;
+		std::vector<std::pair<wiHashString, float>> gpuRanges;
+	};
+	struct Capture
+	{
+		uint32_t frameCount = 0;
+		std::string traceFileName;
+		std::string csvFileName;
+		bool enabledProfiler = false; // the profiler was enabled for the capture, it will be disabled after it
+		int64_t beginTime = 0;
+		std::vector<CapturedFrame> frames;
+	};
+	std::unique_ptr<Capture> capture;
+
+	// Log-linear histogram of times in microseconds, like HDR histograms: values below 2^SUB_BUCKET_BITS are exact,
+	//	above that every power of two range is divided into 2^SUB_BUCKET_BITS buckets
+	struct Histogram
+	{
+		static const uint32_t SUB_BUCKET_BITS = 5;
+		static const uint32_t SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+		static const uint32_t MAX_BITS = 32; // ~71 minutes
+		static const uint32_t BUCKET_COUNT = (MAX_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+		uint32_t counts[BUCKET_COUNT] = {};
+		uint32_t total = 0;
+
+		static uint32_t GetBucket(uint32_t value)
+		{
+			if (value < SUB_BUCKET_COUNT)
+			{
+				return value;
+			}
+			uint32_t shift = 0;
+			while ((value >> shift) >= SUB_BUCKET_COUNT * 2)
+			{
+				shift++;
+			}
+			return (shift + 1) * SUB_BUCKET_COUNT + (value >> shift) - SUB_BUCKET_COUNT;
+		}
+		// Returns the middle of the bucket in microseconds
+		static double GetValue(uint32_t bucket)
+		{
+			if (bucket < SUB_BUCKET_COUNT)
+			{
+				return (double)bucket;
+			}
+			const uint32_t shift = bucket / SUB_BUCKET_COUNT - 1;
+			const uint64_t lower = (uint64_t)(bucket % SUB_BUCKET_COUNT + SUB_BUCKET_COUNT) << shift;
+			return (double)lower + (double)((1ull << shift) - 1) * 0.5;
+		}
+		double GetPercentile(double percentile) const
+		{
+			if (total == 0)
+			{
+				return 0;
+			}
+			const uint32_t rank = std::max(1u, (uint32_t)ceil(std::min(std::max(percentile, 0.0), 100.0) / 100.0 * total));
+			uint32_t count = 0;
+			for (uint32_t i = 0; i < BUCKET_COUNT; ++i)
+			{
+				count += counts[i];
+				if (count >= rank)
+				{
+					return GetValue(i);
+				}
+			}
+			return GetValue(BUCKET_COUNT - 1);
+		}
+	};
+	// The samples of a range in the rolling window, the oldest sample is removed from the histogram when a new one is added
+	struct RangeHistory
+	{
+		std::string path;
+		double last = 0;
+		double sum = 0; // microseconds, of the samples in the window
+		std::vector<uint32_t> samples; // microseconds, ring buffer
+		uint32_t next = 0;
+		Histogram histogram;
+
+		// hitch thresholds:
+		double hitchTime = 0;
+		double hitchMedianFactor = 0;
+	};
+	std::unordered_map<uint64_t, std::unique_ptr<RangeHistory>> histories; // by path hash
+	uint32_t statisticsWindow = 1000;
+	uint64_t frameIndex = 0;
+	static const size_t MAX_HITCHES = 32;
+	static const uint32_t HITCH_MEDIAN_MIN_SAMPLES = 30;
+	std::vector<Hitch> hitches;
+	uint64_t hitchCount = 0;
+	struct HitchThreshold
+	{
+		double time;
+		double medianFactor;
+	};
+	std::unordered_map<uint64_t, HitchThreshold> hitchThresholds; // kept when the statistics are reset
+
+	// The path hash is combined from the hashes of the path elements, so it is computed without building the path string every frame
+	inline uint64_t CombinePath(uint64_t parent, uint64_t name)
+	{
+		return (parent ^ name) * 1099511628211ull + 0x9E3779B97F4A7C15ull;
+	}
+	uint64_t GetPathHash(const std::string& path)
+	{
+		uint64_t result = 0;
+		bool first = true;
+		size_t begin = 0;
+		while (true)
+		{
+			const size_t end = path.find('/', begin);
+			const std::string name = path.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+			const uint64_t hash = wiHashString::Hash(name.c_str(), name.length());
+			result = first ? hash : CombinePath(result, hash);
+			first = false;
+			if (end == std::string::npos)
+			{
+				break;
+			}
+			begin = end + 1;
+		}
+		return result;
+	}
+
+	inline int64_t GetTime()
+	{
+		return (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+	inline double ToMilliseconds(int64_t time)
+	{
+		return (double)time / 1000000.0;
+	}
+
+	ThreadData& GetThreadData()
+	{
+		if (threadData == nullptr)
+		{
+			std::lock_guard<std::mutex> lck(lock);
+			threads.emplace_back(new ThreadData);
+			threadData = threads.back().get();
+			threadData->name = "Thread " + std::to_string(threads.size() - 1);
+		}
+		return *threadData;
+	}
+
+	// reserved: the number of events that must still fit into the buffer after this one
+	inline bool PushEvent(ThreadData& thread, const wiHashString& name, bool begin, uint64_t reserved)
+	{
+		const uint64_t write = thread.writeCount.load(std::memory_order_relaxed);
+		if (write - thread.readCount.load(std::memory_order_acquire) + reserved >= EVENT_CAPACITY)
+		{
+			thread.droppedEvents.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		if (thread.events == nullptr)
+		{
+			thread.events.reset(new Event[EVENT_CAPACITY]);
+		}
+		Event& event = thread.events[write % EVENT_CAPACITY];
+		event.name = name;
+		event.time = GetTime();
+		event.begin = begin;
+		thread.writeCount.store(write + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Process the recorded events of a thread into the aggregated results of the frame
+	void CollectThread(ThreadData& thread)
+	{
+		ThreadResult& result = thread.result;
+		result.name = thread.name;
+		result.ranges.clear();
+		result.timeline.clear();
+		result.droppedEvents = thread.droppedEvents.exchange(0, std::memory_order_relaxed);
+
+		// The hierarchy is built as a tree of first child and next sibling links while reading the events:
+		struct Link
+		{
+			uint32_t firstChild = ~0u;
+			uint32_t lastChild = ~0u;
+			uint32_t nextSibling = ~0u;
+		};
+		std::vector<Link> links;
+		Link roots;
+		auto FindOrAddNode = [&](const wiHashString& name, uint32_t parent) {
+			uint32_t node = parent == ~0u ? roots.firstChild : links[parent].firstChild;
+			while (node != ~0u && result.ranges[node].name != name)
+			{
+				node = links[node].nextSibling;
+			}
+			if (node == ~0u)
+			{
+				node = (uint32_t)result.ranges.size();
+				CPURangeResult range;
+				range.name = name;
+				range.parent = parent;
+				range.depth = parent == ~0u ? 0 : result.ranges[parent].depth + 1;
+				result.ranges.push_back(range);
+				links.emplace_back();
+
+				Link& parentLink = parent == ~0u ? roots : links[parent];
+				if (parentLink.firstChild == ~0u)
+				{
+					parentLink.firstChild = node;
+				}
+				else
+				{
+					links[parentLink.lastChild].nextSibling = node;
+				}
+				parentLink.lastChild = node;
+			}
+			return node;
+		};
+
+		// The ranges that are still open from the previous frames are continued in this frame:
+		for (size_t i = 0; i < thread.stack.size(); ++i)
+		{
+			const uint32_t parent = i == 0 ? ~0u : thread.stack[i - 1].node;
+			thread.stack[i].node = FindOrAddNode(thread.stack[i].name, parent);
+		}
+
+		const uint64_t write = thread.writeCount.load(std::memory_order_acquire);
+		uint64_t read = thread.readCount.load(std::memory_order_relaxed);
+		for (; read < write; ++read)
+		{
+			const Event& event = thread.events[read % EVENT_CAPACITY];
+			if (event.begin)
+			{
+				ThreadData::OpenRange open;
+				open.name = event.name;
+				open.node = FindOrAddNode(event.name, thread.stack.empty() ? ~0u : thread.stack.back().node);
+				open.begin = event.time;
+				open.childTime = 0;
+				thread.stack.push_back(open);
+			}
+			else if (!thread.stack.empty())
+			{
+				const ThreadData::OpenRange open = thread.stack.back();
+				thread.stack.pop_back();
+
+				const double time = ToMilliseconds(event.time - open.begin);
+				CPURangeResult& range = result.ranges[open.node];
+				range.calls++;
+				range.inclusiveTime += time;
+				range.exclusiveTime += time - open.childTime;
+				if (!thread.stack.empty())
+				{
+					thread.stack.back().childTime += time;
+				}
+
+				CPURangeEvent timelineEvent;
+				timelineEvent.name = open.name;
+				timelineEvent.depth = (uint32_t)thread.stack.size();
+				timelineEvent.begin = ToMilliseconds(open.begin - frameBeginTime);
+				timelineEvent.end = ToMilliseconds(event.time - frameBeginTime);
+				result.timeline.push_back(timelineEvent);
+			}
+		}
+		thread.readCount.store(read, std::memory_order_release);
+
+		// Sort the hierarchy into depth first order:
+		if (!result.ranges.empty())
+		{
+			std::vector<CPURangeResult> sorted;
+			std::vector<uint32_t> remap(result.ranges.size());
+			sorted.reserve(result.ranges.size());
+			std::stack<uint32_t> nodes;
+			nodes.push(roots.firstChild);
+			while (!nodes.empty())
+			{
+				const uint32_t node = nodes.top();
+				nodes.pop();
+				remap[node] = (uint32_t)sorted.size();
+				sorted.push_back(result.ranges[node]);
+				if (links[node].nextSibling != ~0u)
+				{
+					nodes.push(links[node].nextSibling);
+				}
+				if (links[node].firstChild != ~0u)
+				{
+					nodes.push(links[node].firstChild);
+				}
+			}
+			for (auto& x : sorted)
+			{
+				if (x.parent != ~0u)
+				{
+					x.parent = remap[x.parent];
+				}
+			}
+			result.ranges = std::move(sorted);
+		}
+	}
+
+	std::string EscapeJSON(const std::string& value)
+	{
+		std::string result;
+		for (char c : value)
+		{
+			if (c == '"' || c == '\\')
+			{
+				result += '\\';
+				result += c;
+			}
+			else if ((unsigned char)c < 0x20)
+			{
+				result += ' ';
+			}
+			else
+			{
+				result += c;
+			}
+		}
+		return result;
+	}
+	std::string EscapeCSV(const std::string& value)
+	{
+		if (value.find_first_of(",\"\n") == std::string::npos)
+		{
+			return value;
+		}
+		std::string result = "\"";
+		for (char c : value)
+		{
+			result += c;
+			if (c == '"')
+			{
+				result += '"';
+			}
+		}
+		return result + "\"";
+	}
+
+	// Chrome trace event format, it can be opened with Perfetto (ui.perfetto.dev) or chrome://tracing
+	//	Every thread is a separate lane, the GPU range times are counters
+	bool SaveTrace(const Capture& capture)
+	{
+		ofstream file(capture.traceFileName, ios::trunc);
+		if (!file.is_open())
+		{
+			return false;
+		}
+		file.precision(3);
+		file << fixed;
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << endl;
+
+		std::unordered_map<std::string, uint32_t> threadIDs;
+		bool first = true;
+		auto Separator = [&]() {
+			if (!first)
+			{
+				file << "," << endl;
+			}
+			first = false;
+		};
+		for (auto& frame : capture.frames)
+		{
+			for (auto& thread : frame.threads)
+			{
+				auto it = threadIDs.find(thread.name);
+				if (it == threadIDs.end())
+				{
+					it = threadIDs.insert(std::make_pair(thread.name, (uint32_t)threadIDs.size())).first;
+					Separator();
+					file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << it->second << ",\"args\":{\"name\":\"" << EscapeJSON(thread.name) << "\"}}";
+					Separator();
+					file << "{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":0,\"tid\":" << it->second << ",\"args\":{\"sort_index\":" << it->second << "}}";
+				}
+				for (auto& event : thread.timeline)
+				{
+					Separator();
+					file << "{\"name\":\"" << EscapeJSON(event.name.GetString()) << "\",\"cat\":\"CPU\",\"ph\":\"X\",\"pid\":0,\"tid\":" << it->second;
+					file << ",\"ts\":" << (frame.beginTime + event.begin) * 1000.0 << ",\"dur\":" << (event.end - event.begin) * 1000.0 << "}";
+				}
+			}
+			if (!frame.gpuRanges.empty())
+			{
+				Separator();
+				file << "{\"name\":\"GPU\",\"ph\":\"C\",\"pid\":0,\"ts\":" << frame.beginTime * 1000.0 << ",\"args\":{";
+				for (size_t i = 0; i < frame.gpuRanges.size(); ++i)
+				{
+					file << (i > 0 ? "," : "") << "\"" << EscapeJSON(frame.gpuRanges[i].first.GetString()) << "\":" << frame.gpuRanges[i].second;
+				}
+				file << "}}";
+			}
+		}
+
+		file << endl << "]}" << endl;
+		file.close();
+		return !file.fail();
+	}
+
+	// One line per frame, one column per range (the inclusive time in milliseconds)
+	//	CPU ranges are identified by their thread and hierarchy path ("Main Thread/CPU Frame/Update"), GPU ranges are prefixed by "GPU/"
+	bool SaveCSV(const Capture& capture)
+	{
+		std::vector<std::string> columns;
+		std::unordered_map<std::string, size_t> columnIndices;
+		std::vector<std::vector<std::pair<size_t, double>>> rows(capture.frames.size());
+		auto AddValue = [&](size_t frame, const std::string& column, double value) {
+			auto it = columnIndices.find(column);
+			if (it == columnIndices.end())
+			{
+				it = columnIndices.insert(std::make_pair(column, columns.size())).first;
+				columns.push_back(column);
+			}
+			rows[frame].push_back(std::make_pair(it->second, value));
+		};
+		for (size_t i = 0; i < capture.frames.size(); ++i)
+		{
+			const CapturedFrame& frame = capture.frames[i];
+			for (auto& thread : frame.threads)
+			{
+				std::vector<std::string> paths(thread.ranges.size());
+				for (size_t j = 0; j < thread.ranges.size(); ++j)
+				{
+					const CPURangeResult& range = thread.ranges[j];
+					paths[j] = (range.parent == ~0u ? thread.name : paths[range.parent]) + "/" + range.name.GetString();
+					AddValue(i, paths[j], range.inclusiveTime);
+				}
+			}
+			for (auto& x : frame.gpuRanges)
+			{
+				AddValue(i, "GPU/" + x.first.GetString(), x.second);
+			}
+		}
+
+		ofstream file(capture.csvFileName, ios::trunc);
+		if (!file.is_open())
+		{
+			return false;
+		}
+		file.precision(3);
+		file << fixed;
+		file << "Frame,Time";
+		for (auto& x : columns)
+		{
+			file << "," << EscapeCSV(x);
+		}
+		file << endl;
+		std::vector<double> values;
+		std::vector<bool> valid;
+		for (size_t i = 0; i < rows.size(); ++i)
+		{
+			values.assign(columns.size(), 0);
+			valid.assign(columns.size(), false);
+			for (auto& x : rows[i])
+			{
+				values[x.first] += x.second;
+				valid[x.first] = true;
+			}
+			file << i << "," << capture.frames[i].beginTime;
+			for (size_t j = 0; j < columns.size(); ++j)
+			{
+				file << ",";
+				if (valid[j])
+				{
+					file << values[j];
+				}
+			}
+			file << endl;
+		}
+		file.close();
+		return !file.fail();
+	}
+
+	void FinishCapture()
+	{
+		std::unique_ptr<Capture> finished = std::move(capture);
+		if (finished->enabledProfiler)
+		{
+			ENABLED = false;
+		}
+
+		stringstream ss("");
+		ss << "Profiler capture of " << finished->frames.size() << " frames";
+		if (!finished->traceFileName.empty())
+		{
+			ss << (SaveTrace(*finished) ? ", saved: " : ", failed to save: ") << finished->traceFileName;
+		}
+		if (!finished->csvFileName.empty())
+		{
+			ss << (SaveCSV(*finished) ? ", saved: " : ", failed to save: ") << finished->csvFileName;
+		}
+		wiBackLog::post(ss.str().c_str());
+	}
+
+	RangeHistory& GetHistory(uint64_t pathHash, const std::function<std::string()>& path)
+	{
+		auto it = histories.find(pathHash);
+		if (it == histories.end())
+		{
+			it = histories.insert(std::make_pair(pathHash, std::unique_ptr<RangeHistory>(new RangeHistory))).first;
+			RangeHistory& history = *it->second;
+			history.path = path();
+			history.samples.reserve(statisticsWindow);
+			auto threshold = hitchThresholds.find(pathHash);
+			if (threshold != hitchThresholds.end())
+			{
+				history.hitchTime = threshold->second.time;
+				history.hitchMedianFactor = threshold->second.medianFactor;
+			}
+		}
+		return *it->second;
+	}
+	// Add a sample to the range history, returns the exceeded hitch threshold or 0
+	double AddSample(RangeHistory& history, double time)
+	{
+		double threshold = 0;
+		if (history.hitchTime > 0 && time > history.hitchTime)
+		{
+			threshold = history.hitchTime;
+		}
+		else if (history.hitchMedianFactor > 0 && history.histogram.total >= HITCH_MEDIAN_MIN_SAMPLES)
+		{
+			const double median = history.histogram.GetPercentile(50) / 1000.0 * history.hitchMedianFactor;
+			if (time > median)
+			{
+				threshold = median;
+			}
+		}
+
+		const uint32_t sample = (uint32_t)std::min(std::max(time * 1000.0, 0.0), (double)~0u);
+		if (history.samples.size() < statisticsWindow)
+		{
+			history.samples.push_back(sample);
+		}
+		else
+		{
+			uint32_t& oldest = history.samples[history.next];
+			history.histogram.counts[Histogram::GetBucket(oldest)]--;
+			history.histogram.total--;
+			history.sum -= oldest;
+			oldest = sample;
+			history.next = (history.next + 1) % statisticsWindow;
+		}
+		history.histogram.counts[Histogram::GetBucket(sample)]++;
+		history.histogram.total++;
+		history.sum += sample;
+		history.last = time;
+		return threshold;
+	}
+	void UpdateStatistics()
+	{
+		const Hitch* hitch = nullptr;
+		auto ReportHitch = [&](RangeHistory& history, double time, double threshold) {
+			if (threshold <= 0 || hitch != nullptr)
+			{
+				return;
+			}
+			hitchCount++;
+			if (hitches.size() >= MAX_HITCHES)
+			{
+				hitches.erase(hitches.begin());
+			}
+			hitches.emplace_back();
+			Hitch& x = hitches.back();
+			x.frame = frameIndex;
+			x.path = history.path;
+			x.time = time;
+			x.threshold = threshold;
+			x.threads = results;
+			for (auto& range : ranges)
+			{
+				x.gpuRanges.push_back(std::make_pair(range.second->name.GetString(), range.second->time));
+			}
+			hitch = &x;
+		};
+
+		std::vector<uint64_t> pathHashes;
+		for (auto& thread : results)
+		{
+			const uint64_t threadHash = wiHashString::Hash(thread.name.c_str(), thread.name.length());
+			pathHashes.resize(thread.ranges.size());
+			for (size_t i = 0; i < thread.ranges.size(); ++i)
+			{
+				const CPURangeResult& range = thread.ranges[i];
+				pathHashes[i] = CombinePath(range.parent == ~0u ? threadHash : pathHashes[range.parent], range.name.GetHash());
+				RangeHistory& history = GetHistory(pathHashes[i], [&]() {
+					std::string path = range.name.GetString();
+					for (uint32_t parent = range.parent; parent != ~0u; parent = thread.ranges[parent].parent)
+					{
+						path = thread.ranges[parent].name.GetString() + "/" + path;
+					}
+					return thread.name + "/" + path;
+				});
+				ReportHitch(history, range.inclusiveTime, AddSample(history, range.inclusiveTime));
+			}
+		}
+		const uint64_t gpuHash = wiHashString::Hash("GPU");
+		for (auto& x : ranges)
+		{
+			const Range& range = *x.second;
+			RangeHistory& history = GetHistory(CombinePath(gpuHash, range.name.GetHash()), [&]() {
+				return "GPU/" + range.name.GetString();
+			});
+			ReportHitch(history, range.time, AddSample(history, range.time));
+		}
+
+		if (hitch != nullptr)
+		{
+			stringstream ss("");
+			ss.precision(2);
+			ss << "[wiProfiler] Hitch in frame " << hitch->frame << ": " << hitch->path << " took " << fixed << hitch->time << " ms (threshold: " << hitch->threshold << " ms)";
+			wiBackLog::post(ss.str().c_str());
+		}
+	}
+
 	void BeginFrame()
 	{
 		if (!ENABLED)
@@ -51,25 +707,44 @@ namespace wiProfiler
 			GPUQueryDesc desc;
 			desc.Type = GPU_QUERY_TYPE_TIMESTAMP_DISJOINT;
 			disjoint.Create(wiRenderer::GetDevice(), &desc);
+
+			GetThreadData().name = "Main Thread";
 		}
 
 		CommandList cmd = wiRenderer::GetDevice()->BeginCommandList(); // it would be a good idea to not start a new command list just for these couple of queries!
 		wiRenderer::GetDevice()->QueryBegin(disjoint.Get_GPU(), cmd);
 		wiRenderer::GetDevice()->QueryEnd(disjoint.Get_GPU(), cmd); // this should be at the end of frame, but the problem is that there will be other command lists submitted in between and it doesn't work that way in DX11
 
-		cpu_frame = BeginRangeCPU("CPU Frame");
-		gpu_frame = BeginRangeGPU("GPU Frame", cmd);
+		frameStarted = true;
+		frameBeginTime = GetTime();
+		cpu_frame = BeginRangeCPU(WI_HASHSTRING("CPU Frame"));
+		gpu_frame = BeginRangeGPU(WI_HASHSTRING("GPU Frame"), cmd);
 	}
 	void EndFrame(CommandList cmd)
 	{
-		if (!ENABLED || !initialized)
+		if (!ENABLED || !initialized || !frameStarted)
 			return;
+		frameStarted = false;
 
 		// note: read the GPU Frame end range manually because it will be on a separate command list than start point:
 		wiRenderer::GetDevice()->QueryEnd(ranges[gpu_frame]->gpuEnd.Get_GPU(), cmd);
 
 		EndRange(cpu_frame);
 
+		// Collect the CPU ranges of all threads:
+		{
+			std::lock_guard<std::mutex> lck(lock);
+			results.clear();
+			for (auto& x : threads)
+			{
+				CollectThread(*x);
+				if (!x->result.ranges.empty() || x->result.droppedEvents > 0)
+				{
+					results.push_back(x->result);
+				}
+			}
+		}
+
 		GPUQueryResult disjoint_result;
 		GPUQuery* disjoint_query = disjoint.Get_CPU();
 		if (disjoint_query != nullptr)
@@ -83,65 +758,71 @@ namespace wiProfiler
 			{
 				auto& range = x.second;
 
-				range->time = 0;
-				if (range->IsCPURange())
+				GPUQuery* begin_query = range->gpuBegin.Get_CPU();
+				GPUQuery* end_query = range->gpuEnd.Get_CPU();
+				GPUQueryResult begin_result, end_result;
+				if (begin_query != nullptr && end_query != nullptr)
 				{
-					range->time = (float)abs(range->cpuEnd.elapsed() - range->cpuBegin.elapsed());
-				}
-				else
-				{
-					GPUQuery* begin_query = range->gpuBegin.Get_CPU();
-					GPUQuery* end_query = range->gpuEnd.Get_CPU();
-					GPUQueryResult begin_result, end_result;
-					if (begin_query != nullptr && end_query != nullptr)
-					{
-						while (!wiRenderer::GetDevice()->QueryRead(begin_query, &begin_result));
-						while (!wiRenderer::GetDevice()->QueryRead(end_query, &end_result));
-					}
-					range->time = abs((float)(end_result.result_timestamp - begin_result.result_timestamp) / disjoint_result.result_timestamp_frequency * 1000.0f);
+					while (!wiRenderer::GetDevice()->QueryRead(begin_query, &begin_result));
+					while (!wiRenderer::GetDevice()->QueryRead(end_query, &end_result));
 				}
+				range->time = abs((float)(end_result.result_timestamp - begin_result.result_timestamp) / disjoint_result.result_timestamp_frequency * 1000.0f);
+			}
+		}
+
+		UpdateStatistics();
+		frameIndex++;
+
+		if (capture != nullptr)
+		{
+			if (capture->frames.empty())
+			{
+				capture->beginTime = frameBeginTime;
+			}
+			capture->frames.emplace_back();
+			CapturedFrame& frame = capture->frames.back();
+			frame.beginTime = ToMilliseconds(frameBeginTime - capture->beginTime);
+			frame.threads = results;
+			for (auto& x : ranges)
+			{
+				frame.gpuRanges.push_back(std::make_pair(x.second->name, x.second->time));
+			}
+
+			if (capture->frames.size() >= capture->frameCount)
+			{
+				FinishCapture();
 			}
 		}
 	}
 
 	range_id BeginRangeCPU(const wiHashString& name)
 	{
-		if (!ENABLED || !initialized)
+		if (!ENABLED.load(std::memory_order_relaxed) || !initialized)
 			return 0;
 
-		range_id id = name.GetHash();
-
-		lock.lock();
-		if (ranges.find(id) == ranges.end())
+		ThreadData& thread = GetThreadData();
+		// A begin is only recorded if its end and the ends of the open ranges will also fit, so the events are dropped in pairs:
+		const bool recorded = thread.depth < MAX_DEPTH && PushEvent(thread, name, true, thread.depth + 1);
+		if (thread.depth < MAX_DEPTH)
 		{
-			Range* range = new Range;
-			range->name = name.GetString();
-			range->time = 0;
-
-			range->cpuBegin.Start();
-			range->cpuEnd.Start();
-
-			ranges.insert(make_pair(id, range));
+			thread.recorded[thread.depth] = recorded;
 		}
+		thread.depth++;
 
-		ranges[id]->cpuBegin.record();
-
-		lock.unlock();
-
-		return id;
+		return name.GetHash() | CPU_RANGE_BIT;
 	}
 	range_id BeginRangeGPU(const wiHashString& name, CommandList cmd)
 	{
 		if (!ENABLED || !initialized)
 			return 0;
 
-		range_id id = name.GetHash();
+		range_id id = name.GetHash() & ~CPU_RANGE_BIT;
 
 		lock.lock();
 		if (ranges.find(id) == ranges.end())
 		{
 			Range* range = new Range;
-			range->name = name.GetString();
+			range->name = name;
 			range->time = 0;
 
 			GPUQueryDesc desc;
@@ -161,29 +842,176 @@ namespace wiProfiler
 	}
 	void EndRange(range_id id)
 	{
+		if (id == 0)
+			return;
+
+		if (id & CPU_RANGE_BIT)
+		{
+			// The end is recorded even if the profiler was disabled in the meantime, so that the ranges stay balanced:
+			ThreadData& thread = GetThreadData();
+			assert(thread.depth > 0); // the range was begun on an other thread!
+			if (thread.depth == 0)
+				return;
+			thread.depth--;
+			if (thread.depth < MAX_DEPTH && thread.recorded[thread.depth])
+			{
+				const bool pushed = PushEvent(thread, wiHashString(), false, 0);
+				assert(pushed); // the space was reserved by the begin
+				(void)pushed;
+			}
+			return;
+		}
+
 		if (!ENABLED || !initialized)
 			return;
 
 		lock.lock();
 
-		auto& it = ranges.find(id);
+		auto it = ranges.find(id);
 		if (it != ranges.end())
 		{
-			if (it->second->IsCPURange())
+			wiRenderer::GetDevice()->QueryEnd(it->second->gpuEnd.Get_GPU(), it->second->cmd);
+		}
+		else
+		{
+			assert(0);
+		}
+
+		lock.unlock();
+	}
+
+	void SetThreadName(const std::string& name)
+	{
+		ThreadData& thread = GetThreadData();
+		std::lock_guard<std::mutex> lck(lock);
+		thread.name = name;
+	}
+
+	const std::vector<ThreadResult>& GetCPUResults()
+	{
+		return results;
+	}
+
+	void BeginCapture(uint32_t frameCount, const std::string& traceFileName, const std::string& csvFileName)
+	{
+		if (frameCount == 0)
+		{
+			return;
+		}
+		capture.reset(new Capture);
+		capture->frameCount = frameCount;
+		capture->traceFileName = traceFileName;
+		capture->csvFileName = csvFileName;
+		capture->enabledProfiler = !ENABLED;
+		capture->frames.reserve(frameCount);
+		ENABLED = true;
+	}
+	bool IsCapturing()
+	{
+		return capture != nullptr;
+	}
+
+	void GetStatistics(const RangeHistory& history, RangeStatistics& result)
+	{
+		const Histogram& histogram = history.histogram;
+		result.path = history.path;
+		result.samples = histogram.total;
+		result.last = history.last;
+		result.average = histogram.total > 0 ? history.sum / histogram.total / 1000.0 : 0;
+		result.min = 0;
+		result.max = 0;
+		for (uint32_t i = 0; i < Histogram::BUCKET_COUNT; ++i)
+		{
+			if (histogram.counts[i] > 0)
 			{
-				it->second->cpuEnd.record();
+				result.min = Histogram::GetValue(i) / 1000.0;
+				break;
 			}
-			else
+		}
+		for (uint32_t i = Histogram::BUCKET_COUNT; i > 0; --i)
+		{
+			if (histogram.counts[i - 1] > 0)
 			{
-				wiRenderer::GetDevice()->QueryEnd(it->second->gpuEnd.Get_GPU(), it->second->cmd);
+				result.max = Histogram::GetValue(i - 1) / 1000.0;
+				break;
 			}
 		}
-		else
+		result.p50 = histogram.GetPercentile(50) / 1000.0;
+		result.p95 = histogram.GetPercentile(95) / 1000.0;
+		result.p99 = histogram.GetPercentile(99) / 1000.0;
+	}
+	bool GetRangeStatistics(const std::string& path, RangeStatistics& result)
+	{
+		auto it = histories.find(GetPathHash(path));
+		if (it == histories.end())
 		{
-			assert(0);
+			return false;
 		}
+		GetStatistics(*it->second, result);
+		return true;
+	}
+	std::vector<RangeStatistics> GetAllRangeStatistics()
+	{
+		std::vector<RangeStatistics> result(histories.size());
+		size_t i = 0;
+		for (auto& x : histories)
+		{
+			GetStatistics(*x.second, result[i++]);
+		}
+		std::sort(result.begin(), result.end(), [](const RangeStatistics& a, const RangeStatistics& b) {
+			return a.path < b.path;
+		});
+		return result;
+	}
+	double GetRangePercentile(const std::string& path, double percentile)
+	{
+		auto it = histories.find(GetPathHash(path));
+		if (it == histories.end())
+		{
+			return 0;
+		}
+		return it->second->histogram.GetPercentile(percentile) / 1000.0;
+	}
+	void SetStatisticsWindow(uint32_t frameCount)
+	{
+		statisticsWindow = std::max(1u, frameCount);
+		ResetStatistics();
+	}
+	void ResetStatistics()
+	{
+		histories.clear();
+	}
 
-		lock.unlock();
+	void SetHitchThreshold(const std::string& path, double milliseconds, double medianFactor)
+	{
+		const uint64_t pathHash = GetPathHash(path);
+		if (milliseconds > 0 || medianFactor > 0)
+		{
+			hitchThresholds[pathHash] = { milliseconds, medianFactor };
+		}
+		else
+		{
+			hitchThresholds.erase(pathHash);
+		}
+		auto it = histories.find(pathHash);
+		if (it != histories.end())
+		{
+			it->second->hitchTime = std::max(0.0, milliseconds);
+			it->second->hitchMedianFactor = std::max(0.0, medianFactor);
+		}
+	}
+	const std::vector<Hitch>& GetHitches()
+	{
+		return hitches;
+	}
+	uint64_t GetHitchCount()
+	{
+		return hitchCount;
+	}
+	void ClearHitches()
+	{
+		hitches.clear();
+		hitchCount = 0;
 	}
 
 	void DrawData(int x, int y, CommandList cmd)
@@ -195,12 +1023,37 @@ namespace wiProfiler
 		ss.precision(2);
 		ss << "Frame Profiler Ranges:" << endl << "----------------------------" << endl;
 
-		// Print CPU ranges:
-		for (auto& x : ranges)
+		RangeStatistics frame;
+		if (GetRangeStatistics("Main Thread/CPU Frame", frame))
+		{
+			ss << "CPU Frame p50: " << fixed << frame.p50 << " ms, p95: " << frame.p95 << " ms, p99: " << frame.p99 << " ms (" << frame.samples << " frames)" << endl;
+			if (hitchCount > 0)
+			{
+				ss << "Hitches: " << hitchCount << endl;
+			}
+			ss << endl;
+		}
+
+		// Print CPU ranges of every thread as a hierarchy (inclusive time, exclusive time and call count):
+		for (auto& thread : results)
 		{
-			if (x.second->IsCPURange())
+			ss << thread.name << ":" << endl;
+			for (auto& range : thread.ranges)
 			{
-				ss << x.second->name << ": " << fixed << x.second->time << " ms" << endl;
+				ss << std::string(range.depth * 2 + 2, ' ') << range.name.GetString() << ": " << fixed << range.inclusiveTime << " ms";
+				if (range.exclusiveTime < range.inclusiveTime)
+				{
+					ss << " (self: " << range.exclusiveTime << " ms)";
+				}
+				if (range.calls > 1)
+				{
+					ss << " x" << range.calls;
+				}
+				ss << endl;
+			}
+			if (thread.droppedEvents > 0)
+			{
+				ss << "  [" << thread.droppedEvents << " ranges were dropped]" << endl;
 			}
 		}
 		ss << endl;
@@ -208,10 +1061,7 @@ namespace wiProfiler
 		// Print GPU ranges:
 		for (auto& x : ranges)
 		{
-			if (!x.second->IsCPURange())
-			{
-				ss << x.second->name << ": " << fixed << x.second->time << " ms" << endl;
-			}
+			ss << x.second->name.GetString() << ": " << fixed << x.second->time << " ms" << endl;
 		}
 
 		wiFont(ss.str(), wiFontParams(x, y, WIFONTSIZE_DEFAULT, WIFALIGN_LEFT, WIFALIGN_TOP, 0, 0, wiColor(255, 255, 255, 255), wiColor(0, 0, 0, 255))).Draw(cmd);
@@ -219,6 +1069,12 @@ namespace wiProfiler
 
 	void SetEnabled(bool value)
 	{
+		if (capture != nullptr)
+		{
+			// The capture needs the profiler, it will be disabled when the capture is finished:
+			capture->enabledProfiler = !value;
+			return;
+		}
 		ENABLED = value;
 	}
 
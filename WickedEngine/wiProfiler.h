@@ -3,6 +3,7 @@
 #include "wiHashString.h"
 
 #include <string>
+#include <vector>
 
 namespace wiProfiler
 {
@@ -15,6 +16,9 @@ namespace wiProfiler
 	void EndFrame(wiGraphics::CommandList cmd);
 
 	// Start a CPU profiling range
+	//	CPU ranges are recorded into a buffer of the calling thread without locking, they can be nested and used on any thread,
+	//	but a range must be ended on the same thread that started it
+	//	The name must be interned to be displayed, for string literals use WI_HASHSTRING()
 	range_id BeginRangeCPU(const wiHashString& name);
 
 	// Start a GPU profiling range
@@ -23,6 +27,103 @@ namespace wiProfiler
 	// End a profiling range
 	void EndRange(range_id id);
 
+	// Set the name of the calling thread that is displayed with its CPU ranges (threads are named "Thread N" by default)
+	void SetThreadName(const std::string& name);
+
+	// CPU range that ends when it goes out of scope
+	struct ScopedRangeCPU
+	{
+		range_id id;
+		ScopedRangeCPU(const wiHashString& name) : id(BeginRangeCPU(name)) {}
+		~ScopedRangeCPU() { EndRange(id); }
+	};
+#define WI_PROFILER_CONCAT_INNER(a, b) a##b
+#define WI_PROFILER_CONCAT(a, b) WI_PROFILER_CONCAT_INNER(a, b)
+	// Profile the CPU time of the current scope, name is a string literal
+#define WI_PROFILE_SCOPE(name) wiProfiler::ScopedRangeCPU WI_PROFILER_CONCAT(wiProfilerScope_, __LINE__)(WI_HASHSTRING(name))
+
+	// The same CPU range name under the same parent range on a thread is aggregated into one result for a frame
+	struct CPURangeResult
+	{
+		wiHashString name;
+		uint32_t parent = ~0u;		// index of the parent range in ThreadResult::ranges, ~0u for root ranges
+		uint32_t depth = 0;
+		uint32_t calls = 0;			// how many times the range was executed in the frame
+		double inclusiveTime = 0;	// milliseconds, including the child ranges
+		double exclusiveTime = 0;	// milliseconds, without the child ranges
+	};
+	// One execution of a CPU range
+	struct CPURangeEvent
+	{
+		wiHashString name;
+		uint32_t depth = 0;
+		double begin = 0;	// milliseconds, relative to the beginning of the frame
+		double end = 0;		// milliseconds, relative to the beginning of the frame
+	};
+	struct ThreadResult
+	{
+		std::string name;
+		std::vector<CPURangeResult> ranges;		// hierarchy, in depth first order
+		std::vector<CPURangeEvent> timeline;	// the ranges that ended in the frame, in the order they ended
+		uint64_t droppedEvents = 0;				// ranges that were not recorded because the buffer of the thread was full
+	};
+	// Returns the CPU ranges of the last finished frame for every thread that recorded ranges
+	//	It must be used on the thread that calls EndFrame()
+	const std::vector<ThreadResult>& GetCPUResults();
+
+	// Record the next frames and save them to files when the capture is finished (the profiler is enabled during the capture)
+	//	traceFileName	: Chrome trace JSON file that contains the CPU ranges of every thread on a timeline and the GPU range times,
+	//					  it can be opened with Perfetto (ui.perfetto.dev) or chrome://tracing. Not saved if empty
+	//	csvFileName		: one line per frame with the times of every CPU and GPU range. Not saved if empty
+	void BeginCapture(uint32_t frameCount, const std::string& traceFileName, const std::string& csvFileName = "");
+	bool IsCapturing();
+
+	// Rolling statistics of the range times over the last frames
+	//	Ranges are identified by a path: the thread name and the CPU range hierarchy separated by '/' (for example "Main Thread/CPU Frame/Update"),
+	//	or "GPU/" and the GPU range name (for example "GPU/GPU Frame"). The frame time is "Main Thread/CPU Frame"
+	//	The times are kept in log-linear histograms, percentiles are within ~3% precision
+	//	Statistics are only collected while the profiler is enabled, the query functions must be used on the thread that calls EndFrame()
+	struct RangeStatistics
+	{
+		std::string path;
+		uint32_t samples = 0;	// the frames in the window that executed the range
+		double last = 0;		// milliseconds, the exact time of the last frame that executed the range
+		double average = 0;
+		double min = 0;
+		double max = 0;
+		double p50 = 0;
+		double p95 = 0;
+		double p99 = 0;
+	};
+	// Returns false if the range was not recorded yet
+	bool GetRangeStatistics(const std::string& path, RangeStatistics& result);
+	std::vector<RangeStatistics> GetAllRangeStatistics();
+	// Returns the time in milliseconds below which the given percentage [0, 100] of the range samples in the window are, 0 if the range was not recorded
+	double GetRangePercentile(const std::string& path, double percentile);
+	// Set how many frames are kept in the rolling window of every range (default: 1000). It resets the statistics
+	void SetStatisticsWindow(uint32_t frameCount);
+	void ResetStatistics();
+
+	// Hitch detection: a frame is a hitch if the time of a range exceeds its threshold
+	//	milliseconds	: absolute threshold, 0 to disable
+	//	medianFactor	: threshold relative to the median (p50) of the range in the window, 0 to disable (used after 30 samples)
+	//	Set both to 0 to remove the threshold of the range
+	void SetHitchThreshold(const std::string& path, double milliseconds, double medianFactor = 0);
+	struct Hitch
+	{
+		uint64_t frame = 0;					// the index of the frame since the start of the profiler
+		std::string path;					// the first range that exceeded its threshold
+		double time = 0;					// milliseconds, the time of the range
+		double threshold = 0;				// milliseconds, the threshold that was exceeded
+		std::vector<ThreadResult> threads;	// the full CPU range breakdown of the frame
+		std::vector<std::pair<std::string, float>> gpuRanges;
+	};
+	// Returns the last hitches (at most 32), oldest first
+	const std::vector<Hitch>& GetHitches();
+	// Returns the count of all hitches since the last ClearHitches()
+	uint64_t GetHitchCount();
+	void ClearHitches();
+
 	// Renders a basic text of the Profiling results to the (x,y) screen coordinate
 	void DrawData(int x, int y, wiGraphics::CommandList cmd);
 
@@ -25,6 +25,7 @@
 #include "wiGPUSortLib.h"
 #include "wiAllocators.h"
 #include "wiGPUBVH.h"
+#include "wiOcclusionCuller.h"
 #include "wiJobSystem.h"
 #include "wiSpinLock.h"
 
@@ -124,6 +125,10 @@ Texture2D* enviroMap = nullptr;
 float GameSpeed = 1;
 bool debugLightCulling = false;
 bool occlusionCulling = false;
+bool cpuOcclusionCulling = false;
+bool meshletCulling = false;
+float lodBias = 0;
+wiOcclusionCuller occlusionCuller;
 bool temporalAA = false;
 bool temporalAADEBUG = false;
 uint32_t raytraceBounceCount = 2;
@@ -193,12 +198,14 @@ struct RenderBatch
 	uint32_t instance;
 	float distance;
 
-	inline void Create(size_t meshIndex, size_t instanceIndex, float _distance)
+	inline void Create(size_t meshIndex, size_t instanceIndex, float _distance, uint32_t lod = 0)
 	{
 		hash = 0;
 
-		assert(meshIndex < 0x00FFFFFF);
-		hash |= (uint32_t)(meshIndex & 0x00FFFFFF) << 8;
+		assert(meshIndex < 0x000FFFFF);
+		assert(lod < 0x10);
+		hash |= (uint32_t)(meshIndex & 0x000FFFFF) << 12;
+		hash |= (lod & 0xF) << 8;
 		hash |= ((uint32_t)(_distance)) & 0xFF;
 
 		instance = (uint32_t)instanceIndex;
@@ -207,7 +214,11 @@ struct RenderBatch
 
 	inline uint32_t GetMeshIndex() const
 	{
-		return (hash >> 8) & 0x00FFFFFF;
+		return (hash >> 12) & 0x000FFFFF;
+	}
+	inline uint32_t GetLOD() const
+	{
+		return (hash >> 8) & 0xF;
 	}
 	inline uint32_t GetInstanceIndex() const
 	{
@@ -1425,6 +1436,15 @@ void RenderMeshes(const RenderQueue& renderQueue, RENDERPASS renderPass, UINT re
 			renderPass == RENDERPASS_ENVMAPCAPTURE ||
 			renderPass == RENDERPASS_VOXELIZE;
 
+		// Can we cull meshlets with the camera of the render queue in this pass?
+		const bool meshletCullingRequest =
+			GetMeshletCullingEnabled() && renderQueue.camera != nullptr && (
+				renderPass == RENDERPASS_FORWARD ||
+				renderPass == RENDERPASS_DEFERRED ||
+				renderPass == RENDERPASS_TILEDFORWARD ||
+				renderPass == RENDERPASS_DEPTHONLY
+				);
+
 
 		// Pre-allocate space for all the instances in GPU-buffer:
 		const UINT instanceDataSize = advancedVBRequest ? sizeof(InstBuf) : sizeof(Instance);
@@ -1432,11 +1452,13 @@ void RenderMeshes(const RenderQueue& renderQueue, RENDERPASS renderPass, UINT re
 		GraphicsDevice::GPUAllocation instances = device->AllocateGPU(alloc_size, cmd);
 
 		// Purpose of InstancedBatch:
-		//	The RenderQueue is sorted by meshIndex. There can be multiple instances for a single meshIndex,
-		//	and the InstancedBatchArray contains this information. The array size will be the unique mesh count here.
+		//	The RenderQueue is sorted by meshIndex and LOD. There can be multiple instances for a single meshIndex and LOD,
+		//	and the InstancedBatchArray contains this information. The array size will be the unique mesh and LOD count here.
 		struct InstancedBatch
 		{
 			uint32_t meshIndex;
+			uint32_t lod;
+			uint32_t instanceIndex; // first instance
 			int instanceCount;
 			uint32_t dataOffset;
 			uint8_t userStencilRefOverride;
@@ -1447,24 +1469,29 @@ void RenderMeshes(const RenderQueue& renderQueue, RENDERPASS renderPass, UINT re
 		int instancedBatchCount = 0;
 
 		size_t prevMeshIndex = ~0;
+		uint32_t prevLOD = ~0;
 		uint8_t prevUserStencilRefOverride = 0;
 		for (uint32_t batchID = 0; batchID < renderQueue.batchCount; ++batchID) // Do not break out of this loop!
 		{
 			const RenderBatch& batch = renderQueue.batchArray[batchID];
 			const uint32_t meshIndex = batch.GetMeshIndex();
+			const uint32_t lod = batch.GetLOD();
 			const uint32_t instanceIndex = batch.GetInstanceIndex();
 			const ObjectComponent& instance = scene.objects[instanceIndex];
 			const uint8_t userStencilRefOverride = instance.userStencilRef;
 
-			// When we encounter a new mesh inside the global instance array, we begin a new InstancedBatch:
-			if (meshIndex != prevMeshIndex || userStencilRefOverride != prevUserStencilRefOverride)
+			// When we encounter a new mesh or LOD inside the global instance array, we begin a new InstancedBatch:
+			if (meshIndex != prevMeshIndex || lod != prevLOD || userStencilRefOverride != prevUserStencilRefOverride)
 			{
 				prevMeshIndex = meshIndex;
+				prevLOD = lod;
 				prevUserStencilRefOverride = userStencilRefOverride;
 
 				instancedBatchCount++;
 				InstancedBatch* instancedBatch = (InstancedBatch*)GetRenderFrameAllocator(cmd).allocate(sizeof(InstancedBatch));
 				instancedBatch->meshIndex = meshIndex;
+				instancedBatch->lod = lod;
+				instancedBatch->instanceIndex = instanceIndex;
 				instancedBatch->instanceCount = 0;
 				instancedBatch->dataOffset = instances.offset + batchID * instanceDataSize;
 				instancedBatch->userStencilRefOverride = userStencilRefOverride;
@@ -1559,8 +1586,30 @@ void RenderMeshes(const RenderQueue& renderQueue, RENDERPASS renderPass, UINT re
 			};
 			BOUNDVERTEXBUFFERTYPE boundVBType_Prev = BOUNDVERTEXBUFFERTYPE::NOTHING;
 
-			for (const MeshComponent::MeshSubset& subset : mesh.subsets)
+			// Single instances of meshes with meshlets will only draw the ranges of the visible meshlets:
+			//	The meshlet bounds are computed from the static vertex positions, so meshes that are deformed
+			//	on the GPU (skinning, dynamic vertices, soft body simulation) can't be culled by them
+			const uint8_t* meshletVisibility = nullptr;
+			uint32_t meshletCursor = 0;
+			if (meshletCullingRequest && instancedBatch.instanceCount == 1 && !mesh.meshlets.empty() &&
+				!mesh.IsSkinned() && !mesh.IsDynamic() && !scene.softbodies.Contains(scene.meshes.GetEntity(instancedBatch.meshIndex)))
+			{
+				const ObjectComponent& instance = scene.objects[instancedBatch.instanceIndex];
+				const XMFLOAT4X4& worldMatrix = instance.transform_index >= 0 ? scene.transforms[instance.transform_index].world : IDENTITYMATRIX;
+				uint8_t* visibility = GetRenderFrameAllocator(cmd).allocate(mesh.meshlets.size());
+				if (visibility != nullptr)
+				{
+					mesh.CullMeshlets(renderQueue.camera->frustum, renderQueue.camera->Eye, worldMatrix, visibility);
+					meshletVisibility = visibility;
+				}
+			}
+
+			uint32_t first_subset = 0;
+			uint32_t last_subset = 0;
+			mesh.GetLODSubsetRange(instancedBatch.lod, first_subset, last_subset);
+			for (uint32_t subsetIndex = first_subset; subsetIndex < last_subset; ++subsetIndex)
 			{
+				const MeshComponent::MeshSubset& subset = mesh.subsets[subsetIndex];
 				if (subset.indexCount == 0)
 				{
 					continue;
@@ -1768,7 +1817,47 @@ void RenderMeshes(const RenderQueue& renderQueue, RENDERPASS renderPass, UINT re
 					device->BindConstantBuffer(DS, material.constantBuffer.get(), CB_GETBINDSLOT(MaterialCB), cmd);
 				}
 
-				device->DrawIndexedInstanced(subset.indexCount, instancedBatch.instanceCount, subset.indexOffset, 0, 0, cmd);
+				if (meshletVisibility != nullptr)
+				{
+					// Meshlets are ordered by subsets, and neighbouring visible meshlets are merged into a single draw:
+					while (meshletCursor < mesh.meshlets.size() && mesh.meshlets[meshletCursor].subsetIndex < subsetIndex)
+					{
+						meshletCursor++;
+					}
+					uint32_t indexOffset = 0;
+					uint32_t indexCount = 0;
+					for (; meshletCursor < mesh.meshlets.size() && mesh.meshlets[meshletCursor].subsetIndex == subsetIndex; ++meshletCursor)
+					{
+						const MeshComponent::Meshlet& meshlet = mesh.meshlets[meshletCursor];
+						if (!meshletVisibility[meshletCursor])
+						{
+							continue;
+						}
+						if (indexCount > 0 && indexOffset + indexCount != meshlet.indexOffset)
+						{
+							device->DrawIndexedInstanced(indexCount, 1, indexOffset, 0, 0, cmd);
+							indexCount = 0;
+						}
+						if (indexCount == 0)
+						{
+							indexOffset = meshlet.indexOffset;
+						}
+						indexCount += meshlet.triangleCount * 3;
+					}
+					if (indexCount > 0)
+					{
+						device->DrawIndexedInstanced(indexCount, 1, indexOffset, 0, 0, cmd);
+					}
+				}
+				else
+				{
+					device->DrawIndexedInstanced(subset.indexCount, instancedBatch.instanceCount, subset.indexOffset, 0, 0, cmd);
+				}
+			}
+
+			if (meshletVisibility != nullptr)
+			{
+				GetRenderFrameAllocator(cmd).free(mesh.meshlets.size());
 			}
 		}
 
@@ -3563,6 +3652,10 @@ void UpdatePerFrameData(float dt, uint32_t layerMask)
 	GraphicsDevice* device = GetDevice();
 	Scene& scene = GetScene();
 
+	// Models and textures that were loaded in the background are added at the frame boundary:
+	MergeLoadedModels();
+	wiResourceManager::GetGlobal().FinishLoading();
+
 	scene.Update(deltaTime);
 
 	wiJobSystem::context ctx;
@@ -3678,7 +3771,7 @@ void UpdatePerFrameData(float dt, uint32_t layerMask)
 
 	// Perform culling and obtain closest reflector:
 	requestReflectionRendering = false;
-	auto range = wiProfiler::BeginRangeCPU("Frustum Culling");
+	auto range = wiProfiler::BeginRangeCPU(WI_HASHSTRING("Frustum Culling"));
 	{
 		for (auto& x : frameCullings)
 		{
@@ -3693,6 +3786,7 @@ void UpdatePerFrameData(float dt, uint32_t layerMask)
 
 			// Cull objects for each camera:
 			wiJobSystem::Execute(ctx, [&] {
+				const XMVECTOR eye = XMLoadFloat3(&camera->Eye);
 				for (size_t i = 0; i < scene.aabb_objects.GetCount(); ++i)
 				{
 					Entity entity = scene.aabb_objects.GetEntity(i);
@@ -3704,6 +3798,28 @@ void UpdatePerFrameData(float dt, uint32_t layerMask)
 
 					const AABB& aabb = scene.aabb_objects[i];
 
+					// Main camera selects the LOD levels from the projected size of the bounding sphere.
+					//	This is done before frustum culling, because shadows can be rendered from outside the frustum
+					if (camera == &GetCamera())
+					{
+						ObjectComponent& object = scene.objects[i];
+						object.lod = 0;
+						if (object.lodCount > 1)
+						{
+							const XMFLOAT3 center = aabb.getCenter();
+							const float radius = aabb.getRadius();
+							const float distance = XMVectorGetX(XMVector3Length(XMLoadFloat3(&center) - eye));
+							float lod = lodBias;
+							if (distance > radius)
+							{
+								// Every time the screen size halves, the next LOD level is used:
+								const float screenSize = radius * camera->Projection._22 / distance;
+								lod += log2f(0.5f / screenSize);
+							}
+							object.lod = (uint32_t)wiMath::Clamp(floorf(lod), 0.0f, (float)(object.lodCount - 1));
+						}
+					}
+
 					if (culling.frustum.CheckBox(aabb))
 					{
 						culling.culledObjects.push_back((uint32_t)i);
@@ -3814,6 +3930,42 @@ void UpdatePerFrameData(float dt, uint32_t layerMask)
 
 				wiJobSystem::Wait(ctx);
 
+				// Remove objects that are hidden behind occluders before the render queues are built:
+				if (GetCPUOcclusionCullingEnabled() && !freezeCullingCamera)
+				{
+					auto range_occlusion = wiProfiler::BeginRangeCPU(WI_HASHSTRING("CPU Occlusion Culling"));
+
+					occlusionCuller.Clear(camera->VP);
+					for (uint32_t objectIndex : culling.culledObjects)
+					{
+						const ObjectComponent& object = scene.objects[objectIndex];
+						if (object.IsOccluder() && object.transform_index >= 0)
+						{
+							const MeshComponent* mesh = scene.meshes.GetComponent(object.meshID);
+							if (mesh != nullptr && !mesh->IsSkinned())
+							{
+								// Only LOD0 is rasterized, because simplified LOD levels are not conservative:
+								const uint32_t indexCount = mesh->GetLOD0IndexCount();
+								const TransformComponent& transform = scene.transforms[object.transform_index];
+								occlusionCuller.AddOccluder(mesh->vertex_positions.data(), (uint32_t)mesh->vertex_positions.size(),
+									mesh->indices.data(), indexCount, transform.world);
+							}
+						}
+					}
+
+					if (occlusionCuller.GetTriangleCount() > 0)
+					{
+						occlusionCuller.Rasterize(ctx);
+						wiJobSystem::Wait(ctx);
+
+						culling.culledObjects.erase(std::remove_if(culling.culledObjects.begin(), culling.culledObjects.end(), [&](uint32_t objectIndex) {
+							return !occlusionCuller.IsVisible(scene.aabb_objects[objectIndex]);
+						}), culling.culledObjects.end());
+					}
+
+					wiProfiler::EndRange(range_occlusion);
+				}
+
 				// Sort lights based on distance so that closer lights will receive shadow map priority:
 				const size_t lightCount = culling.culledLights.size();
 				assert(lightCount < 0x0000FFFF); // watch out for sorting hash truncation!
@@ -4180,7 +4332,7 @@ void UpdateRenderData(CommandList cmd)
 
 	GetPrevCamera() = GetCamera();
 
-	auto range = wiProfiler::BeginRangeGPU("Skinning", cmd);
+	auto range = wiProfiler::BeginRangeGPU(WI_HASHSTRING("Skinning"), cmd);
 	device->EventBegin("Skinning", cmd);
 	{
 		bool streamOutSetUp = false;
@@ -4336,7 +4488,7 @@ void OcclusionCulling_Render(CommandList cmd)
 	GraphicsDevice* device = GetDevice();
 	const FrameCulling& culling = frameCullings.at(&GetCamera());
 
-	auto range = wiProfiler::BeginRangeGPU("Occlusion Culling Render", cmd);
+	auto range = wiProfiler::BeginRangeGPU(WI_HASHSTRING("Occlusion Culling Render"), cmd);
 
 	int queryID = 0;
 
@@ -4411,7 +4563,7 @@ void OcclusionCulling_Read()
 		return;
 	}
 
-	auto range = wiProfiler::BeginRangeCPU("Occlusion Culling Read");
+	auto range = wiProfiler::BeginRangeCPU(WI_HASHSTRING("Occlusion Culling Read"));
 
 	GraphicsDevice* device = GetDevice();
 	const FrameCulling& culling = frameCullings.at(&GetCamera());
@@ -4574,7 +4726,7 @@ void DrawDeferredLights(
 	const Scene& scene = GetScene();
 
 	device->EventBegin("DrawDeferredLights", cmd);
-	auto range = wiProfiler::BeginRangeGPU("Deferred Light Render", cmd);
+	auto range = wiProfiler::BeginRangeGPU(WI_HASHSTRING("Deferred Light Render"), cmd);
 
 	BindShadowmaps(PS, cmd);
 	BindEnvironmentTextures(PS, cmd);
@@ -5054,7 +5206,7 @@ void DrawShadowmaps(const CameraComponent& camera, CommandList cmd, uint32_t lay
 	if (!culling.culledLights.empty())
 	{
 		device->EventBegin("DrawShadowmaps", cmd);
-		auto range = wiProfiler::BeginRangeGPU("Shadow Rendering", cmd);
+		auto range = wiProfiler::BeginRangeGPU(WI_HASHSTRING("Shadow Rendering"), cmd);
 
 		BindCommonResources(cmd);
 		BindConstantBuffers(VS, cmd);
@@ -5146,7 +5298,7 @@ void DrawShadowmaps(const CameraComponent& camera, CommandList cmd, uint32_t lay
 
 									RenderBatch* batch = (RenderBatch*)GetRenderFrameAllocator(cmd).allocate(sizeof(RenderBatch));
 									size_t meshIndex = scene.meshes.GetIndex(object.meshID);
-									batch->Create(meshIndex, i, 0);
+									batch->Create(meshIndex, i, 0, object.lod);
 									renderQueue.add(batch);
 
 									if (object.GetRenderTypes() & RENDERTYPE_TRANSPARENT || object.GetRenderTypes() & RENDERTYPE_WATER)
@@ -5210,7 +5362,7 @@ void DrawShadowmaps(const CameraComponent& camera, CommandList cmd, uint32_t lay
 
 								RenderBatch* batch = (RenderBatch*)GetRenderFrameAllocator(cmd).allocate(sizeof(RenderBatch));
 								size_t meshIndex = scene.meshes.GetIndex(object.meshID);
-								batch->Create(meshIndex, i, 0);
+								batch->Create(meshIndex, i, 0, object.lod);
 								renderQueue.add(batch);
 
 								if (object.GetRenderTypes() & RENDERTYPE_TRANSPARENT || object.GetRenderTypes() & RENDERTYPE_WATER)
@@ -5275,7 +5427,7 @@ void DrawShadowmaps(const CameraComponent& camera, CommandList cmd, uint32_t lay
 
 								RenderBatch* batch = (RenderBatch*)GetRenderFrameAllocator(cmd).allocate(sizeof(RenderBatch));
 								size_t meshIndex = scene.meshes.GetIndex(object.meshID);
-								batch->Create(meshIndex, i, 0);
+								batch->Create(meshIndex, i, 0, object.lod);
 								renderQueue.add(batch);
 							}
 						}
@@ -5386,6 +5538,7 @@ void DrawScene(const CameraComponent& camera, bool tessellation, CommandList cmd
 
 	RenderImpostors(camera, renderPass, cmd);
 
+	auto range = wiProfiler::BeginRangeCPU(WI_HASHSTRING("RenderQueue"));
 	RenderQueue renderQueue;
 	renderQueue.camera = &camera;
 	for (uint32_t instanceIndex : culling.culledObjects)
@@ -5404,13 +5557,18 @@ void DrawScene(const CameraComponent& camera, bool tessellation, CommandList cmd
 			}
 			RenderBatch* batch = (RenderBatch*)GetRenderFrameAllocator(cmd).allocate(sizeof(RenderBatch));
 			size_t meshIndex = scene.meshes.GetIndex(object.meshID);
-			batch->Create(meshIndex, instanceIndex, distance);
+			batch->Create(meshIndex, instanceIndex, distance, object.lod);
 			renderQueue.add(batch);
 		}
 	}
 	if (!renderQueue.empty())
 	{
 		renderQueue.sort(RenderQueue::SORT_FRONT_TO_BACK);
+	}
+	wiProfiler::EndRange(range); // RenderQueue
+
+	if (!renderQueue.empty())
+	{
 		RenderMeshes(renderQueue, renderPass, RENDERTYPE_OPAQUE, cmd, tessellation);
 
 		GetRenderFrameAllocator(cmd).free(sizeof(RenderBatch) * renderQueue.batchCount);
@@ -5476,6 +5634,7 @@ void DrawScene_Transparent(const CameraComponent& camera, const Texture2D& linea
 		}
 	}
 
+	auto range = wiProfiler::BeginRangeCPU(WI_HASHSTRING("RenderQueue"));
 	RenderQueue renderQueue;
 	renderQueue.camera = &camera;
 	for (uint32_t instanceIndex : culling.culledObjects)
@@ -5489,13 +5648,18 @@ void DrawScene_Transparent(const CameraComponent& camera, const Texture2D& linea
 		{
 			RenderBatch* batch = (RenderBatch*)GetRenderFrameAllocator(cmd).allocate(sizeof(RenderBatch));
 			size_t meshIndex = scene.meshes.GetIndex(object.meshID);
-			batch->Create(meshIndex, instanceIndex, wiMath::DistanceEstimated(camera.Eye, object.center));
+			batch->Create(meshIndex, instanceIndex, wiMath::DistanceEstimated(camera.Eye, object.center), object.lod);
 			renderQueue.add(batch);
 		}
 	}
 	if (!renderQueue.empty())
 	{
 		renderQueue.sort(RenderQueue::SORT_BACK_TO_FRONT);
+	}
+	wiProfiler::EndRange(range); // RenderQueue
+
+	if (!renderQueue.empty())
+	{
 		RenderMeshes(renderQueue, renderPass, RENDERTYPE_TRANSPARENT | RENDERTYPE_WATER, cmd, false);
 
 		GetRenderFrameAllocator(cmd).free(sizeof(RenderBatch) * renderQueue.batchCount);
@@ -6058,7 +6222,7 @@ void DrawDebugWorld(const CameraComponent& camera, CommandList cmd)
 				device->BindVertexBuffers(vbs, 0, ARRAYSIZE(vbs), strides, nullptr, cmd);
 				device->BindIndexBuffer(mesh->indexBuffer.get(), mesh->GetIndexFormat(), 0, cmd);
 
-				device->DrawIndexed((UINT)mesh->indices.size(), 0, 0, cmd);
+				device->DrawIndexed((UINT)mesh->GetLOD0IndexCount(), 0, 0, cmd);
 			}
 		}
 
@@ -6705,8 +6869,12 @@ void RefreshImpostors(CommandList cmd)
 					impostorcamera.UpdateCamera();
 					UpdateCameraCB(impostorcamera, cmd);
 
-					for (auto& subset : mesh.subsets)
+					uint32_t first_subset = 0;
+					uint32_t last_subset = 0;
+					mesh.GetLODSubsetRange(0, first_subset, last_subset);
+					for (uint32_t subsetIndex = first_subset; subsetIndex < last_subset; ++subsetIndex)
 					{
+						const MeshComponent::MeshSubset& subset = mesh.subsets[subsetIndex];
 						if (subset.indexCount == 0)
 						{
 							continue;
@@ -6747,7 +6915,7 @@ void VoxelRadiance(CommandList cmd)
 	GraphicsDevice* device = GetDevice();
 
 	device->EventBegin("Voxel Radiance", cmd);
-	auto range = wiProfiler::BeginRangeGPU("Voxel Radiance", cmd);
+	auto range = wiProfiler::BeginRangeGPU(WI_HASHSTRING("Voxel Radiance"), cmd);
 
 	const Scene& scene = GetScene();
 
@@ -6927,7 +7095,7 @@ void ComputeTiledLightCulling(
 )
 {
 	const bool deferred = lightbuffer_diffuse != nullptr && lightbuffer_specular != nullptr;
-	auto range = wiProfiler::BeginRangeGPU("Entity Culling", cmd);
+	auto range = wiProfiler::BeginRangeGPU(WI_HASHSTRING("Entity Culling"), cmd);
 	GraphicsDevice* device = GetDevice();
 
 	int _width = GetInternalResolution().x;
@@ -7601,7 +7769,7 @@ void RayTraceScene(
 
 	const TextureDesc& result_desc = result->GetDesc();
 
-	auto range = wiProfiler::BeginRangeGPU("RayTrace - ALL", cmd);
+	auto range = wiProfiler::BeginRangeGPU(WI_HASHSTRING("RayTrace - ALL"), cmd);
 
 	// Set up tracing resources:
 	sceneBVH.Bind(CS, cmd);
@@ -7675,7 +7843,7 @@ void RayTraceScene(
 				wiProfiler::range_id range;
 				if (bounce == 1)
 				{
-					range = wiProfiler::BeginRangeGPU("RayTrace - Shade", cmd);
+					range = wiProfiler::BeginRangeGPU(WI_HASHSTRING("RayTrace - Shade"), cmd);
 				}
 
 				device->BindComputeShader(computeShaders[CSTYPE_RAYTRACE_SHADE], cmd);
@@ -7712,11 +7880,11 @@ void RayTraceScene(
 			wiProfiler::range_id range;
 			if (bounce == 0)
 			{
-				range = wiProfiler::BeginRangeGPU("RayTrace - First Contact", cmd);
+				range = wiProfiler::BeginRangeGPU(WI_HASHSTRING("RayTrace - First Contact"), cmd);
 			}
 			else if (bounce == 1)
 			{
-				range = wiProfiler::BeginRangeGPU("RayTrace - First Bounce", cmd);
+				range = wiProfiler::BeginRangeGPU(WI_HASHSTRING("RayTrace - First Bounce"), cmd);
 			}
 
 			device->BindComputeShader(computeShaders[CSTYPE_RAYTRACE_CLOSESTHIT], cmd);
@@ -7899,6 +8067,12 @@ void ManageLightmapAtlas()
 	Scene& scene = GetScene();
 	GraphicsDevice* device = GetDevice();
 
+	// The lightmap data is loaded on first use if it was deferred while loading the scene:
+	if (!scene.deferredSections.empty())
+	{
+		scene.LoadDeferredSections("lightmaps");
+	}
+
 	using namespace wiRectPacker;
 
 	// Gather all object lightmap textures:
@@ -8119,7 +8293,7 @@ void RenderObjectLightMap(const ObjectComponent& object, CommandList cmd)
 	device->BindConstantBuffer(PS, &constantBuffers[CBTYPE_RAYTRACE], CB_GETBINDSLOT(RaytracingCB), cmd);
 
 	device->BindPipelineState(&PSO_renderlightmap, cmd);
-	device->DrawIndexedInstanced((UINT)mesh.indices.size(), 1, 0, 0, 0, cmd);
+	device->DrawIndexedInstanced((UINT)mesh.GetLOD0IndexCount(), 1, 0, 0, 0, cmd);
 
 	device->BindRenderTargets(0, nullptr, nullptr, cmd);
 
@@ -8132,7 +8306,7 @@ void RefreshLightmapAtlas(CommandList cmd)
 
 	if (!lightmapsToRefresh.empty())
 	{
-		auto range = wiProfiler::BeginRangeGPU("Lightmap Processing", cmd);
+		auto range = wiProfiler::BeginRangeGPU(WI_HASHSTRING("Lightmap Processing"), cmd);
 
 		// Update GPU scene and BVH data:
 		{
@@ -8761,7 +8935,7 @@ void Postprocess_SSAO(
 	GraphicsDevice* device = GetDevice();
 
 	device->EventBegin("Postprocess_SSAO", cmd);
-	auto prof_range = wiProfiler::BeginRangeGPU("SSAO", cmd);
+	auto prof_range = wiProfiler::BeginRangeGPU(WI_HASHSTRING("SSAO"), cmd);
 
 	device->BindRenderTargets(0, nullptr, nullptr, cmd);
 	device->UnbindResources(TEXSLOT_RENDERPATH_SSAO, 1, cmd);
@@ -8815,7 +8989,7 @@ void Postprocess_SSR(
 	GraphicsDevice* device = GetDevice();
 
 	device->EventBegin("Postprocess_SSR", cmd);
-	auto range = wiProfiler::BeginRangeGPU("SSR", cmd);
+	auto range = wiProfiler::BeginRangeGPU(WI_HASHSTRING("SSR"), cmd);
 
 	device->BindRenderTargets(0, nullptr, nullptr, cmd);
 	device->UnbindResources(TEXSLOT_RENDERPATH_SSR, 1, cmd);
@@ -8873,7 +9047,7 @@ void Postprocess_SSS(
 	GraphicsDevice* device = wiRenderer::GetDevice();
 
 	device->EventBegin("Postprocess_SSS", cmd);
-	auto range = wiProfiler::BeginRangeGPU("SSS", cmd);
+	auto range = wiProfiler::BeginRangeGPU(WI_HASHSTRING("SSS"), cmd);
 
 	device->BindStencilRef(STENCILREF_SKIN, cmd);
 	device->BindPipelineState(&PSO_sss, cmd);
@@ -8954,7 +9128,7 @@ void Postprocess_LightShafts(
 	GraphicsDevice* device = GetDevice();
 
 	device->EventBegin("Postprocess_LightShafts", cmd);
-	auto range = wiProfiler::BeginRangeGPU("LightShafts", cmd);
+	auto range = wiProfiler::BeginRangeGPU(WI_HASHSTRING("LightShafts"), cmd);
 
 	device->BindRenderTargets(0, nullptr, nullptr, cmd);
 
@@ -9009,7 +9183,7 @@ void Postprocess_DepthOfField(
 	GraphicsDevice* device = GetDevice();
 
 	device->EventBegin("Postprocess_DepthOfField", cmd);
-	auto range = wiProfiler::BeginRangeGPU("Depth of Field", cmd);
+	auto range = wiProfiler::BeginRangeGPU(WI_HASHSTRING("Depth of Field"), cmd);
 
 	device->BindRenderTargets(0, nullptr, nullptr, cmd);
 
@@ -9061,7 +9235,7 @@ void Postprocess_Outline(
 	GraphicsDevice* device = GetDevice();
 
 	device->EventBegin("Postprocess_Outline", cmd);
-	auto range = wiProfiler::BeginRangeGPU("Outline", cmd);
+	auto range = wiProfiler::BeginRangeGPU(WI_HASHSTRING("Outline"), cmd);
 
 	device->BindRenderTargets(0, nullptr, nullptr, cmd);
 
@@ -9114,7 +9288,7 @@ void Postprocess_MotionBlur(
 	GraphicsDevice* device = GetDevice();
 
 	device->EventBegin("Postprocess_MotionBlur", cmd);
-	auto range = wiProfiler::BeginRangeGPU("MotionBlur", cmd);
+	auto range = wiProfiler::BeginRangeGPU(WI_HASHSTRING("MotionBlur"), cmd);
 
 	device->BindRenderTargets(0, nullptr, nullptr, cmd);
 
@@ -9207,7 +9381,7 @@ void Postprocess_FXAA(
 	GraphicsDevice* device = GetDevice();
 
 	device->EventBegin("Postprocess_FXAA", cmd);
-	auto range = wiProfiler::BeginRangeGPU("FXAA", cmd);
+	auto range = wiProfiler::BeginRangeGPU(WI_HASHSTRING("FXAA"), cmd);
 
 	device->BindRenderTargets(0, nullptr, nullptr, cmd);
 
@@ -9255,7 +9429,7 @@ void Postprocess_TemporalAA(
 	GraphicsDevice* device = GetDevice();
 
 	device->EventBegin("Postprocess_TemporalAA", cmd);
-	auto range = wiProfiler::BeginRangeGPU("Temporal AA Resolve", cmd);
+	auto range = wiProfiler::BeginRangeGPU(WI_HASHSTRING("Temporal AA Resolve"), cmd);
 
 	device->BindRenderTargets(0, nullptr, nullptr, cmd);
 
@@ -9636,6 +9810,12 @@ void SetOcclusionCullingEnabled(bool value)
 	occlusionCulling = value;
 }
 bool GetOcclusionCullingEnabled() { return occlusionCulling; }
+void SetCPUOcclusionCullingEnabled(bool value) { cpuOcclusionCulling = value; }
+bool GetCPUOcclusionCullingEnabled() { return cpuOcclusionCulling; }
+void SetMeshletCullingEnabled(bool value) { meshletCulling = value; }
+bool GetMeshletCullingEnabled() { return meshletCulling; }
+void SetLODBias(float value) { lodBias = value; }
+float GetLODBias() { return lodBias; }
 void SetLDSSkinningEnabled(bool enabled) { ldsSkinningEnabled = enabled; }
 bool GetLDSSkinningEnabled() { return ldsSkinningEnabled; }
 void SetTemporalAAEnabled(bool enabled) { temporalAA = enabled; }
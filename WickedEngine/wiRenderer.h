@@ -430,6 +430,16 @@ namespace wiRenderer
 	bool GetAlphaCompositionEnabled();
 	void SetOcclusionCullingEnabled(bool enabled);
 	bool GetOcclusionCullingEnabled();
+	// CPU occlusion culling rasterizes the occluder objects and removes hidden objects from the main camera's culling results
+	void SetCPUOcclusionCullingEnabled(bool enabled);
+	bool GetCPUOcclusionCullingEnabled();
+	// Meshlet culling draws only the visible meshlets of single instance meshes that have meshlets
+	void SetMeshletCullingEnabled(bool enabled);
+	bool GetMeshletCullingEnabled();
+	// LOD bias is added to the LOD level that the main camera selects for objects from their screen size
+	//	Positive values switch to lower detail LODs closer to the camera, negative values keep the detailed LODs farther
+	void SetLODBias(float value);
+	float GetLODBias();
 	void SetLDSSkinningEnabled(bool enabled);
 	bool GetLDSSkinningEnabled();
 	void SetTemporalAAEnabled(bool enabled);
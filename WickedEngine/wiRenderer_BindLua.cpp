@@ -230,6 +230,50 @@ namespace wiRenderer_BindLua
 		}
 		return 0;
 	}
+	int SetCPUOcclusionCullingEnabled(lua_State* L)
+	{
+		int argc = wiLua::SGetArgCount(L);
+		if (argc > 0)
+		{
+			wiRenderer::SetCPUOcclusionCullingEnabled(wiLua::SGetBool(L, 1));
+		}
+		else
+		{
+			wiLua::SError(L, "SetCPUOcclusionCullingEnabled(bool enabled) not enough arguments!");
+		}
+		return 0;
+	}
+	int SetMeshletCullingEnabled(lua_State* L)
+	{
+		int argc = wiLua::SGetArgCount(L);
+		if (argc > 0)
+		{
+			wiRenderer::SetMeshletCullingEnabled(wiLua::SGetBool(L, 1));
+		}
+		else
+		{
+			wiLua::SError(L, "SetMeshletCullingEnabled(bool enabled) not enough arguments!");
+		}
+		return 0;
+	}
+	int SetLODBias(lua_State* L)
+	{
+		int argc = wiLua::SGetArgCount(L);
+		if (argc > 0)
+		{
+			wiRenderer::SetLODBias(wiLua::SGetFloat(L, 1));
+		}
+		else
+		{
+			wiLua::SError(L, "SetLODBias(float value) not enough arguments!");
+		}
+		return 0;
+	}
+	int GetLODBias(lua_State* L)
+	{
+		wiLua::SSetFloat(L, wiRenderer::GetLODBias());
+		return 1;
+	}
 
 	int DrawLine(lua_State* L)
 	{
@@ -394,6 +438,10 @@ namespace wiRenderer_BindLua
 			wiLua::GetGlobal()->RegisterFunc("SetResolution", SetResolution);
 			wiLua::GetGlobal()->RegisterFunc("SetDebugLightCulling", SetDebugLightCulling);
 			wiLua::GetGlobal()->RegisterFunc("SetOcclusionCullingEnabled", SetOcclusionCullingEnabled);
+			wiLua::GetGlobal()->RegisterFunc("SetCPUOcclusionCullingEnabled", SetCPUOcclusionCullingEnabled);
+			wiLua::GetGlobal()->RegisterFunc("SetMeshletCullingEnabled", SetMeshletCullingEnabled);
+			wiLua::GetGlobal()->RegisterFunc("SetLODBias", SetLODBias);
+			wiLua::GetGlobal()->RegisterFunc("GetLODBias", GetLODBias);
 
 			wiLua::GetGlobal()->RegisterFunc("DrawLine", DrawLine);
 			wiLua::GetGlobal()->RegisterFunc("DrawPoint", DrawPoint);
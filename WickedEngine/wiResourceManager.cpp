@@ -3,6 +3,8 @@
 #include "wiAudio.h"
 #include "wiHelper.h"
 #include "wiTextureHelper.h"
+#include "wiTextureCooker.h"
+#include "wiVirtualFileSystem.h"
 
 #include "Utility/stb_image.h"
 #include "Utility/tinyddsloader.h"
@@ -21,6 +23,364 @@ static const std::unordered_map<std::string, wiResourceManager::Data_Type> types
 };
 
 
+// Load a texture file and create the GPU texture
+//	type	: the texture type is decided by the file for DDS
+//	mipGen	: request the MIP generation for textures that are not loaded with MIP levels
+//	returns nullptr if the loading failed
+static void* LoadTexture(const string& nameStr, const string& ext, wiResourceManager::Data_Type& type, bool mipGen)
+{
+	void* success = nullptr;
+
+	if (ext.compare(std::string("DDS")))
+	{
+		// The cooked texture is preferred, it is block compressed and contains the mip chain:
+		const string cookedName = wiTextureCooker::GetCookedFileName(nameStr);
+		if (wiVirtualFileSystem::FileExists(cookedName))
+		{
+			success = LoadTexture(cookedName, "DDS", type, mipGen);
+			if (success != nullptr)
+			{
+				return success;
+			}
+		}
+	}
+
+	if (!ext.compare(std::string("DDS")))
+	{
+		// Load dds
+
+		tinyddsloader::DDSFile dds;
+		auto result = tinyddsloader::Result::ErrorFileOpen;
+		wiVirtualFileSystem::FileView file;
+		if (wiVirtualFileSystem::OpenFile(nameStr, file))
+		{
+			result = dds.Load(file.data, file.size);
+		}
+
+		if (result == tinyddsloader::Result::Success)
+		{
+			TextureDesc desc;
+			desc.ArraySize = 1;
+			desc.BindFlags = BIND_SHADER_RESOURCE;
+			desc.CPUAccessFlags = 0;
+			desc.Width = dds.GetWidth();
+			desc.Height = dds.GetHeight();
+			desc.Depth = dds.GetDepth();
+			desc.MipLevels = dds.GetMipCount();
+			desc.ArraySize = dds.GetArraySize();
+			desc.MiscFlags = 0;
+			desc.Usage = USAGE_IMMUTABLE;
+			desc.Format = FORMAT_R8G8B8A8_UNORM;
+
+			if (dds.IsCubemap())
+			{
+				desc.MiscFlags |= RESOURCE_MISC_TEXTURECUBE;
+			}
+
+			auto ddsFormat = dds.GetFormat();
+
+			switch (ddsFormat)
+			{
+			case tinyddsloader::DDSFile::DXGIFormat::R32G32B32A32_Float: desc.Format = FORMAT_R32G32B32A32_FLOAT; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R32G32B32A32_UInt: desc.Format = FORMAT_R32G32B32A32_UINT; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R32G32B32A32_SInt: desc.Format = FORMAT_R32G32B32A32_SINT; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R32G32B32_Float: desc.Format = FORMAT_R32G32B32_FLOAT; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R32G32B32_UInt: desc.Format = FORMAT_R32G32B32_UINT; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R32G32B32_SInt: desc.Format = FORMAT_R32G32B32_SINT; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R16G16B16A16_Float: desc.Format = FORMAT_R16G16B16A16_FLOAT; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R16G16B16A16_UNorm: desc.Format = FORMAT_R16G16B16A16_UNORM; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R16G16B16A16_UInt: desc.Format = FORMAT_R16G16B16A16_UINT; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R16G16B16A16_SNorm: desc.Format = FORMAT_R16G16B16A16_SNORM; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R16G16B16A16_SInt: desc.Format = FORMAT_R16G16B16A16_SINT; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R32G32_Float: desc.Format = FORMAT_R32G32_FLOAT; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R32G32_UInt: desc.Format = FORMAT_R32G32_UINT; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R32G32_SInt: desc.Format = FORMAT_R32G32_SINT; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R10G10B10A2_UNorm: desc.Format = FORMAT_R10G10B10A2_UNORM; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R10G10B10A2_UInt: desc.Format = FORMAT_R10G10B10A2_UINT; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R11G11B10_Float: desc.Format = FORMAT_R11G11B10_FLOAT; break;
+			case tinyddsloader::DDSFile::DXGIFormat::B8G8R8A8_UNorm: desc.Format = FORMAT_B8G8R8A8_UNORM; break;
+			case tinyddsloader::DDSFile::DXGIFormat::B8G8R8A8_UNorm_SRGB: desc.Format = FORMAT_B8G8R8A8_UNORM_SRGB; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R8G8B8A8_UNorm: desc.Format = FORMAT_R8G8B8A8_UNORM; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R8G8B8A8_UNorm_SRGB: desc.Format = FORMAT_R8G8B8A8_UNORM_SRGB; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R8G8B8A8_UInt: desc.Format = FORMAT_R8G8B8A8_UINT; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R8G8B8A8_SNorm: desc.Format = FORMAT_R8G8B8A8_SNORM; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R8G8B8A8_SInt: desc.Format = FORMAT_R8G8B8A8_SINT; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R16G16_Float: desc.Format = FORMAT_R16G16_FLOAT; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R16G16_UNorm: desc.Format = FORMAT_R16G16_UNORM; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R16G16_UInt: desc.Format = FORMAT_R16G16_UINT; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R16G16_SNorm: desc.Format = FORMAT_R16G16_SNORM; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R16G16_SInt: desc.Format = FORMAT_R16G16_SINT; break;
+			case tinyddsloader::DDSFile::DXGIFormat::D32_Float: desc.Format = FORMAT_D32_FLOAT; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R32_Float: desc.Format = FORMAT_R32_FLOAT; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R32_UInt: desc.Format = FORMAT_R32_UINT; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R32_SInt: desc.Format = FORMAT_R32_SINT; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R8G8_UNorm: desc.Format = FORMAT_R8G8_UNORM; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R8G8_UInt: desc.Format = FORMAT_R8G8_UINT; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R8G8_SNorm: desc.Format = FORMAT_R8G8_SNORM; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R8G8_SInt: desc.Format = FORMAT_R8G8_SINT; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R16_Float: desc.Format = FORMAT_R16_FLOAT; break;
+			case tinyddsloader::DDSFile::DXGIFormat::D16_UNorm: desc.Format = FORMAT_D16_UNORM; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R16_UNorm: desc.Format = FORMAT_R16_UNORM; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R16_UInt: desc.Format = FORMAT_R16_UINT; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R16_SNorm: desc.Format = FORMAT_R16_SNORM; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R16_SInt: desc.Format = FORMAT_R16_SINT; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R8_UNorm: desc.Format = FORMAT_R8_UNORM; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R8_UInt: desc.Format = FORMAT_R8_UINT; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R8_SNorm: desc.Format = FORMAT_R8_SNORM; break;
+			case tinyddsloader::DDSFile::DXGIFormat::R8_SInt: desc.Format = FORMAT_R8_SINT; break;
+			case tinyddsloader::DDSFile::DXGIFormat::BC1_UNorm: desc.Format = FORMAT_BC1_UNORM; break;
+			case tinyddsloader::DDSFile::DXGIFormat::BC1_UNorm_SRGB: desc.Format = FORMAT_BC1_UNORM_SRGB; break;
+			case tinyddsloader::DDSFile::DXGIFormat::BC2_UNorm: desc.Format = FORMAT_BC2_UNORM; break;
+			case tinyddsloader::DDSFile::DXGIFormat::BC2_UNorm_SRGB: desc.Format = FORMAT_BC2_UNORM_SRGB; break;
+			case tinyddsloader::DDSFile::DXGIFormat::BC3_UNorm: desc.Format = FORMAT_BC3_UNORM; break;
+			case tinyddsloader::DDSFile::DXGIFormat::BC3_UNorm_SRGB: desc.Format = FORMAT_BC3_UNORM_SRGB; break;
+			case tinyddsloader::DDSFile::DXGIFormat::BC4_UNorm: desc.Format = FORMAT_BC4_UNORM; break;
+			case tinyddsloader::DDSFile::DXGIFormat::BC4_SNorm: desc.Format = FORMAT_BC4_SNORM; break;
+			case tinyddsloader::DDSFile::DXGIFormat::BC5_UNorm: desc.Format = FORMAT_BC5_UNORM; break;
+			case tinyddsloader::DDSFile::DXGIFormat::BC5_SNorm: desc.Format = FORMAT_BC5_SNORM; break;
+			case tinyddsloader::DDSFile::DXGIFormat::BC7_UNorm: desc.Format = FORMAT_BC7_UNORM; break;
+			case tinyddsloader::DDSFile::DXGIFormat::BC7_UNorm_SRGB: desc.Format = FORMAT_BC7_UNORM_SRGB; break;
+			default:
+				assert(0); // incoming format is not supported 
+				break;
+			}
+
+			std::vector<SubresourceData> InitData;
+			for (UINT arrayIndex = 0; arrayIndex < desc.ArraySize; ++arrayIndex)
+			{
+				for (UINT mip = 0; mip < desc.MipLevels; ++mip)
+				{
+					auto imageData = dds.GetImageData(mip, arrayIndex);
+					SubresourceData subresourceData;
+					subresourceData.pSysMem = imageData->m_mem;
+					subresourceData.SysMemPitch = imageData->m_memPitch;
+					subresourceData.SysMemSlicePitch = imageData->m_memSlicePitch;
+					InitData.push_back(subresourceData);
+				}
+			}
+
+			auto dim = dds.GetTextureDimension();
+			switch (dim)
+			{
+			case tinyddsloader::DDSFile::TextureDimension::Texture1D:
+			{
+				Texture1D* image = new Texture1D;
+				HRESULT hr = wiRenderer::GetDevice()->CreateTexture1D(&desc, InitData.data(), image);
+				assert(SUCCEEDED(hr));
+				wiRenderer::GetDevice()->SetName(image, nameStr);
+				success = image;
+				type = wiResourceManager::IMAGE_1D;
+			}
+			break;
+			case tinyddsloader::DDSFile::TextureDimension::Texture2D:
+			{
+				Texture2D* image = new Texture2D;
+				HRESULT hr = wiRenderer::GetDevice()->CreateTexture2D(&desc, InitData.data(), image);
+				assert(SUCCEEDED(hr));
+				wiRenderer::GetDevice()->SetName(image, nameStr);
+				success = image;
+				type = wiResourceManager::IMAGE_2D;
+			}
+			break;
+			case tinyddsloader::DDSFile::TextureDimension::Texture3D:
+			{
+				Texture3D* image = new Texture3D;
+				HRESULT hr = wiRenderer::GetDevice()->CreateTexture3D(&desc, InitData.data(), image);
+				assert(SUCCEEDED(hr));
+				wiRenderer::GetDevice()->SetName(image, nameStr);
+				success = image;
+				type = wiResourceManager::IMAGE_3D;
+			}
+			break;
+			default:
+				assert(0);
+				break;
+			}
+		}
+		else assert(0); // failed to load DDS
+
+	}
+	else
+	{
+		// png, tga, jpg, etc. loader:
+
+		const int channelCount = 4;
+		int width, height, bpp;
+		unsigned char* rgb = nullptr;
+		wiVirtualFileSystem::FileView file;
+		if (wiVirtualFileSystem::OpenFile(nameStr, file))
+		{
+			rgb = stbi_load_from_memory(file.data, (int)file.size, &width, &height, &bpp, channelCount);
+		}
+
+		if (rgb != nullptr)
+		{
+			GraphicsDevice* device = wiRenderer::GetDevice();
+
+			TextureDesc desc;
+			desc.ArraySize = 1;
+			desc.BindFlags = BIND_SHADER_RESOURCE | BIND_UNORDERED_ACCESS;
+			desc.CPUAccessFlags = 0;
+			desc.Format = FORMAT_R8G8B8A8_UNORM;
+			desc.Height = static_cast<uint32_t>(height);
+			desc.Width = static_cast<uint32_t>(width);
+			desc.MipLevels = (UINT)log2(std::max(width, height));
+			desc.MiscFlags = 0;
+			desc.Usage = USAGE_DEFAULT;
+
+			UINT mipwidth = width;
+			std::vector<SubresourceData> InitData(desc.MipLevels);
+			for (UINT mip = 0; mip < desc.MipLevels; ++mip)
+			{
+				InitData[mip].pSysMem = rgb; // attention! we don't fill the mips here correctly, just always point to the mip0 data by default. Mip levels will be created using compute shader when needed!
+				InitData[mip].SysMemPitch = static_cast<UINT>(mipwidth * channelCount);
+				mipwidth = std::max(1u, mipwidth / 2);
+			}
+
+			Texture2D* image = new Texture2D;
+			HRESULT hr = device->CreateTexture2D(&desc, InitData.data(), image);
+			assert(SUCCEEDED(hr));
+			device->SetName(image, nameStr);
+
+			for (UINT i = 0; i < image->GetDesc().MipLevels; ++i)
+			{
+				int subresource_index;
+				subresource_index = device->CreateSubresource(image, SRV, 0, 1, i, 1);
+				assert(subresource_index == i);
+				subresource_index = device->CreateSubresource(image, UAV, 0, 1, i, 1);
+				assert(subresource_index == i);
+			}
+
+			if (mipGen && image->GetDesc().MipLevels > 1)
+			{
+				wiRenderer::AddDeferredMIPGen(image);
+			}
+
+			success = image;
+		}
+
+		stbi_image_free(rgb);
+	}
+
+	return success;
+}
+
+// Estimate the GPU memory size of a texture from its description
+static size_t GetTextureMemorySize(const TextureDesc& desc)
+{
+	size_t blockSize = 0; // bytes per 4x4 block for block compressed formats
+	switch (desc.Format)
+	{
+	case FORMAT_BC1_UNORM:
+	case FORMAT_BC1_UNORM_SRGB:
+	case FORMAT_BC4_UNORM:
+	case FORMAT_BC4_SNORM:
+		blockSize = 8;
+		break;
+	case FORMAT_BC2_UNORM:
+	case FORMAT_BC2_UNORM_SRGB:
+	case FORMAT_BC3_UNORM:
+	case FORMAT_BC3_UNORM_SRGB:
+	case FORMAT_BC5_UNORM:
+	case FORMAT_BC5_SNORM:
+	case FORMAT_BC6H_UF16:
+	case FORMAT_BC6H_SF16:
+	case FORMAT_BC7_UNORM:
+	case FORMAT_BC7_UNORM_SRGB:
+		blockSize = 16;
+		break;
+	default:
+		break;
+	}
+	const size_t stride = blockSize > 0 ? 0 : wiRenderer::GetDevice()->GetFormatStride(desc.Format);
+
+	size_t size = 0;
+	UINT width = std::max(1u, desc.Width);
+	UINT height = std::max(1u, desc.Height);
+	UINT depth = std::max(1u, desc.Depth);
+	for (UINT mip = 0; mip < std::max(1u, desc.MipLevels); ++mip)
+	{
+		if (blockSize > 0)
+		{
+			size += size_t((width + 3) / 4) * size_t((height + 3) / 4) * depth * blockSize;
+		}
+		else
+		{
+			size += size_t(width) * size_t(height) * depth * stride;
+		}
+		width = std::max(1u, width / 2);
+		height = std::max(1u, height / 2);
+		depth = std::max(1u, depth / 2);
+	}
+	return size * std::max(1u, desc.ArraySize);
+}
+
+// Estimate the memory size of a resource, shaders are not handled because their size is not known from the object
+static size_t GetResourceSize(const void* data, wiResourceManager::Data_Type type)
+{
+	switch (type)
+	{
+	case wiResourceManager::IMAGE_1D:
+	case wiResourceManager::IMAGE_2D:
+	case wiResourceManager::IMAGE_3D:
+		return GetTextureMemorySize(((const Texture*)data)->GetDesc());
+	case wiResourceManager::SOUND:
+		return wiAudio::GetSoundSize((const wiAudio::Sound*)data);
+	default:
+		break;
+	}
+	return 0;
+}
+
+// Delete the resource object, returns false if the type is not known
+static bool DestroyResource(const void*& data, wiResourceManager::Data_Type type)
+{
+	switch (type)
+	{
+	case wiResourceManager::IMAGE_1D:
+		SAFE_DELETE(reinterpret_cast<const Texture1D*&>(data));
+		break;
+	case wiResourceManager::IMAGE_2D:
+		SAFE_DELETE(reinterpret_cast<const Texture2D*&>(data));
+		break;
+	case wiResourceManager::IMAGE_3D:
+		SAFE_DELETE(reinterpret_cast<const Texture3D*&>(data));
+		break;
+	case wiResourceManager::VERTEXSHADER:
+		SAFE_DELETE(reinterpret_cast<const VertexShader*&>(data));
+		break;
+	case wiResourceManager::PIXELSHADER:
+		SAFE_DELETE(reinterpret_cast<const PixelShader*&>(data));
+		break;
+	case wiResourceManager::GEOMETRYSHADER:
+		SAFE_DELETE(reinterpret_cast<const GeometryShader*&>(data));
+		break;
+	case wiResourceManager::HULLSHADER:
+		SAFE_DELETE(reinterpret_cast<const HullShader*&>(data));
+		break;
+	case wiResourceManager::DOMAINSHADER:
+		SAFE_DELETE(reinterpret_cast<const DomainShader*&>(data));
+		break;
+	case wiResourceManager::COMPUTESHADER:
+		SAFE_DELETE(reinterpret_cast<const ComputeShader*&>(data));
+		break;
+	case wiResourceManager::SOUND:
+		SAFE_DELETE(reinterpret_cast<const wiAudio::Sound*&>(data));
+		break;
+	default:
+		return false;
+	};
+	return true;
+}
+
+wiResourceManager::wiResourceManager()
+{
+	for (auto& x : memoryUsage)
+	{
+		x.store(0);
+	}
+}
+
 wiResourceManager& wiResourceManager::GetGlobal()
 {
 	static wiResourceManager globalResources;
@@ -33,453 +393,641 @@ wiResourceManager& wiResourceManager::GetShaderManager()
 }
 
 
-wiResourceManager::Resource wiResourceManager::get(const wiHashString& name, bool incRefCount)
+bool wiResourceManager::find(const wiHashString& name, Resource& resource, bool incRefCount)
 {
-	lock.lock();
-	auto& it = resources.find(name);
-	if (it != resources.end())
+	Shard& shard = GetShard(name);
+	std::shared_lock<std::shared_timed_mutex> lck(shard.lock);
+	auto it = shard.resources.find(name);
+	if (it == shard.resources.end())
 	{
-		if(incRefCount)
-			it->second.refCount++;
-		lock.unlock();
-		return it->second;
+		return false;
 	}
+	resource.data = it->second.data;
+	resource.type = it->second.type;
+	resource.refCount = incRefCount ? ++it->second.refCount : it->second.refCount.load();
+	resource.loading = it->second.loading;
+	resource.size = it->second.size;
 
-	lock.unlock();
-	return Resource();
+	// Only written when it changes, so frequently requested resources are not written by every request:
+	const uint64_t used = useCounter.load(std::memory_order_relaxed);
+	if (it->second.lastUsed.load(std::memory_order_relaxed) != used)
+	{
+		it->second.lastUsed.store(used, std::memory_order_relaxed);
+	}
+	return true;
 }
 
-const void* wiResourceManager::add(const wiHashString& name, Data_Type newType)
+bool wiResourceManager::BeginLoad(const wiHashString& name, Resource& resource, std::promise<void>& promise)
 {
-	Resource res = get(name,true);
-	if(res.type == EMPTY)
-	{
-		string nameStr = name.GetString();
-		string ext = wiHelper::toUpper(nameStr.substr(nameStr.length() - 3, nameStr.length()));
-		Data_Type type;
-
-		// dynamic type selection:
-		if(newType==Data_Type::DYNAMIC){
-			auto& it = types.find(ext);
-			if(it!=types.end())
-				type = it->second;
-			else 
-				return nullptr;
-		}
-		else 
-			type = newType;
+	Shard& shard = GetShard(name);
+	std::shared_future<void> inFlight;
+	{
+		std::unique_lock<std::shared_timed_mutex> lck(shard.lock);
 
-		void* success = nullptr;
+		// It could have been loaded since it was looked up:
+		auto it = shard.resources.find(name);
+		if (it != shard.resources.end())
+		{
+			resource.data = it->second.data;
+			resource.type = it->second.type;
+			resource.refCount = ++it->second.refCount;
+			resource.loading = it->second.loading;
+			resource.size = it->second.size;
+			return false;
+		}
 
-		switch(type)
+		auto loading = shard.inFlight.find(name);
+		if (loading == shard.inFlight.end())
 		{
-		case Data_Type::IMAGE_1D:
-		case Data_Type::IMAGE_2D:
-		case Data_Type::IMAGE_3D:
+			shard.inFlight[name] = promise.get_future().share();
+			return true;
+		}
+		inFlight = loading->second;
+	}
+
+	// An other thread is loading it, so the result of that is used:
+	inFlight.wait();
+	find(name, resource, true);
+	return false;
+}
+
+void wiResourceManager::EndLoad(const wiHashString& name, const void* data, Data_Type type, size_t size, bool loading, std::promise<void>& promise)
+{
+	Shard& shard = GetShard(name);
+	{
+		std::unique_lock<std::shared_timed_mutex> lck(shard.lock);
+		if (data != nullptr)
 		{
-			if (!ext.compare(std::string("DDS")))
+			Entry& entry = shard.resources[name];
+			entry.data = data;
+			entry.type = type;
+			entry.refCount.store(1);
+			entry.loading = loading;
+			entry.size = size;
+			entry.lastUsed.store(++useCounter);
+			if (type < EMPTY)
 			{
-				// Load dds
+				memoryUsage[type] += size;
+			}
+		}
+		shard.inFlight.erase(name);
+	}
+	promise.set_value();
+
+	if (data != nullptr)
+	{
+		EnforceMemoryBudget();
+	}
+}
 
-				tinyddsloader::DDSFile dds;
-				auto result = dds.Load(nameStr.c_str());
+wiResourceManager::Resource wiResourceManager::get(const wiHashString& name, bool incRefCount)
+{
+	Resource resource;
+	find(name, resource, incRefCount);
+	return resource;
+}
 
-				if (result == tinyddsloader::Result::Success)
-				{
-					TextureDesc desc;
-					desc.ArraySize = 1;
-					desc.BindFlags = BIND_SHADER_RESOURCE;
-					desc.CPUAccessFlags = 0;
-					desc.Height = dds.GetWidth();
-					desc.Width = dds.GetHeight();
-					desc.Depth = dds.GetDepth();
-					desc.MipLevels = dds.GetMipCount();
-					desc.ArraySize = dds.GetArraySize();
-					desc.MiscFlags = 0;
-					desc.Usage = USAGE_IMMUTABLE;
-					desc.Format = FORMAT_R8G8B8A8_UNORM;
-
-					if (dds.IsCubemap())
-					{
-						desc.MiscFlags |= RESOURCE_MISC_TEXTURECUBE;
-					}
-
-					auto ddsFormat = dds.GetFormat();
-
-					switch (ddsFormat)
-					{
-					case tinyddsloader::DDSFile::DXGIFormat::R32G32B32A32_Float: desc.Format = FORMAT_R32G32B32A32_FLOAT; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R32G32B32A32_UInt: desc.Format = FORMAT_R32G32B32A32_UINT; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R32G32B32A32_SInt: desc.Format = FORMAT_R32G32B32A32_SINT; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R32G32B32_Float: desc.Format = FORMAT_R32G32B32_FLOAT; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R32G32B32_UInt: desc.Format = FORMAT_R32G32B32_UINT; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R32G32B32_SInt: desc.Format = FORMAT_R32G32B32_SINT; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R16G16B16A16_Float: desc.Format = FORMAT_R16G16B16A16_FLOAT; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R16G16B16A16_UNorm: desc.Format = FORMAT_R16G16B16A16_UNORM; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R16G16B16A16_UInt: desc.Format = FORMAT_R16G16B16A16_UINT; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R16G16B16A16_SNorm: desc.Format = FORMAT_R16G16B16A16_SNORM; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R16G16B16A16_SInt: desc.Format = FORMAT_R16G16B16A16_SINT; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R32G32_Float: desc.Format = FORMAT_R32G32_FLOAT; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R32G32_UInt: desc.Format = FORMAT_R32G32_UINT; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R32G32_SInt: desc.Format = FORMAT_R32G32_SINT; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R10G10B10A2_UNorm: desc.Format = FORMAT_R10G10B10A2_UNORM; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R10G10B10A2_UInt: desc.Format = FORMAT_R10G10B10A2_UINT; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R11G11B10_Float: desc.Format = FORMAT_R11G11B10_FLOAT; break;
-					case tinyddsloader::DDSFile::DXGIFormat::B8G8R8A8_UNorm: desc.Format = FORMAT_B8G8R8A8_UNORM; break;
-					case tinyddsloader::DDSFile::DXGIFormat::B8G8R8A8_UNorm_SRGB: desc.Format = FORMAT_B8G8R8A8_UNORM_SRGB; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R8G8B8A8_UNorm: desc.Format = FORMAT_R8G8B8A8_UNORM; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R8G8B8A8_UNorm_SRGB: desc.Format = FORMAT_R8G8B8A8_UNORM_SRGB; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R8G8B8A8_UInt: desc.Format = FORMAT_R8G8B8A8_UINT; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R8G8B8A8_SNorm: desc.Format = FORMAT_R8G8B8A8_SNORM; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R8G8B8A8_SInt: desc.Format = FORMAT_R8G8B8A8_SINT; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R16G16_Float: desc.Format = FORMAT_R16G16_FLOAT; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R16G16_UNorm: desc.Format = FORMAT_R16G16_UNORM; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R16G16_UInt: desc.Format = FORMAT_R16G16_UINT; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R16G16_SNorm: desc.Format = FORMAT_R16G16_SNORM; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R16G16_SInt: desc.Format = FORMAT_R16G16_SINT; break;
-					case tinyddsloader::DDSFile::DXGIFormat::D32_Float: desc.Format = FORMAT_D32_FLOAT; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R32_Float: desc.Format = FORMAT_R32_FLOAT; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R32_UInt: desc.Format = FORMAT_R32_UINT; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R32_SInt: desc.Format = FORMAT_R32_SINT; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R8G8_UNorm: desc.Format = FORMAT_R8G8_UNORM; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R8G8_UInt: desc.Format = FORMAT_R8G8_UINT; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R8G8_SNorm: desc.Format = FORMAT_R8G8_SNORM; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R8G8_SInt: desc.Format = FORMAT_R8G8_SINT; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R16_Float: desc.Format = FORMAT_R16_FLOAT; break;
-					case tinyddsloader::DDSFile::DXGIFormat::D16_UNorm: desc.Format = FORMAT_D16_UNORM; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R16_UNorm: desc.Format = FORMAT_R16_UNORM; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R16_UInt: desc.Format = FORMAT_R16_UINT; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R16_SNorm: desc.Format = FORMAT_R16_SNORM; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R16_SInt: desc.Format = FORMAT_R16_SINT; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R8_UNorm: desc.Format = FORMAT_R8_UNORM; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R8_UInt: desc.Format = FORMAT_R8_UINT; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R8_SNorm: desc.Format = FORMAT_R8_SNORM; break;
-					case tinyddsloader::DDSFile::DXGIFormat::R8_SInt: desc.Format = FORMAT_R8_SINT; break;
-					case tinyddsloader::DDSFile::DXGIFormat::BC1_UNorm: desc.Format = FORMAT_BC1_UNORM; break;
-					case tinyddsloader::DDSFile::DXGIFormat::BC1_UNorm_SRGB: desc.Format = FORMAT_BC1_UNORM_SRGB; break;
-					case tinyddsloader::DDSFile::DXGIFormat::BC2_UNorm: desc.Format = FORMAT_BC2_UNORM; break;
-					case tinyddsloader::DDSFile::DXGIFormat::BC2_UNorm_SRGB: desc.Format = FORMAT_BC2_UNORM_SRGB; break;
-					case tinyddsloader::DDSFile::DXGIFormat::BC3_UNorm: desc.Format = FORMAT_BC3_UNORM; break;
-					case tinyddsloader::DDSFile::DXGIFormat::BC3_UNorm_SRGB: desc.Format = FORMAT_BC3_UNORM_SRGB; break;
-					case tinyddsloader::DDSFile::DXGIFormat::BC4_UNorm: desc.Format = FORMAT_BC4_UNORM; break;
-					case tinyddsloader::DDSFile::DXGIFormat::BC4_SNorm: desc.Format = FORMAT_BC4_SNORM; break;
-					case tinyddsloader::DDSFile::DXGIFormat::BC5_UNorm: desc.Format = FORMAT_BC5_UNORM; break;
-					case tinyddsloader::DDSFile::DXGIFormat::BC5_SNorm: desc.Format = FORMAT_BC5_SNORM; break;
-					case tinyddsloader::DDSFile::DXGIFormat::BC7_UNorm: desc.Format = FORMAT_BC7_UNORM; break;
-					case tinyddsloader::DDSFile::DXGIFormat::BC7_UNorm_SRGB: desc.Format = FORMAT_BC7_UNORM_SRGB; break;
-					default:
-						assert(0); // incoming format is not supported 
-						break;
-					}
-
-					std::vector<SubresourceData> InitData;
-					for (UINT arrayIndex = 0; arrayIndex < desc.ArraySize; ++arrayIndex)
-					{
-						for (UINT mip = 0; mip < desc.MipLevels; ++mip)
-						{
-							auto imageData = dds.GetImageData(mip, arrayIndex);
-							SubresourceData subresourceData;
-							subresourceData.pSysMem = imageData->m_mem;
-							subresourceData.SysMemPitch = imageData->m_memPitch;
-							subresourceData.SysMemSlicePitch = imageData->m_memSlicePitch;
-							InitData.push_back(subresourceData);
-						}
-					}
-
-					auto dim = dds.GetTextureDimension();
-					switch (dim)
-					{
-					case tinyddsloader::DDSFile::TextureDimension::Texture1D:
-					{
-						Texture1D* image = new Texture1D;
-						HRESULT hr = wiRenderer::GetDevice()->CreateTexture1D(&desc, InitData.data(), image);
-						assert(SUCCEEDED(hr));
-						wiRenderer::GetDevice()->SetName(image, nameStr);
-						success = image;
-						type = Data_Type::IMAGE_1D;
-					}
-					break;
-					case tinyddsloader::DDSFile::TextureDimension::Texture2D:
-					{
-						Texture2D* image = new Texture2D;
-						HRESULT hr = wiRenderer::GetDevice()->CreateTexture2D(&desc, InitData.data(), image);
-						assert(SUCCEEDED(hr));
-						wiRenderer::GetDevice()->SetName(image, nameStr);
-						success = image;
-						type = Data_Type::IMAGE_2D;
-					}
-					break;
-					case tinyddsloader::DDSFile::TextureDimension::Texture3D:
-					{
-						Texture3D* image = new Texture3D;
-						HRESULT hr = wiRenderer::GetDevice()->CreateTexture3D(&desc, InitData.data(), image);
-						assert(SUCCEEDED(hr));
-						wiRenderer::GetDevice()->SetName(image, nameStr);
-						success = image;
-						type = Data_Type::IMAGE_3D;
-					}
-					break;
-					default:
-						assert(0);
-						break;
-					}
-				}
-				else assert(0); // failed to load DDS
+const void* wiResourceManager::add(const wiHashString& name, Data_Type newType)
+{
+	Resource res;
+	if (find(name, res, true))
+	{
+		return res.data;
+	}
 
-			}
-			else
-			{
-				// png, tga, jpg, etc. loader:
+	string nameStr = name.GetString();
+	if (nameStr.length() < 4)
+	{
+		// The type is selected by a 3 character extension, so it can't be a file name (or it's a hash that was never interned)
+		return nullptr;
+	}
+	string ext = wiHelper::toUpper(nameStr.substr(nameStr.length() - 3, nameStr.length()));
+	Data_Type type;
 
-				const int channelCount = 4;
-				int width, height, bpp;
-				unsigned char* rgb = stbi_load(nameStr.c_str(), &width, &height, &bpp, channelCount);
+	// dynamic type selection:
+	if(newType==Data_Type::DYNAMIC){
+		auto& it = types.find(ext);
+		if(it!=types.end())
+			type = it->second;
+		else 
+			return nullptr;
+	}
+	else 
+		type = newType;
 
-				if (rgb != nullptr)
-				{
-					GraphicsDevice* device = wiRenderer::GetDevice();
-
-					TextureDesc desc;
-					desc.ArraySize = 1;
-					desc.BindFlags = BIND_SHADER_RESOURCE | BIND_UNORDERED_ACCESS;
-					desc.CPUAccessFlags = 0;
-					desc.Format = FORMAT_R8G8B8A8_UNORM;
-					desc.Height = static_cast<uint32_t>(height);
-					desc.Width = static_cast<uint32_t>(width);
-					desc.MipLevels = (UINT)log2(std::max(width, height));
-					desc.MiscFlags = 0;
-					desc.Usage = USAGE_DEFAULT;
-
-					UINT mipwidth = width;
-					std::vector<SubresourceData> InitData(desc.MipLevels);
-					for (UINT mip = 0; mip < desc.MipLevels; ++mip)
-					{
-						InitData[mip].pSysMem = rgb; // attention! we don't fill the mips here correctly, just always point to the mip0 data by default. Mip levels will be created using compute shader when needed!
-						InitData[mip].SysMemPitch = static_cast<UINT>(mipwidth * channelCount);
-						mipwidth = std::max(1u, mipwidth / 2);
-					}
-
-					Texture2D* image = new Texture2D;
-					HRESULT hr = device->CreateTexture2D(&desc, InitData.data(), image);
-					assert(SUCCEEDED(hr));
-					device->SetName(image, nameStr);
-
-					for (UINT i = 0; i < image->GetDesc().MipLevels; ++i)
-					{
-						int subresource_index;
-						subresource_index = device->CreateSubresource(image, SRV, 0, 1, i, 1);
-						assert(subresource_index == i);
-						subresource_index = device->CreateSubresource(image, UAV, 0, 1, i, 1);
-						assert(subresource_index == i);
-					}
-
-					if (image != nullptr && image->GetDesc().MipLevels > 1)
-					{
-						wiRenderer::AddDeferredMIPGen(image);
-					}
-
-					success = image;
-				}
+	// Only one thread loads the resource, the others wait for it and share the result:
+	std::promise<void> promise;
+	if (!BeginLoad(name, res, promise))
+	{
+		return res.data;
+	}
 
-				stbi_image_free(rgb);
-			}
-		}
-		break;
-		case Data_Type::SOUND:
+	void* success = nullptr;
+	size_t size = 0;
+
+	switch(type)
+	{
+	case Data_Type::IMAGE_1D:
+	case Data_Type::IMAGE_2D:
+	case Data_Type::IMAGE_3D:
+	{
+		success = LoadTexture(nameStr, ext, type, true);
+	}
+	break;
+	case Data_Type::SOUND:
+	{
+		wiAudio::Sound* sound = new wiAudio::Sound;
+		if (SUCCEEDED(wiAudio::CreateSound(name.GetString(), sound)))
 		{
-			wiAudio::Sound* sound = new wiAudio::Sound;
-			if (SUCCEEDED(wiAudio::CreateSound(name.GetString(), sound)))
-			{
-				success = sound;
-			}
+			success = sound;
 		}
-		break;
-		case Data_Type::VERTEXSHADER:
-		{
-			vector<uint8_t> buffer;
-			if (wiHelper::readByteData(nameStr, buffer)) {
-				VertexShader* shader = new VertexShader;
-				wiRenderer::GetDevice()->CreateVertexShader(buffer.data(), buffer.size(), shader);
-				success = shader;
-			}
+	}
+	break;
+	case Data_Type::VERTEXSHADER:
+	{
+		vector<uint8_t> buffer;
+		if (wiVirtualFileSystem::ReadFile(nameStr, buffer)) {
+			VertexShader* shader = new VertexShader;
+			wiRenderer::GetDevice()->CreateVertexShader(buffer.data(), buffer.size(), shader);
+			success = shader;
+			size = buffer.size();
 		}
-		break;
-		case Data_Type::PIXELSHADER:
-		{
-			vector<uint8_t> buffer;
-			if (wiHelper::readByteData(nameStr, buffer)){
-				PixelShader* shader = new PixelShader;
-				wiRenderer::GetDevice()->CreatePixelShader(buffer.data(), buffer.size(), shader);
-				success = shader;
-			}
+	}
+	break;
+	case Data_Type::PIXELSHADER:
+	{
+		vector<uint8_t> buffer;
+		if (wiVirtualFileSystem::ReadFile(nameStr, buffer)){
+			PixelShader* shader = new PixelShader;
+			wiRenderer::GetDevice()->CreatePixelShader(buffer.data(), buffer.size(), shader);
+			success = shader;
+			size = buffer.size();
 		}
-		break;
-		case Data_Type::GEOMETRYSHADER:
-		{
-			vector<uint8_t> buffer;
-			if (wiHelper::readByteData(nameStr, buffer)){
-				GeometryShader* shader = new GeometryShader;
-				wiRenderer::GetDevice()->CreateGeometryShader(buffer.data(), buffer.size(), shader);
-				success = shader;
-			}
+	}
+	break;
+	case Data_Type::GEOMETRYSHADER:
+	{
+		vector<uint8_t> buffer;
+		if (wiVirtualFileSystem::ReadFile(nameStr, buffer)){
+			GeometryShader* shader = new GeometryShader;
+			wiRenderer::GetDevice()->CreateGeometryShader(buffer.data(), buffer.size(), shader);
+			success = shader;
+			size = buffer.size();
+		}
+	}
+	break;
+	case Data_Type::HULLSHADER:
+	{
+		vector<uint8_t> buffer;
+		if (wiVirtualFileSystem::ReadFile(nameStr, buffer)){
+			HullShader* shader = new HullShader;
+			wiRenderer::GetDevice()->CreateHullShader(buffer.data(), buffer.size(), shader);
+			success = shader;
+			size = buffer.size();
+		}
+	}
+	break;
+	case Data_Type::DOMAINSHADER:
+	{
+		vector<uint8_t> buffer;
+		if (wiVirtualFileSystem::ReadFile(nameStr, buffer)){
+			DomainShader* shader = new DomainShader;
+			wiRenderer::GetDevice()->CreateDomainShader(buffer.data(), buffer.size(), shader);
+			success = shader;
+			size = buffer.size();
+		}
+	}
+	break;
+	case Data_Type::COMPUTESHADER:
+	{
+		vector<uint8_t> buffer;
+		if (wiVirtualFileSystem::ReadFile(nameStr, buffer)) {
+			ComputeShader* shader = new ComputeShader;
+			wiRenderer::GetDevice()->CreateComputeShader(buffer.data(), buffer.size(), shader);
+			success = shader;
+			size = buffer.size();
 		}
+	}
+	break;
+	default:
 		break;
-		case Data_Type::HULLSHADER:
+	};
+
+	if (success != nullptr && size == 0)
+	{
+		size = GetResourceSize(success, type);
+	}
+
+	EndLoad(name, success, type, size, false, promise);
+
+	return success;
+}
+
+static std::atomic<uint64_t> textureSwapCount{ 0 };
+
+// The contents of the texture objects are exchanged, so pointers to them will refer to the other texture
+static void SwapTexture(Texture2D& a, Texture2D& b)
+{
+	textureSwapCount.fetch_add(1);
+
+	std::swap(a.device, b.device);
+	std::swap(a.type, b.type);
+	std::swap(a.SRV, b.SRV);
+	std::swap(a.subresourceSRVs, b.subresourceSRVs);
+	std::swap(a.UAV, b.UAV);
+	std::swap(a.subresourceUAVs, b.subresourceUAVs);
+	std::swap(a.resource, b.resource);
+	std::swap(a.resourceMemory, b.resourceMemory);
+	std::swap(a.desc, b.desc);
+	std::swap(a.RTV, b.RTV);
+	std::swap(a.subresourceRTVs, b.subresourceRTVs);
+	std::swap(a.DSV, b.DSV);
+	std::swap(a.subresourceDSVs, b.subresourceDSVs);
+}
+
+const void* wiResourceManager::addAsync(const wiHashString& name, const std::function<void(bool success)>& callback, wiColor placeholderColor)
+{
+	Resource res;
+	if (find(name, res, true))
+	{
+		return res.data;
+	}
+
+	string nameStr = name.GetString();
+	if (nameStr.length() < 4)
+	{
+		// The type is selected by a 3 character extension, so it can't be a file name (or it's a hash that was never interned)
+		return nullptr;
+	}
+	string ext = wiHelper::toUpper(nameStr.substr(nameStr.length() - 3, nameStr.length()));
+	auto type_it = types.find(ext);
+	if (type_it == types.end() || type_it->second != IMAGE_2D)
+	{
+		return nullptr;
+	}
+
+	std::promise<void> promise;
+	if (!BeginLoad(name, res, promise))
+	{
+		return res.data;
+	}
+
+	// The placeholder is a 1x1 texture that is replaced by the loaded texture:
+	TextureDesc desc;
+	desc.Width = 1;
+	desc.Height = 1;
+	desc.MipLevels = 1;
+	desc.ArraySize = 1;
+	desc.Format = FORMAT_R8G8B8A8_UNORM;
+	desc.BindFlags = BIND_SHADER_RESOURCE;
+	desc.Usage = USAGE_IMMUTABLE;
+	SubresourceData InitData;
+	InitData.pSysMem = &placeholderColor.rgba;
+	InitData.SysMemPitch = sizeof(placeholderColor.rgba);
+
+	Texture2D* texture = new Texture2D;
+	HRESULT hr = wiRenderer::GetDevice()->CreateTexture2D(&desc, &InitData, texture);
+	assert(SUCCEEDED(hr));
+
+	EndLoad(name, texture, IMAGE_2D, GetTextureMemorySize(desc), true, promise);
+
+	std::shared_ptr<AsyncTexture> asyncTexture = std::make_shared<AsyncTexture>();
+	asyncTexture->name = name;
+	asyncTexture->texture = texture;
+	asyncTexture->callback = callback;
+
+	// The decoding is a background job, so it can't be executed by the main thread when it waits for other jobs:
+	wiJobSystem::ExecuteBackground(loadingContext, [this, asyncTexture, nameStr, ext] {
+		Data_Type type = IMAGE_2D;
+		void* loaded = LoadTexture(nameStr, ext, type, false);
+		if (loaded != nullptr && type != IMAGE_2D)
 		{
-			vector<uint8_t> buffer;
-			if (wiHelper::readByteData(nameStr, buffer)){
-				HullShader* shader = new HullShader;
-				wiRenderer::GetDevice()->CreateHullShader(buffer.data(), buffer.size(), shader);
-				success = shader;
+			// Only 2D textures can be swapped with the placeholder:
+			switch (type)
+			{
+			case IMAGE_1D:
+				delete (Texture1D*)loaded;
+				break;
+			case IMAGE_3D:
+				delete (Texture3D*)loaded;
+				break;
+			default:
+				break;
 			}
+			loaded = nullptr;
 		}
-		break;
-		case Data_Type::DOMAINSHADER:
+		asyncTexture->loaded = (Texture2D*)loaded;
+
+		lock.lock();
+		finishedTextures.push_back(asyncTexture);
+		lock.unlock();
+	});
+
+	return texture;
+}
+
+bool wiResourceManager::IsReady(const wiHashString& name)
+{
+	Resource res;
+	return find(name, res, false) && !res.loading;
+}
+
+bool wiResourceManager::IsLoading()
+{
+	lock.lock();
+	bool loading = !finishedTextures.empty();
+	lock.unlock();
+	return loading || wiJobSystem::IsBusy(loadingContext);
+}
+
+void wiResourceManager::FinishLoading()
+{
+	// This is called once per frame, so the LRU order of resources that are only requested with lookups has frame granularity:
+	useCounter++;
+
+	lock.lock();
+	std::vector<std::shared_ptr<AsyncTexture>> finished;
+	finished.swap(finishedTextures);
+	lock.unlock();
+
+	for (auto& x : finished)
+	{
+		bool alive = false;
 		{
-			vector<uint8_t> buffer;
-			if (wiHelper::readByteData(nameStr, buffer)){
-				DomainShader* shader = new DomainShader;
-				wiRenderer::GetDevice()->CreateDomainShader(buffer.data(), buffer.size(), shader);
-				success = shader;
+			Shard& shard = GetShard(x->name);
+			std::unique_lock<std::shared_timed_mutex> lck(shard.lock);
+			auto it = shard.resources.find(x->name);
+			alive = it != shard.resources.end() && it->second.data == x->texture;
+			if (alive)
+			{
+				it->second.loading = false;
+				if (x->loaded != nullptr)
+				{
+					const size_t size = GetTextureMemorySize(x->loaded->GetDesc());
+					memoryUsage[IMAGE_2D] -= it->second.size;
+					memoryUsage[IMAGE_2D] += size;
+					it->second.size = size;
+				}
 			}
 		}
-		break;
-		case Data_Type::COMPUTESHADER:
+
+		const bool success = alive && x->loaded != nullptr;
+		if (success)
 		{
-			vector<uint8_t> buffer;
-			if (wiHelper::readByteData(nameStr, buffer)) {
-				ComputeShader* shader = new ComputeShader;
-				wiRenderer::GetDevice()->CreateComputeShader(buffer.data(), buffer.size(), shader);
-				success = shader;
+			// The texture object stays the same, only its contents are replaced, so every user of it will see the loaded texture:
+			SwapTexture(*x->texture, *x->loaded);
+			wiRenderer::GetDevice()->SetName(x->texture, x->name.GetString());
+			if (x->texture->GetDesc().MipLevels > 1 && x->texture->GetDesc().BindFlags & BIND_UNORDERED_ACCESS)
+			{
+				wiRenderer::AddDeferredMIPGen(x->texture);
 			}
 		}
-		break;
-		default:
-			break;
-		};
+		// After the swap, this is the placeholder (or the loaded texture that is not needed any more, if the resource was deleted):
+		SAFE_DELETE(x->loaded);
 
-		if (success != nullptr)
+		if (x->callback != nullptr)
 		{
-			lock.lock();
-			Resource resource;
-			resource.data = success;
-			resource.type = type;
-			resource.refCount = 1;
-			resources.insert(make_pair(name, resource));
-			lock.unlock();
+			x->callback(success);
 		}
+	}
 
-		return success;
+	if (!finished.empty())
+	{
+		EnforceMemoryBudget();
 	}
+}
 
-	return res.data;
+uint64_t wiResourceManager::GetTextureSwapCount()
+{
+	return textureSwapCount.load();
 }
 
 bool wiResourceManager::del(const wiHashString& name, bool forceDelete)
 {
-	lock.lock();
-	Resource res;
-	auto& it = resources.find(name);
-	if (it != resources.end())
-		res = it->second;
-	else
+	Shard& shard = GetShard(name);
+	std::unique_lock<std::shared_timed_mutex> lck(shard.lock);
+
+	auto it = shard.resources.find(name);
+	if (it == shard.resources.end())
 	{
-		lock.unlock();
 		return false;
 	}
-	lock.unlock();
+	Entry& res = it->second;
 
 	if (res.data != nullptr && (res.refCount <= 1 || forceDelete))
 	{
-		lock.lock();
-		bool success = true;
-
-		switch (res.type) 
+		if (!forceDelete && res.refCount == 1 && memoryBudget.load() > 0)
 		{
-		case Data_Type::IMAGE_1D:
-			SAFE_DELETE(reinterpret_cast<const Texture1D*&>(res.data));
-			break;
-		case Data_Type::IMAGE_2D:
-			SAFE_DELETE(reinterpret_cast<const Texture2D*&>(res.data));
-			break;
-		case Data_Type::IMAGE_3D:
-			SAFE_DELETE(reinterpret_cast<const Texture3D*&>(res.data));
-			break;
-		case Data_Type::VERTEXSHADER:
-			SAFE_DELETE(reinterpret_cast<const VertexShader*&>(res.data));
-			break;
-		case Data_Type::PIXELSHADER:
-			SAFE_DELETE(reinterpret_cast<const PixelShader*&>(res.data));
-			break;
-		case Data_Type::GEOMETRYSHADER:
-			SAFE_DELETE(reinterpret_cast<const GeometryShader*&>(res.data));
-			break;
-		case Data_Type::HULLSHADER:
-			SAFE_DELETE(reinterpret_cast<const HullShader*&>(res.data));
-			break;
-		case Data_Type::DOMAINSHADER:
-			SAFE_DELETE(reinterpret_cast<const DomainShader*&>(res.data));
-			break;
-		case Data_Type::COMPUTESHADER:
-			SAFE_DELETE(reinterpret_cast<const ComputeShader*&>(res.data));
-			break;
-		case Data_Type::SOUND:
-			SAFE_DELETE(reinterpret_cast<const wiAudio::Sound*&>(res.data));
-			break;
-		default:
-			success = false;
-			break;
-		};
+			// The resource stays resident without references, until it is requested again or evicted:
+			res.refCount = 0;
+			res.lastUsed.store(++useCounter);
+			lck.unlock();
+			EnforceMemoryBudget();
+			return true;
+		}
 
-		resources.erase(name);
+		if (res.type < EMPTY)
+		{
+			memoryUsage[res.type] -= res.size;
+		}
+		bool success = DestroyResource(res.data, res.type);
 
-		lock.unlock();
+		shard.resources.erase(it);
 
 		return success;
 	}
 	else if (res.data != nullptr)
 	{
-		lock.lock();
-		resources[name].refCount--;
-		lock.unlock();
+		res.refCount--;
 	}
 	return false;
 }
 
 bool wiResourceManager::Register(const wiHashString& name, void* resource, Data_Type newType)
 {
-	lock.lock();
-	if (resources.find(name) == resources.end())
+	Shard& shard = GetShard(name);
+	std::unique_lock<std::shared_timed_mutex> lck(shard.lock);
+
+	if (shard.resources.find(name) == shard.resources.end())
 	{
-		Resource res;
+		Entry& res = shard.resources[name];
 		res.data = resource;
 		res.type = newType;
-		res.refCount = 1;
-		resources.insert(make_pair(name, res));
-		lock.unlock();
+		res.refCount.store(1);
+		res.size = GetResourceSize(resource, newType);
+		res.lastUsed.store(++useCounter);
+		if (newType < EMPTY)
+		{
+			memoryUsage[newType] += res.size;
+		}
+		lck.unlock();
+		EnforceMemoryBudget();
 		return true;
 	}
-	lock.unlock();
 
 	return false;
 }
 
-bool wiResourceManager::Clear()
+void wiResourceManager::GetNames(std::vector<std::string>& names)
 {
-	wiRenderer::GetDevice()->WaitForGPU();
+	for (auto& shard : shards)
+	{
+		std::shared_lock<std::shared_timed_mutex> lck(shard.lock);
+		for (auto& x : shard.resources)
+		{
+			names.push_back(x.first.GetString());
+		}
+	}
+}
+
+void wiResourceManager::SetMemoryBudget(size_t bytes)
+{
+	memoryBudget.store(bytes);
+	if (bytes == 0)
+	{
+		// Without a budget, resources are not kept without references:
+		EvictUnused(0);
+	}
+	else
+	{
+		EnforceMemoryBudget();
+	}
+}
+
+size_t wiResourceManager::GetMemoryUsage() const
+{
+	size_t usage = 0;
+	for (auto& x : memoryUsage)
+	{
+		usage += x.load();
+	}
+	return usage;
+}
+
+void wiResourceManager::EnforceMemoryBudget()
+{
+	const size_t budget = memoryBudget.load();
+	if (budget > 0 && GetMemoryUsage() > budget)
+	{
+		EvictUnused(budget);
+	}
+}
+
+size_t wiResourceManager::EvictUnused(size_t targetBytes)
+{
+	std::lock_guard<std::mutex> evictionLck(evictionLock);
 
-	std::vector<wiHashString> resNames;
-	resNames.reserve(resources.size());
-	for (auto& x : resources)
+	struct Candidate
+	{
+		wiHashString name;
+		uint64_t lastUsed;
+	};
+	std::vector<Candidate> candidates;
+	for (auto& shard : shards)
 	{
-		resNames.push_back(x.first);
+		std::shared_lock<std::shared_timed_mutex> lck(shard.lock);
+		for (auto& x : shard.resources)
+		{
+			if (x.second.refCount.load() == 0 && !x.second.loading)
+			{
+				candidates.push_back({ x.first, x.second.lastUsed.load() });
+			}
+		}
 	}
+	std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+		return a.lastUsed < b.lastUsed;
+	});
+
+	size_t freed = 0;
+	for (auto& x : candidates)
+	{
+		if (GetMemoryUsage() <= targetBytes)
+		{
+			break;
+		}
+
+		Shard& shard = GetShard(x.name);
+		std::unique_lock<std::shared_timed_mutex> lck(shard.lock);
+
+		// It could have been requested again since the candidates were collected:
+		auto it = shard.resources.find(x.name);
+		if (it == shard.resources.end() || it->second.refCount.load() != 0 || it->second.loading)
+		{
+			continue;
+		}
+
+		Entry& res = it->second;
+		if (res.type < EMPTY)
+		{
+			memoryUsage[res.type] -= res.size;
+		}
+		freed += res.size;
+		DestroyResource(res.data, res.type);
+		shard.resources.erase(it);
+	}
+	return freed;
+}
+
+void wiResourceManager::GetResidency(std::vector<ResidencyInfo>& residency)
+{
+	std::vector<std::pair<uint64_t, ResidencyInfo>> resident;
+	for (auto& shard : shards)
+	{
+		std::shared_lock<std::shared_timed_mutex> lck(shard.lock);
+		for (auto& x : shard.resources)
+		{
+			ResidencyInfo info;
+			info.name = x.first.GetString();
+			info.resource.data = x.second.data;
+			info.resource.type = x.second.type;
+			info.resource.refCount = x.second.refCount.load();
+			info.resource.loading = x.second.loading;
+			info.resource.size = x.second.size;
+			resident.push_back(std::make_pair(x.second.lastUsed.load(), info));
+		}
+	}
+	std::sort(resident.begin(), resident.end(), [](const std::pair<uint64_t, ResidencyInfo>& a, const std::pair<uint64_t, ResidencyInfo>& b) {
+		return a.first > b.first;
+	});
+
+	residency.reserve(residency.size() + resident.size());
+	for (auto& x : resident)
+	{
+		residency.push_back(std::move(x.second));
+	}
+}
+
+bool wiResourceManager::IsResident(const wiHashString& name)
+{
+	Shard& shard = GetShard(name);
+	std::shared_lock<std::shared_timed_mutex> lck(shard.lock);
+	return shard.resources.find(name) != shard.resources.end();
+}
+
+bool wiResourceManager::Clear()
+{
+	wiRenderer::GetDevice()->WaitForGPU();
+
+	// Textures that are still loading are finished first, so the background jobs won't refer to deleted resources:
+	wiJobSystem::Wait(loadingContext);
+	FinishLoading();
+
+	std::vector<std::string> resNames;
+	GetNames(resNames);
 	for (auto& x : resNames)
 	{
 		del(x);
 	}
-	lock.lock();
-	resources.clear();
-	lock.unlock();
+	// The resources that are kept without references because of the memory budget:
+	EvictUnused(0);
+	for (auto& shard : shards)
+	{
+		std::unique_lock<std::shared_timed_mutex> lck(shard.lock);
+		shard.resources.clear();
+	}
+	for (auto& x : memoryUsage)
+	{
+		x.store(0);
+	}
 	return true;
 }
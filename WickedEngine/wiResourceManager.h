@@ -2,14 +2,21 @@
 #include "CommonInclude.h"
 #include "wiGraphicsDevice.h"
 #include "wiHashString.h"
+#include "wiJobSystem.h"
+#include "wiColor.h"
 
 #include <mutex>
+#include <shared_mutex>
+#include <future>
+#include <atomic>
 #include <unordered_map>
+#include <functional>
+#include <memory>
 
 class wiResourceManager
 {
 private:
-	std::mutex lock;
+	std::mutex lock; // for the finished background loading
 public:
 	enum Data_Type{
 		DYNAMIC,
@@ -31,11 +38,61 @@ public:
 		const void* data = nullptr;
 		Data_Type type = EMPTY;
 		long refCount = 0;
+		bool loading = false; // the data is a placeholder until the background loading is finished
+		size_t size = 0; // memory usage in bytes (estimated for GPU resources)
 	};
-	std::unordered_map<wiHashString, Resource> resources;
 
+private:
+	struct Entry
+	{
+		const void* data = nullptr;
+		Data_Type type = EMPTY;
+		std::atomic<long> refCount{ 1 }; // it can be incremented while the shard is only locked for reading
+		bool loading = false;
+		size_t size = 0;
+		std::atomic<uint64_t> lastUsed{ 0 }; // the value of useCounter when it was last requested
+	};
+	// The resources are distributed into shards by their name hash, every shard has its own reader-writer lock,
+	//	so requests for different resources rarely wait for each other, and lookups only need the shared (reader) lock
+	//	Resources that are being loaded are in the inFlight table, requests for them wait for that load instead of loading them again
+	struct Shard
+	{
+		std::shared_timed_mutex lock;
+		std::unordered_map<wiHashString, Entry> resources;
+		std::unordered_map<wiHashString, std::shared_future<void>> inFlight;
+	};
+	static const size_t SHARD_COUNT = 16;
+	Shard shards[SHARD_COUNT];
+	Shard& GetShard(const wiHashString& name) { return shards[name.GetHash() % SHARD_COUNT]; }
+
+	// Look up a loaded resource and increment its reference count, returns false if it is not loaded
+	bool find(const wiHashString& name, Resource& resource, bool incRefCount);
+	// Begin loading a resource: returns true if the caller should load it and call EndLoad() afterwards,
+	//	otherwise an other thread was loading it, and resource contains the result (if it was loaded)
+	bool BeginLoad(const wiHashString& name, Resource& resource, std::promise<void>& promise);
+	void EndLoad(const wiHashString& name, const void* data, Data_Type type, size_t size, bool loading, std::promise<void>& promise);
+
+	// Memory accounting per Data_Type, and the LRU order of resources:
+	std::atomic<size_t> memoryUsage[EMPTY];
+	std::atomic<size_t> memoryBudget{ 0 };
+	std::atomic<uint64_t> useCounter{ 0 };
+	std::mutex evictionLock;
+	// Evict unused resources if the memory budget is exceeded
+	void EnforceMemoryBudget();
+
+	// Texture that is being loaded in the background by addAsync()
+	struct AsyncTexture
+	{
+		wiHashString name;
+		wiGraphics::Texture2D* texture = nullptr;	// the texture that was returned by addAsync()
+		wiGraphics::Texture2D* loaded = nullptr;	// the texture that was created by the background job (nullptr if the loading failed)
+		std::function<void(bool success)> callback;
+	};
+	std::vector<std::shared_ptr<AsyncTexture>> finishedTextures; // waiting for FinishLoading()
+	wiJobSystem::context loadingContext;
 
 public:
+	wiResourceManager();
 	~wiResourceManager() { Clear(); }
 	static wiResourceManager& GetGlobal();
 	static wiResourceManager& GetShaderManager();
@@ -45,6 +102,50 @@ public:
 	const void* add(const wiHashString& name, Data_Type newType = Data_Type::DYNAMIC);
 	bool del(const wiHashString& name, bool forceDelete = false);
 	bool Register(const wiHashString& name, void* resource, Data_Type newType);
+	// Get the names of all resources
+	void GetNames(std::vector<std::string>& names);
+
+	// Memory budget:
+	//	When a budget is set, resources are not destroyed when their last reference is deleted with del(), but they stay resident
+	//	with zero references, so they can be requested again without loading. When the memory usage exceeds the budget, the
+	//	zero-reference resources are evicted in least recently used order. Resources that are referenced are never evicted,
+	//	so the budget can be exceeded by them. 0 means no budget, resources are destroyed when their last reference is deleted (default)
+	void SetMemoryBudget(size_t bytes);
+	size_t GetMemoryBudget() const { return memoryBudget.load(); }
+	// Get the memory usage of all resident resources in bytes
+	size_t GetMemoryUsage() const;
+	// Get the memory usage of resident resources of one type in bytes
+	size_t GetMemoryUsage(Data_Type type) const { return type < EMPTY ? memoryUsage[type].load() : 0; }
+	// Evict zero-reference resources in least recently used order until the memory usage drops to targetBytes
+	//	returns the number of bytes that were freed
+	size_t EvictUnused(size_t targetBytes = 0);
+
+	struct ResidencyInfo
+	{
+		std::string name;
+		Resource resource;
+	};
+	// Get every resident resource, from the most recently used to the least recently used
+	void GetResidency(std::vector<ResidencyInfo>& residency);
+	// Returns true if the resource is resident (it can be returned without loading)
+	bool IsResident(const wiHashString& name);
+
+	// Load a texture (2D image file) in the background. A placeholder texture is returned immediately, and the loaded texture
+	//	is swapped into the same texture object by FinishLoading() when it's ready, so the returned pointer stays valid
+	//	If the texture is already loaded or loading, it is returned like with add()
+	//	callback			: optional, called from FinishLoading() after the texture was swapped in (success is false if the loading failed)
+	//	placeholderColor	: the color of the 1x1 placeholder texture (for example a flat normal for normal maps)
+	const void* addAsync(const wiHashString& name, const std::function<void(bool success)>& callback = nullptr, wiColor placeholderColor = wiColor(255, 255, 255, 255));
+	// Returns true if the resource exists and it is not waiting for background loading
+	bool IsReady(const wiHashString& name);
+	// Returns true if any texture is waiting for background loading
+	bool IsLoading();
+	// Swap in the textures that were loaded in the background and call their callbacks
+	//	This must be called at a frame boundary from the main thread, it is called by wiRenderer::UpdatePerFrameData()
+	void FinishLoading();
+	// Returns a number that changes when any resource manager swaps in a loaded texture, so caches that are keyed by texture pointers
+	//	(like the material atlas of the GPU BVH) can detect that the contents of the textures have changed
+	static uint64_t GetTextureSwapCount();
 	bool Clear();
 };
 
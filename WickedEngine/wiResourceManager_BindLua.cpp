@@ -3,8 +3,11 @@
 #include "Texture_BindLua.h"
 #include "wiAudio_BindLua.h"
 #include "wiRenderer.h"
+#include "wiTextureCooker.h"
+#include "wiVirtualFileSystem.h"
 
 #include <sstream>
+#include <algorithm>
 
 using namespace std;
 using namespace wiGraphics;
@@ -16,6 +19,9 @@ Luna<wiResourceManager_BindLua>::FunctionType wiResourceManager_BindLua::methods
 	lunamethod(wiResourceManager_BindLua, Add),
 	lunamethod(wiResourceManager_BindLua, Del),
 	lunamethod(wiResourceManager_BindLua, List),
+	lunamethod(wiResourceManager_BindLua, GetMemoryUsage),
+	lunamethod(wiResourceManager_BindLua, SetMemoryBudget),
+	lunamethod(wiResourceManager_BindLua, GetMemoryBudget),
 	{ NULL, NULL }
 };
 Luna<wiResourceManager_BindLua>::PropertyType wiResourceManager_BindLua::properties[] = {
@@ -123,14 +129,163 @@ int wiResourceManager_BindLua::List(lua_State *L)
 		return 0;
 	}
 	stringstream ss("");
-	for (auto x : resources->resources)
+	std::vector<std::string> names;
+	resources->GetNames(names);
+	for (auto& x : names)
 	{
-		ss << x.first.GetString() << endl;
+		ss << x << endl;
 	}
 	wiLua::SSetString(L, ss.str());
 	return 1;
 }
 
+int wiResourceManager_BindLua::GetMemoryUsage(lua_State *L)
+{
+	if (resources == nullptr)
+	{
+		wiLua::SError(L, "GetMemoryUsage() resources is empty!");
+		return 0;
+	}
+	size_t textures = resources->GetMemoryUsage(IMAGE_1D) + resources->GetMemoryUsage(IMAGE_2D) + resources->GetMemoryUsage(IMAGE_3D);
+	size_t sounds = resources->GetMemoryUsage(SOUND);
+	size_t shaders = resources->GetMemoryUsage(VERTEXSHADER) + resources->GetMemoryUsage(PIXELSHADER) + resources->GetMemoryUsage(GEOMETRYSHADER) +
+		resources->GetMemoryUsage(HULLSHADER) + resources->GetMemoryUsage(DOMAINSHADER) + resources->GetMemoryUsage(COMPUTESHADER);
+	wiLua::SSetLongLong(L, (long long)resources->GetMemoryUsage());
+	wiLua::SSetLongLong(L, (long long)textures);
+	wiLua::SSetLongLong(L, (long long)sounds);
+	wiLua::SSetLongLong(L, (long long)shaders);
+	return 4;
+}
+int wiResourceManager_BindLua::SetMemoryBudget(lua_State *L)
+{
+	if (resources == nullptr)
+	{
+		wiLua::SError(L, "SetMemoryBudget(int bytes) resources is empty!");
+		return 0;
+	}
+	int argc = wiLua::SGetArgCount(L);
+	if (argc > 0)
+	{
+		resources->SetMemoryBudget((size_t)std::max(0ll, wiLua::SGetLongLong(L, 1)));
+	}
+	else
+	{
+		wiLua::SError(L, "SetMemoryBudget(int bytes) not enough arguments!");
+	}
+	return 0;
+}
+int wiResourceManager_BindLua::GetMemoryBudget(lua_State *L)
+{
+	if (resources == nullptr)
+	{
+		wiLua::SError(L, "GetMemoryBudget() resources is empty!");
+		return 0;
+	}
+	wiLua::SSetLongLong(L, (long long)resources->GetMemoryBudget());
+	return 1;
+}
+
+int CookTexture(lua_State* L)
+{
+	int argc = wiLua::SGetArgCount(L);
+	if (argc > 0)
+	{
+		wiTextureCooker::CookParams params;
+		string fileName = wiLua::SGetString(L, 1);
+		if (argc > 1)
+		{
+			params.format = (wiTextureCooker::FORMAT)wiLua::SGetInt(L, 2);
+			if (argc > 2)
+			{
+				params.srgb = wiLua::SGetBool(L, 3);
+			}
+		}
+		wiLua::SSetBool(L, wiTextureCooker::Cook(fileName, params) != wiTextureCooker::RESULT_FAILED);
+		return 1;
+	}
+	else
+	{
+		wiLua::SError(L, "CookTexture(string fileName, opt int format, opt bool srgb) not enough arguments!");
+	}
+	return 0;
+}
+
+int MountPackage(lua_State* L)
+{
+	int argc = wiLua::SGetArgCount(L);
+	if (argc > 0)
+	{
+		string packageFileName = wiLua::SGetString(L, 1);
+		string mountPoint;
+		if (argc > 1)
+		{
+			mountPoint = wiLua::SGetString(L, 2);
+		}
+		wiLua::SSetBool(L, wiVirtualFileSystem::Mount(packageFileName, mountPoint));
+		return 1;
+	}
+	else
+	{
+		wiLua::SError(L, "MountPackage(string packageFileName, opt string mountPoint) not enough arguments!");
+	}
+	return 0;
+}
+int UnmountPackage(lua_State* L)
+{
+	int argc = wiLua::SGetArgCount(L);
+	if (argc > 0)
+	{
+		wiVirtualFileSystem::Unmount(wiLua::SGetString(L, 1));
+	}
+	else
+	{
+		wiLua::SError(L, "UnmountPackage(string packageFileName) not enough arguments!");
+	}
+	return 0;
+}
+int CreatePackage(lua_State* L)
+{
+	int argc = wiLua::SGetArgCount(L);
+	if (argc > 1)
+	{
+		string packageFileName = wiLua::SGetString(L, 1);
+		string directory = wiLua::SGetString(L, 2);
+		bool compress = true;
+		if (argc > 2)
+		{
+			compress = wiLua::SGetBool(L, 3);
+		}
+
+		vector<string> files;
+		vector<string> directoryFiles;
+		wiHelper::GetFilesInDirectory(directoryFiles, directory);
+		for (auto& x : directoryFiles)
+		{
+			// Directories and other packages are not stored:
+			if (wiHelper::toUpper(wiHelper::GetExtensionFromFileName(x)) != "WIPAK" && wiHelper::FileExists(x))
+			{
+				files.push_back(x);
+			}
+		}
+
+		wiLua::SSetBool(L, wiVirtualFileSystem::CreatePackage(packageFileName, files, directory, compress));
+		return 1;
+	}
+	else
+	{
+		wiLua::SError(L, "CreatePackage(string packageFileName, string directory, opt bool compress) not enough arguments!");
+	}
+	return 0;
+}
+int GetIOStatistics(lua_State* L)
+{
+	const wiVirtualFileSystem::IOStatistics statistics = wiVirtualFileSystem::GetIOStatistics();
+	wiLua::SSetLongLong(L, (long long)statistics.fileOpens);
+	wiLua::SSetLongLong(L, (long long)statistics.packageReads);
+	wiLua::SSetLongLong(L, (long long)statistics.bytesRead);
+	return 3;
+}
+
 void wiResourceManager_BindLua::Bind()
 {
 	static bool initialized = false;
@@ -139,6 +294,20 @@ void wiResourceManager_BindLua::Bind()
 		Texture_BindLua::Bind();
 		Luna<wiResourceManager_BindLua>::Register(wiLua::GetGlobal()->GetLuaState());
 		wiLua::GetGlobal()->RegisterObject(className, "globalResources", new wiResourceManager_BindLua(&wiResourceManager::GetGlobal()));
+
+		wiLua::GetGlobal()->RegisterFunc("CookTexture", CookTexture);
+		wiLua::GetGlobal()->RunText("COOK_FORMAT_AUTO = 0");
+		wiLua::GetGlobal()->RunText("COOK_FORMAT_RGBA8 = 1");
+		wiLua::GetGlobal()->RunText("COOK_FORMAT_BC1 = 2");
+		wiLua::GetGlobal()->RunText("COOK_FORMAT_BC3 = 3");
+		wiLua::GetGlobal()->RunText("COOK_FORMAT_BC4 = 4");
+		wiLua::GetGlobal()->RunText("COOK_FORMAT_BC5 = 5");
+		wiLua::GetGlobal()->RunText("COOK_FORMAT_BC7 = 6");
+
+		wiLua::GetGlobal()->RegisterFunc("MountPackage", MountPackage);
+		wiLua::GetGlobal()->RegisterFunc("UnmountPackage", UnmountPackage);
+		wiLua::GetGlobal()->RegisterFunc("CreatePackage", CreatePackage);
+		wiLua::GetGlobal()->RegisterFunc("GetIOStatistics", GetIOStatistics);
 		initialized = true;
 	}
 }
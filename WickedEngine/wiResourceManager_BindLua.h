@@ -22,6 +22,9 @@ public:
 	int Add(lua_State *L);
 	int Del(lua_State *L);
 	int List(lua_State *L);
+	int GetMemoryUsage(lua_State *L);
+	int SetMemoryBudget(lua_State *L);
+	int GetMemoryBudget(lua_State *L);
 
 	static void Bind();
 };
@@ -7,9 +7,14 @@
 #include "wiRenderer.h"
 #include "wiJobSystem.h"
 #include "wiSpinlock.h"
+#include "wiMeshOptimizer.h"
+#include "wiBackLog.h"
+#include "wiVirtualFileSystem.h"
+#include "wiProfiler.h"
 
 #include <functional>
 #include <unordered_map>
+#include <sstream>
 
 #include <DirectXCollision.h>
 
@@ -275,6 +280,25 @@ namespace wiSceneSystem
 		}
 		return wiTextureHelper::getWhite();
 	}
+	void MaterialComponent::ReleaseTextures()
+	{
+		ReleaseTexture(baseColorMap, baseColorMapResource);
+		ReleaseTexture(surfaceMap, surfaceMapResource);
+		ReleaseTexture(normalMap, normalMapResource);
+		ReleaseTexture(displacementMap, displacementMapResource);
+		ReleaseTexture(emissiveMap, emissiveMapResource);
+		ReleaseTexture(occlusionMap, occlusionMapResource);
+	}
+	void MaterialComponent::ReleaseTexture(const Texture2D*& texture, wiHashString& resource)
+	{
+		// If the texture couldn't be loaded, the resource manager has no reference to release:
+		if (texture != nullptr && resource != wiHashString())
+		{
+			wiResourceManager::GetGlobal().del(resource);
+		}
+		texture = nullptr;
+		resource = wiHashString();
+	}
 	ShaderMaterial MaterialComponent::CreateShaderMaterial() const
 	{
 		ShaderMaterial retVal;
@@ -363,15 +387,18 @@ namespace wiSceneSystem
 		{
 			std::vector<uint8_t> vertex_subsetindices(vertex_positions.size());
 
-			uint32_t subsetCounter = 0;
-			for (auto& subset : subsets)
+			// LOD levels are referencing the same vertices as LOD0, so only LOD0 subsets are considered:
+			uint32_t first_subset = 0;
+			uint32_t last_subset = 0;
+			GetLODSubsetRange(0, first_subset, last_subset);
+			for (uint32_t subsetIndex = first_subset; subsetIndex < last_subset; ++subsetIndex)
 			{
+				const MeshSubset& subset = subsets[subsetIndex];
 				for (uint32_t i = 0; i < subset.indexCount; ++i)
 				{
 					uint32_t index = indices[subset.indexOffset + i];
-					vertex_subsetindices[index] = subsetCounter;
+					vertex_subsetindices[index] = subsetIndex;
 				}
-				subsetCounter++;
 			}
 
 			std::vector<Vertex_POS> vertices(vertex_positions.size());
@@ -544,163 +571,271 @@ namespace wiSceneSystem
 		vertexBuffer_PRE.release();
 
 	}
-	void MeshComponent::ComputeNormals(bool smooth)
+	template<typename T>
+	static void RemapVertexStream(std::vector<T>& stream, const std::vector<uint32_t>& remap, size_t vertexCount)
+	{
+		if (stream.empty())
+		{
+			return;
+		}
+		std::vector<T> result(vertexCount);
+		for (size_t i = 0; i < std::min(stream.size(), remap.size()); ++i)
+		{
+			if (remap[i] != ~0u)
+			{
+				result[remap[i]] = stream[i];
+			}
+		}
+		stream.swap(result);
+	}
+	template<typename T>
+	static inline void DuplicateVertex(std::vector<T>& stream, uint32_t vertex)
 	{
+		if (vertex < stream.size())
+		{
+			stream.push_back(stream[vertex]);
+		}
+	}
+	template<typename T>
+	static inline void HashVertex(size_t& seed, const std::vector<T>& stream, uint32_t vertex)
+	{
+		if (vertex < stream.size())
+		{
+			const uint32_t* bits = (const uint32_t*)&stream[vertex];
+			for (size_t i = 0; i < sizeof(T) / sizeof(uint32_t); ++i)
+			{
+				seed ^= (size_t)bits[i] + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+			}
+		}
+	}
+	template<typename T>
+	static inline bool CompareVertex(const std::vector<T>& stream, uint32_t a, uint32_t b)
+	{
+		return stream.size() <= std::max(a, b) || memcmp(&stream[a], &stream[b], sizeof(T)) == 0;
+	}
+	void MeshComponent::ComputeNormals(bool smooth, float smoothingAngle)
+	{
+		meshlets.clear(); // meshlet bounds are no longer valid
+
 		// Start recalculating normals:
 
 		if (smooth)
 		{
 			// Compute smooth surface normals:
 
-			// 1.) Zero normals, they will be averaged later
-			for (size_t i = 0; i < vertex_normals.size(); i++)
-			{
-				vertex_normals[i] = XMFLOAT3(0, 0, 0);
-			}
+			vertex_normals.resize(vertex_positions.size());
 
-			// 2.) Find identical vertices by POSITION, accumulate face normals
-			for (size_t i = 0; i < vertex_positions.size(); i++)
+			// 1.) Gather the faces of LOD0, LOD levels are referencing the same vertices so they will be using the same normals:
+			std::vector<uint32_t> faces;
+			uint32_t first_subset = 0;
+			uint32_t last_subset = 0;
+			GetLODSubsetRange(0, first_subset, last_subset);
+			for (uint32_t subsetIndex = first_subset; subsetIndex < last_subset; ++subsetIndex)
 			{
-				XMFLOAT3& v_search_pos = vertex_positions[i];
-
-				for (size_t ind = 0; ind < indices.size() / 3; ++ind)
+				const MeshSubset& subset = subsets[subsetIndex];
+				for (uint32_t i = 0; i < subset.indexCount / 3; ++i)
 				{
-					uint32_t i0 = indices[ind * 3 + 0];
-					uint32_t i1 = indices[ind * 3 + 1];
-					uint32_t i2 = indices[ind * 3 + 2];
-
-					XMFLOAT3& v0 = vertex_positions[i0];
-					XMFLOAT3& v1 = vertex_positions[i1];
-					XMFLOAT3& v2 = vertex_positions[i2];
-
-					bool match_pos0 =
-						fabs(v_search_pos.x - v0.x) < FLT_EPSILON &&
-						fabs(v_search_pos.y - v0.y) < FLT_EPSILON &&
-						fabs(v_search_pos.z - v0.z) < FLT_EPSILON;
-
-					bool match_pos1 =
-						fabs(v_search_pos.x - v1.x) < FLT_EPSILON &&
-						fabs(v_search_pos.y - v1.y) < FLT_EPSILON &&
-						fabs(v_search_pos.z - v1.z) < FLT_EPSILON;
-
-					bool match_pos2 =
-						fabs(v_search_pos.x - v2.x) < FLT_EPSILON &&
-						fabs(v_search_pos.y - v2.y) < FLT_EPSILON &&
-						fabs(v_search_pos.z - v2.z) < FLT_EPSILON;
-
-					if (match_pos0 || match_pos1 || match_pos2)
-					{
-						XMVECTOR U = XMLoadFloat3(&v2) - XMLoadFloat3(&v0);
-						XMVECTOR V = XMLoadFloat3(&v1) - XMLoadFloat3(&v0);
+					faces.push_back(subset.indexOffset + i * 3);
+				}
+			}
+			const uint32_t faceCount = (uint32_t)faces.size();
 
-						XMVECTOR N = XMVector3Cross(U, V);
-						N = XMVector3Normalize(N);
+			// 2.) Find identical vertices by POSITION with a spatial hash:
+			std::vector<uint32_t> weld;
+			wiMeshOptimizer::WeldPositions(vertex_positions.data(), vertex_positions.size(), weld, FLT_EPSILON);
 
-						XMFLOAT3 normal;
-						XMStoreFloat3(&normal, N);
+			// 3.) Compute face normals and corner angles in parallel, angles will be the weights of the face normals:
+			std::vector<XMFLOAT3> faceNormals(faceCount);
+			std::vector<float> cornerAngles(faceCount * 3);
+			wiJobSystem::context ctx;
+			wiJobSystem::Dispatch(ctx, faceCount, 1024, [&](wiJobDispatchArgs args) {
+				const uint32_t face = args.jobIndex;
+				const uint32_t i0 = indices[faces[face] + 0];
+				const uint32_t i1 = indices[faces[face] + 1];
+				const uint32_t i2 = indices[faces[face] + 2];
 
-						vertex_normals[i].x += normal.x;
-						vertex_normals[i].y += normal.y;
-						vertex_normals[i].z += normal.z;
-					}
+				const XMVECTOR P0 = XMLoadFloat3(&vertex_positions[i0]);
+				const XMVECTOR P1 = XMLoadFloat3(&vertex_positions[i1]);
+				const XMVECTOR P2 = XMLoadFloat3(&vertex_positions[i2]);
 
+				const XMVECTOR U = P2 - P0;
+				const XMVECTOR V = P1 - P0;
+
+				XMVECTOR N = XMVector3Cross(U, V);
+				N = XMVector3Normalize(N);
+				XMStoreFloat3(&faceNormals[face], N);
+
+				const XMVECTOR E01 = XMVector3Normalize(P1 - P0);
+				const XMVECTOR E12 = XMVector3Normalize(P2 - P1);
+				const XMVECTOR E20 = XMVector3Normalize(P0 - P2);
+				cornerAngles[face * 3 + 0] = XMVectorGetX(XMVector3AngleBetweenNormals(E01, -E20));
+				cornerAngles[face * 3 + 1] = XMVectorGetX(XMVector3AngleBetweenNormals(E12, -E01));
+				cornerAngles[face * 3 + 2] = XMVectorGetX(XMVector3AngleBetweenNormals(E20, -E12));
+			});
+
+			// 4.) Build the list of face corners around every welded vertex:
+			std::vector<uint32_t> cornerOffsets(vertex_positions.size() + 1, 0);
+			for (uint32_t face = 0; face < faceCount; ++face)
+			{
+				for (uint32_t i = 0; i < 3; ++i)
+				{
+					cornerOffsets[weld[indices[faces[face] + i]] + 1]++;
 				}
 			}
-
-			// 3.) Find duplicated vertices by POSITION and UV0 and UV1 and ATLAS and SUBSET and remove them:
-			for (auto& subset : subsets)
+			for (size_t i = 1; i < cornerOffsets.size(); ++i)
+			{
+				cornerOffsets[i] += cornerOffsets[i - 1];
+			}
+			std::vector<uint32_t> vertexCorners(faceCount * 3);
 			{
-				for (uint32_t i = 0; i < subset.indexCount - 1; i++)
+				std::vector<uint32_t> cursor(cornerOffsets.begin(), cornerOffsets.end() - 1);
+				for (uint32_t face = 0; face < faceCount; ++face)
 				{
-					uint32_t ind0 = indices[subset.indexOffset + (uint32_t)i];
-					const XMFLOAT3& p0 = vertex_positions[ind0];
-					const XMFLOAT3& n0 = vertex_normals[ind0];
-					const XMFLOAT2& u00 = vertex_uvset_0.empty() ? XMFLOAT2(0, 0) : vertex_uvset_0[ind0];
-					const XMFLOAT2& u10 = vertex_uvset_1.empty() ? XMFLOAT2(0, 0) : vertex_uvset_1[ind0];
-					const XMFLOAT2& at0 = vertex_atlas.empty() ? XMFLOAT2(0, 0) : vertex_atlas[ind0];
-
-					for (uint32_t j = i + 1; j < subset.indexCount; j++)
+					for (uint32_t i = 0; i < 3; ++i)
 					{
-						uint32_t ind1 = indices[subset.indexOffset + (uint32_t)j];
-
-						if (ind1 == ind0)
-						{
-							continue;
-						}
-
-						const XMFLOAT3& p1 = vertex_positions[ind1];
-						const XMFLOAT3& n1 = vertex_normals[ind1];
-						const XMFLOAT2& u01 = vertex_uvset_0.empty() ? XMFLOAT2(0, 0) : vertex_uvset_0[ind1];
-						const XMFLOAT2& u11 = vertex_uvset_1.empty() ? XMFLOAT2(0, 0) : vertex_uvset_1[ind1];
-						const XMFLOAT2& at1 = vertex_atlas.empty() ? XMFLOAT2(0, 0) : vertex_atlas[ind1];
-
-						const bool duplicated_pos =
-							fabs(p0.x - p1.x) < FLT_EPSILON &&
-							fabs(p0.y - p1.y) < FLT_EPSILON &&
-							fabs(p0.z - p1.z) < FLT_EPSILON;
-
-						const bool duplicated_uv0 =
-							fabs(u00.x - u01.x) < FLT_EPSILON &&
-							fabs(u00.y - u01.y) < FLT_EPSILON;
-
-						const bool duplicated_uv1 =
-							fabs(u10.x - u11.x) < FLT_EPSILON &&
-							fabs(u10.y - u11.y) < FLT_EPSILON;
-
-						const bool duplicated_atl =
-							fabs(at0.x - at1.x) < FLT_EPSILON &&
-							fabs(at0.y - at1.y) < FLT_EPSILON;
-
-						if (duplicated_pos && duplicated_uv0 && duplicated_uv1 && duplicated_atl)
-						{
-							// Erase vertices[ind1] because it is a duplicate:
-							if (ind1 < vertex_positions.size())
-							{
-								vertex_positions.erase(vertex_positions.begin() + ind1);
-							}
-							if (ind1 < vertex_normals.size())
-							{
-								vertex_normals.erase(vertex_normals.begin() + ind1);
-							}
-							if (ind1 < vertex_uvset_0.size())
-							{
-								vertex_uvset_0.erase(vertex_uvset_0.begin() + ind1);
-							}
-							if (ind1 < vertex_uvset_1.size())
-							{
-								vertex_uvset_1.erase(vertex_uvset_1.begin() + ind1);
-							}
-							if (ind1 < vertex_atlas.size())
-							{
-								vertex_atlas.erase(vertex_atlas.begin() + ind1);
-							}
-							if (ind1 < vertex_boneindices.size())
-							{
-								vertex_boneindices.erase(vertex_boneindices.begin() + ind1);
-							}
-							if (ind1 < vertex_boneweights.size())
-							{
-								vertex_boneweights.erase(vertex_boneweights.begin() + ind1);
-							}
-
-							// The vertices[ind1] was removed, so each index after that needs to be updated:
-							for (auto& index : indices)
-							{
-								if (index > ind1 && index > 0)
-								{
-									index--;
-								}
-								else if (index == ind1)
-								{
-									index = ind0;
-								}
-							}
+						vertexCorners[cursor[weld[indices[faces[face] + i]]]++] = face * 3 + i;
+					}
+				}
+			}
+			wiJobSystem::Wait(ctx);
+
+			// 5.) Accumulate the weighted face normals around every corner in parallel. Faces that are at a larger angle
+			//	than smoothingAngle to the corner's face are not accumulated, so they will be separated by a hard edge:
+			const bool hardEdges = smoothingAngle < XM_PI;
+			const float hardEdgeThreshold = cosf(smoothingAngle);
+			std::vector<XMFLOAT3> cornerNormals(faceCount * 3);
+			wiJobSystem::Dispatch(ctx, faceCount * 3, 1024, [&](wiJobDispatchArgs args) {
+				const uint32_t corner = args.jobIndex;
+				const uint32_t face = corner / 3;
+				const uint32_t welded = weld[indices[faces[face] + corner % 3]];
+				const XMVECTOR faceNormal = XMLoadFloat3(&faceNormals[face]);
+
+				XMVECTOR N = XMVectorZero();
+				for (uint32_t i = cornerOffsets[welded]; i < cornerOffsets[welded + 1]; ++i)
+				{
+					const uint32_t neighbor = vertexCorners[i];
+					const XMVECTOR neighborNormal = XMLoadFloat3(&faceNormals[neighbor / 3]);
+					if (hardEdges && XMVectorGetX(XMVector3Dot(faceNormal, neighborNormal)) < hardEdgeThreshold)
+					{
+						continue;
+					}
+					N += neighborNormal * cornerAngles[neighbor];
+				}
+				N = XMVector3Normalize(N);
+				XMStoreFloat3(&cornerNormals[corner], N);
+			});
+			wiJobSystem::Wait(ctx);
+
+			// 6.) Write the normals to the vertices, a vertex will be duplicated when its corners have different normals:
+			std::vector<uint8_t> written(vertex_positions.size(), 0);
+			std::vector<uint32_t> duplicates(vertex_positions.size(), ~0u); // next duplicate of a vertex
+			for (uint32_t corner = 0; corner < faceCount * 3; ++corner)
+			{
+				uint32_t& index = indices[faces[corner / 3] + corner % 3];
+				const XMFLOAT3& normal = cornerNormals[corner];
 
-						}
+				if (!written[index])
+				{
+					vertex_normals[index] = normal;
+					written[index] = 1;
+					continue;
+				}
 
+				uint32_t vertex = index;
+				while (memcmp(&vertex_normals[vertex], &normal, sizeof(XMFLOAT3)) != 0)
+				{
+					if (duplicates[vertex] == ~0u)
+					{
+						const uint32_t duplicate = (uint32_t)vertex_positions.size();
+						DuplicateVertex(vertex_positions, index);
+						DuplicateVertex(vertex_normals, index);
+						DuplicateVertex(vertex_uvset_0, index);
+						DuplicateVertex(vertex_uvset_1, index);
+						DuplicateVertex(vertex_boneindices, index);
+						DuplicateVertex(vertex_boneweights, index);
+						DuplicateVertex(vertex_atlas, index);
+						DuplicateVertex(vertex_colors, index);
+						vertex_normals[duplicate] = normal;
+						duplicates[vertex] = duplicate;
+						duplicates.push_back(~0u);
+						written.push_back(1);
 					}
+					vertex = duplicates[vertex];
 				}
+				index = vertex;
+			}
 
+			// 7.) Find duplicated vertices by every vertex attribute and SUBSET with hashing and remove them
+			//	(vertices of different subsets are not merged, because every vertex stores the index of its subset):
+			std::vector<uint32_t> vertexSubsets(vertex_positions.size(), ~0u);
+			for (uint32_t subsetIndex = first_subset; subsetIndex < last_subset; ++subsetIndex)
+			{
+				const MeshSubset& subset = subsets[subsetIndex];
+				for (uint32_t i = 0; i < subset.indexCount; ++i)
+				{
+					vertexSubsets[indices[subset.indexOffset + i]] = subsetIndex;
+				}
+			}
+			struct VertexHasher
+			{
+				const MeshComponent* mesh;
+				const std::vector<uint32_t>* subsets;
+				inline size_t operator()(uint32_t vertex) const
+				{
+					size_t seed = 0;
+					HashVertex(seed, *subsets, vertex);
+					HashVertex(seed, mesh->vertex_positions, vertex);
+					HashVertex(seed, mesh->vertex_normals, vertex);
+					HashVertex(seed, mesh->vertex_uvset_0, vertex);
+					HashVertex(seed, mesh->vertex_uvset_1, vertex);
+					HashVertex(seed, mesh->vertex_atlas, vertex);
+					return seed;
+				}
+			};
+			struct VertexEqual
+			{
+				const MeshComponent* mesh;
+				const std::vector<uint32_t>* subsets;
+				inline bool operator()(uint32_t a, uint32_t b) const
+				{
+					return
+						CompareVertex(*subsets, a, b) &&
+						CompareVertex(mesh->vertex_positions, a, b) &&
+						CompareVertex(mesh->vertex_normals, a, b) &&
+						CompareVertex(mesh->vertex_uvset_0, a, b) &&
+						CompareVertex(mesh->vertex_uvset_1, a, b) &&
+						CompareVertex(mesh->vertex_boneindices, a, b) &&
+						CompareVertex(mesh->vertex_boneweights, a, b) &&
+						CompareVertex(mesh->vertex_atlas, a, b) &&
+						CompareVertex(mesh->vertex_colors, a, b);
+				}
+			};
+			std::unordered_map<uint32_t, uint32_t, VertexHasher, VertexEqual> lookup(vertex_positions.size(), VertexHasher{ this, &vertexSubsets }, VertexEqual{ this, &vertexSubsets });
+			std::vector<uint32_t> remap(vertex_positions.size());
+			uint32_t vertexCount = 0;
+			for (uint32_t i = 0; i < (uint32_t)vertex_positions.size(); ++i)
+			{
+				auto it = lookup.insert(std::make_pair(i, vertexCount));
+				remap[i] = it.first->second;
+				if (it.second)
+				{
+					vertexCount++;
+				}
+			}
+			if (vertexCount < vertex_positions.size())
+			{
+				for (auto& index : indices)
+				{
+					index = remap[index];
+				}
+				RemapVertexStream(vertex_positions, remap, vertexCount);
+				RemapVertexStream(vertex_normals, remap, vertexCount);
+				RemapVertexStream(vertex_uvset_0, remap, vertexCount);
+				RemapVertexStream(vertex_uvset_1, remap, vertexCount);
+				RemapVertexStream(vertex_boneindices, remap, vertexCount);
+				RemapVertexStream(vertex_boneweights, remap, vertexCount);
+				RemapVertexStream(vertex_atlas, remap, vertexCount);
+				RemapVertexStream(vertex_colors, remap, vertexCount);
 			}
 
 		}
@@ -808,6 +943,8 @@ namespace wiSceneSystem
 	}
 	void MeshComponent::FlipCulling()
 	{
+		meshlets.clear(); // meshlet bounds are no longer valid
+
 		for (size_t face = 0; face < indices.size() / 3; face++)
 		{
 			uint32_t i0 = indices[face * 3 + 0];
@@ -834,6 +971,8 @@ namespace wiSceneSystem
 	}
 	void MeshComponent::Recenter()
 	{
+		meshlets.clear(); // meshlet bounds are no longer valid
+
 		XMFLOAT3 center = aabb.getCenter();
 
 		for (auto& pos : vertex_positions)
@@ -847,6 +986,8 @@ namespace wiSceneSystem
 	}
 	void MeshComponent::RecenterToBottom()
 	{
+		meshlets.clear(); // meshlet bounds are no longer valid
+
 		XMFLOAT3 center = aabb.getCenter();
 		center.y -= aabb.getHalfWidth().y;
 
@@ -860,6 +1001,196 @@ namespace wiSceneSystem
 		CreateRenderData();
 	}
 
+	void MeshComponent::CreateLODs(uint32_t lodCount, float reduction, float maxError)
+	{
+		lodCount = std::max(1u, std::min(lodCount, 16u)); // RenderBatch stores the LOD on 4 bits
+		reduction = wiMath::Clamp(reduction, 0.01f, 0.99f);
+
+		meshlets.clear(); // meshlet ranges are no longer valid
+
+		// Remove previous LOD levels, and rebuild LOD0 indices in subset order:
+		uint32_t first_subset = 0;
+		uint32_t last_subset = 0;
+		GetLODSubsetRange(0, first_subset, last_subset);
+		std::vector<MeshSubset> lod0_subsets(subsets.begin() + first_subset, subsets.begin() + last_subset);
+		std::vector<uint32_t> lod0_indices;
+		for (auto& subset : lod0_subsets)
+		{
+			const uint32_t indexOffset = (uint32_t)lod0_indices.size();
+			lod0_indices.insert(lod0_indices.end(), indices.begin() + subset.indexOffset, indices.begin() + subset.indexOffset + subset.indexCount);
+			subset.indexOffset = indexOffset;
+		}
+		indices = lod0_indices;
+		subsets = lod0_subsets;
+		subsets_per_lod = lodCount > 1 ? (uint32_t)subsets.size() : 0;
+
+		std::stringstream ss;
+		ss << "MeshComponent::CreateLODs: LOD0: " << indices.size() / 3 << " triangles";
+
+		for (uint32_t lod = 1; lod < lodCount; ++lod)
+		{
+			const float targetRatio = powf(reduction, (float)lod);
+			size_t triangleCount = 0;
+			float error = 0;
+			for (size_t i = 0; i < lod0_subsets.size(); ++i)
+			{
+				const MeshSubset& lod0_subset = lod0_subsets[i];
+				std::vector<uint32_t> lod_indices(lod0_indices.begin() + lod0_subset.indexOffset, lod0_indices.begin() + lod0_subset.indexOffset + lod0_subset.indexCount);
+				const size_t targetIndexCount = (size_t)(lod0_subset.indexCount * targetRatio) / 3 * 3;
+				error = std::max(error, wiMeshOptimizer::Simplify(lod_indices, vertex_positions.data(), vertex_positions.size(), targetIndexCount, maxError));
+
+				MeshSubset subset = lod0_subset;
+				subset.indexOffset = (uint32_t)indices.size();
+				subset.indexCount = (uint32_t)lod_indices.size();
+				indices.insert(indices.end(), lod_indices.begin(), lod_indices.end());
+				subsets.push_back(subset);
+				triangleCount += lod_indices.size() / 3;
+			}
+			ss << ", LOD" << lod << ": " << triangleCount << " triangles (error: " << error << ")";
+		}
+
+		wiBackLog::post(ss.str().c_str());
+
+		CreateRenderData();
+	}
+
+	void MeshComponent::Optimize(SoftBodyPhysicsComponent* softbody, bool createRenderData)
+	{
+		if (indices.empty() || vertex_positions.empty())
+		{
+			return;
+		}
+
+		meshlets.clear(); // meshlet ranges are no longer valid
+
+		const wiMeshOptimizer::VertexCacheStatistics before = wiMeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), vertex_positions.size());
+
+		for (auto& subset : subsets)
+		{
+			wiMeshOptimizer::OptimizeVertexCache(&indices[subset.indexOffset], subset.indexCount, vertex_positions.size());
+			wiMeshOptimizer::OptimizeOverdraw(&indices[subset.indexOffset], subset.indexCount, vertex_positions.data(), vertex_positions.size());
+		}
+
+		std::vector<uint32_t> remap;
+		const size_t vertexCount = wiMeshOptimizer::OptimizeVertexFetch(indices.data(), indices.size(), vertex_positions.size(), remap);
+		RemapVertexStream(vertex_positions, remap, vertexCount);
+		RemapVertexStream(vertex_normals, remap, vertexCount);
+		RemapVertexStream(vertex_uvset_0, remap, vertexCount);
+		RemapVertexStream(vertex_uvset_1, remap, vertexCount);
+		RemapVertexStream(vertex_boneindices, remap, vertexCount);
+		RemapVertexStream(vertex_boneweights, remap, vertexCount);
+		RemapVertexStream(vertex_atlas, remap, vertexCount);
+		RemapVertexStream(vertex_colors, remap, vertexCount);
+
+		if (softbody != nullptr)
+		{
+			RemapVertexStream(softbody->restPose, remap, vertexCount);
+		}
+		if (softbody != nullptr && !softbody->physicsToGraphicsVertexMapping.empty())
+		{
+			RemapVertexStream(softbody->graphicsToPhysicsVertexMapping, remap, vertexCount);
+
+			// Physics vertices that lost all of their graphics vertices are removed, the weights of the remaining ones are kept:
+			std::vector<uint32_t> physicsRemap(softbody->physicsToGraphicsVertexMapping.size(), ~0u);
+			std::vector<uint32_t> physicsToGraphicsVertexMapping;
+			std::vector<float> weights;
+			for (size_t i = 0; i < softbody->graphicsToPhysicsVertexMapping.size(); ++i)
+			{
+				uint32_t& physicsInd = softbody->graphicsToPhysicsVertexMapping[i];
+				if (physicsRemap[physicsInd] == ~0u)
+				{
+					physicsRemap[physicsInd] = (uint32_t)physicsToGraphicsVertexMapping.size();
+					physicsToGraphicsVertexMapping.push_back((uint32_t)i);
+					weights.push_back(softbody->weights[physicsInd]);
+				}
+				physicsInd = physicsRemap[physicsInd];
+			}
+			softbody->physicsToGraphicsVertexMapping = std::move(physicsToGraphicsVertexMapping);
+			softbody->weights = std::move(weights);
+
+			// The physics engine will recreate the soft body from the new mappings:
+			softbody->physicsobject = nullptr;
+		}
+
+		const wiMeshOptimizer::VertexCacheStatistics after = wiMeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), vertex_positions.size());
+
+		std::stringstream ss;
+		ss << "MeshComponent::Optimize: ACMR: " << before.ACMR << " -> " << after.ACMR << ", ATVR: " << before.ATVR << " -> " << after.ATVR;
+		ss << ", vertices: " << remap.size() << " -> " << vertexCount;
+		wiBackLog::post(ss.str().c_str());
+
+		if (createRenderData)
+		{
+			CreateRenderData();
+		}
+	}
+
+	void MeshComponent::CreateMeshlets(bool createRenderData)
+	{
+		meshlets.clear();
+
+		std::vector<wiMeshOptimizer::Meshlet> subsetMeshlets;
+		for (uint32_t subsetIndex = 0; subsetIndex < (uint32_t)subsets.size(); ++subsetIndex)
+		{
+			const MeshSubset& subset = subsets[subsetIndex];
+			wiMeshOptimizer::BuildMeshlets(&indices[subset.indexOffset], subset.indexCount, vertex_positions.data(), vertex_positions.size(), subsetMeshlets);
+
+			for (auto& x : subsetMeshlets)
+			{
+				Meshlet meshlet;
+				meshlet.subsetIndex = subsetIndex;
+				meshlet.indexOffset = subset.indexOffset + x.indexOffset;
+				meshlet.triangleCount = x.triangleCount;
+				meshlet.vertexCount = x.vertexCount;
+				meshlet.center = x.center;
+				meshlet.radius = x.radius;
+				meshlet.coneAxis = x.coneAxis;
+				meshlet.coneCutoff = x.coneCutoff;
+				meshlets.push_back(meshlet);
+			}
+		}
+
+		if (createRenderData)
+		{
+			CreateRenderData();
+		}
+	}
+	uint32_t MeshComponent::CullMeshlets(const Frustum& frustum, const XMFLOAT3& eye, const XMFLOAT4X4& world, uint8_t* visibility) const
+	{
+		const XMMATRIX W = XMLoadFloat4x4(&world);
+
+		// Backface culling is done in local space, where the normal cones are valid even with non-uniform scaling:
+		XMFLOAT3 eye_local;
+		XMStoreFloat3(&eye_local, XMVector3Transform(XMLoadFloat3(&eye), XMMatrixInverse(nullptr, W)));
+		const bool backfaceCulling = !IsDoubleSided();
+
+		// Bounding spheres are transformed to world space for frustum culling:
+		const float scale = std::max(XMVectorGetX(XMVector3Length(W.r[0])), std::max(XMVectorGetX(XMVector3Length(W.r[1])), XMVectorGetX(XMVector3Length(W.r[2]))));
+
+		uint32_t visibleCount = 0;
+		for (size_t i = 0; i < meshlets.size(); ++i)
+		{
+			const Meshlet& meshlet = meshlets[i];
+
+			bool visible = true;
+			if (backfaceCulling)
+			{
+				const XMVECTOR V = XMLoadFloat3(&meshlet.center) - XMLoadFloat3(&eye_local);
+				visible = XMVectorGetX(XMVector3Dot(V, XMLoadFloat3(&meshlet.coneAxis))) < meshlet.coneCutoff * XMVectorGetX(XMVector3Length(V)) + meshlet.radius;
+			}
+			if (visible)
+			{
+				XMFLOAT3 center;
+				XMStoreFloat3(&center, XMVector3Transform(XMLoadFloat3(&meshlet.center), W));
+				visible = frustum.CheckSphere(center, meshlet.radius * scale);
+			}
+
+			visibility[i] = visible ? 1 : 0;
+			visibleCount += visibility[i];
+		}
+		return visibleCount;
+	}
+
 	void ObjectComponent::ClearLightmap()
 	{
 		lightmapWidth = 0;
@@ -1034,6 +1365,8 @@ namespace wiSceneSystem
 
 	void Scene::Update(float dt)
 	{
+		WI_PROFILE_SCOPE("Scene Update");
+
 		wiJobSystem::context ctx;
 
 		RunPreviousFrameTransformUpdateSystem(ctx, transforms, prev_transforms);
@@ -1083,6 +1416,10 @@ namespace wiSceneSystem
 		transforms.Clear();
 		prev_transforms.Clear();
 		hierarchy.Clear();
+		for (size_t i = 0; i < materials.GetCount(); ++i)
+		{
+			materials[i].ReleaseTextures();
+		}
 		materials.Clear();
 		meshes.Clear();
 		impostors.Clear();
@@ -1104,6 +1441,8 @@ namespace wiSceneSystem
 		hairs.Clear();
 		weathers.Clear();
 		sounds.Clear();
+
+		deferredSections.clear();
 	}
 	void Scene::Merge(Scene& other)
 	{
@@ -1134,6 +1473,9 @@ namespace wiSceneSystem
 		weathers.Merge(other.weathers);
 		sounds.Merge(other.sounds);
 
+		deferredSections.insert(deferredSections.end(), other.deferredSections.begin(), other.deferredSections.end());
+		other.deferredSections.clear();
+
 		bounds = AABB::Merge(bounds, other.bounds);
 	}
 
@@ -1145,6 +1487,11 @@ namespace wiSceneSystem
 		layers.Remove(entity);
 		transforms.Remove(entity);
 		prev_transforms.Remove(entity);
+		MaterialComponent* material = materials.GetComponent(entity);
+		if (material != nullptr)
+		{
+			material->ReleaseTextures();
+		}
 		materials.Remove(entity);
 		meshes.Remove(entity);
 		impostors.Remove(entity);
@@ -1178,18 +1525,185 @@ namespace wiSceneSystem
 		}
 		return INVALID_ENTITY;
 	}
-	Entity Scene::Entity_Duplicate(Entity entity)
+	// Components that contain only plain data are copied directly:
+	template<typename T>
+	static void CopyComponent(const T& source, T& dest)
+	{
+		dest = source;
+	}
+	// The object owns the GPU lightmap, so only the serialized attributes are copied, the rest is recreated for the clone:
+	static void CopyComponent(const ObjectComponent& source, ObjectComponent& dest)
+	{
+		dest._flags = source._flags;
+		dest.meshID = source.meshID;
+		dest.cascadeMask = source.cascadeMask;
+		dest.rendertypeMask = source.rendertypeMask;
+		dest.color = source.color;
+		dest.lightmapWidth = source.lightmapWidth;
+		dest.lightmapHeight = source.lightmapHeight;
+		dest.lightmapTextureData = source.lightmapTextureData;
+		dest.userStencilRef = source.userStencilRef;
+	}
+	// The mesh vectors are copied directly, the GPU buffers are created for the clone after this:
+	static void CopyComponent(const MeshComponent& source, MeshComponent& dest)
+	{
+		dest._flags = source._flags;
+		dest.vertex_positions = source.vertex_positions;
+		dest.vertex_normals = source.vertex_normals;
+		dest.vertex_uvset_0 = source.vertex_uvset_0;
+		dest.vertex_uvset_1 = source.vertex_uvset_1;
+		dest.vertex_boneindices = source.vertex_boneindices;
+		dest.vertex_boneweights = source.vertex_boneweights;
+		dest.vertex_atlas = source.vertex_atlas;
+		dest.vertex_colors = source.vertex_colors;
+		dest.indices = source.indices;
+		dest.subsets = source.subsets;
+		dest.tessellationFactor = source.tessellationFactor;
+		dest.armatureID = source.armatureID;
+		dest.subsets_per_lod = source.subsets_per_lod;
+		dest.meshlets = source.meshlets;
+		dest.aabb = source.aabb;
+	}
+	// Copy the component of an entity for every clone
+	template<typename T>
+	static void DuplicateComponent(ComponentManager<T>& manager, Entity entity, const Entity* clones, size_t count)
+	{
+		const size_t index = manager.GetIndex(entity);
+		if (index == ~0ull)
+		{
+			return;
+		}
+		if (count > 1)
+		{
+			manager.Reserve(manager.GetCount() + count);
+		}
+		for (size_t i = 0; i < count; ++i)
+		{
+			// The clone is created first, so the source component is not referenced while the containers grow:
+			T& clone = manager.Create(clones[i]);
+			CopyComponent(manager[index], clone);
+		}
+	}
+	// Components that own resources (GPU buffers, textures, physics objects, etc.) are copied by serialization
+	//	The component is written once, then it is read for every clone, so the resources are created for them
+	template<typename T>
+	static void DuplicateComponent_Serialized(ComponentManager<T>& manager, Entity entity, const Entity* clones, size_t count)
 	{
+		const size_t index = manager.GetIndex(entity);
+		if (index == ~0ull)
+		{
+			return;
+		}
 		wiArchive archive;
+		manager[index].Serialize(archive);
+		archive.SetReadModeAndResetPos(true);
+		const size_t start = archive.GetPos();
 
-		// First write the entity to staging area:
-		archive.SetReadModeAndResetPos(false);
-		Entity_Serialize(archive, entity, 0);
+		if (count > 1)
+		{
+			manager.Reserve(manager.GetCount() + count);
+		}
+		for (size_t i = 0; i < count; ++i)
+		{
+			archive.Jump(start);
+			manager.Create(clones[i]).Serialize(archive);
+		}
+	}
+	Entity Scene::Entity_Duplicate(Entity entity)
+	{
+		std::vector<Entity> clones;
+		Entity_Duplicate(entity, 1, clones);
+		return clones.back();
+	}
+	void Scene::Entity_Duplicate(Entity entity, size_t count, std::vector<Entity>& clones)
+	{
+		const size_t first = clones.size();
+		for (size_t i = 0; i < count; ++i)
+		{
+			clones.push_back(CreateEntity());
+		}
+		const Entity* newEntities = clones.data() + first;
+
+		// Entity references inside the components are kept, so the clones will share the same meshes, materials, parents, etc.
+		//	Only the references to the source entity itself are remapped to the clones after copying
+		DuplicateComponent(names, entity, newEntities, count);
+		DuplicateComponent(layers, entity, newEntities, count);
+		DuplicateComponent(transforms, entity, newEntities, count);
+		DuplicateComponent(prev_transforms, entity, newEntities, count);
+		DuplicateComponent(hierarchy, entity, newEntities, count);
+		DuplicateComponent_Serialized(materials, entity, newEntities, count);
+		DuplicateComponent(meshes, entity, newEntities, count);
+		DuplicateComponent(impostors, entity, newEntities, count);
+		DuplicateComponent(objects, entity, newEntities, count);
+		DuplicateComponent(aabb_objects, entity, newEntities, count);
+		DuplicateComponent_Serialized(rigidbodies, entity, newEntities, count);
+		DuplicateComponent_Serialized(softbodies, entity, newEntities, count);
+		DuplicateComponent_Serialized(armatures, entity, newEntities, count);
+		DuplicateComponent_Serialized(lights, entity, newEntities, count);
+		DuplicateComponent(aabb_lights, entity, newEntities, count);
+		DuplicateComponent(cameras, entity, newEntities, count);
+		DuplicateComponent_Serialized(probes, entity, newEntities, count);
+		DuplicateComponent(aabb_probes, entity, newEntities, count);
+		DuplicateComponent(forces, entity, newEntities, count);
+		DuplicateComponent_Serialized(decals, entity, newEntities, count);
+		DuplicateComponent(aabb_decals, entity, newEntities, count);
+		DuplicateComponent(animations, entity, newEntities, count);
+		DuplicateComponent_Serialized(emitters, entity, newEntities, count);
+		DuplicateComponent_Serialized(hairs, entity, newEntities, count);
+		DuplicateComponent(weathers, entity, newEntities, count);
+		DuplicateComponent_Serialized(sounds, entity, newEntities, count);
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			const Entity clone = newEntities[i];
 
-		// Then deserialize with a unique seed:
-		archive.SetReadModeAndResetPos(true);
-		uint32_t seed = wiRandom::getRandom(1, INT_MAX);
-		return Entity_Serialize(archive, entity, seed, false);
+			ObjectComponent* object = objects.GetComponent(clone);
+			if (object != nullptr && object->meshID == entity)
+			{
+				object->meshID = clone;
+			}
+
+			MeshComponent* mesh = meshes.GetComponent(clone);
+			if (mesh != nullptr)
+			{
+				for (auto& subset : mesh->subsets)
+				{
+					if (subset.materialID == entity)
+					{
+						subset.materialID = clone;
+					}
+				}
+				if (mesh->armatureID == entity)
+				{
+					mesh->armatureID = clone;
+				}
+				mesh->CreateRenderData();
+			}
+
+			wiEmittedParticle* emitter = emitters.GetComponent(clone);
+			if (emitter != nullptr && emitter->meshID == entity)
+			{
+				emitter->meshID = clone;
+			}
+
+			wiHairParticle* hair = hairs.GetComponent(clone);
+			if (hair != nullptr && hair->meshID == entity)
+			{
+				hair->meshID = clone;
+			}
+
+			AnimationComponent* animation = animations.GetComponent(clone);
+			if (animation != nullptr)
+			{
+				for (auto& channel : animation->channels)
+				{
+					if (channel.target == entity)
+					{
+						channel.target = clone;
+					}
+				}
+			}
+		}
 	}
 	Entity Scene::Entity_CreateMaterial(
 		const std::string& name
@@ -1329,12 +1843,14 @@ namespace wiSceneSystem
 		if (!textureName.empty())
 		{
 			material.baseColorMapName = textureName;
-			material.baseColorMap = (Texture2D*)wiResourceManager::GetGlobal().add(material.baseColorMapName);
+			material.baseColorMapResource = material.baseColorMapName;
+			material.baseColorMap = (Texture2D*)wiResourceManager::GetGlobal().add(material.baseColorMapResource);
 		}
 		if (!normalMapName.empty())
 		{
 			material.normalMapName = normalMapName;
-			material.normalMap = (Texture2D*)wiResourceManager::GetGlobal().add(material.normalMapName);
+			material.normalMapResource = material.normalMapName;
+			material.normalMap = (Texture2D*)wiResourceManager::GetGlobal().add(material.normalMapResource);
 		}
 
 		return entity;
@@ -1838,6 +2354,8 @@ namespace wiSceneSystem
 						// We need sometimes the center of the instance bounding box, not the transform position (which can be outside the bounding box)
 						object.center = *((XMFLOAT3*)&meshMatrix._41);
 
+						object.lodCount = mesh->GetLODCount();
+
 						if (mesh->IsSkinned() || mesh->IsDynamic())
 						{
 							object.SetDynamic(true);
@@ -2183,21 +2701,45 @@ namespace wiSceneSystem
 
 
 
-	Entity LoadModel(const std::string& fileName, const XMMATRIX& transformMatrix, bool attached)
+	Entity LoadModel(const std::string& fileName, const XMMATRIX& transformMatrix, bool attached, const Scene::SectionLoadingCallback& sectionLoading)
 	{
 		Scene scene;
-		Entity root = LoadModel(scene, fileName, transformMatrix, attached);
+		Entity root = LoadModel(scene, fileName, transformMatrix, attached, sectionLoading);
 		GetScene().Merge(scene);
 		return root;
 	}
 
-	Entity LoadModel(Scene& scene, const std::string& fileName, const XMMATRIX& transformMatrix, bool attached)
+	// The optional task receives the progress, and the loading is stopped if the task is cancelled
+	static Entity LoadModel_Internal(Scene& scene, const std::string& fileName, const XMMATRIX& transformMatrix, bool attached, const Scene::SectionLoadingCallback& sectionLoading, LoadModelTask* task)
 	{
+		const wiVirtualFileSystem::IOStatistics statistics = wiVirtualFileSystem::GetIOStatistics();
+
 		wiArchive archive(fileName, true);
 		if (archive.IsOpen())
 		{
+			if (task != nullptr)
+			{
+				task->progress.store(0.1f);
+				if (task->IsCancelled())
+				{
+					return INVALID_ENTITY;
+				}
+			}
+
 			// Serialize it from file:
-			scene.Serialize(archive);
+			scene.Serialize(archive, sectionLoading);
+
+			// The file data is not needed anymore, release it before the scene update:
+			archive.Close();
+
+			if (task != nullptr)
+			{
+				task->progress.store(0.8f);
+				if (task->IsCancelled())
+				{
+					return INVALID_ENTITY;
+				}
+			}
 
 			// First, create new root:
 			Entity root = CreateEntity();
@@ -2230,11 +2772,76 @@ namespace wiSceneSystem
 				root = INVALID_ENTITY;
 			}
 
+			// Report the file accesses of the level loading (the asynchronous loads that are still running are not included):
+			const wiVirtualFileSystem::IOStatistics statisticsAfter = wiVirtualFileSystem::GetIOStatistics();
+			std::stringstream ss;
+			ss << "Loaded " << fileName << ": " << statisticsAfter.fileOpens - statistics.fileOpens << " file opens, ";
+			ss << statisticsAfter.packageReads - statistics.packageReads << " package reads, ";
+			ss << (statisticsAfter.bytesRead - statistics.bytesRead) / 1024 << " KB read";
+			wiBackLog::post(ss.str().c_str());
+
 			return root;
 		}
 
 		return INVALID_ENTITY;
 	}
+	Entity LoadModel(Scene& scene, const std::string& fileName, const XMMATRIX& transformMatrix, bool attached, const Scene::SectionLoadingCallback& sectionLoading)
+	{
+		return LoadModel_Internal(scene, fileName, transformMatrix, attached, sectionLoading, nullptr);
+	}
+
+	wiSpinLock loadModelTasksLock;
+	std::vector<std::shared_ptr<LoadModelTask>> loadModelTasks; // waiting to be merged into the global scene
+	std::shared_ptr<LoadModelTask> LoadModelAsync(const std::string& fileName, const XMMATRIX& transformMatrix, bool attached, const Scene::SectionLoadingCallback& sectionLoading)
+	{
+		std::shared_ptr<LoadModelTask> task = std::make_shared<LoadModelTask>();
+
+		loadModelTasksLock.lock();
+		loadModelTasks.push_back(task);
+		loadModelTasksLock.unlock();
+
+		XMFLOAT4X4 transform;
+		XMStoreFloat4x4(&transform, transformMatrix);
+
+		// A background job can't be picked up by the main thread while it waits for its own per-frame jobs,
+		//	and the jobs that are started by the loading (section loading, scene update) are background jobs too:
+		wiJobSystem::ExecuteBackground(task->ctx, [task, fileName, transform, attached, sectionLoading] {
+			task->root = LoadModel_Internal(task->scene, fileName, XMLoadFloat4x4(&transform), attached, sectionLoading, task.get());
+			if (task->IsCancelled())
+			{
+				task->scene.Clear();
+			}
+			else
+			{
+				task->progress.store(1.0f);
+			}
+			task->finished.store(true);
+		});
+
+		return task;
+	}
+	void MergeLoadedModels()
+	{
+		loadModelTasksLock.lock();
+		for (size_t i = 0; i < loadModelTasks.size();)
+		{
+			std::shared_ptr<LoadModelTask>& task = loadModelTasks[i];
+			if (task->IsFinished())
+			{
+				if (!task->IsCancelled())
+				{
+					GetScene().Merge(task->scene);
+					task->merged.store(true);
+				}
+				loadModelTasks.erase(loadModelTasks.begin() + i);
+			}
+			else
+			{
+				i++;
+			}
+		}
+		loadModelTasksLock.unlock();
+	}
 
 	PickResult Pick(const RAY& ray, UINT renderTypeMask, uint32_t layerMask, const Scene& scene)
 	{
@@ -2281,8 +2888,12 @@ namespace wiSceneSystem
 				const ArmatureComponent* armature = mesh.IsSkinned() ? scene.armatures.GetComponent(mesh.armatureID) : nullptr;
 
 				int subsetCounter = 0;
-				for (auto& subset : mesh.subsets)
+				uint32_t first_subset = 0;
+				uint32_t last_subset = 0;
+				mesh.GetLODSubsetRange(0, first_subset, last_subset);
+				for (uint32_t subsetIndex = first_subset; subsetIndex < last_subset; ++subsetIndex)
 				{
+					const MeshComponent::MeshSubset& subset = mesh.subsets[subsetIndex];
 					for (size_t i = 0; i < subset.indexCount; i += 3)
 					{
 						const uint32_t i0 = mesh.indices[subset.indexOffset + i + 0];
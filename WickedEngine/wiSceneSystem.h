@@ -8,12 +8,16 @@
 #include "wiJobSystem.h"
 #include "wiAudio.h"
 #include "wiRenderer.h"
+#include "wiHashString.h"
 
 #include "wiECS.h"
 #include "wiSceneSystem_Decl.h"
 
 #include <string>
 #include <vector>
+#include <functional>
+#include <memory>
+#include <atomic>
 
 class wiArchive;
 
@@ -157,6 +161,13 @@ namespace wiSceneSystem
 		const wiGraphics::Texture2D* displacementMap = nullptr;
 		const wiGraphics::Texture2D* emissiveMap = nullptr;
 		const wiGraphics::Texture2D* occlusionMap = nullptr;
+		// The names that the textures were requested with from the global resource manager, so their references can be released:
+		wiHashString baseColorMapResource;
+		wiHashString surfaceMapResource;
+		wiHashString normalMapResource;
+		wiHashString displacementMapResource;
+		wiHashString emissiveMapResource;
+		wiHashString occlusionMapResource;
 		std::unique_ptr<wiGraphics::GPUBuffer> constantBuffer;
 
 		int customShaderID = -1; // for now, this is not serialized; need to consider actual proper use case first
@@ -179,6 +190,12 @@ namespace wiSceneSystem
 		const wiGraphics::Texture2D* GetEmissiveMap() const;
 		const wiGraphics::Texture2D* GetOcclusionMap() const;
 
+		// Release the references of the textures to the global resource manager, this must be called before the material is removed or replaced
+		//	Without it, the textures can't be destroyed or evicted by the memory budget
+		void ReleaseTextures();
+		// Release the reference of one texture to the global resource manager
+		static void ReleaseTexture(const wiGraphics::Texture2D*& texture, wiHashString& resource);
+
 		inline float GetOpacity() const { return baseColor.w; }
 		inline float GetEmissiveStrength() const { return emissiveColor.w; }
 		inline int GetCustomShaderID() const { return customShaderID; }
@@ -235,6 +252,8 @@ namespace wiSceneSystem
 		void Serialize(wiArchive& archive, uint32_t seed = 0);
 	};
 
+	struct SoftBodyPhysicsComponent;
+
 	struct MeshComponent
 	{
 		enum FLAGS
@@ -267,6 +286,25 @@ namespace wiSceneSystem
 		float tessellationFactor = 0.0f;
 		wiECS::Entity armatureID = wiECS::INVALID_ENTITY;
 
+		// Subsets are laid out by LOD levels: [LOD0 subsets][LOD1 subsets]...
+		//	If this is zero, then there are no LOD levels and all subsets belong to LOD0
+		uint32_t subsets_per_lod = 0;
+
+		// Meshlets are clusters of at most 64 vertices and 124 triangles, with bounds for culling (optional)
+		//	Every meshlet is a contiguous range of indices inside a subset
+		struct Meshlet
+		{
+			uint32_t subsetIndex = 0;
+			uint32_t indexOffset = 0;
+			uint32_t triangleCount = 0;
+			uint32_t vertexCount = 0;
+			XMFLOAT3 center = XMFLOAT3(0, 0, 0);
+			float radius = 0;
+			XMFLOAT3 coneAxis = XMFLOAT3(0, 0, 1);
+			float coneCutoff = 1;
+		};
+		std::vector<Meshlet>		meshlets;
+
 		// Non-serialized attributes:
 		AABB aabb;
 		std::unique_ptr<wiGraphics::GPUBuffer>	indexBuffer;
@@ -291,14 +329,49 @@ namespace wiSceneSystem
 		inline float GetTessellationFactor() const { return tessellationFactor; }
 		inline wiGraphics::INDEXBUFFER_FORMAT GetIndexFormat() const { return vertex_positions.size() > 65535 ? wiGraphics::INDEXFORMAT_32BIT : wiGraphics::INDEXFORMAT_16BIT; }
 		inline bool IsSkinned() const { return armatureID != wiECS::INVALID_ENTITY; }
+		inline uint32_t GetLODCount() const { return subsets_per_lod == 0 ? 1 : ((uint32_t)subsets.size() / subsets_per_lod); }
+		inline void GetLODSubsetRange(uint32_t lod, uint32_t& first_subset, uint32_t& last_subset) const
+		{
+			first_subset = 0;
+			last_subset = (uint32_t)subsets.size();
+			if (subsets_per_lod > 0)
+			{
+				first_subset = subsets_per_lod * lod;
+				last_subset = first_subset + subsets_per_lod;
+			}
+		}
+		// LOD0 indices are placed before the other LOD levels in the index buffer, this is the number of LOD0 indices:
+		inline uint32_t GetLOD0IndexCount() const { return GetLODCount() > 1 ? subsets[subsets_per_lod].indexOffset : (uint32_t)indices.size(); }
 
 		void CreateRenderData();
-		void ComputeNormals(bool smooth);
+		// Generate simplified LOD levels for every subset (LOD0 is the original mesh, and previous LOD levels are replaced)
+		//	lodCount	: total number of LOD levels, including LOD0
+		//	reduction	: the triangle count of each LOD level relative to the previous level
+		//	maxError	: simplification of a LOD level stops when the error relative to the mesh extents would exceed this
+		void CreateLODs(uint32_t lodCount, float reduction = 0.5f, float maxError = 0.05f);
+		// Reorder triangles for vertex cache efficiency and less overdraw inside every subset, then reorder vertices for fetch locality
+		//	Unreferenced vertices are removed. The ACMR and ATVR before and after the optimization are posted to the backlog
+		//	softbody			: the soft body of this mesh (if any), its vertex mappings and rest pose are remapped and its physics object is recreated
+		//	createRenderData	: if false, the GPU buffers are not recreated, so CreateRenderData() must be called after further processing
+		void Optimize(SoftBodyPhysicsComponent* softbody = nullptr, bool createRenderData = true);
+		// Split every subset into meshlets, this reorders triangles inside the subsets
+		//	Functions that modify the geometry will remove the meshlets, so this should be called after those
+		//	Meshlets are not culled for skinned, dynamic and soft body meshes, because their bounds are computed from the static vertex positions
+		//	createRenderData	: if false, the GPU buffers are not recreated, so CreateRenderData() must be called after further processing
+		void CreateMeshlets(bool createRenderData = true);
+		// Cull meshlets against a world space frustum and eye position (backfacing meshlets are culled unless the mesh is double sided)
+		//	visibility	: output array with one element per meshlet, it will be 1 if the meshlet is visible, 0 otherwise
+		//	returns the number of visible meshlets
+		uint32_t CullMeshlets(const Frustum& frustum, const XMFLOAT3& eye, const XMFLOAT4X4& world, uint8_t* visibility) const;
+		// Recompute vertex normals. Smooth normals are averaged across faces that share vertex positions
+		//	smoothingAngle	: faces at a larger angle (in radians) than this will be separated by hard edges, vertices will be duplicated along them
+		void ComputeNormals(bool smooth, float smoothingAngle = XM_PI);
 		void FlipCulling();
 		void FlipNormals();
 		void Recenter();
 		void RecenterToBottom();
 
+		// Reading doesn't create the render data (the scene creates it in parallel for all the loaded meshes)
 		void Serialize(wiArchive& archive, uint32_t seed = 0);
 
 
@@ -453,6 +526,7 @@ namespace wiSceneSystem
 			IMPOSTOR_PLACEMENT = 1 << 3,
 			REQUEST_PLANAR_REFLECTION = 1 << 4,
 			LIGHTMAP_RENDER_REQUEST = 1 << 5,
+			OCCLUDER = 1 << 6,
 		};
 		uint32_t _flags = RENDERABLE | CAST_SHADOW;
 
@@ -481,6 +555,10 @@ namespace wiSceneSystem
 		int transform_index = -1;
 		int prev_transform_index = -1;
 
+		// LOD level selected for the main camera by the culling (only valid for a single frame):
+		uint32_t lod = 0;
+		uint32_t lodCount = 1;
+
 		// occlusion result history bitfield (32 bit->32 frame history)
 		uint32_t occlusionHistory = ~0;
 		// occlusion query pool index
@@ -501,6 +579,8 @@ namespace wiSceneSystem
 		inline void SetImpostorPlacement(bool value) { if (value) { _flags |= IMPOSTOR_PLACEMENT; } else { _flags &= ~IMPOSTOR_PLACEMENT; } }
 		inline void SetRequestPlanarReflection(bool value) { if (value) { _flags |= REQUEST_PLANAR_REFLECTION; } else { _flags &= ~REQUEST_PLANAR_REFLECTION; } }
 		inline void SetLightmapRenderRequest(bool value) { if (value) { _flags |= LIGHTMAP_RENDER_REQUEST; } else { _flags &= ~LIGHTMAP_RENDER_REQUEST; } }
+		// Occluder objects' meshes will be rasterized by the CPU occlusion culling, they should be simple and opaque
+		inline void SetOccluder(bool value) { if (value) { _flags |= OCCLUDER; } else { _flags &= ~OCCLUDER; } }
 
 		inline bool IsRenderable() const { return _flags & RENDERABLE; }
 		inline bool IsCastingShadow() const { return _flags & CAST_SHADOW; }
@@ -508,6 +588,7 @@ namespace wiSceneSystem
 		inline bool IsImpostorPlacement() const { return _flags & IMPOSTOR_PLACEMENT; }
 		inline bool IsRequestPlanarReflection() const { return _flags & REQUEST_PLANAR_REFLECTION; }
 		inline bool IsLightmapRenderRequested() const { return _flags & LIGHTMAP_RENDER_REQUEST; }
+		inline bool IsOccluder() const { return _flags & OCCLUDER; }
 
 		inline float GetTransparency() const { return 1 - color.w; }
 		inline uint32_t GetRenderTypes() const { return rendertypeMask; }
@@ -990,6 +1071,14 @@ namespace wiSceneSystem
 		void Serialize(wiArchive& archive, uint32_t seed = 0);
 	};
 
+	// Content hashes of all components of a scene at a point in time, used to find out which components were changed since then
+	//	The hashes are in the order of Scene::GetComponentManagers()
+	struct SceneSnapshot
+	{
+		std::vector<std::unordered_map<wiECS::Entity, uint64_t>> hashes;
+		uint64_t baseSize = 0; // the size of the scene archive that the snapshot was taken of
+	};
+
 	struct Scene
 	{
 		wiECS::ComponentManager<NameComponent> names;
@@ -1024,6 +1113,45 @@ namespace wiSceneSystem
 		XMFLOAT4 waterPlane = XMFLOAT4(0, 1, 0, 0);
 		WeatherComponent weather;
 
+		// Since archive version 35, the scene is serialized in sections. Every component manager is a separate section,
+		//	named the same as the component manager (for example "meshes"), and large data blobs that are not required
+		//	for the scene to work are separate sections too ("lightmaps"). The scene archive begins with a table of contents
+		//	(name, version, offset and size of each section), so that sections can be skipped or loaded later independently.
+		enum SECTION_LOADING
+		{
+			SECTION_LOAD,	// load the section immediately
+			SECTION_SKIP,	// don't load the section
+			SECTION_DEFER,	// don't load the section now, but remember where it is, so it can be loaded by LoadDeferredSections()
+		};
+		// Decides how to load a section by its name
+		//	Bounding boxes and previous transforms (for example "aabb_objects", "prev_transforms") are not asked, they are
+		//	loaded in the same way as the components they belong to ("objects", "transforms")
+		typedef std::function<SECTION_LOADING(const std::string& section)> SectionLoadingCallback;
+
+		// Sections that were deferred while loading
+		struct DeferredSection
+		{
+			std::string fileName;
+			std::string name;
+			uint64_t offset = 0;
+			uint64_t size = 0;
+			uint32_t seed = 0;
+		};
+		std::vector<DeferredSection> deferredSections;
+
+		// Returns the component managers with their section names, in the order of serialization
+		std::vector<std::pair<std::string, wiECS::ComponentManager_Interface*>> GetComponentManagers();
+
+		// Delta saving: instead of writing the whole scene, a patch can be written that contains only the components
+		//	that were created, modified or removed since the scene was saved as a base. When the base scene is read from a file,
+		//	its patch file (GetScenePatchFileName()) is applied on top of it automatically. A patch always contains every
+		//	change since the base, so only the latest patch needs to be kept. CompactScene() folds the patch into the base.
+
+		// Take a snapshot of the scene after it was written to the base archive (base must be still open)
+		void CreateSnapshot(SceneSnapshot& snapshot, const wiArchive& base);
+		// Write the components that were created, modified or removed since the snapshot to a patch archive
+		void WritePatch(wiArchive& archive, const SceneSnapshot& snapshot);
+
 		// Update all components by a given timestep (in seconds):
 		void Update(float dt);
 		// Remove everything from the scene that it owns:
@@ -1037,6 +1165,8 @@ namespace wiSceneSystem
 		wiECS::Entity Entity_FindByName(const std::string& name);
 		// Duplicates all of an entity's components and creates a new entity with them:
 		wiECS::Entity Entity_Duplicate(wiECS::Entity entity);
+		// Duplicates all of an entity's components multiple times, the new entities are appended to clones:
+		void Entity_Duplicate(wiECS::Entity entity, size_t count, std::vector<wiECS::Entity>& clones);
 		// Serializes entity and all of its components to archive:
 		//	You can specify entity = INVALID_ENTITY when the entity needs to be created from archive
 		//	You can specify seed = 0 when the archive is guaranteed to be storing persistent and unique entities
@@ -1098,7 +1228,13 @@ namespace wiSceneSystem
 		// Detaches all children from an entity (if there are any):
 		void Component_DetachChildren(wiECS::Entity parent);
 
-		void Serialize(wiArchive& archive);
+		// Read/Write the scene with an archive
+		//	sectionLoading	: in read mode, it decides which sections are loaded (if not specified, everything is loaded)
+		void Serialize(wiArchive& archive, const SectionLoadingCallback& sectionLoading = nullptr);
+		// Load the sections that were deferred while loading. The archive files must not be modified until then
+		//	name	: only load the sections with this name (or every deferred section if empty)
+		//	returns true if anything was loaded
+		bool LoadDeferredSections(const std::string& name = "");
 	};
 
 	void RunPreviousFrameTransformUpdateSystem(
@@ -1210,18 +1346,57 @@ namespace wiSceneSystem
 	//	fileName		:	file path
 	//	transformMatrix	:	everything will be transformed by this matrix (optional)
 	//	attached		:	everything will be attached to a base entity
+	//	sectionLoading	:	decides which parts of the scene are loaded (optional, see Scene::SECTION_LOADING)
 	//
 	//	returns INVALID_ENTITY if attached argument was false, else it returns the base entity handle
-	wiECS::Entity LoadModel(const std::string& fileName, const XMMATRIX& transformMatrix = XMMatrixIdentity(), bool attached = false);
+	wiECS::Entity LoadModel(const std::string& fileName, const XMMATRIX& transformMatrix = XMMatrixIdentity(), bool attached = false, const Scene::SectionLoadingCallback& sectionLoading = nullptr);
 
 	// Helper function to open a wiscene file and add the contents to the specified scene. This is thread safe as it doesn't modify global scene
 	//	scene			:	the scene that will contain the model
 	//	fileName		:	file path
 	//	transformMatrix	:	everything will be transformed by this matrix (optional)
 	//	attached		:	everything will be attached to a base entity
+	//	sectionLoading	:	decides which parts of the scene are loaded (optional, see Scene::SECTION_LOADING)
 	//
 	//	returns INVALID_ENTITY if attached argument was false, else it returns the base entity handle
-	wiECS::Entity LoadModel(Scene& scene, const std::string& fileName, const XMMATRIX& transformMatrix = XMMatrixIdentity(), bool attached = false);
+	wiECS::Entity LoadModel(Scene& scene, const std::string& fileName, const XMMATRIX& transformMatrix = XMMatrixIdentity(), bool attached = false, const Scene::SectionLoadingCallback& sectionLoading = nullptr);
+
+	// The file name of the patch that belongs to a scene file (see Scene::WritePatch())
+	inline std::string GetScenePatchFileName(const std::string& fileName) { return fileName + ".patch"; }
+
+	// Fold the patch of a scene file into the scene file, and delete the patch file
+	//	returns false if the scene file couldn't be read or written
+	bool CompactScene(const std::string& fileName);
+
+	// State of a model that is being loaded in the background by LoadModelAsync()
+	struct LoadModelTask
+	{
+		std::atomic<float> progress{ 0 };		// 0: not started yet, 1: loaded and waiting to be merged
+		std::atomic<bool> cancelled{ false };
+		std::atomic<bool> finished{ false };	// loading is finished (or stopped because it was cancelled)
+		std::atomic<bool> merged{ false };		// the model was merged into the global scene
+		wiECS::Entity root = wiECS::INVALID_ENTITY; // valid after loading if the model was loaded as attached
+		Scene scene; // the model is loaded into this scene in the background
+		wiJobSystem::context ctx; // the background job
+
+		float GetProgress() const { return progress.load(); }
+		// The loading is stopped at the next step, and the model will not be merged into the global scene
+		void Cancel() { cancelled.store(true); }
+		bool IsCancelled() const { return cancelled.load(); }
+		bool IsFinished() const { return finished.load(); }
+		bool IsMerged() const { return merged.load(); }
+	};
+	// Helper function to open a wiscene file in the background and add the contents to the global scene when it's finished
+	//	Everything is done by a background job in a separate scene (loading, updating), then the scene is merged
+	//	into the global scene by MergeLoadedModels(), so only the merging is done on the main thread
+	//	The background job and its nested jobs are only executed by the worker threads (wiJobSystem::ExecuteBackground())
+	//	The arguments are the same as for LoadModel()
+	//
+	//	returns the task that can be used to query the progress and cancel the loading
+	std::shared_ptr<LoadModelTask> LoadModelAsync(const std::string& fileName, const XMMATRIX& transformMatrix = XMMatrixIdentity(), bool attached = false, const Scene::SectionLoadingCallback& sectionLoading = nullptr);
+	// Merge the models that were finished loading by LoadModelAsync() into the global scene
+	//	This must be called from the main thread at a frame boundary, it is called by wiRenderer::UpdatePerFrameData()
+	void MergeLoadedModels();
 
 	struct PickResult
 	{
@@ -89,6 +89,101 @@ int LoadModel(lua_State* L)
 	}
 	return 0;
 }
+int LoadModelAsync(lua_State* L)
+{
+	int argc = wiLua::SGetArgCount(L);
+	if (argc > 0)
+	{
+		string fileName = wiLua::SGetString(L, 1);
+		XMMATRIX transform = XMMatrixIdentity();
+		if (argc > 1)
+		{
+			Matrix_BindLua* matrix = Luna<Matrix_BindLua>::lightcheck(L, 2);
+			if (matrix != nullptr)
+			{
+				transform = matrix->matrix;
+			}
+			else
+			{
+				wiLua::SError(L, "LoadModelAsync(string fileName, opt Matrix transform) argument is not a matrix!");
+			}
+		}
+		Luna<LoadModelTask_BindLua>::push(L, new LoadModelTask_BindLua(wiSceneSystem::LoadModelAsync(fileName, transform, true)));
+		return 1;
+	}
+	else
+	{
+		wiLua::SError(L, "LoadModelAsync(string fileName, opt Matrix transform) not enough arguments!");
+	}
+	return 0;
+}
+int CompactScene(lua_State* L)
+{
+	int argc = wiLua::SGetArgCount(L);
+	if (argc > 0)
+	{
+		string fileName = wiLua::SGetString(L, 1);
+		wiLua::SSetBool(L, wiSceneSystem::CompactScene(fileName));
+		return 1;
+	}
+	else
+	{
+		wiLua::SError(L, "CompactScene(string fileName) not enough arguments!");
+	}
+	return 0;
+}
+int OptimizeMeshes(lua_State* L)
+{
+	Scene* scene = &wiSceneSystem::GetScene();
+	int argc = wiLua::SGetArgCount(L);
+	if (argc > 0)
+	{
+		Scene_BindLua* custom_scene = Luna<Scene_BindLua>::lightcheck(L, 1);
+		if (custom_scene)
+		{
+			scene = custom_scene->scene;
+		}
+		else
+		{
+			wiLua::SError(L, "OptimizeMeshes(opt Scene scene) argument is not of type Scene!");
+			return 0;
+		}
+	}
+	for (size_t i = 0; i < scene->meshes.GetCount(); ++i)
+	{
+		scene->meshes[i].Optimize(scene->softbodies.GetComponent(scene->meshes.GetEntity(i)));
+	}
+	return 0;
+}
+int CreateMeshlets(lua_State* L)
+{
+	Scene* scene = &wiSceneSystem::GetScene();
+	int argc = wiLua::SGetArgCount(L);
+	if (argc > 0)
+	{
+		Scene_BindLua* custom_scene = Luna<Scene_BindLua>::lightcheck(L, 1);
+		if (custom_scene)
+		{
+			scene = custom_scene->scene;
+		}
+		else
+		{
+			wiLua::SError(L, "CreateMeshlets(opt Scene scene) argument is not of type Scene!");
+			return 0;
+		}
+	}
+	for (size_t i = 0; i < scene->meshes.GetCount(); ++i)
+	{
+		MeshComponent& mesh = scene->meshes[i];
+		if (mesh.IsSkinned() || mesh.IsDynamic() || scene->softbodies.Contains(scene->meshes.GetEntity(i)))
+		{
+			// These are deformed on the GPU, meshlets are not culled for them
+			continue;
+		}
+		mesh.CreateMeshlets();
+	}
+	return 0;
+}
 int Pick(lua_State* L)
 {
 	int argc = wiLua::SGetArgCount(L);
@@ -167,6 +262,10 @@ void Bind()
 
 		wiLua::GetGlobal()->RegisterFunc("GetScene", GetScene);
 		wiLua::GetGlobal()->RegisterFunc("LoadModel", LoadModel);
+		wiLua::GetGlobal()->RegisterFunc("LoadModelAsync", LoadModelAsync);
+		wiLua::GetGlobal()->RegisterFunc("CompactScene", CompactScene);
+		wiLua::GetGlobal()->RegisterFunc("OptimizeMeshes", OptimizeMeshes);
+		wiLua::GetGlobal()->RegisterFunc("CreateMeshlets", CreateMeshlets);
 		wiLua::GetGlobal()->RegisterFunc("Pick", Pick);
 
 		Luna<Scene_BindLua>::Register(L);
@@ -179,6 +278,7 @@ void Bind()
 		Luna<EmitterComponent_BindLua>::Register(L);
 		Luna<LightComponent_BindLua>::Register(L);
 		Luna<ObjectComponent_BindLua>::Register(L);
+		Luna<LoadModelTask_BindLua>::Register(L);
 	}
 }
 
@@ -1916,10 +2016,12 @@ Luna<ObjectComponent_BindLua>::FunctionType ObjectComponent_BindLua::methods[] =
 	lunamethod(ObjectComponent_BindLua, GetMeshID),
 	lunamethod(ObjectComponent_BindLua, GetColor),
 	lunamethod(ObjectComponent_BindLua, GetUserStencilRef),
+	lunamethod(ObjectComponent_BindLua, IsOccluder),
 
 	lunamethod(ObjectComponent_BindLua, SetMeshID),
 	lunamethod(ObjectComponent_BindLua, SetColor),
 	lunamethod(ObjectComponent_BindLua, SetUserStencilRef),
+	lunamethod(ObjectComponent_BindLua, SetOccluder),
 	{ NULL, NULL }
 };
 Luna<ObjectComponent_BindLua>::PropertyType ObjectComponent_BindLua::properties[] = {
@@ -1955,6 +2057,11 @@ int ObjectComponent_BindLua::GetUserStencilRef(lua_State* L)
 	wiLua::SSetInt(L, (int)component->userStencilRef);
 	return 1;
 }
+int ObjectComponent_BindLua::IsOccluder(lua_State* L)
+{
+	wiLua::SSetBool(L, component->IsOccluder());
+	return 1;
+}
 
 int ObjectComponent_BindLua::SetMeshID(lua_State* L)
 {
@@ -2008,6 +2115,71 @@ int ObjectComponent_BindLua::SetUserStencilRef(lua_State* L)
 
 	return 0;
 }
+int ObjectComponent_BindLua::SetOccluder(lua_State* L)
+{
+	int argc = wiLua::SGetArgCount(L);
+	if (argc > 0)
+	{
+		component->SetOccluder(wiLua::SGetBool(L, 1));
+	}
+	else
+	{
+		wiLua::SError(L, "SetOccluder(bool value) not enough arguments!");
+	}
+
+	return 0;
+}
+
+
+
+
+
+
+
+
+const char LoadModelTask_BindLua::className[] = "LoadModelTask";
+
+Luna<LoadModelTask_BindLua>::FunctionType LoadModelTask_BindLua::methods[] = {
+	lunamethod(LoadModelTask_BindLua, GetProgress),
+	lunamethod(LoadModelTask_BindLua, Cancel),
+	lunamethod(LoadModelTask_BindLua, IsFinished),
+	lunamethod(LoadModelTask_BindLua, IsMerged),
+	lunamethod(LoadModelTask_BindLua, GetRootEntity),
+	{ NULL, NULL }
+};
+Luna<LoadModelTask_BindLua>::PropertyType LoadModelTask_BindLua::properties[] = {
+	{ NULL, NULL }
+};
+
+
+int LoadModelTask_BindLua::GetProgress(lua_State* L)
+{
+	wiLua::SSetFloat(L, task != nullptr ? task->GetProgress() : 0.0f);
+	return 1;
+}
+int LoadModelTask_BindLua::Cancel(lua_State* L)
+{
+	if (task != nullptr)
+	{
+		task->Cancel();
+	}
+	return 0;
+}
+int LoadModelTask_BindLua::IsFinished(lua_State* L)
+{
+	wiLua::SSetBool(L, task != nullptr && task->IsFinished());
+	return 1;
+}
+int LoadModelTask_BindLua::IsMerged(lua_State* L)
+{
+	wiLua::SSetBool(L, task != nullptr && task->IsMerged());
+	return 1;
+}
+int LoadModelTask_BindLua::GetRootEntity(lua_State* L)
+{
+	wiLua::SSetInt(L, task != nullptr && task->IsFinished() ? (int)task->root : (int)INVALID_ENTITY);
+	return 1;
+}
 
 
 }
@@ -3,6 +3,8 @@
 #include "wiLuna.h"
 #include "wiSceneSystem_Decl.h"
 
+#include <memory>
+
 namespace wiSceneSystem_BindLua
 {
 	void Bind();
@@ -273,10 +275,31 @@ namespace wiSceneSystem_BindLua
 		int GetMeshID(lua_State* L);
 		int GetColor(lua_State* L);
 		int GetUserStencilRef(lua_State* L);
+		int IsOccluder(lua_State* L);
 
 		int SetMeshID(lua_State* L);
 		int SetColor(lua_State* L);
 		int SetUserStencilRef(lua_State* L);
+		int SetOccluder(lua_State* L);
+	};
+
+	class LoadModelTask_BindLua
+	{
+	public:
+		std::shared_ptr<wiSceneSystem::LoadModelTask> task;
+
+		static const char className[];
+		static Luna<LoadModelTask_BindLua>::FunctionType methods[];
+		static Luna<LoadModelTask_BindLua>::PropertyType properties[];
+
+		LoadModelTask_BindLua(const std::shared_ptr<wiSceneSystem::LoadModelTask>& task) :task(task) {}
+		LoadModelTask_BindLua(lua_State* L) {}
+
+		int GetProgress(lua_State* L);
+		int Cancel(lua_State* L);
+		int IsFinished(lua_State* L);
+		int IsMerged(lua_State* L);
+		int GetRootEntity(lua_State* L);
 	};
 
 }
@@ -24,6 +24,7 @@ namespace wiSceneSystem
 	struct WeatherComponent;
 	struct SoundComponent;
 	struct Scene;
+	struct LoadModelTask;
 
 	class wiEmittedParticle; // todo: rename
 	class wiHairParticle; // todo: rename
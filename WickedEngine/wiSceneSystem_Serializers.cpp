@@ -3,6 +3,12 @@
 #include "wiArchive.h"
 #include "wiRandom.h"
 #include "wiHelper.h"
+#include "wiBackLog.h"
+#include "wiHashString.h"
+
+#include <memory>
+#include <algorithm>
+#include <cstdio>
 
 using namespace wiECS;
 
@@ -129,29 +135,36 @@ namespace wiSceneSystem
 
 			SetDirty();
 
+			// The textures are loaded in the background, they are placeholders until they are ready:
 			if (!baseColorMapName.empty())
 			{
-				baseColorMap = (wiGraphics::Texture2D*)wiResourceManager::GetGlobal().add(dir + baseColorMapName);
+				baseColorMapResource = dir + baseColorMapName;
+				baseColorMap = (wiGraphics::Texture2D*)wiResourceManager::GetGlobal().addAsync(baseColorMapResource);
 			}
 			if (!surfaceMapName.empty())
 			{
-				surfaceMap = (wiGraphics::Texture2D*)wiResourceManager::GetGlobal().add(dir + surfaceMapName);
+				surfaceMapResource = dir + surfaceMapName;
+				surfaceMap = (wiGraphics::Texture2D*)wiResourceManager::GetGlobal().addAsync(surfaceMapResource);
 			}
 			if (!normalMapName.empty())
 			{
-				normalMap = (wiGraphics::Texture2D*)wiResourceManager::GetGlobal().add(dir + normalMapName);
+				normalMapResource = dir + normalMapName;
+				normalMap = (wiGraphics::Texture2D*)wiResourceManager::GetGlobal().addAsync(normalMapResource, nullptr, wiColor(127, 127, 255, 255));
 			}
 			if (!displacementMapName.empty())
 			{
-				displacementMap = (wiGraphics::Texture2D*)wiResourceManager::GetGlobal().add(dir + displacementMapName);
+				displacementMapResource = dir + displacementMapName;
+				displacementMap = (wiGraphics::Texture2D*)wiResourceManager::GetGlobal().addAsync(displacementMapResource);
 			}
 			if (!emissiveMapName.empty())
 			{
-				emissiveMap = (wiGraphics::Texture2D*)wiResourceManager::GetGlobal().add(dir + emissiveMapName);
+				emissiveMapResource = dir + emissiveMapName;
+				emissiveMap = (wiGraphics::Texture2D*)wiResourceManager::GetGlobal().addAsync(emissiveMapResource);
 			}
 			if (!occlusionMapName.empty())
 			{
-				occlusionMap = (wiGraphics::Texture2D*)wiResourceManager::GetGlobal().add(dir + occlusionMapName);
+				occlusionMapResource = dir + occlusionMapName;
+				occlusionMap = (wiGraphics::Texture2D*)wiResourceManager::GetGlobal().addAsync(occlusionMapResource);
 			}
 
 		}
@@ -275,7 +288,28 @@ namespace wiSceneSystem
 				archive >> vertex_uvset_1;
 			}
 
-			CreateRenderData();
+			if (archive.GetVersion() >= 32)
+			{
+				archive >> subsets_per_lod;
+			}
+
+			if (archive.GetVersion() >= 33)
+			{
+				size_t meshletCount;
+				archive >> meshletCount;
+				meshlets.resize(meshletCount);
+				for (size_t i = 0; i < meshletCount; ++i)
+				{
+					archive >> meshlets[i].subsetIndex;
+					archive >> meshlets[i].indexOffset;
+					archive >> meshlets[i].triangleCount;
+					archive >> meshlets[i].vertexCount;
+					archive >> meshlets[i].center;
+					archive >> meshlets[i].radius;
+					archive >> meshlets[i].coneAxis;
+					archive >> meshlets[i].coneCutoff;
+				}
+			}
 		}
 		else
 		{
@@ -305,6 +339,27 @@ namespace wiSceneSystem
 				archive << vertex_uvset_1;
 			}
 
+			if (archive.GetVersion() >= 32)
+			{
+				archive << subsets_per_lod;
+			}
+
+			if (archive.GetVersion() >= 33)
+			{
+				archive << meshlets.size();
+				for (size_t i = 0; i < meshlets.size(); ++i)
+				{
+					archive << meshlets[i].subsetIndex;
+					archive << meshlets[i].indexOffset;
+					archive << meshlets[i].triangleCount;
+					archive << meshlets[i].vertexCount;
+					archive << meshlets[i].center;
+					archive << meshlets[i].radius;
+					archive << meshlets[i].coneAxis;
+					archive << meshlets[i].coneCutoff;
+				}
+			}
+
 		}
 	}
 	void ImpostorComponent::Serialize(wiArchive& archive, uint32_t seed)
@@ -745,7 +800,135 @@ namespace wiSceneSystem
 		}
 	}
 
-	void Scene::Serialize(wiArchive& archive)
+	std::vector<std::pair<std::string, ComponentManager_Interface*>> Scene::GetComponentManagers()
+	{
+		return {
+			{ "names", &names },
+			{ "layers", &layers },
+			{ "transforms", &transforms },
+			{ "prev_transforms", &prev_transforms },
+			{ "hierarchy", &hierarchy },
+			{ "materials", &materials },
+			{ "meshes", &meshes },
+			{ "impostors", &impostors },
+			{ "objects", &objects },
+			{ "aabb_objects", &aabb_objects },
+			{ "rigidbodies", &rigidbodies },
+			{ "softbodies", &softbodies },
+			{ "armatures", &armatures },
+			{ "lights", &lights },
+			{ "aabb_lights", &aabb_lights },
+			{ "cameras", &cameras },
+			{ "probes", &probes },
+			{ "aabb_probes", &aabb_probes },
+			{ "forces", &forces },
+			{ "decals", &decals },
+			{ "aabb_decals", &aabb_decals },
+			{ "animations", &animations },
+			{ "emitters", &emitters },
+			{ "hairs", &hairs },
+			{ "weathers", &weathers },
+			{ "sounds", &sounds },
+		};
+	}
+
+	// An entry in the table of contents of the scene archive:
+	struct SceneSection
+	{
+		std::string name;
+		uint64_t version = 0;
+		uint64_t offset = 0;
+		uint64_t size = 0;
+	};
+	static void ReadTableOfContents(wiArchive& archive, std::vector<SceneSection>& sections)
+	{
+		size_t count;
+		archive >> count;
+		sections.resize(count);
+		for (auto& section : sections)
+		{
+			archive >> section.name;
+			archive >> section.version;
+			archive >> section.offset;
+			archive >> section.size;
+		}
+	}
+	// Read the string table section if the archive has one, strings in the other sections are read from it
+	static void ReadStringTable(wiArchive& archive, const std::vector<SceneSection>& sections)
+	{
+		for (auto& section : sections)
+		{
+			if (section.name == "strings")
+			{
+				auto stringTable = std::make_shared<wiArchive::StringTable>();
+				archive.Jump((size_t)section.offset);
+				archive >> stringTable->strings;
+				archive.SetStringTable(stringTable);
+				return;
+			}
+		}
+	}
+	// Bounding boxes and previous transforms are loaded in the same way as the components they belong to:
+	static std::string GetSectionOwner(const std::string& name)
+	{
+		if (name.compare(0, 5, "aabb_") == 0)
+		{
+			return name.substr(5);
+		}
+		if (name == "prev_transforms")
+		{
+			return "transforms";
+		}
+		return name;
+	}
+	// Read a section from the current archive position into the scene
+	//	Component managers are replaced by the section contents, the lightmaps are given to the existing objects
+	static void ReadSection(Scene& scene, wiArchive& archive, const std::string& name, uint32_t seed)
+	{
+		if (name == "lightmaps")
+		{
+			size_t count;
+			archive >> count;
+			for (size_t i = 0; i < count; ++i)
+			{
+				Entity entity;
+				SerializeEntity(archive, entity, seed);
+				std::vector<uint8_t> lightmapTextureData;
+				archive >> lightmapTextureData;
+
+				ObjectComponent* object = scene.objects.GetComponent(entity);
+				if (object != nullptr)
+				{
+					object->lightmapTextureData = std::move(lightmapTextureData);
+				}
+			}
+			return;
+		}
+
+		for (auto& x : scene.GetComponentManagers())
+		{
+			if (x.first == name)
+			{
+				x.second->Serialize(archive, seed, true);
+				return;
+			}
+		}
+
+		// Sections that are unknown to this version are ignored
+	}
+	// Create the render data of all meshes in parallel:
+	static void CreateMeshRenderData(Scene& scene)
+	{
+		wiJobSystem::context ctx;
+		wiJobSystem::Dispatch(ctx, (uint32_t)scene.meshes.GetCount(), 1, [&scene](wiJobDispatchArgs args) {
+			scene.meshes[args.jobIndex].CreateRenderData();
+		});
+		wiJobSystem::Wait(ctx);
+	}
+
+	static void ReadPatch(Scene& scene, wiArchive& patch, const wiArchive& base, uint32_t seed, const Scene::SectionLoadingCallback& sectionLoading);
+
+	void Scene::Serialize(wiArchive& archive, const SectionLoadingCallback& sectionLoading)
 	{
 		if (archive.IsReadMode())
 		{
@@ -761,6 +944,191 @@ namespace wiSceneSystem
 		// With this we will ensure that serialized entities are unique and persistent across the scene:
 		uint32_t seed = (uint32_t)wiRandom::getRandom(1, INT_MAX);
 
+		// The patch of a scene file is read after the scene, with the same seed:
+		std::unique_ptr<wiArchive> patch;
+		if (archive.IsReadMode() && !archive.GetSourceFileName().empty())
+		{
+			const std::string patchFileName = GetScenePatchFileName(archive.GetSourceFileName());
+			if (wiHelper::FileExists(patchFileName))
+			{
+				patch.reset(new wiArchive(patchFileName, true));
+			}
+		}
+
+		if (archive.GetVersion() >= 35)
+		{
+			if (archive.IsReadMode())
+			{
+				std::vector<SceneSection> sections;
+				ReadTableOfContents(archive, sections);
+				ReadStringTable(archive, sections);
+
+				// Every section that is loaded gets its own reader, so they can be read in parallel:
+				std::vector<std::pair<const SceneSection*, std::unique_ptr<wiArchive>>> readers;
+				const SceneSection* lightmaps = nullptr;
+
+				size_t end = archive.GetPos();
+				for (auto& section : sections)
+				{
+					end = std::max(end, size_t(section.offset + section.size));
+					if (section.name == "strings")
+					{
+						continue; // it was already read
+					}
+
+					SECTION_LOADING loading = SECTION_LOAD;
+					if (sectionLoading != nullptr)
+					{
+						loading = sectionLoading(GetSectionOwner(section.name));
+					}
+					if (loading == SECTION_DEFER && (archive.GetSourceFileName().empty() || patch != nullptr))
+					{
+						loading = SECTION_LOAD; // only archive files can be opened again later, and the patch must be applied on the whole section
+					}
+
+					switch (loading)
+					{
+					case SECTION_LOAD:
+						if (section.name == "lightmaps")
+						{
+							lightmaps = &section; // they are given to the objects, so they are read after everything else
+						}
+						else
+						{
+							readers.emplace_back(&section, std::unique_ptr<wiArchive>(new wiArchive(archive, (size_t)section.offset)));
+						}
+						break;
+					case SECTION_DEFER:
+					{
+						DeferredSection deferred;
+						deferred.fileName = archive.GetSourceFileName();
+						deferred.name = section.name;
+						deferred.offset = section.offset;
+						deferred.size = section.size;
+						deferred.seed = seed;
+						deferredSections.push_back(deferred);
+					}
+					break;
+					default:
+						break;
+					}
+				}
+
+				wiJobSystem::context ctx;
+				wiJobSystem::Dispatch(ctx, (uint32_t)readers.size(), 1, [&](wiJobDispatchArgs args) {
+					const SceneSection& section = *readers[args.jobIndex].first;
+					ReadSection(*this, *readers[args.jobIndex].second, section.name, seed);
+
+					if (section.name == "meshes")
+					{
+						// The render data is created while the other sections are still being read:
+						wiJobSystem::Dispatch(ctx, (uint32_t)meshes.GetCount(), 1, [this](wiJobDispatchArgs meshArgs) {
+							meshes[meshArgs.jobIndex].CreateRenderData();
+						});
+					}
+				});
+				wiJobSystem::Wait(ctx);
+				readers.clear();
+
+				if (lightmaps != nullptr)
+				{
+					archive.Jump((size_t)lightmaps->offset);
+					ReadSection(*this, archive, lightmaps->name, seed);
+				}
+
+				// Continue after the last section:
+				archive.SetStringTable(nullptr);
+				archive.Jump(end);
+
+				if (patch != nullptr)
+				{
+					ReadPatch(*this, *patch, archive, seed, sectionLoading);
+				}
+			}
+			else
+			{
+				// Nothing should be lost that was not loaded yet:
+				LoadDeferredSections();
+
+				auto componentManagers = GetComponentManagers();
+
+				// The table of contents is written with placeholders for the section locations, they are patched after the sections are written:
+				struct SectionPlaceholders
+				{
+					size_t offset;
+					size_t size;
+				};
+				std::vector<SectionPlaceholders> placeholders;
+				archive << componentManagers.size() + 2; // +2: lightmaps, strings
+				for (auto& x : componentManagers)
+				{
+					archive << x.first;
+					archive << archive.GetVersion();
+					placeholders.push_back({ archive.WritePlaceholder(), archive.WritePlaceholder() });
+				}
+				archive << std::string("lightmaps");
+				archive << archive.GetVersion();
+				placeholders.push_back({ archive.WritePlaceholder(), archive.WritePlaceholder() });
+				archive << std::string("strings");
+				archive << archive.GetVersion();
+				placeholders.push_back({ archive.WritePlaceholder(), archive.WritePlaceholder() });
+
+				// Strings of the sections are collected into the string table section, which is written last:
+				auto stringTable = std::make_shared<wiArchive::StringTable>();
+				archive.SetStringTable(stringTable);
+
+				// The lightmap data has its own section, so it is taken out of the objects while they are written:
+				std::vector<std::vector<uint8_t>> lightmaps(objects.GetCount());
+				for (size_t i = 0; i < objects.GetCount(); ++i)
+				{
+					lightmaps[i].swap(objects[i].lightmapTextureData);
+				}
+
+				for (size_t i = 0; i < componentManagers.size(); ++i)
+				{
+					const size_t offset = archive.GetPos();
+					componentManagers[i].second->Serialize(archive, seed, true);
+					archive.Patch(placeholders[i].offset, offset);
+					archive.Patch(placeholders[i].size, archive.GetPos() - offset);
+				}
+
+				{
+					const size_t offset = archive.GetPos();
+					size_t count = 0;
+					for (auto& x : lightmaps)
+					{
+						count += x.empty() ? 0 : 1;
+					}
+					archive << count;
+					for (size_t i = 0; i < objects.GetCount(); ++i)
+					{
+						if (!lightmaps[i].empty())
+						{
+							Entity entity = objects.GetEntity(i);
+							SerializeEntity(archive, entity, seed);
+							archive << lightmaps[i];
+						}
+					}
+					archive.Patch(placeholders[componentManagers.size()].offset, offset);
+					archive.Patch(placeholders[componentManagers.size()].size, archive.GetPos() - offset);
+				}
+
+				archive.SetStringTable(nullptr);
+				{
+					const size_t offset = archive.GetPos();
+					archive << stringTable->strings;
+					archive.Patch(placeholders.back().offset, offset);
+					archive.Patch(placeholders.back().size, archive.GetPos() - offset);
+				}
+
+				for (size_t i = 0; i < objects.GetCount(); ++i)
+				{
+					lightmaps[i].swap(objects[i].lightmapTextureData);
+				}
+			}
+			return;
+		}
+
 		names.Serialize(archive, seed);
 		layers.Serialize(archive, seed);
 		transforms.Serialize(archive, seed);
@@ -791,6 +1159,333 @@ namespace wiSceneSystem
 			sounds.Serialize(archive, seed);
 		}
 
+		if (archive.IsReadMode())
+		{
+			CreateMeshRenderData(*this);
+
+			if (patch != nullptr)
+			{
+				ReadPatch(*this, *patch, archive, seed, sectionLoading);
+			}
+		}
+	}
+
+	bool Scene::LoadDeferredSections(const std::string& name)
+	{
+		bool loaded = false;
+		std::unique_ptr<wiArchive> archive;
+		std::vector<SceneSection> sections;
+		for (size_t i = 0; i < deferredSections.size();)
+		{
+			if (!name.empty() && deferredSections[i].name != name)
+			{
+				i++;
+				continue;
+			}
+			DeferredSection deferred = std::move(deferredSections[i]);
+			deferredSections.erase(deferredSections.begin() + i);
+
+			// Deferred sections of the same file are next to each other, so the file is only opened again when it changes:
+			if (archive == nullptr || archive->GetSourceFileName() != deferred.fileName)
+			{
+				archive.reset(new wiArchive(deferred.fileName, true));
+				sections.clear();
+				if (archive->IsOpen() && archive->GetVersion() >= 35)
+				{
+					uint32_t reserved;
+					(*archive) >> reserved;
+					ReadTableOfContents(*archive, sections);
+					ReadStringTable(*archive, sections);
+				}
+			}
+
+			// The file could have been changed since it was loaded, so the section must be still the same:
+			bool valid = false;
+			for (auto& section : sections)
+			{
+				if (section.name == deferred.name && section.offset == deferred.offset && section.size == deferred.size)
+				{
+					valid = true;
+					break;
+				}
+			}
+			if (!valid)
+			{
+				wiBackLog::post(("The deferred scene section \"" + deferred.name + "\" can't be loaded from file: " + deferred.fileName).c_str());
+				continue;
+			}
+
+			archive->Jump((size_t)deferred.offset);
+			if (deferred.name == "lightmaps")
+			{
+				ReadSection(*this, *archive, deferred.name, deferred.seed);
+			}
+			else
+			{
+				// Reading a component manager replaces its contents, so it is read separately and merged:
+				Scene scene;
+				ReadSection(scene, *archive, deferred.name, deferred.seed);
+				CreateMeshRenderData(scene);
+				Merge(scene);
+			}
+			loaded = true;
+		}
+		return loaded;
+	}
+
+	// Compute the hash of the serialized data of every component, the component managers are processed in parallel
+	static void ComputeHashes(Scene& scene, std::vector<std::unordered_map<Entity, uint64_t>>& hashes)
+	{
+		auto componentManagers = scene.GetComponentManagers();
+		hashes.clear();
+		hashes.resize(componentManagers.size());
+
+		wiJobSystem::context ctx;
+		wiJobSystem::Dispatch(ctx, (uint32_t)componentManagers.size(), 1, [&](wiJobDispatchArgs args) {
+			ComponentManager_Interface* manager = componentManagers[args.jobIndex].second;
+			auto& result = hashes[args.jobIndex];
+			result.reserve(manager->GetCount());
+
+			wiArchive archive;
+			for (size_t i = 0; i < manager->GetCount(); ++i)
+			{
+				const Entity entity = manager->GetEntity(i);
+				archive.SetReadModeAndResetPos(false);
+				const size_t start = archive.GetPos();
+				manager->SerializeComponent(archive, entity, 0);
+				result[entity] = wiHashString::Hash((const char*)archive.GetData() + start, archive.GetPos() - start);
+			}
+		});
+		wiJobSystem::Wait(ctx);
+	}
+
+	void Scene::CreateSnapshot(SceneSnapshot& snapshot, const wiArchive& base)
+	{
+		ComputeHashes(*this, snapshot.hashes);
+		snapshot.baseSize = base.GetPos();
+	}
+
+	// The patch archive contains the size of the base scene archive, then a section for every changed component manager:
+	//	name, end offset, whole flag and either the whole component manager, or the removed entities and the changed components
+	//	The hierarchy is always written whole, because the parents must stay before their children
+	void Scene::WritePatch(wiArchive& archive, const SceneSnapshot& snapshot)
+	{
+		// Nothing should be lost that was not loaded yet:
+		LoadDeferredSections();
+
+		auto componentManagers = GetComponentManagers();
+		assert(snapshot.hashes.size() == componentManagers.size());
+
+		std::vector<std::unordered_map<Entity, uint64_t>> hashes;
+		ComputeHashes(*this, hashes);
+
+		struct PatchSection
+		{
+			std::vector<Entity> removed;
+			std::vector<Entity> changed;
+		};
+		std::vector<PatchSection> sections(componentManagers.size());
+		size_t sectionCount = 0;
+		for (size_t i = 0; i < componentManagers.size(); ++i)
+		{
+			ComponentManager_Interface* manager = componentManagers[i].second;
+			const auto& base = snapshot.hashes[i];
+			PatchSection& section = sections[i];
+
+			for (auto& x : base)
+			{
+				if (!manager->Contains(x.first))
+				{
+					section.removed.push_back(x.first);
+				}
+			}
+			std::sort(section.removed.begin(), section.removed.end());
+
+			// The changed components are written in the order of the component manager:
+			for (size_t j = 0; j < manager->GetCount(); ++j)
+			{
+				const Entity entity = manager->GetEntity(j);
+				auto it = base.find(entity);
+				if (it == base.end() || it->second != hashes[i][entity])
+				{
+					section.changed.push_back(entity);
+				}
+			}
+
+			if (!section.removed.empty() || !section.changed.empty())
+			{
+				sectionCount++;
+			}
+		}
+
+		archive << snapshot.baseSize;
+		archive << sectionCount;
+		for (size_t i = 0; i < componentManagers.size(); ++i)
+		{
+			const PatchSection& section = sections[i];
+			if (section.removed.empty() && section.changed.empty())
+			{
+				continue;
+			}
+			const std::string& name = componentManagers[i].first;
+			ComponentManager_Interface* manager = componentManagers[i].second;
+
+			archive << name;
+			const size_t end = archive.WritePlaceholder();
+			const bool whole = name == "hierarchy";
+			archive << whole;
+			if (whole)
+			{
+				manager->Serialize(archive, 0, true);
+			}
+			else
+			{
+				archive << section.removed.size();
+				for (Entity entity : section.removed)
+				{
+					SerializeEntity(archive, entity, 0);
+				}
+				archive << section.changed.size();
+				for (Entity entity : section.changed)
+				{
+					SerializeEntity(archive, entity, 0);
+					manager->SerializeComponent(archive, entity, 0);
+				}
+			}
+			archive.Patch(end, archive.GetPos());
+		}
+	}
+
+	// Apply a patch on the scene that was just read from the base archive
+	static void ReadPatch(Scene& scene, wiArchive& patch, const wiArchive& base, uint32_t seed, const Scene::SectionLoadingCallback& sectionLoading)
+	{
+		if (!patch.IsOpen())
+		{
+			return;
+		}
+
+		uint64_t baseSize;
+		patch >> baseSize;
+		if (baseSize != base.GetPos())
+		{
+			wiBackLog::post(("The scene patch doesn't belong to the scene file, it was not applied: " + patch.GetSourceFileName()).c_str());
+			return;
+		}
+
+		auto componentManagers = scene.GetComponentManagers();
+		std::vector<Entity> changedMeshes;
+
+		size_t sectionCount;
+		patch >> sectionCount;
+		for (size_t i = 0; i < sectionCount; ++i)
+		{
+			std::string name;
+			patch >> name;
+			uint64_t end;
+			patch >> end;
+
+			ComponentManager_Interface* manager = nullptr;
+			for (auto& x : componentManagers)
+			{
+				if (x.first == name)
+				{
+					manager = x.second;
+					break;
+				}
+			}
+			// Sections that are unknown to this version or that were skipped are not patched:
+			if (manager == nullptr || (sectionLoading != nullptr && sectionLoading(GetSectionOwner(name)) == Scene::SECTION_SKIP))
+			{
+				patch.Jump((size_t)end);
+				continue;
+			}
+
+			// Materials that are removed or replaced must release their textures first:
+			const bool materials = manager == &scene.materials;
+
+			bool whole;
+			patch >> whole;
+			if (whole)
+			{
+				if (materials)
+				{
+					for (size_t j = 0; j < scene.materials.GetCount(); ++j)
+					{
+						scene.materials[j].ReleaseTextures();
+					}
+				}
+				manager->Serialize(patch, seed, true);
+			}
+			else
+			{
+				size_t removedCount;
+				patch >> removedCount;
+				for (size_t j = 0; j < removedCount; ++j)
+				{
+					Entity entity;
+					SerializeEntity(patch, entity, seed);
+					if (materials && scene.materials.Contains(entity))
+					{
+						scene.materials.GetComponent(entity)->ReleaseTextures();
+					}
+					manager->Remove(entity);
+				}
+				size_t changedCount;
+				patch >> changedCount;
+				for (size_t j = 0; j < changedCount; ++j)
+				{
+					Entity entity;
+					SerializeEntity(patch, entity, seed);
+					if (materials && scene.materials.Contains(entity))
+					{
+						scene.materials.GetComponent(entity)->ReleaseTextures();
+					}
+					manager->SerializeComponent(patch, entity, seed);
+					if (manager == &scene.meshes)
+					{
+						changedMeshes.push_back(entity);
+					}
+				}
+			}
+		}
+
+		for (Entity entity : changedMeshes)
+		{
+			scene.meshes.GetComponent(entity)->CreateRenderData();
+		}
+	}
+
+	bool CompactScene(const std::string& fileName)
+	{
+		const std::string patchFileName = GetScenePatchFileName(fileName);
+		if (!wiHelper::FileExists(patchFileName))
+		{
+			return true;
+		}
+
+		// The patch is applied while the scene is read:
+		Scene scene;
+		bool compressed = false;
+		{
+			wiArchive archive(fileName, true);
+			if (!archive.IsOpen())
+			{
+				return false;
+			}
+			compressed = archive.IsCompressed();
+			scene.Serialize(archive);
+		}
+
+		wiArchive archive(fileName, false, compressed);
+		if (!archive.IsOpen())
+		{
+			return false;
+		}
+		scene.Serialize(archive);
+		archive.Close();
+
+		std::remove(patchFileName.c_str());
+		return true;
 	}
 
 	Entity Scene::Entity_Serialize(wiArchive& archive, Entity entity, uint32_t seed, bool propagateSeedDeep)
@@ -861,6 +1556,7 @@ namespace wiSceneSystem
 				{
 					auto& component = meshes.Create(entity);
 					component.Serialize(archive, propagateSeedDeep ? seed : 0);
+					component.CreateRenderData();
 				}
 			}
 			{
@@ -29,3 +29,16 @@ bool wiStartupArguments::HasArgument(const std::string& value)
 {
 	return params.find(value) != params.end();
 }
+
+std::string wiStartupArguments::GetArgument(const std::string& name, const std::string& defaultValue)
+{
+	const string prefix = name + "=";
+	for (auto& x : params)
+	{
+		if (x.compare(0, prefix.length(), prefix) == 0)
+		{
+			return x.substr(prefix.length());
+		}
+	}
+	return defaultValue;
+}
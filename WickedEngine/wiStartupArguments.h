@@ -10,5 +10,7 @@ public:
 
 	static void Parse(const wchar_t* args);
 	static bool HasArgument(const std::string& value);
+	// Returns the value of an argument in the "name=value" form, or defaultValue if it was not specified
+	static std::string GetArgument(const std::string& name, const std::string& defaultValue = "");
 };
 
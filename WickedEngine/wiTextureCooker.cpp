@@ -0,0 +1,807 @@
+#include "wiTextureCooker.h"
+#include "wiHelper.h"
+#include "wiJobSystem.h"
+#include "wiBackLog.h"
+#include "wiHashString.h"
+
+#include "Utility/stb_image.h"
+#include "Utility/tinyddsloader.h"
+
+#include <algorithm>
+#include <fstream>
+#include <cassert>
+
+using namespace std;
+using namespace tinyddsloader;
+
+namespace wiTextureCooker
+{
+	// Increment this when the cooker output changes, so every cooked texture will be cooked again:
+	static const uint64_t COOKER_VERSION = 2;
+	// Marker of cooked textures in the reserved area of the DDS header, followed by the 64-bit source hash:
+	static const uint32_t COOKED_MARKER = DDSFile::MakeFourCC('W', 'I', 'C', 'K');
+
+	static float SRGBToLinear(float value)
+	{
+		value /= 255.0f;
+		return value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+	}
+	static uint8_t LinearToSRGB(float value)
+	{
+		value = value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+		return (uint8_t)std::min(255.0f, std::max(0.0f, value * 255.0f + 0.5f));
+	}
+
+
+	// Block compression:
+	//	The block colors are stored in XMVECTORs, so the endpoint fitting and the palette search is done for every channel at once
+
+	// Color block, 16 pixels with 4 channels in the 0-255 range
+	typedef XMVECTOR Block[16];
+
+	static void LoadBlock(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, Block& block)
+	{
+		for (uint32_t y = 0; y < 4; ++y)
+		{
+			const uint32_t pixelY = std::min(blockY * 4 + y, height - 1);
+			for (uint32_t x = 0; x < 4; ++x)
+			{
+				const uint32_t pixelX = std::min(blockX * 4 + x, width - 1);
+				const uint8_t* pixel = rgba + (pixelY * width + pixelX) * 4;
+				block[y * 4 + x] = XMVectorSet(pixel[0], pixel[1], pixel[2], pixel[3]);
+			}
+		}
+	}
+
+	// Only the first channels are considered (3: RGB, 4: RGBA), the others are zeroed
+	static inline XMVECTOR MaskChannels(FXMVECTOR value, int channels)
+	{
+		return channels > 3 ? value : XMVectorSetW(value, 0);
+	}
+
+	// Find the line that fits the colors best: through the mean along the principal axis, from the smallest to the largest projection
+	//	channels	: the first channels that are considered
+	static void FitEndpoints(const Block& block, int channels, XMVECTOR& e0, XMVECTOR& e1)
+	{
+		XMVECTOR mean = XMVectorZero();
+		for (int i = 0; i < 16; ++i)
+		{
+			mean = XMVectorAdd(mean, block[i]);
+		}
+		mean = MaskChannels(XMVectorScale(mean, 1.0f / 16.0f), channels);
+
+		// The rows of the covariance matrix are accumulated at once:
+		XMMATRIX covariance(XMVectorZero(), XMVectorZero(), XMVectorZero(), XMVectorZero());
+		for (int i = 0; i < 16; ++i)
+		{
+			const XMVECTOR d = MaskChannels(XMVectorSubtract(block[i], mean), channels);
+			covariance.r[0] = XMVectorMultiplyAdd(XMVectorSplatX(d), d, covariance.r[0]);
+			covariance.r[1] = XMVectorMultiplyAdd(XMVectorSplatY(d), d, covariance.r[1]);
+			covariance.r[2] = XMVectorMultiplyAdd(XMVectorSplatZ(d), d, covariance.r[2]);
+			covariance.r[3] = XMVectorMultiplyAdd(XMVectorSplatW(d), d, covariance.r[3]);
+		}
+
+		// Power iteration, starting from the diagonal gives a good initial direction:
+		XMVECTOR axis = XMVectorSet(
+			XMVectorGetX(covariance.r[0]),
+			XMVectorGetY(covariance.r[1]),
+			XMVectorGetZ(covariance.r[2]),
+			XMVectorGetW(covariance.r[3])
+		);
+		for (int iteration = 0; iteration < 8; ++iteration)
+		{
+			// The covariance matrix is symmetric, so the transform is the same as the matrix * axis product:
+			const XMVECTOR next = XMVector4Transform(axis, covariance);
+			XMFLOAT4 absNext;
+			XMStoreFloat4(&absNext, XMVectorAbs(next));
+			const float length = std::max(std::max(absNext.x, absNext.y), std::max(absNext.z, absNext.w));
+			if (length < 1e-6f)
+			{
+				break;
+			}
+			axis = XMVectorScale(next, 1.0f / length);
+		}
+		const float lengthSq = XMVectorGetX(XMVector4LengthSq(axis));
+		if (lengthSq < 1e-12f)
+		{
+			// All colors are the same:
+			e0 = e1 = mean;
+			return;
+		}
+		axis = XMVectorScale(axis, 1.0f / sqrtf(lengthSq));
+
+		// The unused channels of the axis are zero, so they don't contribute to the projections:
+		XMVECTOR minT = XMVectorReplicate(FLT_MAX);
+		XMVECTOR maxT = XMVectorReplicate(-FLT_MAX);
+		for (int i = 0; i < 16; ++i)
+		{
+			const XMVECTOR t = XMVector4Dot(XMVectorSubtract(block[i], mean), axis);
+			minT = XMVectorMin(minT, t);
+			maxT = XMVectorMax(maxT, t);
+		}
+		e0 = XMVectorMultiplyAdd(axis, minT, mean);
+		e1 = XMVectorMultiplyAdd(axis, maxT, mean);
+	}
+
+	// Least squares endpoints for the interpolation weights (0: e0, 1: e1) that were selected for the pixels
+	//	returns false if the endpoints can't be solved (every pixel has the same weight)
+	static bool RefineEndpoints(const Block& block, int channels, const float weights[16], XMVECTOR& e0, XMVECTOR& e1)
+	{
+		float a = 0, b = 0, c = 0;
+		XMVECTOR x0 = XMVectorZero();
+		XMVECTOR x1 = XMVectorZero();
+		for (int i = 0; i < 16; ++i)
+		{
+			const float w = weights[i];
+			a += (1 - w) * (1 - w);
+			b += (1 - w) * w;
+			c += w * w;
+			x0 = XMVectorMultiplyAdd(XMVectorReplicate(1 - w), block[i], x0);
+			x1 = XMVectorMultiplyAdd(XMVectorReplicate(w), block[i], x1);
+		}
+		const float det = a * c - b * b;
+		if (std::abs(det) < 1e-6f)
+		{
+			return false;
+		}
+		const XMVECTOR minValue = XMVectorZero();
+		const XMVECTOR maxValue = XMVectorReplicate(255);
+		const XMVECTOR refined0 = XMVectorClamp(XMVectorScale(XMVectorSubtract(XMVectorScale(x0, c), XMVectorScale(x1, b)), 1.0f / det), minValue, maxValue);
+		const XMVECTOR refined1 = XMVectorClamp(XMVectorScale(XMVectorSubtract(XMVectorScale(x1, a), XMVectorScale(x0, b)), 1.0f / det), minValue, maxValue);
+		e0 = channels > 3 ? refined0 : XMVectorSetW(refined0, XMVectorGetW(e0));
+		e1 = channels > 3 ? refined1 : XMVectorSetW(refined1, XMVectorGetW(e1));
+		return true;
+	}
+
+	// Squared distances of a color to 4 palette colors, the palette is transposed: the rows are the channels, the columns are the colors
+	static inline XMVECTOR PaletteDistanceSq(FXMVECTOR color, const XMMATRIX& palette, int channels)
+	{
+		XMVECTOR d = XMVectorSubtract(XMVectorSplatX(color), palette.r[0]);
+		XMVECTOR distanceSq = XMVectorMultiply(d, d);
+		d = XMVectorSubtract(XMVectorSplatY(color), palette.r[1]);
+		distanceSq = XMVectorMultiplyAdd(d, d, distanceSq);
+		d = XMVectorSubtract(XMVectorSplatZ(color), palette.r[2]);
+		distanceSq = XMVectorMultiplyAdd(d, d, distanceSq);
+		if (channels > 3)
+		{
+			d = XMVectorSubtract(XMVectorSplatW(color), palette.r[3]);
+			distanceSq = XMVectorMultiplyAdd(d, d, distanceSq);
+		}
+		return distanceSq;
+	}
+
+	// Select the closest palette color, the palette is stored in groups of 4 transposed colors
+	//	returns the palette index (the smallest one if there are more with the same distance), error is the squared distance
+	static inline uint32_t SelectPaletteIndex(FXMVECTOR color, const XMMATRIX* palette, int groupCount, int channels, float& error)
+	{
+		const XMVECTOR laneIndex = XMVectorSet(0, 1, 2, 3);
+		XMVECTOR bestError = PaletteDistanceSq(color, palette[0], channels);
+		XMVECTOR bestIndex = laneIndex;
+		for (int group = 1; group < groupCount; ++group)
+		{
+			const XMVECTOR groupError = PaletteDistanceSq(color, palette[group], channels);
+			const XMVECTOR closer = XMVectorLess(groupError, bestError);
+			bestError = XMVectorSelect(bestError, groupError, closer);
+			bestIndex = XMVectorSelect(bestIndex, XMVectorAdd(laneIndex, XMVectorReplicate(float(group * 4))), closer);
+		}
+
+		XMFLOAT4 errors, indices;
+		XMStoreFloat4(&errors, bestError);
+		XMStoreFloat4(&indices, bestIndex);
+		const float laneErrors[4] = { errors.x, errors.y, errors.z, errors.w };
+		const float laneIndices[4] = { indices.x, indices.y, indices.z, indices.w };
+		error = laneErrors[0];
+		float best = laneIndices[0];
+		for (int lane = 1; lane < 4; ++lane)
+		{
+			if (laneErrors[lane] < error || (laneErrors[lane] == error && laneIndices[lane] < best))
+			{
+				error = laneErrors[lane];
+				best = laneIndices[lane];
+			}
+		}
+		return (uint32_t)best;
+	}
+
+	static inline uint16_t PackRGB565(FXMVECTOR color)
+	{
+		const XMVECTOR maxValue = XMVectorSet(31, 63, 31, 0);
+		XMFLOAT4 quantized;
+		XMStoreFloat4(&quantized, XMVectorClamp(XMVectorAdd(XMVectorDivide(XMVectorMultiply(color, maxValue), XMVectorReplicate(255)), XMVectorReplicate(0.5f)), XMVectorZero(), maxValue));
+		return ((uint16_t)quantized.x << 11) | ((uint16_t)quantized.y << 5) | (uint16_t)quantized.z;
+	}
+	static inline XMVECTOR UnpackRGB565(uint16_t value)
+	{
+		const int r = (value >> 11) & 31;
+		const int g = (value >> 5) & 63;
+		const int b = value & 31;
+		return XMVectorSet(float((r << 3) | (r >> 2)), float((g << 2) | (g >> 4)), float((b << 3) | (b >> 2)), 0);
+	}
+
+	// Select the BC1 color indices for the endpoints (4 color mode), returns the squared error
+	static float SelectBC1Indices(const Block& block, uint16_t& c0, uint16_t& c1, uint32_t& indices)
+	{
+		if (c0 < c1)
+		{
+			std::swap(c0, c1); // c0 > c1 is the 4 color mode
+		}
+
+		const XMVECTOR color0 = UnpackRGB565(c0);
+		const XMVECTOR color1 = UnpackRGB565(c1);
+		XMMATRIX palette;
+		if (c0 == c1)
+		{
+			// Only the first color can be used, the others would be decoded in 3 color mode:
+			palette = XMMatrixTranspose(XMMATRIX(color0, color0, color0, color0));
+		}
+		else
+		{
+			const XMVECTOR third = XMVectorReplicate(3);
+			palette = XMMatrixTranspose(XMMATRIX(
+				color0,
+				color1,
+				XMVectorDivide(XMVectorAdd(XMVectorAdd(color0, color0), color1), third),
+				XMVectorDivide(XMVectorAdd(XMVectorAdd(color1, color1), color0), third)
+			));
+		}
+
+		float error = 0;
+		indices = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			float pixelError;
+			const uint32_t best = SelectPaletteIndex(block[i], &palette, 1, 3, pixelError);
+			indices |= best << (i * 2);
+			error += pixelError;
+		}
+		return error;
+	}
+
+	static void EncodeBC1(const Block& block, uint8_t* dst)
+	{
+		XMVECTOR e0, e1;
+		FitEndpoints(block, 3, e0, e1);
+
+		uint16_t c0 = PackRGB565(e0);
+		uint16_t c1 = PackRGB565(e1);
+		uint32_t indices;
+		float error = SelectBC1Indices(block, c0, c1, indices);
+
+		// The endpoints are refined for the selected indices, as long as that reduces the error:
+		static const float indexWeights[4] = { 0, 1, 1.0f / 3.0f, 2.0f / 3.0f };
+		for (int iteration = 0; iteration < 2 && error > 0; ++iteration)
+		{
+			float weights[16];
+			for (int i = 0; i < 16; ++i)
+			{
+				weights[i] = indexWeights[(indices >> (i * 2)) & 3];
+			}
+			if (!RefineEndpoints(block, 3, weights, e0, e1))
+			{
+				break;
+			}
+			uint16_t refined0 = PackRGB565(e0);
+			uint16_t refined1 = PackRGB565(e1);
+			uint32_t refinedIndices;
+			const float refinedError = SelectBC1Indices(block, refined0, refined1, refinedIndices);
+			if (refinedError >= error)
+			{
+				break;
+			}
+			c0 = refined0;
+			c1 = refined1;
+			indices = refinedIndices;
+			error = refinedError;
+		}
+
+		dst[0] = c0 & 0xFF;
+		dst[1] = c0 >> 8;
+		dst[2] = c1 & 0xFF;
+		dst[3] = c1 >> 8;
+		for (int i = 0; i < 4; ++i)
+		{
+			dst[4 + i] = (indices >> (i * 8)) & 0xFF;
+		}
+	}
+
+	// Single channel block (8 value mode)
+	static void EncodeBC4(const Block& block, int channel, uint8_t* dst)
+	{
+		float values[16];
+		for (int i = 0; i < 16; ++i)
+		{
+			values[i] = XMVectorGetByIndex(block[i], channel);
+		}
+
+		float minValue = 255;
+		float maxValue = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			minValue = std::min(minValue, values[i]);
+			maxValue = std::max(maxValue, values[i]);
+		}
+		const int a0 = (int)maxValue;
+		const int a1 = (int)minValue;
+		dst[0] = (uint8_t)a0;
+		dst[1] = (uint8_t)a1;
+
+		float palette[8];
+		palette[0] = float(a0);
+		palette[1] = float(a1);
+		for (int j = 2; j < 8; ++j)
+		{
+			palette[j] = ((8 - j) * a0 + (j - 1) * a1) / 7.0f;
+		}
+		const int paletteSize = a0 == a1 ? 1 : 8;
+
+		uint64_t indices = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			float bestError = FLT_MAX;
+			uint64_t best = 0;
+			for (int p = 0; p < paletteSize; ++p)
+			{
+				const float e = std::abs(values[i] - palette[p]);
+				if (e < bestError)
+				{
+					bestError = e;
+					best = p;
+				}
+			}
+			indices |= best << (i * 3);
+		}
+		for (int i = 0; i < 6; ++i)
+		{
+			dst[2 + i] = (indices >> (i * 8)) & 0xFF;
+		}
+	}
+
+	static void EncodeBC3(const Block& block, uint8_t* dst)
+	{
+		EncodeBC4(block, 3, dst);
+		EncodeBC1(block, dst + 8);
+	}
+
+	static void EncodeBC5(const Block& block, uint8_t* dst)
+	{
+		EncodeBC4(block, 0, dst);
+		EncodeBC4(block, 1, dst + 8);
+	}
+
+	// BC7 is encoded in mode 6: a single subset with RGBA endpoints (7 bits per channel and a shared p-bit per endpoint) and 4-bit indices
+	static const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// Quantize an endpoint to 7 bits per channel and a p-bit, value is the 8-bit result
+	//	forcedP	: 0 or 1 to force the p-bit, -1 to select the better one
+	static void QuantizeBC7Endpoint(FXMVECTOR endpoint, int forcedP, XMVECTOR& value)
+	{
+		float bestError = FLT_MAX;
+		for (int p = 0; p < 2; ++p)
+		{
+			if (forcedP >= 0 && p != forcedP)
+			{
+				continue;
+			}
+			const XMVECTOR pBit = XMVectorReplicate(float(p));
+			const XMVECTOR half = XMVectorReplicate(0.5f);
+			const XMVECTOR q = XMVectorFloor(XMVectorClamp(XMVectorMultiplyAdd(XMVectorSubtract(endpoint, pBit), half, half), XMVectorZero(), XMVectorReplicate(127)));
+			const XMVECTOR candidate = XMVectorMultiplyAdd(q, XMVectorReplicate(2), pBit);
+			const float error = XMVectorGetX(XMVector4LengthSq(XMVectorSubtract(endpoint, candidate)));
+			if (error < bestError)
+			{
+				bestError = error;
+				value = candidate;
+			}
+		}
+	}
+
+	// Select the BC7 indices for the quantized endpoints, returns the squared error
+	static float SelectBC7Indices(const Block& block, FXMVECTOR v0, FXMVECTOR v1, uint8_t indices[16])
+	{
+		// The interpolation is exact in floating point, it gives the same result as the integer interpolation of the decoder:
+		XMMATRIX palette[4];
+		for (int group = 0; group < 4; ++group)
+		{
+			XMVECTOR colors[4];
+			for (int j = 0; j < 4; ++j)
+			{
+				const float w = float(BC7_WEIGHTS[group * 4 + j]);
+				colors[j] = XMVectorFloor(XMVectorScale(XMVectorAdd(XMVectorAdd(XMVectorScale(v0, 64 - w), XMVectorScale(v1, w)), XMVectorReplicate(32)), 1.0f / 64.0f));
+			}
+			palette[group] = XMMatrixTranspose(XMMATRIX(colors[0], colors[1], colors[2], colors[3]));
+		}
+
+		float error = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			float pixelError;
+			indices[i] = (uint8_t)SelectPaletteIndex(block[i], palette, 4, 4, pixelError);
+			error += pixelError;
+		}
+		return error;
+	}
+
+	struct BitWriter
+	{
+		uint8_t* dst;
+		uint32_t pos = 0;
+
+		BitWriter(uint8_t* dst) :dst(dst) {}
+		void Write(uint32_t value, uint32_t bits)
+		{
+			for (uint32_t i = 0; i < bits; ++i)
+			{
+				if ((value >> i) & 1)
+				{
+					dst[pos >> 3] |= 1 << (pos & 7);
+				}
+				pos++;
+			}
+		}
+	};
+
+	static void EncodeBC7(const Block& block, uint8_t* dst)
+	{
+		bool opaque = true;
+		for (int i = 0; i < 16; ++i)
+		{
+			opaque = opaque && XMVectorGetW(block[i]) == 255;
+		}
+		// Opaque blocks must decode to exactly 255 alpha, which needs the p-bit:
+		const int forcedP = opaque ? 1 : -1;
+
+		XMVECTOR e0, e1;
+		FitEndpoints(block, 4, e0, e1);
+
+		XMVECTOR v0, v1;
+		QuantizeBC7Endpoint(e0, forcedP, v0);
+		QuantizeBC7Endpoint(e1, forcedP, v1);
+		uint8_t indices[16];
+		float error = SelectBC7Indices(block, v0, v1, indices);
+
+		for (int iteration = 0; iteration < 2 && error > 0; ++iteration)
+		{
+			float weights[16];
+			for (int i = 0; i < 16; ++i)
+			{
+				weights[i] = BC7_WEIGHTS[indices[i]] / 64.0f;
+			}
+			if (!RefineEndpoints(block, 4, weights, e0, e1))
+			{
+				break;
+			}
+			XMVECTOR refined0, refined1;
+			QuantizeBC7Endpoint(e0, forcedP, refined0);
+			QuantizeBC7Endpoint(e1, forcedP, refined1);
+			uint8_t refinedIndices[16];
+			const float refinedError = SelectBC7Indices(block, refined0, refined1, refinedIndices);
+			if (refinedError >= error)
+			{
+				break;
+			}
+			v0 = refined0;
+			v1 = refined1;
+			std::copy(refinedIndices, refinedIndices + 16, indices);
+			error = refinedError;
+		}
+
+		// The most significant bit of the first index is implicitly 0, so the endpoints are swapped if it would be 1:
+		if (indices[0] & 8)
+		{
+			std::swap(v0, v1);
+			for (int i = 0; i < 16; ++i)
+			{
+				indices[i] = 15 - indices[i];
+			}
+		}
+
+		XMFLOAT4 endpoint0, endpoint1;
+		XMStoreFloat4(&endpoint0, v0);
+		XMStoreFloat4(&endpoint1, v1);
+		const uint32_t values[2][4] = {
+			{ (uint32_t)endpoint0.x, (uint32_t)endpoint0.y, (uint32_t)endpoint0.z, (uint32_t)endpoint0.w },
+			{ (uint32_t)endpoint1.x, (uint32_t)endpoint1.y, (uint32_t)endpoint1.z, (uint32_t)endpoint1.w },
+		};
+
+		std::fill(dst, dst + 16, 0);
+		BitWriter writer(dst);
+		writer.Write(1 << 6, 7); // mode 6
+		for (int c = 0; c < 4; ++c)
+		{
+			writer.Write(values[0][c] >> 1, 7);
+			writer.Write(values[1][c] >> 1, 7);
+		}
+		writer.Write(values[0][0] & 1, 1);
+		writer.Write(values[1][0] & 1, 1);
+		writer.Write(indices[0], 3);
+		for (int i = 1; i < 16; ++i)
+		{
+			writer.Write(indices[i], 4);
+		}
+	}
+
+	static size_t GetBlockSize(FORMAT format)
+	{
+		switch (format)
+		{
+		case FORMAT_BC1:
+		case FORMAT_BC4:
+			return 8;
+		case FORMAT_BC3:
+		case FORMAT_BC5:
+		case FORMAT_BC7:
+			return 16;
+		default:
+			break;
+		}
+		return 0;
+	}
+
+	size_t GetCompressedSize(uint32_t width, uint32_t height, FORMAT format)
+	{
+		const size_t blockSize = GetBlockSize(format);
+		if (blockSize == 0)
+		{
+			return size_t(width) * size_t(height) * 4;
+		}
+		return size_t((width + 3) / 4) * size_t((height + 3) / 4) * blockSize;
+	}
+
+	void Compress(const uint8_t* rgba, uint32_t width, uint32_t height, FORMAT format, uint8_t* dst)
+	{
+		const size_t blockSize = GetBlockSize(format);
+		assert(blockSize > 0);
+		const uint32_t blocksX = (width + 3) / 4;
+		const uint32_t blocksY = (height + 3) / 4;
+
+		wiJobSystem::context ctx;
+		wiJobSystem::Dispatch(ctx, blocksX * blocksY, 64, [&](wiJobDispatchArgs args) {
+			const uint32_t blockX = args.jobIndex % blocksX;
+			const uint32_t blockY = args.jobIndex / blocksX;
+
+			Block block;
+			LoadBlock(rgba, width, height, blockX, blockY, block);
+
+			uint8_t* output = dst + args.jobIndex * blockSize;
+			switch (format)
+			{
+			case FORMAT_BC1:
+				EncodeBC1(block, output);
+				break;
+			case FORMAT_BC3:
+				EncodeBC3(block, output);
+				break;
+			case FORMAT_BC4:
+				EncodeBC4(block, 0, output);
+				break;
+			case FORMAT_BC5:
+				EncodeBC5(block, output);
+				break;
+			case FORMAT_BC7:
+				EncodeBC7(block, output);
+				break;
+			default:
+				break;
+			}
+		});
+		wiJobSystem::Wait(ctx);
+	}
+
+	void GenerateMip(const uint8_t* src, uint32_t width, uint32_t height, std::vector<uint8_t>& dst, bool srgb)
+	{
+		static const std::vector<float> srgbToLinear = [] {
+			std::vector<float> table(256);
+			for (int i = 0; i < 256; ++i)
+			{
+				table[i] = SRGBToLinear(float(i));
+			}
+			return table;
+		}();
+
+		const uint32_t mipWidth = std::max(1u, width / 2);
+		const uint32_t mipHeight = std::max(1u, height / 2);
+		dst.resize(size_t(mipWidth) * size_t(mipHeight) * 4);
+
+		for (uint32_t y = 0; y < mipHeight; ++y)
+		{
+			const uint32_t y0 = std::min(y * 2, height - 1);
+			const uint32_t y1 = std::min(y * 2 + 1, height - 1);
+			for (uint32_t x = 0; x < mipWidth; ++x)
+			{
+				const uint32_t x0 = std::min(x * 2, width - 1);
+				const uint32_t x1 = std::min(x * 2 + 1, width - 1);
+				const uint8_t* samples[4] = {
+					src + (y0 * width + x0) * 4,
+					src + (y0 * width + x1) * 4,
+					src + (y1 * width + x0) * 4,
+					src + (y1 * width + x1) * 4,
+				};
+
+				uint8_t* pixel = dst.data() + (y * mipWidth + x) * 4;
+				for (int c = 0; c < 4; ++c)
+				{
+					if (srgb && c < 3)
+					{
+						const float value = (srgbToLinear[samples[0][c]] + srgbToLinear[samples[1][c]] + srgbToLinear[samples[2][c]] + srgbToLinear[samples[3][c]]) * 0.25f;
+						pixel[c] = LinearToSRGB(value);
+					}
+					else
+					{
+						pixel[c] = (uint8_t)((samples[0][c] + samples[1][c] + samples[2][c] + samples[3][c] + 2) / 4);
+					}
+				}
+			}
+		}
+	}
+
+
+	// Cooking:
+
+	std::string GetCookedFileName(const std::string& fileName)
+	{
+		return fileName + ".dds";
+	}
+
+	static DDSFile::DXGIFormat GetDXGIFormat(FORMAT format)
+	{
+		switch (format)
+		{
+		case FORMAT_BC1:
+			return DDSFile::DXGIFormat::BC1_UNorm;
+		case FORMAT_BC3:
+			return DDSFile::DXGIFormat::BC3_UNorm;
+		case FORMAT_BC4:
+			return DDSFile::DXGIFormat::BC4_UNorm;
+		case FORMAT_BC5:
+			return DDSFile::DXGIFormat::BC5_UNorm;
+		case FORMAT_BC7:
+			return DDSFile::DXGIFormat::BC7_UNorm;
+		default:
+			break;
+		}
+		return DDSFile::DXGIFormat::R8G8B8A8_UNorm;
+	}
+
+	// Returns true if the file is a texture that was cooked from the same source hash
+	static bool IsCookedFrom(const std::string& cookedFileName, uint64_t hash)
+	{
+		ifstream file(cookedFileName, ios::binary);
+		if (!file.is_open())
+		{
+			return false;
+		}
+		char magic[4];
+		DDSFile::Header header;
+		file.read(magic, sizeof(magic));
+		file.read((char*)&header, sizeof(header));
+		return file.good() &&
+			header.m_reserved1[0] == COOKED_MARKER &&
+			header.m_reserved1[1] == uint32_t(hash & 0xFFFFFFFF) &&
+			header.m_reserved1[2] == uint32_t(hash >> 32);
+	}
+
+	RESULT Cook(const std::string& fileName, const CookParams& params)
+	{
+		std::vector<uint8_t> fileData;
+		if (!wiHelper::readByteData(fileName, fileData))
+		{
+			return RESULT_FAILED;
+		}
+
+		uint64_t hash = wiHashString::Hash((const char*)fileData.data(), fileData.size());
+		hash = wiHashString::Hash((const char*)&COOKER_VERSION, sizeof(COOKER_VERSION), hash);
+		hash = wiHashString::Hash((const char*)&params.format, sizeof(params.format), hash);
+		hash = wiHashString::Hash((const char*)&params.mips, sizeof(params.mips), hash);
+		hash = wiHashString::Hash((const char*)&params.srgb, sizeof(params.srgb), hash);
+
+		const std::string cookedFileName = GetCookedFileName(fileName);
+		if (IsCookedFrom(cookedFileName, hash))
+		{
+			return RESULT_UP_TO_DATE;
+		}
+
+		int width, height, bpp;
+		uint8_t* rgba = stbi_load_from_memory(fileData.data(), (int)fileData.size(), &width, &height, &bpp, 4);
+		if (rgba == nullptr)
+		{
+			return RESULT_FAILED;
+		}
+
+		FORMAT format = params.format;
+		if (format == FORMAT_AUTO)
+		{
+			format = FORMAT_BC1;
+			for (int i = 0; i < width * height; ++i)
+			{
+				if (rgba[i * 4 + 3] < 255)
+				{
+					format = FORMAT_BC7;
+					break;
+				}
+			}
+		}
+		if (format != FORMAT_RGBA8 && (width % 4 != 0 || height % 4 != 0))
+		{
+			wiBackLog::post(("Texture cooker: " + fileName + " can't be block compressed, because its size is not a multiple of 4").c_str());
+			format = FORMAT_RGBA8;
+		}
+
+		// Mip chain:
+		std::vector<std::vector<uint8_t>> mips(1);
+		mips[0].assign(rgba, rgba + size_t(width) * size_t(height) * 4);
+		stbi_image_free(rgba);
+		if (params.mips)
+		{
+			uint32_t mipWidth = (uint32_t)width;
+			uint32_t mipHeight = (uint32_t)height;
+			while (mipWidth > 1 || mipHeight > 1)
+			{
+				mips.emplace_back();
+				GenerateMip(mips[mips.size() - 2].data(), mipWidth, mipHeight, mips.back(), params.srgb);
+				mipWidth = std::max(1u, mipWidth / 2);
+				mipHeight = std::max(1u, mipHeight / 2);
+			}
+		}
+
+		// DDS with DX10 header:
+		DDSFile::Header header = {};
+		header.m_size = sizeof(DDSFile::Header);
+		header.m_flags = uint32_t(DDSFile::HeaderFlagBits::Texture) | uint32_t(DDSFile::HeaderFlagBits::Mipmap);
+		header.m_flags |= uint32_t(format == FORMAT_RGBA8 ? DDSFile::HeaderFlagBits::Pitch : DDSFile::HeaderFlagBits::LinearSize);
+		header.m_height = (uint32_t)height;
+		header.m_width = (uint32_t)width;
+		header.m_pitchOrLinerSize = uint32_t(format == FORMAT_RGBA8 ? width * 4 : GetCompressedSize(width, height, format));
+		header.m_depth = 1;
+		header.m_mipMapCount = (uint32_t)mips.size();
+		header.m_reserved1[0] = COOKED_MARKER;
+		header.m_reserved1[1] = uint32_t(hash & 0xFFFFFFFF);
+		header.m_reserved1[2] = uint32_t(hash >> 32);
+		header.m_pixelFormat.m_size = sizeof(DDSFile::PixelFormat);
+		header.m_pixelFormat.m_flags = uint32_t(DDSFile::PixelFormatFlagBits::FourCC);
+		header.m_pixelFormat.m_fourCC = DDSFile::MakeFourCC('D', 'X', '1', '0');
+		header.m_caps = 0x00001000 | 0x00400000 | 0x00000008; // texture, mipmap, complex
+
+		DDSFile::HeaderDXT10 header10 = {};
+		header10.m_format = GetDXGIFormat(format);
+		header10.m_resourceDimension = DDSFile::TextureDimension::Texture2D;
+		header10.m_arraySize = 1;
+
+		std::vector<uint8_t> dds;
+		dds.insert(dds.end(), DDSFile::Magic, DDSFile::Magic + sizeof(DDSFile::Magic));
+		dds.insert(dds.end(), (const uint8_t*)&header, (const uint8_t*)&header + sizeof(header));
+		dds.insert(dds.end(), (const uint8_t*)&header10, (const uint8_t*)&header10 + sizeof(header10));
+
+		uint32_t mipWidth = (uint32_t)width;
+		uint32_t mipHeight = (uint32_t)height;
+		for (auto& mip : mips)
+		{
+			if (format == FORMAT_RGBA8)
+			{
+				dds.insert(dds.end(), mip.begin(), mip.end());
+			}
+			else
+			{
+				const size_t offset = dds.size();
+				dds.resize(offset + GetCompressedSize(mipWidth, mipHeight, format));
+				Compress(mip.data(), mipWidth, mipHeight, format, dds.data() + offset);
+			}
+			mipWidth = std::max(1u, mipWidth / 2);
+			mipHeight = std::max(1u, mipHeight / 2);
+		}
+
+		ofstream file(cookedFileName, ios::binary | ios::trunc);
+		if (!file.is_open())
+		{
+			return RESULT_FAILED;
+		}
+		file.write((const char*)dds.data(), dds.size());
+		file.close();
+		if (file.fail())
+		{
+			// A partially written file must not be mistaken for an up to date cooked texture:
+			std::remove(cookedFileName.c_str());
+			return RESULT_FAILED;
+		}
+		return RESULT_COOKED;
+	}
+}
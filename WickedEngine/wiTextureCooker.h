@@ -0,0 +1,60 @@
+#pragma once
+#include "CommonInclude.h"
+
+#include <string>
+#include <vector>
+
+// Offline texture cooking: image files (PNG, JPG, TGA...) are converted to DDS files with a full mip chain and block compression
+//	The cooker only uses the CPU, so it doesn't need a graphics device (it can be used from tools and build steps)
+//	wiResourceManager loads the cooked texture instead of the image file when it exists
+namespace wiTextureCooker
+{
+	enum FORMAT
+	{
+		FORMAT_AUTO,	// BC1 for opaque images, BC7 for images with transparency
+		FORMAT_RGBA8,	// uncompressed, only the mip chain is generated
+		FORMAT_BC1,		// RGB, 4 bits per pixel
+		FORMAT_BC3,		// RGBA, 8 bits per pixel
+		FORMAT_BC4,		// R, 4 bits per pixel
+		FORMAT_BC5,		// RG, 8 bits per pixel
+		FORMAT_BC7,		// RGBA, 8 bits per pixel, better quality than BC3
+	};
+
+	struct CookParams
+	{
+		FORMAT format = FORMAT_AUTO;
+		// Generate the full mip chain
+		bool mips = true;
+		// The image contains sRGB colors, so the mips are filtered in linear space (the texture format stays UNORM, like for the image files)
+		bool srgb = false;
+	};
+
+	enum RESULT
+	{
+		RESULT_FAILED,
+		RESULT_COOKED,
+		RESULT_UP_TO_DATE,
+	};
+
+	// Returns the file name of the cooked texture for an image file ("image.png" -> "image.png.dds")
+	std::string GetCookedFileName(const std::string& fileName);
+
+	// Cook an image file into the file that is returned by GetCookedFileName()
+	//	The cooked file contains the hash of the image file contents and the cooking parameters,
+	//	so it is only cooked again if the image or the parameters changed
+	//	Block compression requires the image width and height to be multiples of 4, otherwise it will be FORMAT_RGBA8
+	RESULT Cook(const std::string& fileName, const CookParams& params = CookParams());
+
+	// Returns the size of an image in bytes after compression to a format
+	size_t GetCompressedSize(uint32_t width, uint32_t height, FORMAT format);
+
+	// Compress an RGBA8 image to a block compressed format (BC1, BC3, BC4, BC5 or BC7)
+	//	The blocks are compressed in parallel with the job system, partial blocks at the edges are padded by clamping
+	//	dst	: must have GetCompressedSize() bytes
+	void Compress(const uint8_t* rgba, uint32_t width, uint32_t height, FORMAT format, uint8_t* dst);
+
+	// Generate the next mip level of an RGBA8 image with a box filter
+	//	dst	: output image, max(1, width / 2) x max(1, height / 2)
+	//	srgb	: filter the colors in linear space
+	void GenerateMip(const uint8_t* src, uint32_t width, uint32_t height, std::vector<uint8_t>& dst, bool srgb);
+}
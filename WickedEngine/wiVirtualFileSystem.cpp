@@ -0,0 +1,487 @@
+#include "wiVirtualFileSystem.h"
+#include "wiHelper.h"
+#include "wiCompression.h"
+#include "wiHashString.h"
+
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <unordered_set>
+#include <cctype>
+
+using namespace std;
+
+namespace wiVirtualFileSystem
+{
+	static const uint64_t PACKAGE_MAGIC = 0x4B41504B4349570Aull;
+	static const uint64_t PACKAGE_VERSION = 1;
+	static const uint64_t PACKAGE_ALIGNMENT = 64; // file data is aligned to cache lines
+
+	struct PackageHeader
+	{
+		uint64_t magic;
+		uint64_t version;
+		uint64_t fileCount;
+		uint64_t tableOffset;
+		uint64_t namesOffset;
+		uint64_t namesSize;
+	};
+	struct PackageEntry
+	{
+		uint64_t pathHash;
+		uint64_t offset;
+		uint64_t size;
+		uint64_t compressedSize; // 0 if the file is not compressed
+		uint64_t nameOffset;
+		uint64_t nameLength;
+	};
+
+	struct Package
+	{
+		std::string fileName;
+		std::string mountPoint; // normalized, with a trailing slash if not empty
+		wiHelper::MappedFile file;
+		const PackageEntry* entries = nullptr; // sorted by pathHash
+		size_t entryCount = 0;
+		const char* names = nullptr;
+
+		~Package()
+		{
+			wiHelper::UnmapFile(file);
+		}
+
+		const PackageEntry* Find(const std::string& path, uint64_t hash) const
+		{
+			const PackageEntry* end = entries + entryCount;
+			const PackageEntry* it = std::lower_bound(entries, end, hash, [](const PackageEntry& entry, uint64_t hash) {
+				return entry.pathHash < hash;
+			});
+			for (; it != end && it->pathHash == hash; ++it)
+			{
+				if (it->nameLength == path.length() && path.compare(0, path.length(), names + it->nameOffset, (size_t)it->nameLength) == 0)
+				{
+					return it;
+				}
+			}
+			return nullptr;
+		}
+	};
+
+	static std::shared_timed_mutex locker;
+	static std::vector<std::shared_ptr<Package>> packages; // the last one has the highest priority
+	static std::atomic<bool> looseFileOverride{ false };
+
+	static std::atomic<uint64_t> fileOpens{ 0 };
+	static std::atomic<uint64_t> packageReads{ 0 };
+	static std::atomic<uint64_t> bytesRead{ 0 };
+
+	static uint64_t HashPath(const std::string& path)
+	{
+		return wiHashString::Hash(path.c_str(), path.length());
+	}
+
+	// Lower case, forward slashes, without "." and resolvable ".." parts
+	static std::string ResolvePath(const std::string& path)
+	{
+		std::vector<std::string> parts;
+		size_t start = 0;
+		while (start <= path.length())
+		{
+			size_t end = path.find_first_of("/\\", start);
+			if (end == std::string::npos)
+			{
+				end = path.length();
+			}
+			std::string part = path.substr(start, end - start);
+			for (auto& c : part)
+			{
+				c = (char)tolower((unsigned char)c);
+			}
+			if (part == "..")
+			{
+				if (!parts.empty() && parts.back() != ".." && !parts.back().empty())
+				{
+					parts.pop_back();
+				}
+				else
+				{
+					parts.push_back(part);
+				}
+			}
+			else if (part != "." && !(part.empty() && !parts.empty()))
+			{
+				parts.push_back(part); // an empty first part is kept for absolute paths
+			}
+			start = end + 1;
+		}
+
+		std::string result;
+		for (size_t i = 0; i < parts.size(); ++i)
+		{
+			if (i > 0)
+			{
+				result += '/';
+			}
+			result += parts[i];
+		}
+		return result;
+	}
+
+	// The resolved path, relative to the working directory if it is inside it
+	static std::string NormalizePath(const std::string& path)
+	{
+		std::string result = ResolvePath(path);
+		const std::string workingDirectory = ResolvePath(wiHelper::GetWorkingDirectory()) + '/';
+		if (result.compare(0, workingDirectory.length(), workingDirectory) == 0)
+		{
+			result = result.substr(workingDirectory.length());
+		}
+		return result;
+	}
+
+	// Find a file in the mounted packages
+	static bool FindPackageFile(const std::string& fileName, std::shared_ptr<Package>& package, const PackageEntry*& entry)
+	{
+		std::shared_lock<std::shared_timed_mutex> lock(locker);
+		if (packages.empty())
+		{
+			return false;
+		}
+
+		const std::string path = NormalizePath(fileName);
+		for (auto it = packages.rbegin(); it != packages.rend(); ++it)
+		{
+			const Package& x = **it;
+			if (path.compare(0, x.mountPoint.length(), x.mountPoint) != 0)
+			{
+				continue;
+			}
+			const std::string relativePath = path.substr(x.mountPoint.length());
+			entry = x.Find(relativePath, HashPath(relativePath));
+			if (entry != nullptr)
+			{
+				package = *it;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static bool IsLooseFileOverridden(const std::string& fileName)
+	{
+		if (!looseFileOverride.load())
+		{
+			return false;
+		}
+		fileOpens++;
+		return wiHelper::FileExists(fileName);
+	}
+
+	// Open a file from the mounted packages
+	static bool OpenPackageFile(const std::string& fileName, FileView& view)
+	{
+		std::shared_ptr<Package> package;
+		const PackageEntry* entry = nullptr;
+		if (!FindPackageFile(fileName, package, entry) || IsLooseFileOverridden(fileName))
+		{
+			return false;
+		}
+
+		const uint8_t* data = package->file.data + entry->offset;
+		if (entry->compressedSize == 0)
+		{
+			view.data = data;
+			view.size = (size_t)entry->size;
+			view.owner = package;
+		}
+		else
+		{
+			std::shared_ptr<std::vector<uint8_t>> decompressed = std::make_shared<std::vector<uint8_t>>((size_t)entry->size);
+			if (!wiCompression::Decompress(data, (size_t)entry->compressedSize, decompressed->data(), decompressed->size()))
+			{
+				return false;
+			}
+			view.data = decompressed->data();
+			view.size = decompressed->size();
+			view.owner = decompressed;
+		}
+
+		packageReads++;
+		bytesRead += view.size;
+		return true;
+	}
+
+	static bool ReadLooseFile(const std::string& fileName, std::vector<uint8_t>& data)
+	{
+		fileOpens++;
+		ifstream file(fileName, ios::binary | ios::ate);
+		if (!file.is_open())
+		{
+			return false;
+		}
+		const size_t dataSize = (size_t)file.tellg();
+		file.seekg(0, file.beg);
+		data.resize(dataSize);
+		file.read((char*)data.data(), dataSize);
+		file.close();
+		bytesRead += dataSize;
+		return true;
+	}
+
+	bool CreatePackage(const std::string& packageFileName, const std::vector<std::string>& files, const std::string& baseDirectory, bool compress)
+	{
+		ofstream file(packageFileName, ios::binary | ios::trunc);
+		if (!file.is_open())
+		{
+			return false;
+		}
+
+		std::string base = NormalizePath(baseDirectory);
+		if (!base.empty())
+		{
+			base += '/';
+		}
+
+		PackageHeader header = {};
+		header.magic = PACKAGE_MAGIC;
+		header.version = PACKAGE_VERSION;
+		file.write((const char*)&header, sizeof(header));
+		uint64_t offset = sizeof(header);
+
+		std::vector<PackageEntry> entries;
+		std::string names;
+		std::unordered_set<std::string> paths;
+		std::vector<uint8_t> data;
+		std::vector<uint8_t> compressed;
+		static const uint8_t padding[PACKAGE_ALIGNMENT] = {};
+
+		for (auto& x : files)
+		{
+			std::string path = NormalizePath(x);
+			if (path.compare(0, base.length(), base) == 0)
+			{
+				path = path.substr(base.length());
+			}
+			if (!paths.insert(path).second)
+			{
+				continue; // the same file is only stored once
+			}
+
+			if (!ReadLooseFile(x, data))
+			{
+				wiHelper::messageBox("File not found: " + x);
+				file.close();
+				std::remove(packageFileName.c_str());
+				return false;
+			}
+
+			PackageEntry entry = {};
+			entry.pathHash = HashPath(path);
+			entry.size = data.size();
+			entry.nameOffset = names.length();
+			entry.nameLength = path.length();
+			names += path;
+
+			const uint8_t* fileData = data.data();
+			size_t fileSize = data.size();
+			if (compress && !data.empty())
+			{
+				compressed.resize(wiCompression::CompressBound(data.size()));
+				const size_t compressedSize = wiCompression::Compress(data.data(), data.size(), compressed.data(), data.size() - 1);
+				if (compressedSize > 0)
+				{
+					entry.compressedSize = compressedSize;
+					fileData = compressed.data();
+					fileSize = compressedSize;
+				}
+			}
+
+			const uint64_t alignedOffset = (offset + PACKAGE_ALIGNMENT - 1) / PACKAGE_ALIGNMENT * PACKAGE_ALIGNMENT;
+			file.write((const char*)padding, (streamsize)(alignedOffset - offset));
+			entry.offset = alignedOffset;
+			file.write((const char*)fileData, (streamsize)fileSize);
+			offset = alignedOffset + fileSize;
+
+			entries.push_back(entry);
+		}
+
+		std::sort(entries.begin(), entries.end(), [](const PackageEntry& a, const PackageEntry& b) {
+			return a.pathHash < b.pathHash;
+		});
+
+		const uint64_t tableOffset = (offset + PACKAGE_ALIGNMENT - 1) / PACKAGE_ALIGNMENT * PACKAGE_ALIGNMENT;
+		file.write((const char*)padding, (streamsize)(tableOffset - offset));
+		file.write((const char*)entries.data(), (streamsize)(sizeof(PackageEntry) * entries.size()));
+		file.write(names.data(), (streamsize)names.length());
+
+		header.fileCount = entries.size();
+		header.tableOffset = tableOffset;
+		header.namesOffset = tableOffset + sizeof(PackageEntry) * entries.size();
+		header.namesSize = names.length();
+		file.seekp(0);
+		file.write((const char*)&header, sizeof(header));
+		file.close();
+
+		if (file.fail())
+		{
+			std::remove(packageFileName.c_str());
+			return false;
+		}
+		return true;
+	}
+
+	bool Mount(const std::string& packageFileName, const std::string& mountPoint)
+	{
+		std::shared_ptr<Package> package = std::make_shared<Package>();
+		package->fileName = packageFileName;
+		package->mountPoint = NormalizePath(mountPoint);
+		if (!package->mountPoint.empty())
+		{
+			package->mountPoint += '/';
+		}
+
+		fileOpens++;
+		if (!wiHelper::MapFile(packageFileName, package->file))
+		{
+			return false;
+		}
+
+		const uint8_t* data = package->file.data;
+		const size_t size = package->file.size;
+		const PackageHeader* header = (const PackageHeader*)data;
+		if (size < sizeof(PackageHeader) ||
+			header->magic != PACKAGE_MAGIC ||
+			header->version != PACKAGE_VERSION ||
+			header->tableOffset > size ||
+			header->fileCount > (size - header->tableOffset) / sizeof(PackageEntry) ||
+			header->namesOffset > size ||
+			header->namesSize > size - header->namesOffset)
+		{
+			wiHelper::messageBox("The package is invalid: " + packageFileName, "Error!");
+			return false;
+		}
+		package->entries = (const PackageEntry*)(data + header->tableOffset);
+		package->entryCount = (size_t)header->fileCount;
+		package->names = (const char*)(data + header->namesOffset);
+		for (size_t i = 0; i < package->entryCount; ++i)
+		{
+			const PackageEntry& entry = package->entries[i];
+			const uint64_t storedSize = entry.compressedSize > 0 ? entry.compressedSize : entry.size;
+			if (entry.offset > size || storedSize > size - entry.offset || entry.nameOffset + entry.nameLength > header->namesSize)
+			{
+				wiHelper::messageBox("The package is corrupted: " + packageFileName, "Error!");
+				return false;
+			}
+		}
+
+		Unmount(packageFileName);
+
+		std::unique_lock<std::shared_timed_mutex> lock(locker);
+		packages.push_back(package);
+		return true;
+	}
+
+	void Unmount(const std::string& packageFileName)
+	{
+		std::unique_lock<std::shared_timed_mutex> lock(locker);
+		packages.erase(std::remove_if(packages.begin(), packages.end(), [&](const std::shared_ptr<Package>& x) {
+			return x->fileName == packageFileName;
+		}), packages.end());
+	}
+
+	void UnmountAll()
+	{
+		std::unique_lock<std::shared_timed_mutex> lock(locker);
+		packages.clear();
+	}
+
+	void SetLooseFileOverride(bool value)
+	{
+		looseFileOverride.store(value);
+	}
+	bool IsLooseFileOverride()
+	{
+		return looseFileOverride.load();
+	}
+
+	bool FileExists(const std::string& fileName)
+	{
+		std::shared_ptr<Package> package;
+		const PackageEntry* entry = nullptr;
+		if (FindPackageFile(fileName, package, entry))
+		{
+			return true;
+		}
+		fileOpens++;
+		return wiHelper::FileExists(fileName);
+	}
+
+	bool ReadFile(const std::string& fileName, std::vector<uint8_t>& data)
+	{
+		FileView view;
+		if (OpenPackageFile(fileName, view))
+		{
+			data.assign(view.data, view.data + view.size);
+			return true;
+		}
+		if (ReadLooseFile(fileName, data))
+		{
+			return true;
+		}
+		stringstream ss("");
+		ss << "File not found: " << fileName;
+		wiHelper::messageBox(ss.str());
+		return false;
+	}
+
+	bool OpenFile(const std::string& fileName, FileView& view)
+	{
+		if (OpenPackageFile(fileName, view))
+		{
+			return true;
+		}
+
+		fileOpens++;
+		std::shared_ptr<wiHelper::MappedFile> mappedFile(new wiHelper::MappedFile, [](wiHelper::MappedFile* file) {
+			wiHelper::UnmapFile(*file);
+			delete file;
+		});
+		if (wiHelper::MapFile(fileName, *mappedFile))
+		{
+			view.data = mappedFile->data;
+			view.size = mappedFile->size;
+			view.owner = mappedFile;
+			bytesRead += view.size;
+			return true;
+		}
+
+		// The file can't be mapped (for example it is empty), so it is read into memory:
+		std::shared_ptr<std::vector<uint8_t>> data = std::make_shared<std::vector<uint8_t>>();
+		if (ReadLooseFile(fileName, *data))
+		{
+			view.data = data->data();
+			view.size = data->size();
+			view.owner = data;
+			return true;
+		}
+		return false;
+	}
+
+	IOStatistics GetIOStatistics()
+	{
+		IOStatistics statistics;
+		statistics.fileOpens = fileOpens.load();
+		statistics.packageReads = packageReads.load();
+		statistics.bytesRead = bytesRead.load();
+		return statistics;
+	}
+	void ResetIOStatistics()
+	{
+		fileOpens.store(0);
+		packageReads.store(0);
+		bytesRead.store(0);
+	}
+}
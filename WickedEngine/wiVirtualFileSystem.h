@@ -0,0 +1,57 @@
+#pragma once
+#include "CommonInclude.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+
+// Virtual file system: files are read from packages that are mounted with file mapping, or from disk
+//	A package (.wipak) is a single file that contains many files, with aligned (optionally compressed) file data
+//	and a table of the file paths that is sorted by path hash, so files are found without opening anything
+//	Paths are case insensitive, both slash types are accepted, absolute paths inside the working directory are the same as relative paths
+namespace wiVirtualFileSystem
+{
+	// Create a package from files
+	//	files			: the files to store in the package
+	//	baseDirectory	: the files are stored relative to this, the package should be mounted to this directory
+	//	compress		: compress the files that get smaller by compression
+	bool CreatePackage(const std::string& packageFileName, const std::vector<std::string>& files, const std::string& baseDirectory = "", bool compress = true);
+
+	// Mount a package, its files will be accessible relative to the mountPoint directory
+	//	Packages that are mounted later take precedence over the earlier ones
+	bool Mount(const std::string& packageFileName, const std::string& mountPoint = "");
+	// Unmount a package. Files that are still open from it remain valid until they are released
+	void Unmount(const std::string& packageFileName);
+	void UnmountAll();
+
+	// Loose file override: files that exist on disk are read from disk instead of the mounted packages (for development)
+	//	It is disabled by default, because it needs to look for every file on disk
+	void SetLooseFileOverride(bool value);
+	bool IsLooseFileOverride();
+
+	// Returns true if the file is in a mounted package or on disk
+	bool FileExists(const std::string& fileName);
+
+	// Read a whole file into memory, like wiHelper::readByteData()
+	bool ReadFile(const std::string& fileName, std::vector<uint8_t>& data);
+
+	// Read-only file data
+	struct FileView
+	{
+		const uint8_t* data = nullptr;
+		size_t size = 0;
+		std::shared_ptr<void> owner; // keeps the data alive (the mounted package, the file mapping or the decompressed data)
+	};
+	// Open a file for reading without copying it when possible: files that are stored uncompressed in a mounted package are
+	//	pointing into the package mapping, files on disk are memory mapped
+	bool OpenFile(const std::string& fileName, FileView& view);
+
+	struct IOStatistics
+	{
+		uint64_t fileOpens = 0;		// files that were opened on disk (including packages and the checks of loose files)
+		uint64_t packageReads = 0;	// files that were read from mounted packages
+		uint64_t bytesRead = 0;		// the size of all files that were read
+	};
+	IOStatistics GetIOStatistics();
+	void ResetIOStatistics();
+}